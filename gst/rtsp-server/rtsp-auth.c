@@ -49,6 +49,7 @@
 #include <string.h>
 
 #include "rtsp-auth.h"
+#include "rtsp-server-internal.h"
 
 #define GST_RTSP_AUTH_GET_PRIVATE(obj)  \
    (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTSP_AUTH, GstRTSPAuthPrivate))
@@ -905,6 +906,28 @@ accept_certificate_cb (GTlsConnection * conn, GTlsCertificate * peer_cert,
   return ret;
 }
 
+/* check if the connect check of @auth can set up TLS on a new connection. A
+ * subclass can set it up in its own check. */
+gboolean
+gst_rtsp_auth_connect_uses_tls (GstRTSPAuth * auth)
+{
+  GstRTSPAuthPrivate *priv;
+  gboolean res;
+
+  g_return_val_if_fail (GST_IS_RTSP_AUTH (auth), TRUE);
+
+  priv = auth->priv;
+
+  if (GST_RTSP_AUTH_GET_CLASS (auth)->check != default_check)
+    return TRUE;
+
+  g_mutex_lock (&priv->lock);
+  res = priv->certificate != NULL || priv->mode != G_TLS_AUTHENTICATION_NONE;
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
 /* new connection */
 static gboolean
 check_connect (GstRTSPAuth * auth, GstRTSPContext * ctx, const gchar * check)
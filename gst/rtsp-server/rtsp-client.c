@@ -50,6 +50,14 @@
 #include "rtsp-client.h"
 #include "rtsp-sdp.h"
 #include "rtsp-params.h"
+#include "rtsp-server-internal.h"
+
+#ifdef G_OS_UNIX
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
 
 #define GST_RTSP_CLIENT_GET_PRIVATE(obj)  \
    (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTSP_CLIENT, GstRTSPClientPrivate))
@@ -73,6 +81,8 @@ struct _GstRTSPClientPrivate
   GstRTSPClientSendFunc send_func;      /* protected by send_lock */
   gpointer send_data;           /* protected by send_lock */
   GDestroyNotify send_notify;   /* protected by send_lock */
+  gint watch_pending;           /* messages queued in the watch, atomic */
+  gboolean plain_connection;    /* TLS is not set up on the connection */
 
   GstRTSPSessionPool *session_pool;
   gulong session_removed_id;
@@ -90,9 +100,26 @@ struct _GstRTSPClientPrivate
   guint sessions_cookie;
 
   gboolean drop_backlog;
+  guint send_queue_size;
+  GstRTSPSendQueuePolicy send_queue_policy;
 
   guint rtsp_ctrl_timeout_id;
   guint rtsp_ctrl_timeout_cnt;
+
+  /* interleaved data received for one channel that is not pushed yet, only
+   * used from the context of the watch */
+  GstBufferList *recv_list;
+  GstRTSPStreamTransport *recv_trans;
+  guint8 recv_channel;
+  GSource *recv_source;
+
+  /* a request that waits for its media to preroll and the messages received
+   * after it, only used from the context of the watch */
+  GstRTSPMessage *parked_request;
+  GQueue parked_messages;
+  gboolean can_park;
+  gboolean park;
+  gboolean resuming;
 };
 
 static GMutex tunnels_lock;
@@ -105,6 +132,21 @@ static GHashTable *tunnels;     /* protected by tunnels_lock */
 #define DEFAULT_SESSION_POOL            NULL
 #define DEFAULT_MOUNT_POINTS            NULL
 #define DEFAULT_DROP_BACKLOG            TRUE
+#define DEFAULT_SEND_QUEUE_SIZE         0
+#define DEFAULT_SEND_QUEUE_POLICY       GST_RTSP_SEND_QUEUE_POLICY_DROP_OLDEST
+
+/* maximum number of memories in a buffer we write without copying */
+#define DIRECT_SEND_MAX_MEMORIES        16
+
+/* maximum number of received packets that are pushed in one go */
+#define RECV_BATCH_MAX                  64
+
+/* maximum number of messages that wait behind a parked request */
+#define PARKED_MESSAGES_MAX             8
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 
 #define RTSP_CTRL_CB_INTERVAL           1
 #define RTSP_CTRL_TIMEOUT_VALUE         60
@@ -115,6 +157,8 @@ enum
   PROP_SESSION_POOL,
   PROP_MOUNT_POINTS,
   PROP_DROP_BACKLOG,
+  PROP_SEND_QUEUE_SIZE,
+  PROP_SEND_QUEUE_POLICY,
   PROP_LAST
 };
 
@@ -174,10 +218,13 @@ static gchar *default_make_path_from_uri (GstRTSPClient * client,
     const GstRTSPUrl * uri);
 static void client_session_removed (GstRTSPSessionPool * pool,
     GstRTSPSession * session, GstRTSPClient * client);
+static void flush_recv_data (GstRTSPClient * client);
 static GstRTSPStatusCode default_pre_signal_handler (GstRTSPClient * client,
     GstRTSPContext * ctx);
 static gboolean pre_signal_accumulator (GSignalInvocationHint * ihint,
     GValue * return_accu, const GValue * handler_return, gpointer data);
+static gboolean do_send_message (GstRTSPClient * client,
+    GstRTSPMessage * message, gboolean close, gpointer user_data);
 
 G_DEFINE_TYPE (GstRTSPClient, gst_rtsp_client, G_TYPE_OBJECT);
 
@@ -230,6 +277,36 @@ gst_rtsp_client_class_init (GstRTSPClientClass * klass)
           "Drop data when the backlog queue is full",
           DEFAULT_DROP_BACKLOG, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRTSPClient:send-queue-size:
+   *
+   * The maximum number of packets to queue for each interleaved transport
+   * when the connection can't keep up. Queued packets are sent from the
+   * context of the client, so that a slow client never blocks the streaming
+   * thread of a shared media. 0 disables the queue and uses the
+   * #GstRTSPClient:drop-backlog behaviour instead.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_SEND_QUEUE_SIZE,
+      g_param_spec_uint ("send-queue-size", "Send Queue Size",
+          "Maximum number of packets queued per interleaved transport "
+          "(0 = disabled)", 0, G_MAXUINT, DEFAULT_SEND_QUEUE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRTSPClient:send-queue-policy:
+   *
+   * What to do when the send queue of an interleaved transport is full.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_SEND_QUEUE_POLICY,
+      g_param_spec_enum ("send-queue-policy", "Send Queue Policy",
+          "What to do when the send queue is full",
+          GST_TYPE_RTSP_SEND_QUEUE_POLICY, DEFAULT_SEND_QUEUE_POLICY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_rtsp_client_signals[SIGNAL_CLOSED] =
       g_signal_new ("closed", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST,
       G_STRUCT_OFFSET (GstRTSPClientClass, closed), NULL, NULL,
@@ -525,9 +602,12 @@ gst_rtsp_client_init (GstRTSPClient * client)
   g_mutex_init (&priv->watch_lock);
   priv->close_seq = 0;
   priv->drop_backlog = DEFAULT_DROP_BACKLOG;
+  priv->send_queue_size = DEFAULT_SEND_QUEUE_SIZE;
+  priv->send_queue_policy = DEFAULT_SEND_QUEUE_POLICY;
   priv->transports =
       g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
       g_object_unref);
+  g_queue_init (&priv->parked_messages);
 }
 
 static GstRTSPFilterResult
@@ -690,6 +770,11 @@ gst_rtsp_client_finalize (GObject * obj)
 
   g_hash_table_unref (priv->transports);
 
+  if (priv->recv_list)
+    gst_buffer_list_unref (priv->recv_list);
+  if (priv->recv_trans)
+    g_object_unref (priv->recv_trans);
+
   if (priv->connection)
     gst_rtsp_connection_free (priv->connection);
   if (priv->session_pool) {
@@ -702,6 +787,12 @@ gst_rtsp_client_finalize (GObject * obj)
   if (priv->thread_pool)
     g_object_unref (priv->thread_pool);
 
+  if (priv->parked_request)
+    gst_rtsp_message_free (priv->parked_request);
+  g_queue_foreach (&priv->parked_messages, (GFunc) gst_rtsp_message_free,
+      NULL);
+  g_queue_clear (&priv->parked_messages);
+
   clean_cached_media (client, TRUE);
 
   g_free (priv->server_ip);
@@ -729,6 +820,12 @@ gst_rtsp_client_get_property (GObject * object, guint propid,
     case PROP_DROP_BACKLOG:
       g_value_set_boolean (value, priv->drop_backlog);
       break;
+    case PROP_SEND_QUEUE_SIZE:
+      g_value_set_uint (value, priv->send_queue_size);
+      break;
+    case PROP_SEND_QUEUE_POLICY:
+      g_value_set_enum (value, priv->send_queue_policy);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, propid, pspec);
   }
@@ -753,6 +850,16 @@ gst_rtsp_client_set_property (GObject * object, guint propid,
       priv->drop_backlog = g_value_get_boolean (value);
       g_mutex_unlock (&priv->lock);
       break;
+    case PROP_SEND_QUEUE_SIZE:
+      g_mutex_lock (&priv->lock);
+      priv->send_queue_size = g_value_get_uint (value);
+      g_mutex_unlock (&priv->lock);
+      break;
+    case PROP_SEND_QUEUE_POLICY:
+      g_mutex_lock (&priv->lock);
+      priv->send_queue_policy = g_value_get_enum (value);
+      g_mutex_unlock (&priv->lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, propid, pspec);
   }
@@ -857,9 +964,39 @@ paths_are_equal (const gchar * path1, const gchar * path2, gint len2)
   return TRUE;
 }
 
+static gboolean resume_parked_request (GstRTSPClient * client);
+
+/* called when a media that a parked request waits for is done preparing */
+static void
+media_prepared (GstRTSPMedia * media, GstRTSPMediaStatus status,
+    GstRTSPClient * client)
+{
+  GstRTSPClientPrivate *priv = client->priv;
+  GSource *source;
+
+  GST_INFO ("client %p: media %p is done preparing, status %d", client, media,
+      status);
+
+  /* continue with the request from the context of the client */
+  g_mutex_lock (&priv->lock);
+  if (priv->watch_context) {
+    source = g_idle_source_new ();
+    g_source_set_callback (source, (GSourceFunc) resume_parked_request,
+        g_object_ref (client), (GDestroyNotify) g_object_unref);
+    g_source_attach (source, priv->watch_context);
+    g_source_unref (source);
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
 /* this function is called to initially find the media for the DESCRIBE request
  * but is cached for when the same client (without breaking the connection) is
- * doing a setup for the exact same url. */
+ * doing a setup for the exact same url.
+ *
+ * When the client runs from a watch, the request is parked instead of waiting
+ * for a new media to preroll. %NULL is returned without sending a response,
+ * priv->park is set so that the caller can tell this apart from an error,
+ * and the request is handled again when the media is prepared. */
 static GstRTSPMedia *
 find_media (GstRTSPClient * client, GstRTSPContext * ctx, gchar * path,
     gint * matched)
@@ -892,6 +1029,11 @@ find_media (GstRTSPClient * client, GstRTSPContext * ctx, gchar * path,
      * media for uri */
     clean_cached_media (client, TRUE);
 
+    /* the warm pool of the factory prepares media in the thread pool of the
+     * first client unless it was given one, this is a no-op after that */
+    gst_rtsp_media_factory_set_fallback_thread_pool (factory,
+        priv->thread_pool);
+
     /* prepare the media and add it to the pipeline */
     if (!(media = gst_rtsp_media_factory_construct (factory, ctx->uri)))
       goto no_media;
@@ -908,7 +1050,17 @@ find_media (GstRTSPClient * client, GstRTSPContext * ctx, gchar * path,
         goto no_thread;
 
       /* prepare the media */
-      if (!gst_rtsp_media_prepare (media, thread))
+      if (priv->can_park) {
+        GstRTSPMediaStatus status;
+
+        status = gst_rtsp_media_prepare_async (media, thread,
+            (GstRTSPMediaPrepareFunc) media_prepared, g_object_ref (client),
+            g_object_unref);
+        if (status == GST_RTSP_MEDIA_STATUS_ERROR)
+          goto no_prepare;
+        if (status == GST_RTSP_MEDIA_STATUS_PREPARING)
+          goto park;
+      } else if (!gst_rtsp_media_prepare (media, thread))
         goto no_prepare;
     }
 
@@ -920,6 +1072,15 @@ find_media (GstRTSPClient * client, GstRTSPContext * ctx, gchar * path,
     media = priv->media;
     ctx->media = media;
     GST_INFO ("reusing cached media %p for path %s", media, priv->path);
+
+    /* check if the media we were waiting for prerolled */
+    if (priv->resuming) {
+      GstRTSPMediaStatus status = gst_rtsp_media_get_status (media);
+
+      if (status != GST_RTSP_MEDIA_STATUS_PREPARED &&
+          status != GST_RTSP_MEDIA_STATUS_SUSPENDED)
+        goto preroll_failed;
+    }
   }
 
   g_object_unref (factory);
@@ -930,6 +1091,20 @@ find_media (GstRTSPClient * client, GstRTSPContext * ctx, gchar * path,
 
   return media;
 
+park:
+  {
+    GST_INFO ("client %p: parking request until media %p is prepared", client,
+        media);
+    /* keep track of the media so that we find it again when resuming */
+    priv->path = g_strndup (path, path_len);
+    priv->media = media;
+    priv->park = TRUE;
+    ctx->media = NULL;
+    g_object_unref (factory);
+    ctx->factory = NULL;
+    return NULL;
+  }
+
   /* ERRORS */
 no_factory:
   {
@@ -982,37 +1157,264 @@ no_prepare:
     ctx->factory = NULL;
     return NULL;
   }
+preroll_failed:
+  {
+    GST_ERROR ("client %p: media %p did not preroll", client, media);
+    send_generic_response (client, GST_RTSP_STS_SERVICE_UNAVAILABLE, ctx);
+    clean_cached_media (client, TRUE);
+    ctx->media = NULL;
+    g_object_unref (factory);
+    ctx->factory = NULL;
+    return NULL;
+  }
 }
 
 static gboolean
-do_send_data (GstBuffer * buffer, guint8 channel, GstRTSPClient * client)
+close_client_idle (GstRTSPClient * client)
+{
+  gst_rtsp_client_close (client);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* close the connection of @client from its own context */
+static void
+close_client_async (GstRTSPClient * client)
 {
   GstRTSPClientPrivate *priv = client->priv;
-  GstRTSPMessage message = { 0 };
+  GSource *source;
+
+  g_mutex_lock (&priv->lock);
+  if (priv->watch_context) {
+    source = g_idle_source_new ();
+    g_source_set_callback (source, (GSourceFunc) close_client_idle,
+        g_object_ref (client), (GDestroyNotify) g_object_unref);
+    g_source_attach (source, priv->watch_context);
+    g_source_unref (source);
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
+/* called with send_lock. Write the interleaved header and the memory of
+ * @buffer to the socket with one sendmsg() call, without copying the data into
+ * a message first. This is only possible when the watch has nothing queued,
+ * because we would otherwise overtake it, and when the data doesn't need to be
+ * encoded, as is the case for TLS and tunneled connections. TLS is only ruled
+ * out when gst_rtsp_client_set_connection() knew it was not set up.
+ *
+ * Returns GST_RTSP_EINTR when nothing was written and the buffer should be
+ * sent the regular way. */
+static GstRTSPResult
+send_data_direct (GstRTSPClient * client, GstBuffer * buffer, guint8 channel)
+{
+#ifdef G_OS_UNIX
+  GstRTSPClientPrivate *priv = client->priv;
+  struct iovec iov[DIRECT_SEND_MAX_MEMORIES + 1];
+  GstMapInfo maps[DIRECT_SEND_MAX_MEMORIES];
+  struct msghdr msg;
   GstRTSPResult res = GST_RTSP_OK;
+  GSocket *socket;
+  guint8 header[4];
+  gsize size;
+  gssize written;
+  guint i, n_mem;
+
+  if (priv->send_func != do_send_message ||
+      g_atomic_int_get (&priv->watch_pending) != 0 ||
+      !priv->plain_connection ||
+      gst_rtsp_connection_is_tunneled (priv->connection))
+    return GST_RTSP_EINTR;
+
+  n_mem = gst_buffer_n_memory (buffer);
+  size = gst_buffer_get_size (buffer);
+  if (n_mem == 0 || n_mem > DIRECT_SEND_MAX_MEMORIES || size > G_MAXUINT16)
+    return GST_RTSP_EINTR;
+
+  header[0] = '$';
+  header[1] = channel;
+  GST_WRITE_UINT16_BE (&header[2], size);
+  iov[0].iov_base = header;
+  iov[0].iov_len = sizeof (header);
+
+  for (i = 0; i < n_mem; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+
+    if (!gst_memory_map (mem, &maps[i], GST_MAP_READ)) {
+      n_mem = i;
+      res = GST_RTSP_EINTR;
+      goto done;
+    }
+    iov[i + 1].iov_base = maps[i].data;
+    iov[i + 1].iov_len = maps[i].size;
+  }
+
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = n_mem + 1;
+
+  socket = gst_rtsp_connection_get_write_socket (priv->connection);
+  do {
+    written = sendmsg (g_socket_get_fd (socket), &msg,
+        MSG_DONTWAIT | MSG_NOSIGNAL);
+  } while (written < 0 && errno == EINTR);
+
+  if (written < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      /* nothing was written, let the watch queue the message */
+      res = GST_RTSP_EINTR;
+    } else {
+      GST_DEBUG_OBJECT (client, "failed to send data: %s", g_strerror (errno));
+      res = GST_RTSP_ESYS;
+    }
+    goto done;
+  }
+
+  if ((gsize) written < size + sizeof (header)) {
+    GstRTSPWatch *watch = priv->send_data;
+    gsize skip, rest_size, offset = 0;
+    guint8 *rest;
+    guint id = 0;
+
+    /* the socket is full, copy what is left and let the watch write it out
+     * when there is room again */
+    skip = written;
+    rest_size = size + sizeof (header) - skip;
+    rest = g_malloc (rest_size);
+    for (i = 0; i < n_mem + 1; i++) {
+      gsize len = iov[i].iov_len;
+
+      if (skip >= len) {
+        skip -= len;
+        continue;
+      }
+      memcpy (rest + offset, (guint8 *) iov[i].iov_base + skip, len - skip);
+      offset += len - skip;
+      skip = 0;
+    }
+
+    res = gst_rtsp_watch_write_data (watch, rest, rest_size, &id);
+    if (res == GST_RTSP_OK) {
+      if (id != 0)
+        g_atomic_int_inc (&priv->watch_pending);
+    } else {
+      /* we wrote half a message, the stream is broken now */
+      GST_ERROR_OBJECT (client, "could not queue partial data: %d", res);
+      close_client_async (client);
+    }
+  }
+
+done:
+  for (i = 0; i < n_mem; i++)
+    gst_memory_unmap (gst_buffer_peek_memory (buffer, i), &maps[i]);
+
+  return res;
+#else
+  return GST_RTSP_EINTR;
+#endif
+}
+
+/* called with send_lock */
+static gboolean
+send_data_unlocked (GstRTSPClient * client, GstBuffer * buffer,
+    guint8 channel)
+{
+  GstRTSPClientPrivate *priv = client->priv;
+  GstRTSPMessage message = { 0 };
+  GstRTSPResult res;
+  gboolean ret = TRUE;
   GstMapInfo map_info;
   guint8 *data;
   guint usize;
 
-  gst_rtsp_message_init_data (&message, channel);
+  res = send_data_direct (client, buffer, channel);
+  if (res != GST_RTSP_EINTR)
+    return res == GST_RTSP_OK;
 
-  /* FIXME, need some sort of iovec RTSPMessage here */
   if (!gst_buffer_map (buffer, &map_info, GST_MAP_READ))
     return FALSE;
 
+  gst_rtsp_message_init_data (&message, channel);
   gst_rtsp_message_take_body (&message, map_info.data, map_info.size);
 
-  g_mutex_lock (&priv->send_lock);
   if (priv->send_func)
-    res = priv->send_func (client, &message, FALSE, priv->send_data);
-  g_mutex_unlock (&priv->send_lock);
+    ret = priv->send_func (client, &message, FALSE, priv->send_data);
 
   gst_rtsp_message_steal_body (&message, &data, &usize);
   gst_buffer_unmap (buffer, &map_info);
 
   gst_rtsp_message_unset (&message);
 
-  return res == GST_RTSP_OK;
+  return ret;
+}
+
+static gboolean
+do_send_data (GstBuffer * buffer, guint8 channel, GstRTSPClient * client)
+{
+  GstRTSPClientPrivate *priv = client->priv;
+  gboolean res;
+
+  g_mutex_lock (&priv->send_lock);
+  res = send_data_unlocked (client, buffer, channel);
+  g_mutex_unlock (&priv->send_lock);
+
+  return res;
+}
+
+/* send all buffers of @buffer_list on @channel, taking the send lock only once
+ * for the whole list so that packets of one batch are not interleaved with
+ * data from other streams */
+static gboolean
+do_send_data_list (GstBufferList * buffer_list, guint8 channel,
+    GstRTSPClient * client)
+{
+  GstRTSPClientPrivate *priv = client->priv;
+  gboolean res = TRUE;
+  guint i, len;
+
+  len = gst_buffer_list_length (buffer_list);
+
+  g_mutex_lock (&priv->send_lock);
+  for (i = 0; i < len && res; i++)
+    res = send_data_unlocked (client, gst_buffer_list_get (buffer_list, i),
+        channel);
+  g_mutex_unlock (&priv->send_lock);
+
+  return res;
+}
+
+/* called from the streaming thread when the send queue of one of our
+ * transports overflowed, close the connection from our own context */
+static void
+do_send_queue_overflow (GstRTSPStreamTransport * trans,
+    GstRTSPClient * client)
+{
+  GST_WARNING_OBJECT (client, "send queue of transport %p overflowed, "
+      "closing connection", trans);
+
+  close_client_async (client);
+}
+
+/* called from our context when the watch wrote out a message and so has room
+ * for more data, send what our transports have queued */
+static void
+flush_send_queues (GstRTSPClient * client)
+{
+  GstRTSPClientPrivate *priv = client->priv;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_hash_table_iter_init (&iter, priv->transports);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    GstRTSPStreamTransport *trans = value;
+    const GstRTSPTransport *tr;
+
+    /* transports are in the table for the RTP and the RTCP channel */
+    tr = gst_rtsp_stream_transport_get_transport (trans);
+    if (GPOINTER_TO_INT (key) != tr->interleaved.min)
+      continue;
+
+    gst_rtsp_stream_transport_flush_send_queue (trans);
+  }
 }
 
 /**
@@ -1031,6 +1433,8 @@ gst_rtsp_client_close (GstRTSPClient * client)
 
   GST_DEBUG ("client %p: closing connection", client);
 
+  flush_recv_data (client);
+
   if (priv->connection) {
     if ((tunnelid = gst_rtsp_connection_get_tunnelid (priv->connection))) {
       g_mutex_lock (&tunnels_lock);
@@ -2253,9 +2657,12 @@ handle_setup_request (GstRTSPClient * client, GstRTSPContext * ctx)
     else
       goto media_not_found;
   }
-  /* no media, not found then */
-  if (media == NULL)
+  /* no media, not found then, unless the request waits for it */
+  if (media == NULL) {
+    if (priv->park)
+      goto parked;
     goto media_not_found_no_reply;
+  }
 
   if (path[matched] == '\0') {
     if (gst_rtsp_media_n_streams (media) == 1) {
@@ -2363,6 +2770,16 @@ handle_setup_request (GstRTSPClient * client, GstRTSPContext * ctx)
     gst_rtsp_stream_transport_set_callbacks (trans,
         (GstRTSPSendFunc) do_send_data,
         (GstRTSPSendFunc) do_send_data, client, NULL);
+    gst_rtsp_stream_transport_set_list_callbacks (trans,
+        (GstRTSPSendListFunc) do_send_data_list,
+        (GstRTSPSendListFunc) do_send_data_list, client, NULL);
+
+    if (priv->send_queue_size > 0) {
+      gst_rtsp_stream_transport_set_send_queue (trans, priv->send_queue_size,
+          priv->send_queue_policy);
+      gst_rtsp_stream_transport_set_overflow_callback (trans,
+          (GstRTSPOverflowFunc) do_send_queue_overflow, client, NULL);
+    }
 
     g_hash_table_insert (priv->transports,
         GINT_TO_POINTER (ct->interleaved.min), trans);
@@ -2427,6 +2844,14 @@ no_pool:
     send_generic_response (client, GST_RTSP_STS_SESSION_NOT_FOUND, ctx);
     goto cleanup_path;
   }
+parked:
+  {
+    GST_DEBUG ("client %p: SETUP of '%s' waits for its media", client, path);
+    if (session)
+      g_object_unref (session);
+    g_free (path);
+    return TRUE;
+  }
 media_not_found_no_reply:
   {
     GST_ERROR ("client %p: media '%s' not found", client, path);
@@ -2597,10 +3022,14 @@ handle_describe_request (GstRTSPClient * client, GstRTSPContext * ctx)
   if (!ctx->uri)
     goto no_uri;
 
-  g_signal_emit (client, gst_rtsp_client_signals[SIGNAL_PRE_DESCRIBE_REQUEST],
-      0, ctx, &sig_result);
-  if (sig_result != GST_RTSP_STS_OK) {
-    goto sig_failed;
+  /* a resumed request was checked before it was parked */
+  if (!priv->resuming) {
+    g_signal_emit (client,
+        gst_rtsp_client_signals[SIGNAL_PRE_DESCRIBE_REQUEST], 0, ctx,
+        &sig_result);
+    if (sig_result != GST_RTSP_STS_OK) {
+      goto sig_failed;
+    }
   }
 
   /* check what kind of format is accepted, we don't really do anything with it
@@ -2625,8 +3054,11 @@ handle_describe_request (GstRTSPClient * client, GstRTSPContext * ctx)
     goto no_path;
 
   /* find the media object for the uri */
-  if (!(media = find_media (client, ctx, path, NULL)))
+  if (!(media = find_media (client, ctx, path, NULL))) {
+    if (priv->park)
+      goto parked;
     goto no_media;
+  }
 
   if (!(gst_rtsp_media_get_transport_mode (media) &
           GST_RTSP_TRANSPORT_MODE_PLAY))
@@ -2691,6 +3123,13 @@ no_path:
     send_generic_response (client, GST_RTSP_STS_NOT_FOUND, ctx);
     return FALSE;
   }
+parked:
+  {
+    GST_DEBUG ("client %p: DESCRIBE of '%s' waits for its media", client,
+        path);
+    g_free (path);
+    return TRUE;
+  }
 no_media:
   {
     GST_ERROR ("client %p: no media", client);
@@ -2802,8 +3241,11 @@ handle_announce_request (GstRTSPClient * client, GstRTSPContext * ctx)
     goto no_path;
 
   /* find the media object for the uri */
-  if (!(media = find_media (client, ctx, path, NULL)))
+  if (!(media = find_media (client, ctx, path, NULL))) {
+    if (priv->park)
+      goto parked;
     goto no_media;
+  }
 
   ctx->media = media;
 
@@ -2875,6 +3317,14 @@ sdp_parse_failed:
     gst_sdp_message_free (sdp);
     return FALSE;
   }
+parked:
+  {
+    GST_DEBUG ("client %p: ANNOUNCE of '%s' waits for its media", client,
+        path);
+    g_free (path);
+    gst_sdp_message_free (sdp);
+    return TRUE;
+  }
 no_media:
   {
     GST_ERROR ("client %p: no media", client);
@@ -3504,6 +3954,57 @@ session_not_found:
   }
 }
 
+/* push the packets we collected in handle_data() */
+static void
+flush_recv_data (GstRTSPClient * client)
+{
+  GstRTSPClientPrivate *priv = client->priv;
+  GstRTSPStreamTransport *trans;
+  GstBufferList *list;
+
+  if (priv->recv_source) {
+    g_source_destroy (priv->recv_source);
+    g_source_unref (priv->recv_source);
+    priv->recv_source = NULL;
+  }
+
+  if ((list = priv->recv_list) == NULL)
+    return;
+
+  trans = priv->recv_trans;
+  priv->recv_list = NULL;
+  priv->recv_trans = NULL;
+
+  GST_LOG_OBJECT (client, "pushing %u packets of channel %u",
+      gst_buffer_list_length (list), priv->recv_channel);
+  gst_rtsp_stream_transport_recv_data_list (trans, priv->recv_channel, list);
+  g_object_unref (trans);
+}
+
+/* called when the main loop is idle, pushes what is left when the socket has
+ * no complete message anymore */
+static gboolean
+flush_recv_data_idle (GstRTSPClient * client)
+{
+  flush_recv_data (client);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* make a buffer from the interleaved data of @message. The buffer takes over
+ * the body that the connection allocated for @message so the data is not
+ * copied again. The trailing \0 that GstRTSPConnection adds is left out. */
+static GstBuffer *
+make_recv_buffer (GstRTSPMessage * message)
+{
+  guint8 *data;
+  guint size;
+
+  gst_rtsp_message_steal_body (message, &data, &size);
+
+  return gst_buffer_new_wrapped (data, size - 1);
+}
+
 static void
 handle_data (GstRTSPClient * client, GstRTSPMessage * message)
 {
@@ -3524,23 +4025,52 @@ handle_data (GstRTSPClient * client, GstRTSPMessage * message)
   if (size < 2)
     goto invalid_length;
 
-  gst_rtsp_message_steal_body (message, &data, &size);
-
   /* Strip trailing \0 (which GstRTSPConnection adds) */
   --size;
 
-  buffer = gst_buffer_new_wrapped (data, size);
-
   trans =
       g_hash_table_lookup (priv->transports, GINT_TO_POINTER ((gint) channel));
-  if (trans) {
-    /* dispatch to the stream based on the channel number */
-    GST_LOG_OBJECT (client, "%u bytes of data on channel %u", size, channel);
+  if (trans == NULL)
+    goto unknown_channel;
+
+  GST_LOG_OBJECT (client, "%u bytes of data on channel %u", size, channel);
+  buffer = make_recv_buffer (message);
+
+  /* without a watch we don't know when the next message comes, dispatch to
+   * the stream based on the channel number right away */
+  if (priv->watch_context == NULL) {
     gst_rtsp_stream_transport_recv_data (trans, channel, buffer);
-  } else {
-    GST_DEBUG_OBJECT (client, "received %u bytes of data for "
-        "unknown channel %u", size, channel);
-    gst_buffer_unref (buffer);
+    return;
+  }
+
+  /* collect the packets for the same channel and push them when there is
+   * nothing more to read, so that a burst is pushed into the pipeline in one
+   * go. The watch handles one message per dispatch. */
+  if (priv->recv_list && (priv->recv_trans != trans
+          || priv->recv_channel != channel))
+    flush_recv_data (client);
+
+  if (priv->recv_list == NULL) {
+    priv->recv_list = gst_buffer_list_new_sized (RECV_BATCH_MAX);
+    priv->recv_trans = g_object_ref (trans);
+    priv->recv_channel = channel;
+  }
+  gst_buffer_list_add (priv->recv_list, buffer);
+
+  if (gst_buffer_list_length (priv->recv_list) >= RECV_BATCH_MAX ||
+      g_socket_condition_check (gst_rtsp_connection_get_read_socket
+          (priv->connection), G_IO_IN) == 0) {
+    flush_recv_data (client);
+  } else if (priv->recv_source == NULL) {
+    /* the socket has more data, the watch dispatches the next messages
+     * first. This only pushes the packets when the data was not a complete
+     * message, a busy watch pushes them after RECV_BATCH_MAX packets. */
+    priv->recv_source = g_idle_source_new ();
+    g_source_set_priority (priv->recv_source, G_PRIORITY_DEFAULT_IDLE);
+    g_source_set_callback (priv->recv_source,
+        (GSourceFunc) flush_recv_data_idle, g_object_ref (client),
+        (GDestroyNotify) g_object_unref);
+    g_source_attach (priv->recv_source, priv->watch_context);
   }
 
   return;
@@ -3551,6 +4081,12 @@ invalid_length:
     GST_DEBUG ("client %p: Short message received, ignoring", client);
     return;
   }
+unknown_channel:
+  {
+    GST_DEBUG_OBJECT (client, "received %u bytes of data for "
+        "unknown channel %u", size, channel);
+    return;
+  }
 }
 
 /**
@@ -3797,6 +4333,9 @@ gst_rtsp_client_get_thread_pool (GstRTSPClient * client)
  * Set the #GstRTSPConnection of @client. This function takes ownership of
  * @conn.
  *
+ * TLS must be set up on @conn before, by the #GstRTSPAuth of the server when
+ * it checks %GST_RTSP_AUTH_CHECK_CONNECT.
+ *
  * Returns: %TRUE on success.
  */
 gboolean
@@ -3804,6 +4343,7 @@ gst_rtsp_client_set_connection (GstRTSPClient * client,
     GstRTSPConnection * conn)
 {
   GstRTSPClientPrivate *priv;
+  GstRTSPContext *ctx;
   GSocket *read_socket;
   GSocketAddress *address;
   GstRTSPUrl *url;
@@ -3841,6 +4381,18 @@ gst_rtsp_client_set_connection (GstRTSPClient * client,
   url = gst_rtsp_connection_get_url (conn);
   GST_INFO ("added new client %p ip %s:%d", client, url->host, url->port);
 
+  /* GstRTSPConnection can't tell if it uses TLS without setting it up. When
+   * the server accepted @conn, its auth did the connect check and only sets TLS
+   * up when it has a certificate or a TLS authentication mode. Otherwise we
+   * can't know and assume TLS. */
+  ctx = gst_rtsp_context_get_current ();
+  if (ctx && ctx->conn == conn)
+    priv->plain_connection = ctx->auth == NULL ||
+        !gst_rtsp_auth_connect_uses_tls (ctx->auth);
+  else
+    priv->plain_connection = FALSE;
+  GST_DEBUG ("client %p plain connection %d", client, priv->plain_connection);
+
   priv->connection = conn;
 
   return TRUE;
@@ -3925,6 +4477,10 @@ gst_rtsp_client_handle_message (GstRTSPClient * client,
   g_return_val_if_fail (GST_IS_RTSP_CLIENT (client), GST_RTSP_EINVAL);
   g_return_val_if_fail (message != NULL, GST_RTSP_EINVAL);
 
+  /* data that was received before must be handled first */
+  if (message->type != GST_RTSP_MESSAGE_DATA)
+    flush_recv_data (client);
+
   switch (message->type) {
     case GST_RTSP_MESSAGE_REQUEST:
       handle_request (client, message);
@@ -3991,6 +4547,7 @@ do_send_message (GstRTSPClient * client, GstRTSPMessage * message,
   GstRTSPClientPrivate *priv = client->priv;
   GstRTSPResult ret;
   GTimeVal time;
+  guint id;
 
   time.tv_sec = 1;
   time.tv_usec = 0;
@@ -3998,11 +4555,16 @@ do_send_message (GstRTSPClient * client, GstRTSPMessage * message,
   do {
     /* send the response and store the seq number so we can wait until it's
      * written to the client to close the connection */
-    ret =
-        gst_rtsp_watch_send_message (priv->watch, message,
-        close ? &priv->close_seq : NULL);
-    if (ret == GST_RTSP_OK)
+    id = 0;
+    ret = gst_rtsp_watch_send_message (priv->watch, message, &id);
+    if (ret == GST_RTSP_OK) {
+      if (close)
+        priv->close_seq = id;
+      /* the watch only gives us an id when the message was queued */
+      if (id != 0)
+        g_atomic_int_inc (&priv->watch_pending);
       break;
+    }
 
     if (ret != GST_RTSP_ENOMEM)
       goto error;
@@ -4011,6 +4573,14 @@ do_send_message (GstRTSPClient * client, GstRTSPMessage * message,
     if (priv->drop_backlog)
       break;
 
+    /* never block on data when our transports queue it for us, the queue is
+     * flushed again when the watch has written out a message. Waiting from
+     * our own context would also block the watch that makes room. */
+    if (message->type == GST_RTSP_MESSAGE_DATA && (priv->send_queue_size > 0
+            || (priv->watch_context
+                && g_main_context_is_owner (priv->watch_context))))
+      break;
+
     /* queue was full, wait for more space */
     GST_DEBUG_OBJECT (client, "waiting for backlog");
     ret = gst_rtsp_watch_wait_backlog (priv->watch, &time);
@@ -4027,11 +4597,121 @@ error:
   }
 }
 
+/* take the contents of @message, which is owned by the watch */
+static GstRTSPMessage *
+steal_message (GstRTSPMessage * message)
+{
+  GstRTSPMessage *result;
+
+  result = g_new (GstRTSPMessage, 1);
+  memcpy (result, message, sizeof (GstRTSPMessage));
+  memset (message, 0, sizeof (GstRTSPMessage));
+
+  return result;
+}
+
+/* handle @message from the context of the watch, a request that has to wait
+ * for its media is parked */
+static GstRTSPResult
+handle_watch_message (GstRTSPClient * client, GstRTSPMessage * message)
+{
+  GstRTSPClientPrivate *priv = client->priv;
+  GstRTSPResult res;
+
+  priv->can_park = TRUE;
+  res = gst_rtsp_client_handle_message (client, message);
+  priv->can_park = FALSE;
+
+  if (priv->park) {
+    priv->park = FALSE;
+    priv->parked_request = steal_message (message);
+  }
+
+  return res;
+}
+
+static gboolean
+resume_parked_request (GstRTSPClient * client)
+{
+  GstRTSPClientPrivate *priv = client->priv;
+  GstRTSPMessage *message;
+
+  if (priv->parked_request == NULL)
+    return G_SOURCE_REMOVE;
+
+  GST_INFO ("client %p: resuming parked request", client);
+
+  message = priv->parked_request;
+  priv->parked_request = NULL;
+
+  priv->resuming = TRUE;
+  handle_watch_message (client, message);
+  priv->resuming = FALSE;
+  gst_rtsp_message_free (message);
+
+  /* handle the messages that were received in the meantime, in order, until
+   * one of them is parked again */
+  while (priv->watch != NULL && priv->parked_request == NULL &&
+      (message = g_queue_pop_head (&priv->parked_messages))) {
+    handle_watch_message (client, message);
+    gst_rtsp_message_free (message);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+/* queue @message while a request waits for its media. Data can't be handled
+ * before the media is prepared and is dropped, requests over the limit are
+ * refused */
+static void
+park_message (GstRTSPClient * client, GstRTSPMessage * message)
+{
+  GstRTSPClientPrivate *priv = client->priv;
+
+  if (message->type == GST_RTSP_MESSAGE_DATA) {
+    GST_LOG_OBJECT (client, "dropping data while a request is parked");
+    return;
+  }
+
+  if (g_queue_get_length (&priv->parked_messages) >= PARKED_MESSAGES_MAX) {
+    GstRTSPContext sctx = { NULL };
+    GstRTSPMessage response = { 0 };
+
+    GST_WARNING_OBJECT (client, "too many messages behind a parked request");
+    if (message->type != GST_RTSP_MESSAGE_REQUEST)
+      return;
+
+    sctx.conn = priv->connection;
+    sctx.client = client;
+    sctx.request = message;
+    sctx.response = &response;
+    send_generic_response (client, GST_RTSP_STS_SERVICE_UNAVAILABLE, &sctx);
+    return;
+  }
+
+  g_queue_push_tail (&priv->parked_messages, steal_message (message));
+}
+
 static GstRTSPResult
 message_received (GstRTSPWatch * watch, GstRTSPMessage * message,
     gpointer user_data)
 {
-  return gst_rtsp_client_handle_message (GST_RTSP_CLIENT (user_data), message);
+  GstRTSPClient *client = GST_RTSP_CLIENT (user_data);
+  GstRTSPClientPrivate *priv = client->priv;
+  GstRTSPResult res;
+  gint64 begin;
+
+  /* keep the order of the messages while a request waits for its media */
+  if (priv->parked_request != NULL) {
+    park_message (client, message);
+    return GST_RTSP_OK;
+  }
+
+  begin = gst_rtsp_thread_dispatch_begin ();
+  res = handle_watch_message (client, message);
+  gst_rtsp_thread_dispatch_end (GST_RTSP_THREAD_SOURCE_CLIENT, begin);
+
+  return res;
 }
 
 static GstRTSPResult
@@ -4039,13 +4719,23 @@ message_sent (GstRTSPWatch * watch, guint cseq, gpointer user_data)
 {
   GstRTSPClient *client = GST_RTSP_CLIENT (user_data);
   GstRTSPClientPrivate *priv = client->priv;
+  gint64 begin;
+
+  begin = gst_rtsp_thread_dispatch_begin ();
+
+  if (cseq != 0)
+    g_atomic_int_add (&priv->watch_pending, -1);
 
   if (priv->close_seq && priv->close_seq == cseq) {
     GST_INFO ("client %p: send close message", client);
     priv->close_seq = 0;
     gst_rtsp_client_close (client);
+  } else {
+    flush_send_queues (client);
   }
 
+  gst_rtsp_thread_dispatch_end (GST_RTSP_THREAD_SOURCE_CLIENT, begin);
+
   return GST_RTSP_OK;
 }
 
@@ -4058,6 +4748,8 @@ closed (GstRTSPWatch * watch, gpointer user_data)
 
   GST_INFO ("client %p: connection closed", client);
 
+  flush_recv_data (client);
+
   if ((tunnelid = gst_rtsp_connection_get_tunnelid (priv->connection))) {
     g_mutex_lock (&tunnels_lock);
     /* remove from tunnelids */
@@ -39,6 +39,7 @@
  */
 
 #include "rtsp-media-factory.h"
+#include "rtsp-server-internal.h"
 
 #define GST_RTSP_MEDIA_FACTORY_GET_PRIVATE(obj)  \
        (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTSP_MEDIA_FACTORY, GstRTSPMediaFactoryPrivate))
@@ -47,17 +48,53 @@
 #define GST_RTSP_MEDIA_FACTORY_LOCK(f)           (g_mutex_lock(GST_RTSP_MEDIA_FACTORY_GET_LOCK(f)))
 #define GST_RTSP_MEDIA_FACTORY_UNLOCK(f)         (g_mutex_unlock(GST_RTSP_MEDIA_FACTORY_GET_LOCK(f)))
 
+/* a launch line that was parsed once, see compile_launch_template() */
+typedef struct _LaunchTemplate LaunchTemplate;
+
+typedef struct
+{
+  const gchar *name;
+  GValue value;
+} TemplateProp;
+
+typedef struct
+{
+  guint src;
+  gchar *src_pad;
+  guint sink;
+  gchar *sink_pad;
+} TemplateLink;
+
+struct _LaunchTemplate
+{
+  GstElementFactory *factory;
+  gchar *name;
+  GArray *props;                /* TemplateProp */
+  GPtrArray *children;          /* LaunchTemplate, only for bins */
+  GArray *links;                /* TemplateLink between the children */
+};
+
 struct _GstRTSPMediaFactoryPrivate
 {
   GMutex lock;                  /* protects everything but medias */
   GstRTSPPermissions *permissions;
   gchar *launch;
+  LaunchTemplate *launch_template;
+  gboolean launch_compiled;
   gboolean shared;
   GstRTSPSuspendMode suspend_mode;
   gboolean eos_shutdown;
   GstRTSPProfile profiles;
   GstRTSPLowerTrans protocols;
   guint buffer_size;
+  gboolean udp_fanout;
+  guint fanout_threads;
+  guint fanout_queue_size;
+  GstRTSPFanoutPartition fanout_partition;
+  guint gop_cache_size;
+  guint recv_batch_size;
+  guint prepare_timeout;
+  gboolean pacing;
   GstRTSPAddressPool *pool;
   GstRTSPTransportMode transport_mode;
   gboolean stop_on_disconnect;
@@ -74,8 +111,38 @@ struct _GstRTSPMediaFactoryPrivate
   GstClock *clock;
 
   GstRTSPPublishClockMode publish_clock_mode;
+
+  /* non-shared media that were prepared in advance, by key */
+  GMutex warm_lock;
+  guint warm_pool_size;         /* protected by warm_lock */
+  guint warm_pool_timeout;      /* protected by warm_lock */
+  GHashTable *warm_pools;       /* protected by warm_lock */
+  GstRTSPThreadPool *thread_pool;       /* protected by warm_lock */
+  GstRTSPThreadPool *fallback_thread_pool;      /* set once with warm_lock */
+  GstRTSPThreadPool *warm_thread_pool;  /* protected by warm_lock */
+  GstRTSPThread *warm_thread;   /* protected by warm_lock */
+  GSource *warm_refill_source;  /* protected by warm_lock */
+  GSource *warm_expire_source;  /* protected by warm_lock */
+  gboolean warm_preparing;      /* protected by warm_lock */
+  guint64 warm_hits;            /* protected by warm_lock */
+  guint64 warm_misses;          /* protected by warm_lock */
 };
 
+/* the media prepared in advance for one key */
+typedef struct
+{
+  GstRTSPUrl *url;
+  GQueue medias;
+  gint64 last_used;
+} WarmPool;
+
+/* a media of the warm pool of @key that is prerolling */
+typedef struct
+{
+  GWeakRef factory;
+  gchar *key;
+} WarmPrepare;
+
 #define DEFAULT_LAUNCH          NULL
 #define DEFAULT_SHARED          FALSE
 #define DEFAULT_SUSPEND_MODE    GST_RTSP_SUSPEND_MODE_NONE
@@ -84,9 +151,19 @@ struct _GstRTSPMediaFactoryPrivate
 #define DEFAULT_PROTOCOLS       GST_RTSP_LOWER_TRANS_UDP | GST_RTSP_LOWER_TRANS_UDP_MCAST | \
                                         GST_RTSP_LOWER_TRANS_TCP
 #define DEFAULT_BUFFER_SIZE     0x80000
+#define DEFAULT_UDP_FANOUT      FALSE
 #define DEFAULT_LATENCY         200
 #define DEFAULT_TRANSPORT_MODE  GST_RTSP_TRANSPORT_MODE_PLAY
 #define DEFAULT_STOP_ON_DISCONNECT TRUE
+#define DEFAULT_FANOUT_THREADS  0
+#define DEFAULT_FANOUT_QUEUE_SIZE 256
+#define DEFAULT_FANOUT_PARTITION GST_RTSP_FANOUT_PARTITION_HASH
+#define DEFAULT_GOP_CACHE_SIZE  0
+#define DEFAULT_RECV_BATCH_SIZE 0
+#define DEFAULT_PREPARE_TIMEOUT 20
+#define DEFAULT_PACING          FALSE
+#define DEFAULT_WARM_POOL_SIZE  0
+#define DEFAULT_WARM_POOL_TIMEOUT 60
 
 enum
 {
@@ -98,10 +175,20 @@ enum
   PROP_PROFILES,
   PROP_PROTOCOLS,
   PROP_BUFFER_SIZE,
+  PROP_UDP_FANOUT,
   PROP_LATENCY,
   PROP_TRANSPORT_MODE,
   PROP_STOP_ON_DISCONNECT,
   PROP_CLOCK,
+  PROP_FANOUT_THREADS,
+  PROP_FANOUT_QUEUE_SIZE,
+  PROP_FANOUT_PARTITION,
+  PROP_GOP_CACHE_SIZE,
+  PROP_RECV_BATCH_SIZE,
+  PROP_PREPARE_TIMEOUT,
+  PROP_PACING,
+  PROP_WARM_POOL_SIZE,
+  PROP_WARM_POOL_TIMEOUT,
   PROP_LAST
 };
 
@@ -123,6 +210,14 @@ static void gst_rtsp_media_factory_set_property (GObject * object, guint propid,
     const GValue * value, GParamSpec * pspec);
 static void gst_rtsp_media_factory_finalize (GObject * obj);
 
+static void warm_pool_free (WarmPool * wpool);
+static GList *clear_warm_pools (GstRTSPMediaFactory * factory, guint size,
+    GList * drop);
+static void drop_warm_media (GList * drop);
+static void schedule_warm_refill (GstRTSPMediaFactory * factory);
+
+static void launch_template_free (LaunchTemplate * templ);
+
 static gchar *default_gen_key (GstRTSPMediaFactory * factory,
     const GstRTSPUrl * url);
 static GstElement *default_create_element (GstRTSPMediaFactory * factory,
@@ -200,6 +295,12 @@ gst_rtsp_media_factory_class_init (GstRTSPMediaFactoryClass * klass)
           "The kernel UDP buffer size to use", 0, G_MAXUINT,
           DEFAULT_BUFFER_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_UDP_FANOUT,
+      g_param_spec_boolean ("udp-fanout", "UDP Fanout",
+          "Send to UDP unicast destinations with a dedicated sender that "
+          "batches packets",
+          DEFAULT_UDP_FANOUT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (gobject_class, PROP_LATENCY,
       g_param_spec_uint ("latency", "Latency",
           "Latency used for receiving media in milliseconds", 0, G_MAXUINT,
@@ -224,12 +325,88 @@ gst_rtsp_media_factory_class_init (GstRTSPMediaFactoryClass * klass)
           "medias of this factory", GST_TYPE_CLOCK,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_FANOUT_THREADS,
+      g_param_spec_uint ("fanout-threads", "Fan-out Threads",
+          "The number of threads sending the packets of each stream to the "
+          "clients (0 = streaming thread)", 0, G_MAXUINT,
+          DEFAULT_FANOUT_THREADS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FANOUT_QUEUE_SIZE,
+      g_param_spec_uint ("fanout-queue-size", "Fan-out Queue Size",
+          "The maximum number of packets queued for each fan-out thread",
+          1, G_MAXUINT, DEFAULT_FANOUT_QUEUE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FANOUT_PARTITION,
+      g_param_spec_enum ("fanout-partition", "Fan-out Partition",
+          "How the transports are spread over the fan-out threads",
+          GST_TYPE_RTSP_FANOUT_PARTITION, DEFAULT_FANOUT_PARTITION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_GOP_CACHE_SIZE,
+      g_param_spec_uint ("gop-cache-size", "GOP Cache Size",
+          "The maximum size in bytes of the packets since the last keyframe "
+          "that are sent to new clients (0 = disabled)", 0, G_MAXUINT,
+          DEFAULT_GOP_CACHE_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_RECV_BATCH_SIZE,
+      g_param_spec_uint ("recv-batch-size", "Receive Batch Size",
+          "The maximum number of UDP packets received with one system "
+          "call (0 = one at a time)", 0, 1024,
+          DEFAULT_RECV_BATCH_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PREPARE_TIMEOUT,
+      g_param_spec_uint ("prepare-timeout", "Prepare Timeout",
+          "Seconds to wait for the media to preroll before giving up",
+          1, G_MAXUINT,
+          DEFAULT_PREPARE_TIMEOUT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PACING,
+      g_param_spec_boolean ("pacing", "Pacing",
+          "Spread the RTP packets of a frame over the frame interval when "
+          "sending them to UDP unicast destinations",
+          DEFAULT_PACING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_WARM_POOL_SIZE,
+      g_param_spec_uint ("warm-pool-size", "Warm Pool Size",
+          "The number of non-shared media to keep prepared in advance "
+          "for each url (0 = disabled)", 0, G_MAXUINT,
+          DEFAULT_WARM_POOL_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_WARM_POOL_TIMEOUT,
+      g_param_spec_uint ("warm-pool-timeout", "Warm Pool Timeout",
+          "Seconds after which unused media in the warm pool are released "
+          "(0 = never)", 0, G_MAXUINT,
+          DEFAULT_WARM_POOL_TIMEOUT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRTSPMediaFactory::media-constructed:
+   * @factory: a #GstRTSPMediaFactory
+   * @media: the #GstRTSPMedia that was constructed
+   *
+   * Emitted when @factory constructed @media. Media for the warm pool are
+   * constructed ahead of the client that will use them, from the thread that
+   * fills the warm pool, see gst_rtsp_media_factory_set_warm_pool_size().
+   */
   gst_rtsp_media_factory_signals[SIGNAL_MEDIA_CONSTRUCTED] =
       g_signal_new ("media-constructed", G_TYPE_FROM_CLASS (klass),
       G_SIGNAL_RUN_LAST, G_STRUCT_OFFSET (GstRTSPMediaFactoryClass,
           media_constructed), NULL, NULL, g_cclosure_marshal_generic,
       G_TYPE_NONE, 1, GST_TYPE_RTSP_MEDIA);
 
+  /**
+   * GstRTSPMediaFactory::media-configure:
+   * @factory: a #GstRTSPMediaFactory
+   * @media: the #GstRTSPMedia to configure
+   *
+   * Emitted after @media was constructed, before it is prepared. Media for
+   * the warm pool are configured when they are constructed, from the thread
+   * that fills the warm pool, and are already prepared when
+   * gst_rtsp_media_factory_construct() hands them out. The signal is not
+   * emitted again at that point, so handlers must not depend on the client
+   * or request that will use @media.
+   */
   gst_rtsp_media_factory_signals[SIGNAL_MEDIA_CONFIGURE] =
       g_signal_new ("media-configure", G_TYPE_FROM_CLASS (klass),
       G_SIGNAL_RUN_LAST, G_STRUCT_OFFSET (GstRTSPMediaFactoryClass,
@@ -260,6 +437,14 @@ gst_rtsp_media_factory_init (GstRTSPMediaFactory * factory)
   priv->profiles = DEFAULT_PROFILES;
   priv->protocols = DEFAULT_PROTOCOLS;
   priv->buffer_size = DEFAULT_BUFFER_SIZE;
+  priv->udp_fanout = DEFAULT_UDP_FANOUT;
+  priv->fanout_threads = DEFAULT_FANOUT_THREADS;
+  priv->fanout_queue_size = DEFAULT_FANOUT_QUEUE_SIZE;
+  priv->fanout_partition = DEFAULT_FANOUT_PARTITION;
+  priv->gop_cache_size = DEFAULT_GOP_CACHE_SIZE;
+  priv->recv_batch_size = DEFAULT_RECV_BATCH_SIZE;
+  priv->prepare_timeout = DEFAULT_PREPARE_TIMEOUT;
+  priv->pacing = DEFAULT_PACING;
   priv->latency = DEFAULT_LATENCY;
   priv->transport_mode = DEFAULT_TRANSPORT_MODE;
   priv->stop_on_disconnect = DEFAULT_STOP_ON_DISCONNECT;
@@ -270,6 +455,12 @@ gst_rtsp_media_factory_init (GstRTSPMediaFactory * factory)
   priv->medias = g_hash_table_new_full (g_str_hash, g_str_equal,
       g_free, g_object_unref);
   priv->media_gtype = GST_TYPE_RTSP_MEDIA;
+
+  g_mutex_init (&priv->warm_lock);
+  priv->warm_pool_size = DEFAULT_WARM_POOL_SIZE;
+  priv->warm_pool_timeout = DEFAULT_WARM_POOL_TIMEOUT;
+  priv->warm_pools = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) warm_pool_free);
 }
 
 static void
@@ -283,11 +474,25 @@ gst_rtsp_media_factory_finalize (GObject * obj)
   g_hash_table_unref (priv->medias);
   g_mutex_clear (&priv->medias_lock);
   g_free (priv->launch);
+  if (priv->launch_template)
+    launch_template_free (priv->launch_template);
   g_mutex_clear (&priv->lock);
   if (priv->pool)
     g_object_unref (priv->pool);
   g_free (priv->multicast_iface);
 
+  drop_warm_media (clear_warm_pools (factory, 0, NULL));
+  g_hash_table_unref (priv->warm_pools);
+  if (priv->warm_thread)
+    gst_rtsp_thread_stop (priv->warm_thread);
+  if (priv->warm_thread_pool)
+    g_object_unref (priv->warm_thread_pool);
+  if (priv->thread_pool)
+    g_object_unref (priv->thread_pool);
+  if (priv->fallback_thread_pool)
+    g_object_unref (priv->fallback_thread_pool);
+  g_mutex_clear (&priv->warm_lock);
+
   G_OBJECT_CLASS (gst_rtsp_media_factory_parent_class)->finalize (obj);
 }
 
@@ -322,6 +527,10 @@ gst_rtsp_media_factory_get_property (GObject * object, guint propid,
       g_value_set_uint (value,
           gst_rtsp_media_factory_get_buffer_size (factory));
       break;
+    case PROP_UDP_FANOUT:
+      g_value_set_boolean (value,
+          gst_rtsp_media_factory_get_udp_fanout (factory));
+      break;
     case PROP_LATENCY:
       g_value_set_uint (value, gst_rtsp_media_factory_get_latency (factory));
       break;
@@ -336,6 +545,42 @@ gst_rtsp_media_factory_get_property (GObject * object, guint propid,
     case PROP_CLOCK:
       g_value_take_object (value, gst_rtsp_media_factory_get_clock (factory));
       break;
+    case PROP_FANOUT_THREADS:
+      g_value_set_uint (value,
+          gst_rtsp_media_factory_get_fanout_threads (factory));
+      break;
+    case PROP_FANOUT_QUEUE_SIZE:
+      g_value_set_uint (value,
+          gst_rtsp_media_factory_get_fanout_queue_size (factory));
+      break;
+    case PROP_FANOUT_PARTITION:
+      g_value_set_enum (value,
+          gst_rtsp_media_factory_get_fanout_partition (factory));
+      break;
+    case PROP_GOP_CACHE_SIZE:
+      g_value_set_uint (value,
+          gst_rtsp_media_factory_get_gop_cache_size (factory));
+      break;
+    case PROP_RECV_BATCH_SIZE:
+      g_value_set_uint (value,
+          gst_rtsp_media_factory_get_recv_batch_size (factory));
+      break;
+    case PROP_PREPARE_TIMEOUT:
+      g_value_set_uint (value,
+          gst_rtsp_media_factory_get_prepare_timeout (factory));
+      break;
+    case PROP_PACING:
+      g_value_set_boolean (value,
+          gst_rtsp_media_factory_get_pacing (factory));
+      break;
+    case PROP_WARM_POOL_SIZE:
+      g_value_set_uint (value,
+          gst_rtsp_media_factory_get_warm_pool_size (factory));
+      break;
+    case PROP_WARM_POOL_TIMEOUT:
+      g_value_set_uint (value,
+          gst_rtsp_media_factory_get_warm_pool_timeout (factory));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, propid, pspec);
   }
@@ -372,6 +617,10 @@ gst_rtsp_media_factory_set_property (GObject * object, guint propid,
       gst_rtsp_media_factory_set_buffer_size (factory,
           g_value_get_uint (value));
       break;
+    case PROP_UDP_FANOUT:
+      gst_rtsp_media_factory_set_udp_fanout (factory,
+          g_value_get_boolean (value));
+      break;
     case PROP_LATENCY:
       gst_rtsp_media_factory_set_latency (factory, g_value_get_uint (value));
       break;
@@ -386,6 +635,42 @@ gst_rtsp_media_factory_set_property (GObject * object, guint propid,
     case PROP_CLOCK:
       gst_rtsp_media_factory_set_clock (factory, g_value_get_object (value));
       break;
+    case PROP_FANOUT_THREADS:
+      gst_rtsp_media_factory_set_fanout_threads (factory,
+          g_value_get_uint (value));
+      break;
+    case PROP_FANOUT_QUEUE_SIZE:
+      gst_rtsp_media_factory_set_fanout_queue_size (factory,
+          g_value_get_uint (value));
+      break;
+    case PROP_FANOUT_PARTITION:
+      gst_rtsp_media_factory_set_fanout_partition (factory,
+          g_value_get_enum (value));
+      break;
+    case PROP_GOP_CACHE_SIZE:
+      gst_rtsp_media_factory_set_gop_cache_size (factory,
+          g_value_get_uint (value));
+      break;
+    case PROP_RECV_BATCH_SIZE:
+      gst_rtsp_media_factory_set_recv_batch_size (factory,
+          g_value_get_uint (value));
+      break;
+    case PROP_PREPARE_TIMEOUT:
+      gst_rtsp_media_factory_set_prepare_timeout (factory,
+          g_value_get_uint (value));
+      break;
+    case PROP_PACING:
+      gst_rtsp_media_factory_set_pacing (factory,
+          g_value_get_boolean (value));
+      break;
+    case PROP_WARM_POOL_SIZE:
+      gst_rtsp_media_factory_set_warm_pool_size (factory,
+          g_value_get_uint (value));
+      break;
+    case PROP_WARM_POOL_TIMEOUT:
+      gst_rtsp_media_factory_set_warm_pool_timeout (factory,
+          g_value_get_uint (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, propid, pspec);
   }
@@ -524,6 +809,11 @@ gst_rtsp_media_factory_set_launch (GstRTSPMediaFactory * factory,
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
   g_free (priv->launch);
   priv->launch = g_strdup (launch);
+  if (priv->launch_template) {
+    launch_template_free (priv->launch_template);
+    priv->launch_template = NULL;
+  }
+  priv->launch_compiled = FALSE;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 }
 
@@ -746,179 +1036,180 @@ gst_rtsp_media_factory_get_buffer_size (GstRTSPMediaFactory * factory)
 }
 
 /**
- * gst_rtsp_media_factory_set_address_pool:
+ * gst_rtsp_media_factory_set_udp_fanout:
  * @factory: a #GstRTSPMediaFactory
- * @pool: (transfer none): a #GstRTSPAddressPool
+ * @udp_fanout: the new value
  *
- * configure @pool to be used as the address pool of @factory.
+ * Configure if the media created from @factory use a dedicated sender for
+ * UDP unicast destinations. See gst_rtsp_media_set_udp_fanout().
+ *
+ * Since: 1.14
  */
 void
-gst_rtsp_media_factory_set_address_pool (GstRTSPMediaFactory * factory,
-    GstRTSPAddressPool * pool)
+gst_rtsp_media_factory_set_udp_fanout (GstRTSPMediaFactory * factory,
+    gboolean udp_fanout)
 {
   GstRTSPMediaFactoryPrivate *priv;
-  GstRTSPAddressPool *old;
 
   g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
 
   priv = factory->priv;
 
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  if ((old = priv->pool) != pool)
-    priv->pool = pool ? g_object_ref (pool) : NULL;
-  else
-    old = NULL;
+  priv->udp_fanout = udp_fanout;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
-
-  if (old)
-    g_object_unref (old);
 }
 
 /**
- * gst_rtsp_media_factory_get_address_pool:
+ * gst_rtsp_media_factory_get_udp_fanout:
  * @factory: a #GstRTSPMediaFactory
  *
- * Get the #GstRTSPAddressPool used as the address pool of @factory.
+ * Check if the media created from @factory use a dedicated sender for UDP
+ * unicast destinations.
  *
- * Returns: (transfer full): the #GstRTSPAddressPool of @factory. g_object_unref() after
- * usage.
+ * Returns: %TRUE if a dedicated sender is used.
+ *
+ * Since: 1.14
  */
-GstRTSPAddressPool *
-gst_rtsp_media_factory_get_address_pool (GstRTSPMediaFactory * factory)
+gboolean
+gst_rtsp_media_factory_get_udp_fanout (GstRTSPMediaFactory * factory)
 {
   GstRTSPMediaFactoryPrivate *priv;
-  GstRTSPAddressPool *result;
+  gboolean result;
 
-  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), NULL);
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), FALSE);
 
   priv = factory->priv;
 
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  if ((result = priv->pool))
-    g_object_ref (result);
+  result = priv->udp_fanout;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 
   return result;
 }
 
 /**
- * gst_rtsp_media_factory_set_multicast_iface:
+ * gst_rtsp_media_factory_set_fanout_threads:
  * @factory: a #GstRTSPMediaFactory
- * @multicast_iface: (transfer none): a multicast interface name
+ * @n_threads: the number of threads
  *
- * configure @multicast_iface to be used for @factory.
+ * Set the number of threads each stream of the medias of @factory uses to
+ * send its packets to the clients. With a value bigger than 0 the clients of
+ * a stream are divided over @n_threads threads, which is useful for shared
+ * medias with many TCP clients. See gst_rtsp_stream_set_fanout_threads().
+ *
+ * Since: 1.14
  */
 void
-gst_rtsp_media_factory_set_multicast_iface (GstRTSPMediaFactory * media_factory,
-    const gchar * multicast_iface)
+gst_rtsp_media_factory_set_fanout_threads (GstRTSPMediaFactory * factory,
+    guint n_threads)
 {
   GstRTSPMediaFactoryPrivate *priv;
-  gchar *old;
-
-  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (media_factory));
-
-  priv = media_factory->priv;
 
-  GST_LOG_OBJECT (media_factory, "set multicast interface %s", multicast_iface);
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
 
-  g_mutex_lock (&priv->lock);
-  if ((old = priv->multicast_iface) != multicast_iface)
-    priv->multicast_iface = multicast_iface ? g_strdup (multicast_iface) : NULL;
-  else
-    old = NULL;
-  g_mutex_unlock (&priv->lock);
+  priv = factory->priv;
 
-  if (old)
-    g_free (old);
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  priv->fanout_threads = n_threads;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 }
 
 /**
- * gst_rtsp_media_factory_get_multicast_iface:
+ * gst_rtsp_media_factory_get_fanout_threads:
  * @factory: a #GstRTSPMediaFactory
  *
- * Get the multicast interface used for @factory.
+ * Get the number of threads each stream of the medias of @factory uses to
+ * send its packets to the clients.
  *
- * Returns: (transfer full): the multicast interface for @factory. g_free() after
- * usage.
+ * Returns: the number of fan-out threads.
+ *
+ * Since: 1.14
  */
-gchar *
-gst_rtsp_media_factory_get_multicast_iface (GstRTSPMediaFactory * media_factory)
+guint
+gst_rtsp_media_factory_get_fanout_threads (GstRTSPMediaFactory * factory)
 {
   GstRTSPMediaFactoryPrivate *priv;
-  gchar *result;
+  guint result;
 
-  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (media_factory), NULL);
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), 0);
 
-  priv = media_factory->priv;
+  priv = factory->priv;
 
-  g_mutex_lock (&priv->lock);
-  if ((result = priv->multicast_iface))
-    result = g_strdup (result);
-  g_mutex_unlock (&priv->lock);
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  result = priv->fanout_threads;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 
   return result;
 }
 
 /**
- * gst_rtsp_media_factory_set_profiles:
+ * gst_rtsp_media_factory_set_fanout_queue_size:
  * @factory: a #GstRTSPMediaFactory
- * @profiles: the new flags
+ * @size: the maximum number of packets
  *
- * Configure the allowed profiles for @factory.
+ * Configure the maximum number of packets queued for each fan-out thread of
+ * the media created from @factory. See gst_rtsp_media_set_fanout_queue_size().
+ *
+ * Since: 1.14
  */
 void
-gst_rtsp_media_factory_set_profiles (GstRTSPMediaFactory * factory,
-    GstRTSPProfile profiles)
+gst_rtsp_media_factory_set_fanout_queue_size (GstRTSPMediaFactory * factory,
+    guint size)
 {
   GstRTSPMediaFactoryPrivate *priv;
 
   g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+  g_return_if_fail (size > 0);
 
   priv = factory->priv;
 
-  GST_DEBUG_OBJECT (factory, "profiles %d", profiles);
-
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  priv->profiles = profiles;
+  priv->fanout_queue_size = size;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 }
 
 /**
- * gst_rtsp_media_factory_get_profiles:
+ * gst_rtsp_media_factory_get_fanout_queue_size:
  * @factory: a #GstRTSPMediaFactory
  *
- * Get the allowed profiles of @factory.
+ * Get the maximum number of packets queued for each fan-out thread of the
+ * media created from @factory.
  *
- * Returns: a #GstRTSPProfile
+ * Returns: the maximum number of packets.
+ *
+ * Since: 1.14
  */
-GstRTSPProfile
-gst_rtsp_media_factory_get_profiles (GstRTSPMediaFactory * factory)
+guint
+gst_rtsp_media_factory_get_fanout_queue_size (GstRTSPMediaFactory * factory)
 {
   GstRTSPMediaFactoryPrivate *priv;
-  GstRTSPProfile res;
+  guint result;
 
-  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory),
-      GST_RTSP_PROFILE_UNKNOWN);
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), 0);
 
   priv = factory->priv;
 
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  res = priv->profiles;
+  result = priv->fanout_queue_size;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 
-  return res;
+  return result;
 }
 
 /**
- * gst_rtsp_media_factory_set_protocols:
+ * gst_rtsp_media_factory_set_fanout_partition:
  * @factory: a #GstRTSPMediaFactory
- * @protocols: the new flags
+ * @partition: a #GstRTSPFanoutPartition
  *
- * Configure the allowed lower transport for @factory.
+ * Configure how the transports of the media created from @factory are spread
+ * over their fan-out threads. See gst_rtsp_media_set_fanout_partition().
+ *
+ * Since: 1.14
  */
 void
-gst_rtsp_media_factory_set_protocols (GstRTSPMediaFactory * factory,
-    GstRTSPLowerTrans protocols)
+gst_rtsp_media_factory_set_fanout_partition (GstRTSPMediaFactory * factory,
+    GstRTSPFanoutPartition partition)
 {
   GstRTSPMediaFactoryPrivate *priv;
 
@@ -926,50 +1217,56 @@ gst_rtsp_media_factory_set_protocols (GstRTSPMediaFactory * factory,
 
   priv = factory->priv;
 
-  GST_DEBUG_OBJECT (factory, "protocols %d", protocols);
-
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  priv->protocols = protocols;
+  priv->fanout_partition = partition;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 }
 
 /**
- * gst_rtsp_media_factory_get_protocols:
+ * gst_rtsp_media_factory_get_fanout_partition:
  * @factory: a #GstRTSPMediaFactory
  *
- * Get the allowed protocols of @factory.
+ * Get how the transports of the media created from @factory are spread over
+ * their fan-out threads.
  *
- * Returns: a #GstRTSPLowerTrans
+ * Returns: the #GstRTSPFanoutPartition of @factory.
+ *
+ * Since: 1.14
  */
-GstRTSPLowerTrans
-gst_rtsp_media_factory_get_protocols (GstRTSPMediaFactory * factory)
+GstRTSPFanoutPartition
+gst_rtsp_media_factory_get_fanout_partition (GstRTSPMediaFactory * factory)
 {
   GstRTSPMediaFactoryPrivate *priv;
-  GstRTSPLowerTrans res;
+  GstRTSPFanoutPartition result;
 
   g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory),
-      GST_RTSP_LOWER_TRANS_UNKNOWN);
+      GST_RTSP_FANOUT_PARTITION_HASH);
 
   priv = factory->priv;
 
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  res = priv->protocols;
+  result = priv->fanout_partition;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 
-  return res;
+  return result;
 }
 
 /**
- * gst_rtsp_media_factory_set_stop_on_disconnect:
+ * gst_rtsp_media_factory_set_gop_cache_size:
  * @factory: a #GstRTSPMediaFactory
- * @stop_on_disconnect: the new value
+ * @size: the maximum size of the cache in bytes
  *
- * Configure if media created from this factory should be stopped
- * when a client disconnects without sending TEARDOWN.
+ * Configure the medias of @factory to keep the RTP packets since the last
+ * keyframe, up to @size bytes per stream, and send them to new clients
+ * first. With shared live media this lets late joiners start decoding right
+ * away instead of waiting for the next keyframe. A value of 0 disables the
+ * cache. See gst_rtsp_stream_set_gop_cache_size().
+ *
+ * Since: 1.14
  */
 void
-gst_rtsp_media_factory_set_stop_on_disconnect (GstRTSPMediaFactory * factory,
-    gboolean stop_on_disconnect)
+gst_rtsp_media_factory_set_gop_cache_size (GstRTSPMediaFactory * factory,
+    guint size)
 {
   GstRTSPMediaFactoryPrivate *priv;
 
@@ -978,47 +1275,53 @@ gst_rtsp_media_factory_set_stop_on_disconnect (GstRTSPMediaFactory * factory,
   priv = factory->priv;
 
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  priv->stop_on_disconnect = stop_on_disconnect;
+  priv->gop_cache_size = size;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 }
 
 /**
- * gst_rtsp_media_factory_is_stop_on_disconnect:
+ * gst_rtsp_media_factory_get_gop_cache_size:
  * @factory: a #GstRTSPMediaFactory
  *
- * Get if media created from this factory should be stopped when a client
- * disconnects without sending TEARDOWN.
+ * Get the maximum size of the cache of RTP packets since the last keyframe
+ * of the streams of the medias of @factory.
  *
- * Returns: %TRUE if the media will be stopped when a client disconnects
- *     without sending TEARDOWN.
+ * Returns: the size of the cache in bytes, 0 when disabled.
+ *
+ * Since: 1.14
  */
-gboolean
-gst_rtsp_media_factory_is_stop_on_disonnect (GstRTSPMediaFactory * factory)
+guint
+gst_rtsp_media_factory_get_gop_cache_size (GstRTSPMediaFactory * factory)
 {
   GstRTSPMediaFactoryPrivate *priv;
-  gboolean result;
+  guint result;
 
-  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), TRUE);
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), 0);
 
   priv = factory->priv;
 
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  result = priv->stop_on_disconnect;
+  result = priv->gop_cache_size;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 
   return result;
 }
 
 /**
- * gst_rtsp_media_factory_set_retransmission_time:
+ * gst_rtsp_media_factory_set_recv_batch_size:
  * @factory: a #GstRTSPMediaFactory
- * @time: a #GstClockTime
+ * @size: the maximum number of packets
  *
- * Configure the time to store for possible retransmission
+ * Configure the medias of @factory to receive up to @size UDP packets with
+ * one system call and to push them into the pipeline as one buffer list.
+ * This reduces the CPU usage of high-bitrate RECORD streams. A value of 0
+ * receives one packet at a time. See gst_rtsp_stream_set_recv_batch_size().
+ *
+ * Since: 1.14
  */
 void
-gst_rtsp_media_factory_set_retransmission_time (GstRTSPMediaFactory * factory,
-    GstClockTime time)
+gst_rtsp_media_factory_set_recv_batch_size (GstRTSPMediaFactory * factory,
+    guint size)
 {
   GstRTSPMediaFactoryPrivate *priv;
 
@@ -1026,125 +1329,1257 @@ gst_rtsp_media_factory_set_retransmission_time (GstRTSPMediaFactory * factory,
 
   priv = factory->priv;
 
-  GST_DEBUG_OBJECT (factory, "retransmission time %" G_GUINT64_FORMAT, time);
-
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  priv->rtx_time = time;
+  priv->recv_batch_size = size;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 }
 
 /**
- * gst_rtsp_media_factory_get_retransmission_time:
+ * gst_rtsp_media_factory_get_recv_batch_size:
  * @factory: a #GstRTSPMediaFactory
  *
- * Get the time that is stored for retransmission purposes
+ * Get the maximum number of UDP packets that the streams of the medias of
+ * @factory receive at once.
  *
- * Returns: a #GstClockTime
+ * Returns: the batch size, 0 when packets are received one at a time.
+ *
+ * Since: 1.14
  */
-GstClockTime
-gst_rtsp_media_factory_get_retransmission_time (GstRTSPMediaFactory * factory)
+guint
+gst_rtsp_media_factory_get_recv_batch_size (GstRTSPMediaFactory * factory)
 {
   GstRTSPMediaFactoryPrivate *priv;
-  GstClockTime res;
+  guint result;
 
   g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), 0);
 
   priv = factory->priv;
 
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  res = priv->rtx_time;
+  result = priv->recv_batch_size;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 
-  return res;
+  return result;
 }
 
 /**
- * gst_rtsp_media_factory_set_latency:
+ * gst_rtsp_media_factory_set_prepare_timeout:
  * @factory: a #GstRTSPMediaFactory
- * @latency: latency in milliseconds
+ * @timeout: the timeout in seconds
  *
- * Configure the latency used for receiving media
+ * Configure how many seconds the media created from @factory wait for their
+ * pipeline to preroll. See gst_rtsp_media_set_prepare_timeout().
+ *
+ * Since: 1.14
  */
 void
-gst_rtsp_media_factory_set_latency (GstRTSPMediaFactory * factory,
-    guint latency)
+gst_rtsp_media_factory_set_prepare_timeout (GstRTSPMediaFactory * factory,
+    guint timeout)
 {
   GstRTSPMediaFactoryPrivate *priv;
 
   g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+  g_return_if_fail (timeout > 0);
 
   priv = factory->priv;
 
-  GST_DEBUG_OBJECT (factory, "latency %ums", latency);
-
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  priv->latency = latency;
+  priv->prepare_timeout = timeout;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 }
 
 /**
- * gst_rtsp_media_factory_get_latency:
+ * gst_rtsp_media_factory_get_prepare_timeout:
  * @factory: a #GstRTSPMediaFactory
  *
- * Get the latency that is used for receiving media
+ * Get the prepare timeout of the media created from @factory.
  *
- * Returns: latency in milliseconds
+ * Returns: the prepare timeout of @media in seconds.
+ *
+ * Since: 1.14
  */
 guint
-gst_rtsp_media_factory_get_latency (GstRTSPMediaFactory * factory)
+gst_rtsp_media_factory_get_prepare_timeout (GstRTSPMediaFactory * factory)
 {
   GstRTSPMediaFactoryPrivate *priv;
-  guint res;
+  guint result;
 
   g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), 0);
 
   priv = factory->priv;
 
   GST_RTSP_MEDIA_FACTORY_LOCK (factory);
-  res = priv->latency;
+  result = priv->prepare_timeout;
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 
-  return res;
+  return result;
 }
 
-static gboolean
-compare_media (gpointer key, GstRTSPMedia * media1, GstRTSPMedia * media2)
+/**
+ * gst_rtsp_media_factory_set_pacing:
+ * @factory: a #GstRTSPMediaFactory
+ * @pacing: the new value
+ *
+ * Configure if the media created from @factory pace their RTP packets. See
+ * gst_rtsp_media_set_pacing().
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_media_factory_set_pacing (GstRTSPMediaFactory * factory,
+    gboolean pacing)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+
+  priv = factory->priv;
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  priv->pacing = pacing;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+}
+
+/**
+ * gst_rtsp_media_factory_get_pacing:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Check if the media created from @factory pace their RTP packets.
+ *
+ * Returns: %TRUE if the RTP packets are paced.
+ *
+ * Since: 1.14
+ */
+gboolean
+gst_rtsp_media_factory_get_pacing (GstRTSPMediaFactory * factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  gboolean result;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), FALSE);
+
+  priv = factory->priv;
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  result = priv->pacing;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+
+  return result;
+}
+
+/**
+ * gst_rtsp_media_factory_set_warm_pool_size:
+ * @factory: a #GstRTSPMediaFactory
+ * @size: the number of media to keep prepared per url
+ *
+ * Configure how many non-shared media @factory keeps prepared in advance for
+ * each url that was requested before. gst_rtsp_media_factory_construct() then
+ * returns one of those media, so that clients do not have to wait for the
+ * pipeline to preroll. A @size of 0 disables the warm pool.
+ *
+ * The pool is not used for shared factories or factories that record.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_media_factory_set_warm_pool_size (GstRTSPMediaFactory * factory,
+    guint size)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  gboolean shrink;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+
+  priv = factory->priv;
+
+  g_mutex_lock (&priv->warm_lock);
+  shrink = size < priv->warm_pool_size;
+  priv->warm_pool_size = size;
+  if (size > 0 && g_hash_table_size (priv->warm_pools) > 0)
+    schedule_warm_refill (factory);
+  g_mutex_unlock (&priv->warm_lock);
+
+  if (shrink)
+    drop_warm_media (clear_warm_pools (factory, size, NULL));
+}
+
+/**
+ * gst_rtsp_media_factory_get_warm_pool_size:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Get the number of media @factory keeps prepared in advance per url.
+ *
+ * Returns: the warm pool size, 0 when disabled.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_media_factory_get_warm_pool_size (GstRTSPMediaFactory * factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  guint result;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), 0);
+
+  priv = factory->priv;
+
+  g_mutex_lock (&priv->warm_lock);
+  result = priv->warm_pool_size;
+  g_mutex_unlock (&priv->warm_lock);
+
+  return result;
+}
+
+/**
+ * gst_rtsp_media_factory_set_warm_pool_timeout:
+ * @factory: a #GstRTSPMediaFactory
+ * @timeout: the timeout in seconds
+ *
+ * Configure after how many seconds without a request for its url the
+ * prepared media of a warm pool are released. A @timeout of 0 keeps them
+ * until the warm pool size is changed or @factory is destroyed.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_media_factory_set_warm_pool_timeout (GstRTSPMediaFactory * factory,
+    guint timeout)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+
+  priv = factory->priv;
+
+  g_mutex_lock (&priv->warm_lock);
+  priv->warm_pool_timeout = timeout;
+  g_mutex_unlock (&priv->warm_lock);
+}
+
+/**
+ * gst_rtsp_media_factory_get_warm_pool_timeout:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Get the timeout after which unused media of the warm pool are released.
+ *
+ * Returns: the warm pool timeout in seconds, 0 when it never expires.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_media_factory_get_warm_pool_timeout (GstRTSPMediaFactory * factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  guint result;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), 0);
+
+  priv = factory->priv;
+
+  g_mutex_lock (&priv->warm_lock);
+  result = priv->warm_pool_timeout;
+  g_mutex_unlock (&priv->warm_lock);
+
+  return result;
+}
+
+/**
+ * gst_rtsp_media_factory_get_warm_pool_stats:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Get statistics about the warm pool of @factory. The structure contains the
+ * number of constructed media that were taken from the warm pool in the
+ * "hits" field, the number of media that had to be constructed because the
+ * pool was empty in "misses" (both #guint64) and the number of media that are
+ * currently prepared in "ready" (#guint).
+ *
+ * Returns: (transfer full): a #GstStructure with the statistics, free with
+ * gst_structure_free().
+ *
+ * Since: 1.14
+ */
+GstStructure *
+gst_rtsp_media_factory_get_warm_pool_stats (GstRTSPMediaFactory * factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  GstStructure *result;
+  GHashTableIter iter;
+  gpointer value;
+  guint ready = 0;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), NULL);
+
+  priv = factory->priv;
+
+  g_mutex_lock (&priv->warm_lock);
+  g_hash_table_iter_init (&iter, priv->warm_pools);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    ready += g_queue_get_length (&((WarmPool *) value)->medias);
+
+  result =
+      gst_structure_new ("application/x-rtsp-media-factory-warm-pool-stats",
+      "hits", G_TYPE_UINT64, priv->warm_hits,
+      "misses", G_TYPE_UINT64, priv->warm_misses,
+      "ready", G_TYPE_UINT, ready, NULL);
+  g_mutex_unlock (&priv->warm_lock);
+
+  return result;
+}
+
+/**
+ * gst_rtsp_media_factory_set_thread_pool:
+ * @factory: a #GstRTSPMediaFactory
+ * @pool: (transfer none) (allow-none): a #GstRTSPThreadPool
+ *
+ * Configure @pool as the thread pool that provides the thread in which
+ * @factory prepares the media of its warm pool. When no pool is set, the
+ * thread pool of the first client that requests media from @factory is used,
+ * which is the thread pool of the server by default.
+ *
+ * The pool is used when the warm pool needs a thread, it should be set before
+ * the warm pool is enabled.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_media_factory_set_thread_pool (GstRTSPMediaFactory * factory,
+    GstRTSPThreadPool * pool)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  GstRTSPThreadPool *old;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+
+  priv = factory->priv;
+
+  if (pool)
+    g_object_ref (pool);
+
+  g_mutex_lock (&priv->warm_lock);
+  old = priv->thread_pool;
+  priv->thread_pool = pool;
+  g_mutex_unlock (&priv->warm_lock);
+
+  if (old)
+    g_object_unref (old);
+}
+
+/**
+ * gst_rtsp_media_factory_get_thread_pool:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Get the #GstRTSPThreadPool that was configured with
+ * gst_rtsp_media_factory_set_thread_pool().
+ *
+ * Returns: (transfer full) (nullable): the #GstRTSPThreadPool of @factory.
+ * g_object_unref() after usage.
+ *
+ * Since: 1.14
+ */
+GstRTSPThreadPool *
+gst_rtsp_media_factory_get_thread_pool (GstRTSPMediaFactory * factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  GstRTSPThreadPool *result;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), NULL);
+
+  priv = factory->priv;
+
+  g_mutex_lock (&priv->warm_lock);
+  if ((result = priv->thread_pool))
+    g_object_ref (result);
+  g_mutex_unlock (&priv->warm_lock);
+
+  return result;
+}
+
+/* the thread pool of the first client that requests media from @factory, used
+ * for the warm pool when no thread pool was configured on @factory. Only the
+ * first call has an effect, the others return right away. */
+void
+gst_rtsp_media_factory_set_fallback_thread_pool (GstRTSPMediaFactory *
+    factory, GstRTSPThreadPool * pool)
+{
+  GstRTSPMediaFactoryPrivate *priv = factory->priv;
+
+  if (pool == NULL || g_atomic_pointer_get (&priv->fallback_thread_pool))
+    return;
+
+  g_mutex_lock (&priv->warm_lock);
+  if (priv->fallback_thread_pool == NULL)
+    g_atomic_pointer_set (&priv->fallback_thread_pool, g_object_ref (pool));
+  g_mutex_unlock (&priv->warm_lock);
+}
+
+/**
+ * gst_rtsp_media_factory_set_address_pool:
+ * @factory: a #GstRTSPMediaFactory
+ * @pool: (transfer none): a #GstRTSPAddressPool
+ *
+ * configure @pool to be used as the address pool of @factory.
+ */
+void
+gst_rtsp_media_factory_set_address_pool (GstRTSPMediaFactory * factory,
+    GstRTSPAddressPool * pool)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  GstRTSPAddressPool *old;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+
+  priv = factory->priv;
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  if ((old = priv->pool) != pool)
+    priv->pool = pool ? g_object_ref (pool) : NULL;
+  else
+    old = NULL;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+
+  if (old)
+    g_object_unref (old);
+}
+
+/**
+ * gst_rtsp_media_factory_get_address_pool:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Get the #GstRTSPAddressPool used as the address pool of @factory.
+ *
+ * Returns: (transfer full): the #GstRTSPAddressPool of @factory. g_object_unref() after
+ * usage.
+ */
+GstRTSPAddressPool *
+gst_rtsp_media_factory_get_address_pool (GstRTSPMediaFactory * factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  GstRTSPAddressPool *result;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), NULL);
+
+  priv = factory->priv;
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  if ((result = priv->pool))
+    g_object_ref (result);
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+
+  return result;
+}
+
+/**
+ * gst_rtsp_media_factory_set_multicast_iface:
+ * @factory: a #GstRTSPMediaFactory
+ * @multicast_iface: (transfer none): a multicast interface name
+ *
+ * configure @multicast_iface to be used for @factory.
+ */
+void
+gst_rtsp_media_factory_set_multicast_iface (GstRTSPMediaFactory * media_factory,
+    const gchar * multicast_iface)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  gchar *old;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (media_factory));
+
+  priv = media_factory->priv;
+
+  GST_LOG_OBJECT (media_factory, "set multicast interface %s", multicast_iface);
+
+  g_mutex_lock (&priv->lock);
+  if ((old = priv->multicast_iface) != multicast_iface)
+    priv->multicast_iface = multicast_iface ? g_strdup (multicast_iface) : NULL;
+  else
+    old = NULL;
+  g_mutex_unlock (&priv->lock);
+
+  if (old)
+    g_free (old);
+}
+
+/**
+ * gst_rtsp_media_factory_get_multicast_iface:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Get the multicast interface used for @factory.
+ *
+ * Returns: (transfer full): the multicast interface for @factory. g_free() after
+ * usage.
+ */
+gchar *
+gst_rtsp_media_factory_get_multicast_iface (GstRTSPMediaFactory * media_factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  gchar *result;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (media_factory), NULL);
+
+  priv = media_factory->priv;
+
+  g_mutex_lock (&priv->lock);
+  if ((result = priv->multicast_iface))
+    result = g_strdup (result);
+  g_mutex_unlock (&priv->lock);
+
+  return result;
+}
+
+/**
+ * gst_rtsp_media_factory_set_profiles:
+ * @factory: a #GstRTSPMediaFactory
+ * @profiles: the new flags
+ *
+ * Configure the allowed profiles for @factory.
+ */
+void
+gst_rtsp_media_factory_set_profiles (GstRTSPMediaFactory * factory,
+    GstRTSPProfile profiles)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+
+  priv = factory->priv;
+
+  GST_DEBUG_OBJECT (factory, "profiles %d", profiles);
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  priv->profiles = profiles;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+}
+
+/**
+ * gst_rtsp_media_factory_get_profiles:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Get the allowed profiles of @factory.
+ *
+ * Returns: a #GstRTSPProfile
+ */
+GstRTSPProfile
+gst_rtsp_media_factory_get_profiles (GstRTSPMediaFactory * factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  GstRTSPProfile res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory),
+      GST_RTSP_PROFILE_UNKNOWN);
+
+  priv = factory->priv;
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  res = priv->profiles;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_media_factory_set_protocols:
+ * @factory: a #GstRTSPMediaFactory
+ * @protocols: the new flags
+ *
+ * Configure the allowed lower transport for @factory.
+ */
+void
+gst_rtsp_media_factory_set_protocols (GstRTSPMediaFactory * factory,
+    GstRTSPLowerTrans protocols)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+
+  priv = factory->priv;
+
+  GST_DEBUG_OBJECT (factory, "protocols %d", protocols);
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  priv->protocols = protocols;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+}
+
+/**
+ * gst_rtsp_media_factory_get_protocols:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Get the allowed protocols of @factory.
+ *
+ * Returns: a #GstRTSPLowerTrans
+ */
+GstRTSPLowerTrans
+gst_rtsp_media_factory_get_protocols (GstRTSPMediaFactory * factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  GstRTSPLowerTrans res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory),
+      GST_RTSP_LOWER_TRANS_UNKNOWN);
+
+  priv = factory->priv;
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  res = priv->protocols;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_media_factory_set_stop_on_disconnect:
+ * @factory: a #GstRTSPMediaFactory
+ * @stop_on_disconnect: the new value
+ *
+ * Configure if media created from this factory should be stopped
+ * when a client disconnects without sending TEARDOWN.
+ */
+void
+gst_rtsp_media_factory_set_stop_on_disconnect (GstRTSPMediaFactory * factory,
+    gboolean stop_on_disconnect)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+
+  priv = factory->priv;
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  priv->stop_on_disconnect = stop_on_disconnect;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+}
+
+/**
+ * gst_rtsp_media_factory_is_stop_on_disconnect:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Get if media created from this factory should be stopped when a client
+ * disconnects without sending TEARDOWN.
+ *
+ * Returns: %TRUE if the media will be stopped when a client disconnects
+ *     without sending TEARDOWN.
+ */
+gboolean
+gst_rtsp_media_factory_is_stop_on_disonnect (GstRTSPMediaFactory * factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  gboolean result;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), TRUE);
+
+  priv = factory->priv;
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  result = priv->stop_on_disconnect;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+
+  return result;
+}
+
+/**
+ * gst_rtsp_media_factory_set_retransmission_time:
+ * @factory: a #GstRTSPMediaFactory
+ * @time: a #GstClockTime
+ *
+ * Configure the time to store for possible retransmission
+ */
+void
+gst_rtsp_media_factory_set_retransmission_time (GstRTSPMediaFactory * factory,
+    GstClockTime time)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+
+  priv = factory->priv;
+
+  GST_DEBUG_OBJECT (factory, "retransmission time %" G_GUINT64_FORMAT, time);
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  priv->rtx_time = time;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+}
+
+/**
+ * gst_rtsp_media_factory_get_retransmission_time:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Get the time that is stored for retransmission purposes
+ *
+ * Returns: a #GstClockTime
+ */
+GstClockTime
+gst_rtsp_media_factory_get_retransmission_time (GstRTSPMediaFactory * factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  GstClockTime res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), 0);
+
+  priv = factory->priv;
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  res = priv->rtx_time;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_media_factory_set_latency:
+ * @factory: a #GstRTSPMediaFactory
+ * @latency: latency in milliseconds
+ *
+ * Configure the latency used for receiving media
+ */
+void
+gst_rtsp_media_factory_set_latency (GstRTSPMediaFactory * factory,
+    guint latency)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
+
+  priv = factory->priv;
+
+  GST_DEBUG_OBJECT (factory, "latency %ums", latency);
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  priv->latency = latency;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+}
+
+/**
+ * gst_rtsp_media_factory_get_latency:
+ * @factory: a #GstRTSPMediaFactory
+ *
+ * Get the latency that is used for receiving media
+ *
+ * Returns: latency in milliseconds
+ */
+guint
+gst_rtsp_media_factory_get_latency (GstRTSPMediaFactory * factory)
+{
+  GstRTSPMediaFactoryPrivate *priv;
+  guint res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory), 0);
+
+  priv = factory->priv;
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  res = priv->latency;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+
+  return res;
+}
+
+static gboolean
+compare_media (gpointer key, GstRTSPMedia * media1, GstRTSPMedia * media2)
+{
+  return (media1 == media2);
+}
+
+static void
+media_unprepared (GstRTSPMedia * media, GWeakRef * ref)
+{
+  GstRTSPMediaFactory *factory = g_weak_ref_get (ref);
+  GstRTSPMediaFactoryPrivate *priv;
+
+  if (!factory)
+    return;
+
+  priv = factory->priv;
+
+  g_mutex_lock (&priv->medias_lock);
+  g_hash_table_foreach_remove (priv->medias, (GHRFunc) compare_media, media);
+  g_mutex_unlock (&priv->medias_lock);
+
+  g_object_unref (factory);
+}
+
+static GWeakRef *
+weak_ref_new (gpointer obj)
+{
+  GWeakRef *ref = g_slice_new (GWeakRef);
+
+  g_weak_ref_init (ref, obj);
+  return ref;
+}
+
+static void
+weak_ref_free (GWeakRef * ref)
+{
+  g_weak_ref_clear (ref);
+  g_slice_free (GWeakRef, ref);
+}
+
+static void
+warm_pool_free (WarmPool * wpool)
 {
-  return (media1 == media2);
+  /* the media must have been taken out with clear_warm_pools() */
+  g_warn_if_fail (g_queue_is_empty (&wpool->medias));
+  gst_rtsp_url_free (wpool->url);
+  g_slice_free (WarmPool, wpool);
 }
 
+/* unprepare and release the media collected by clear_warm_pools(), must be
+ * called without the warm_lock */
 static void
-media_unprepared (GstRTSPMedia * media, GWeakRef * ref)
+drop_warm_media (GList * drop)
+{
+  GList *walk;
+
+  for (walk = drop; walk; walk = g_list_next (walk)) {
+    GstRTSPMedia *media = walk->data;
+
+    GST_DEBUG ("dropping warm media %p", media);
+    gst_rtsp_media_unprepare (media);
+    g_object_unref (media);
+  }
+  g_list_free (drop);
+}
+
+/* must be called with warm_lock */
+static GList *
+steal_warm_media (WarmPool * wpool, guint keep, GList * drop)
+{
+  while (g_queue_get_length (&wpool->medias) > keep)
+    drop = g_list_prepend (drop, g_queue_pop_tail (&wpool->medias));
+
+  return drop;
+}
+
+static void
+destroy_source (GSource ** source)
+{
+  if (*source) {
+    g_source_destroy (*source);
+    g_source_unref (*source);
+    *source = NULL;
+  }
+}
+
+/* trim all pools to @keep media, 0 removes all pools. Returns @drop with the
+ * media that should be released with drop_warm_media() */
+static GList *
+clear_warm_pools (GstRTSPMediaFactory * factory, guint keep, GList * drop)
+{
+  GstRTSPMediaFactoryPrivate *priv = factory->priv;
+  GHashTableIter iter;
+  gpointer value;
+
+  g_mutex_lock (&priv->warm_lock);
+  g_hash_table_iter_init (&iter, priv->warm_pools);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    drop = steal_warm_media (value, keep, drop);
+
+  if (keep == 0) {
+    g_hash_table_remove_all (priv->warm_pools);
+    destroy_source (&priv->warm_refill_source);
+    destroy_source (&priv->warm_expire_source);
+  }
+  g_mutex_unlock (&priv->warm_lock);
+
+  return drop;
+}
+
+/* forget about the pool of @key, used when we fail to fill it */
+static void
+remove_warm_pool (GstRTSPMediaFactory * factory, const gchar * key)
+{
+  GstRTSPMediaFactoryPrivate *priv = factory->priv;
+  WarmPool *wpool;
+  GList *drop = NULL;
+
+  g_mutex_lock (&priv->warm_lock);
+  wpool = g_hash_table_lookup (priv->warm_pools, key);
+  if (wpool) {
+    drop = steal_warm_media (wpool, 0, NULL);
+    g_hash_table_remove (priv->warm_pools, key);
+  }
+  g_mutex_unlock (&priv->warm_lock);
+
+  drop_warm_media (drop);
+}
+
+/* construct and configure a new media for @url, called with the medias_lock
+ * from gst_rtsp_media_factory_construct() and without it when filling the
+ * warm pool */
+static GstRTSPMedia *
+construct_media (GstRTSPMediaFactory * factory, const GstRTSPUrl * url)
+{
+  GstRTSPMediaFactoryClass *klass;
+  GstRTSPMedia *media;
+
+  klass = GST_RTSP_MEDIA_FACTORY_GET_CLASS (factory);
+
+  if (klass->construct) {
+    media = klass->construct (factory, url);
+    if (media)
+      g_signal_emit (factory,
+          gst_rtsp_media_factory_signals[SIGNAL_MEDIA_CONSTRUCTED], 0, media,
+          NULL);
+  } else
+    media = NULL;
+
+  if (media) {
+    /* configure the media */
+    if (klass->configure)
+      klass->configure (factory, media);
+
+    g_signal_emit (factory,
+        gst_rtsp_media_factory_signals[SIGNAL_MEDIA_CONFIGURE], 0, media,
+        NULL);
+  }
+  return media;
+}
+
+/* find a pool with less than warm_pool_size media, must be called with
+ * warm_lock */
+static gboolean
+find_unfilled_pool (GstRTSPMediaFactory * factory, gchar ** key,
+    GstRTSPUrl ** url)
+{
+  GstRTSPMediaFactoryPrivate *priv = factory->priv;
+  GHashTableIter iter;
+  gpointer k, value;
+
+  g_hash_table_iter_init (&iter, priv->warm_pools);
+  while (g_hash_table_iter_next (&iter, &k, &value)) {
+    WarmPool *wpool = value;
+
+    if (g_queue_get_length (&wpool->medias) < priv->warm_pool_size) {
+      *key = g_strdup (k);
+      *url = gst_rtsp_url_copy (wpool->url);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static void
+warm_prepare_free (WarmPrepare * wprep)
+{
+  g_weak_ref_clear (&wprep->factory);
+  g_free (wprep->key);
+  g_slice_free (WarmPrepare, wprep);
+}
+
+/* add the prepared @media to the pool of @key and continue filling the
+ * pools. Takes the reference of @media. */
+static void
+finish_warm_prepare (GstRTSPMediaFactory * factory, const gchar * key,
+    GstRTSPMedia * media, GstRTSPMediaStatus status)
+{
+  GstRTSPMediaFactoryPrivate *priv = factory->priv;
+  WarmPool *wpool;
+
+  if (status != GST_RTSP_MEDIA_STATUS_PREPARED)
+    goto prepare_failed;
+
+  g_mutex_lock (&priv->warm_lock);
+  wpool = g_hash_table_lookup (priv->warm_pools, key);
+  if (wpool && g_queue_get_length (&wpool->medias) < priv->warm_pool_size) {
+    GST_DEBUG ("warm media %p ready for key %s", media, key);
+    g_queue_push_tail (&wpool->medias, media);
+    media = NULL;
+  }
+  g_mutex_unlock (&priv->warm_lock);
+
+  if (media) {
+    /* the pool was removed or shrunk while we were preparing */
+    gst_rtsp_media_unprepare (media);
+    g_object_unref (media);
+  }
+
+done:
+  g_mutex_lock (&priv->warm_lock);
+  priv->warm_preparing = FALSE;
+  if (priv->warm_pool_size > 0 && g_hash_table_size (priv->warm_pools) > 0)
+    schedule_warm_refill (factory);
+  g_mutex_unlock (&priv->warm_lock);
+  return;
+
+  /* ERRORS */
+prepare_failed:
+  {
+    GST_WARNING ("could not prepare warm media for key %s", key);
+    g_object_unref (media);
+    remove_warm_pool (factory, key);
+    goto done;
+  }
+}
+
+/* called from the thread of @media when it prerolled */
+static void
+warm_media_prepared (GstRTSPMedia * media, GstRTSPMediaStatus status,
+    WarmPrepare * wprep)
+{
+  GstRTSPMediaFactory *factory;
+
+  if (status != GST_RTSP_MEDIA_STATUS_PREPARED)
+    gst_rtsp_media_unprepare (media);
+
+  factory = g_weak_ref_get (&wprep->factory);
+  if (factory) {
+    finish_warm_prepare (factory, wprep->key, media, status);
+    g_object_unref (factory);
+  } else {
+    if (status == GST_RTSP_MEDIA_STATUS_PREPARED)
+      gst_rtsp_media_unprepare (media);
+    g_object_unref (media);
+  }
+}
+
+/* starts preparing one media for a pool that is not full yet, runs in the
+ * warm thread. The media prerolls without blocking the warm thread, which can
+ * be shared with other media, and the pools are filled further when it is
+ * done. */
+static gboolean
+refill_warm_pools (GWeakRef * ref)
 {
   GstRTSPMediaFactory *factory = g_weak_ref_get (ref);
   GstRTSPMediaFactoryPrivate *priv;
+  GstRTSPMedia *media;
+  GstRTSPThread *thread;
+  GstRTSPMediaStatus status;
+  WarmPrepare *wprep;
+  gchar *key;
+  GstRTSPUrl *url;
 
   if (!factory)
-    return;
+    return G_SOURCE_REMOVE;
 
   priv = factory->priv;
 
-  g_mutex_lock (&priv->medias_lock);
-  g_hash_table_foreach_remove (priv->medias, (GHRFunc) compare_media, media);
-  g_mutex_unlock (&priv->medias_lock);
+  g_mutex_lock (&priv->warm_lock);
+  if (!find_unfilled_pool (factory, &key, &url))
+    goto all_filled;
+  g_mutex_unlock (&priv->warm_lock);
+
+  media = construct_media (factory, url);
+  if (media == NULL)
+    goto no_media;
+
+  if (gst_rtsp_media_is_shared (media) ||
+      gst_rtsp_media_get_transport_mode (media) !=
+      GST_RTSP_TRANSPORT_MODE_PLAY)
+    goto not_poolable;
+
+  /* stop refilling until this media is prepared */
+  g_mutex_lock (&priv->warm_lock);
+  thread = gst_rtsp_thread_pool_get_thread (priv->warm_thread_pool,
+      GST_RTSP_THREAD_TYPE_MEDIA, NULL);
+  priv->warm_preparing = TRUE;
+  destroy_source (&priv->warm_refill_source);
+  g_mutex_unlock (&priv->warm_lock);
+
+  wprep = g_slice_new (WarmPrepare);
+  g_weak_ref_init (&wprep->factory, factory);
+  wprep->key = g_strdup (key);
+
+  /* the reference of media is released by warm_media_prepared() unless it
+   * is done preparing already */
+  status = gst_rtsp_media_prepare_async (media, thread,
+      (GstRTSPMediaPrepareFunc) warm_media_prepared, wprep,
+      (GDestroyNotify) warm_prepare_free);
+  if (status != GST_RTSP_MEDIA_STATUS_PREPARING)
+    finish_warm_prepare (factory, key, media, status);
+
+  g_free (key);
+  gst_rtsp_url_free (url);
+  g_object_unref (factory);
 
+  return G_SOURCE_REMOVE;
+
+done:
+  g_free (key);
+  gst_rtsp_url_free (url);
   g_object_unref (factory);
+
+  return G_SOURCE_CONTINUE;
+
+all_filled:
+  {
+    destroy_source (&priv->warm_refill_source);
+    g_mutex_unlock (&priv->warm_lock);
+    g_object_unref (factory);
+    return G_SOURCE_REMOVE;
+  }
+no_media:
+  {
+    GST_WARNING ("could not construct warm media for key %s", key);
+    remove_warm_pool (factory, key);
+    goto done;
+  }
+not_poolable:
+  {
+    GST_WARNING ("media for key %s can not be kept in the warm pool", key);
+    g_object_unref (media);
+    remove_warm_pool (factory, key);
+    goto done;
+  }
 }
 
-static GWeakRef *
-weak_ref_new (gpointer obj)
+/* releases the pools that were not used for warm_pool_timeout seconds */
+static gboolean
+expire_warm_pools (GWeakRef * ref)
 {
-  GWeakRef *ref = g_slice_new (GWeakRef);
+  GstRTSPMediaFactory *factory = g_weak_ref_get (ref);
+  GstRTSPMediaFactoryPrivate *priv;
+  GHashTableIter iter;
+  gpointer key, value;
+  gint64 now;
+  GList *drop = NULL;
 
-  g_weak_ref_init (ref, obj);
-  return ref;
+  if (!factory)
+    return G_SOURCE_REMOVE;
+
+  priv = factory->priv;
+  now = g_get_monotonic_time ();
+
+  g_mutex_lock (&priv->warm_lock);
+  if (priv->warm_pool_timeout > 0) {
+    g_hash_table_iter_init (&iter, priv->warm_pools);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+      WarmPool *wpool = value;
+
+      if (now - wpool->last_used <
+          (gint64) priv->warm_pool_timeout * G_USEC_PER_SEC)
+        continue;
+
+      GST_DEBUG ("warm pool for key %s expired", (gchar *) key);
+      drop = steal_warm_media (wpool, 0, drop);
+      g_hash_table_iter_remove (&iter);
+    }
+  }
+  g_mutex_unlock (&priv->warm_lock);
+
+  drop_warm_media (drop);
+  g_object_unref (factory);
+
+  return G_SOURCE_CONTINUE;
 }
 
+/* make sure the warm thread runs and fills the pools, must be called with
+ * warm_lock */
 static void
-weak_ref_free (GWeakRef * ref)
+schedule_warm_refill (GstRTSPMediaFactory * factory)
 {
-  g_weak_ref_clear (ref);
-  g_slice_free (GWeakRef, ref);
+  GstRTSPMediaFactoryPrivate *priv = factory->priv;
+
+  if (priv->warm_thread == NULL) {
+    GstRTSPThreadPool *pool;
+
+    pool = priv->thread_pool ? priv->thread_pool : priv->fallback_thread_pool;
+    if (pool == NULL)
+      goto no_pool;
+
+    priv->warm_thread_pool = g_object_ref (pool);
+    priv->warm_thread = gst_rtsp_thread_pool_get_thread (priv->warm_thread_pool,
+        GST_RTSP_THREAD_TYPE_MEDIA, NULL);
+    if (priv->warm_thread == NULL)
+      goto no_thread;
+  }
+
+  /* a media that is prerolling schedules the refill again when it is done */
+  if (priv->warm_refill_source == NULL && !priv->warm_preparing) {
+    GSource *source;
+
+    source = g_idle_source_new ();
+    g_source_set_callback (source, (GSourceFunc) refill_warm_pools,
+        weak_ref_new (factory), (GDestroyNotify) weak_ref_free);
+    g_source_attach (source, priv->warm_thread->context);
+    priv->warm_refill_source = source;
+  }
+
+  if (priv->warm_expire_source == NULL) {
+    GSource *source;
+
+    source = g_timeout_source_new_seconds (1);
+    g_source_set_callback (source, (GSourceFunc) expire_warm_pools,
+        weak_ref_new (factory), (GDestroyNotify) weak_ref_free);
+    g_source_attach (source, priv->warm_thread->context);
+    priv->warm_expire_source = source;
+  }
+  return;
+
+  /* ERRORS */
+no_pool:
+  {
+    GST_DEBUG ("no thread pool to fill the warm pool with");
+    return;
+  }
+no_thread:
+  {
+    GST_WARNING ("could not get a thread for the warm pool");
+    g_clear_object (&priv->warm_thread_pool);
+    return;
+  }
+}
+
+/* get a prepared media for @key from the warm pool and make sure the pool is
+ * filled again. Must be called with the medias_lock */
+static GstRTSPMedia *
+take_warm_media (GstRTSPMediaFactory * factory, const gchar * key,
+    const GstRTSPUrl * url)
+{
+  GstRTSPMediaFactoryPrivate *priv = factory->priv;
+  GstRTSPMedia *media = NULL;
+  WarmPool *wpool;
+  gboolean poolable;
+  GList *drop = NULL;
+
+  GST_RTSP_MEDIA_FACTORY_LOCK (factory);
+  poolable = !priv->shared &&
+      priv->transport_mode == GST_RTSP_TRANSPORT_MODE_PLAY;
+  GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+
+  if (!poolable)
+    return NULL;
+
+  g_mutex_lock (&priv->warm_lock);
+  if (priv->warm_pool_size == 0)
+    goto disabled;
+
+  wpool = g_hash_table_lookup (priv->warm_pools, key);
+  if (wpool == NULL) {
+    wpool = g_slice_new0 (WarmPool);
+    wpool->url = gst_rtsp_url_copy (url);
+    g_queue_init (&wpool->medias);
+    g_hash_table_insert (priv->warm_pools, g_strdup (key), wpool);
+  }
+  wpool->last_used = g_get_monotonic_time ();
+
+  while ((media = g_queue_pop_head (&wpool->medias))) {
+    if (gst_rtsp_media_get_status (media) == GST_RTSP_MEDIA_STATUS_PREPARED)
+      break;
+    /* something went wrong with the pipeline while it was waiting */
+    drop = g_list_prepend (drop, media);
+  }
+
+  if (media) {
+    priv->warm_hits++;
+    GST_DEBUG ("took warm media %p for key %s", media, key);
+  } else {
+    priv->warm_misses++;
+  }
+  schedule_warm_refill (factory);
+  g_mutex_unlock (&priv->warm_lock);
+
+  drop_warm_media (drop);
+
+  if (media)
+    gst_rtsp_media_hand_over_prepared (media);
+
+  return media;
+
+disabled:
+  {
+    g_mutex_unlock (&priv->warm_lock);
+    return NULL;
+  }
 }
 
 /**
@@ -1195,26 +2630,15 @@ gst_rtsp_media_factory_construct (GstRTSPMediaFactory * factory,
   } else
     media = NULL;
 
+  /* a non-shared media might be waiting in the warm pool */
+  if (media == NULL && key)
+    media = take_warm_media (factory, key, url);
+
   if (media == NULL) {
     /* nothing cached found, try to create one */
-    if (klass->construct) {
-      media = klass->construct (factory, url);
-      if (media)
-        g_signal_emit (factory,
-            gst_rtsp_media_factory_signals[SIGNAL_MEDIA_CONSTRUCTED], 0, media,
-            NULL);
-    } else
-      media = NULL;
+    media = construct_media (factory, url);
 
     if (media) {
-      /* configure the media */
-      if (klass->configure)
-        klass->configure (factory, media);
-
-      g_signal_emit (factory,
-          gst_rtsp_media_factory_signals[SIGNAL_MEDIA_CONFIGURE], 0, media,
-          NULL);
-
       /* check if we can cache this media */
       if (gst_rtsp_media_is_shared (media) && key) {
         /* insert in the hashtable, takes ownership of the key */
@@ -1401,6 +2825,260 @@ default_gen_key (GstRTSPMediaFactory * factory, const GstRTSPUrl * url)
   return result;
 }
 
+static void
+launch_template_free (LaunchTemplate * templ)
+{
+  guint i;
+
+  for (i = 0; i < templ->props->len; i++)
+    g_value_unset (&g_array_index (templ->props, TemplateProp, i).value);
+  g_array_free (templ->props, TRUE);
+
+  if (templ->children)
+    g_ptr_array_free (templ->children, TRUE);
+  if (templ->links) {
+    for (i = 0; i < templ->links->len; i++) {
+      TemplateLink *link = &g_array_index (templ->links, TemplateLink, i);
+
+      g_free (link->src_pad);
+      g_free (link->sink_pad);
+    }
+    g_array_free (templ->links, TRUE);
+  }
+  gst_object_unref (templ->factory);
+  g_free (templ->name);
+  g_slice_free (LaunchTemplate, templ);
+}
+
+/* elements with sometimes pads are linked by gst_parse_launch() when the pads
+ * appear, we can't replay that */
+static gboolean
+has_sometimes_pads (GstElementFactory * factory)
+{
+  const GList *walk;
+
+  for (walk = gst_element_factory_get_static_pad_templates (factory); walk;
+      walk = g_list_next (walk)) {
+    GstStaticPadTemplate *templ = walk->data;
+
+    if (templ->presence == GST_PAD_SOMETIMES)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* remember the properties of @element that differ from those of a new element
+ * of the same factory. Elements can change the defaults of their param specs
+ * when they are made, so compare against a real instance. Fails when a
+ * property could have been set but can't be read back. */
+static gboolean
+compile_properties (LaunchTemplate * templ, GstElement * element)
+{
+  GstElement *fresh;
+  GParamSpec **specs;
+  guint i, n_specs;
+
+  fresh = gst_element_factory_create (templ->factory, NULL);
+  if (fresh == NULL)
+    return FALSE;
+  gst_object_ref_sink (fresh);
+
+  specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (element),
+      &n_specs);
+  for (i = 0; i < n_specs; i++) {
+    GParamSpec *spec = specs[i];
+    TemplateProp prop = { NULL, G_VALUE_INIT };
+    GValue value = G_VALUE_INIT;
+    gint cmp;
+
+    if (spec->flags & G_PARAM_CONSTRUCT_ONLY)
+      continue;
+    if ((spec->flags & G_PARAM_READWRITE) == G_PARAM_WRITABLE)
+      goto write_only;
+    if (!(spec->flags & G_PARAM_WRITABLE))
+      continue;
+    /* the name is given when creating the element, objects can't be shared
+     * between the pipelines */
+    if (g_str_equal (spec->name, "name") ||
+        G_TYPE_IS_OBJECT (spec->value_type) ||
+        G_TYPE_IS_INTERFACE (spec->value_type))
+      continue;
+
+    g_value_init (&prop.value, spec->value_type);
+    g_object_get_property (G_OBJECT (element), spec->name, &prop.value);
+    g_value_init (&value, spec->value_type);
+    g_object_get_property (G_OBJECT (fresh), spec->name, &value);
+    cmp = g_param_values_cmp (spec, &prop.value, &value);
+    g_value_unset (&value);
+    if (cmp == 0) {
+      g_value_unset (&prop.value);
+      continue;
+    }
+    prop.name = spec->name;
+    g_array_append_val (templ->props, prop);
+  }
+  g_free (specs);
+  gst_object_unref (fresh);
+
+  return TRUE;
+
+  /* ERRORS */
+write_only:
+  {
+    GST_DEBUG ("property %s of %s is write-only", specs[i]->name,
+        GST_OBJECT_NAME (templ->factory));
+    g_free (specs);
+    gst_object_unref (fresh);
+    return FALSE;
+  }
+}
+
+/* make a template from the parsed @element or return %NULL when it can not be
+ * recreated from its factories, properties and links alone */
+static LaunchTemplate *
+compile_launch_template (GstElement * element)
+{
+  GstElementFactory *factory;
+  LaunchTemplate *templ;
+  GList *children, *walk;
+
+  factory = gst_element_get_factory (element);
+  if (factory == NULL || has_sometimes_pads (factory))
+    return NULL;
+
+  templ = g_slice_new0 (LaunchTemplate);
+  templ->factory = gst_object_ref (factory);
+  templ->name = gst_element_get_name (element);
+  templ->props = g_array_new (FALSE, FALSE, sizeof (TemplateProp));
+  if (!compile_properties (templ, element))
+    goto not_compilable;
+
+  /* only look inside the bins made by the parser, other bins create their
+   * own children */
+  if (!GST_IS_BIN (element) ||
+      !g_str_equal (GST_OBJECT_NAME (factory), "bin")) {
+    /* the launch line can set properties of their children, which are not
+     * in the template */
+    if (GST_IS_CHILD_PROXY (element))
+      goto not_compilable;
+    return templ;
+  }
+
+  /* links to elements outside of the bin would need ghostpads */
+  if (element->numpads > 0)
+    goto not_compilable;
+
+  templ->children =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) launch_template_free);
+  templ->links = g_array_new (FALSE, FALSE, sizeof (TemplateLink));
+
+  /* the children list is in reverse order of adding */
+  children = g_list_reverse (g_list_copy (GST_BIN_CHILDREN (element)));
+  for (walk = children; walk; walk = g_list_next (walk)) {
+    LaunchTemplate *child;
+
+    child = compile_launch_template (walk->data);
+    if (child == NULL)
+      goto child_failed;
+    g_ptr_array_add (templ->children, child);
+  }
+
+  for (walk = children; walk; walk = g_list_next (walk)) {
+    GstElement *src = walk->data;
+    GList *pads;
+
+    for (pads = src->srcpads; pads; pads = g_list_next (pads)) {
+      GstPad *pad = pads->data, *peer;
+      GstElement *sink;
+      TemplateLink link;
+      gint sink_idx;
+
+      peer = gst_pad_get_peer (pad);
+      if (peer == NULL)
+        continue;
+
+      sink = gst_pad_get_parent_element (peer);
+      sink_idx = sink ? g_list_index (children, sink) : -1;
+      if (sink_idx < 0) {
+        if (sink)
+          gst_object_unref (sink);
+        gst_object_unref (peer);
+        goto child_failed;
+      }
+      link.src = g_list_position (children, walk);
+      link.src_pad = gst_pad_get_name (pad);
+      link.sink = sink_idx;
+      link.sink_pad = gst_pad_get_name (peer);
+      g_array_append_val (templ->links, link);
+
+      gst_object_unref (sink);
+      gst_object_unref (peer);
+    }
+  }
+  g_list_free (children);
+
+  return templ;
+
+  /* ERRORS */
+child_failed:
+  {
+    g_list_free (children);
+    goto not_compilable;
+  }
+not_compilable:
+  {
+    launch_template_free (templ);
+    return NULL;
+  }
+}
+
+/* create a new element from @templ, returns a floating ref like
+ * gst_parse_launch() */
+static GstElement *
+instantiate_launch_template (LaunchTemplate * templ)
+{
+  GstElement *element, **children;
+  guint i;
+
+  element = gst_element_factory_create (templ->factory, templ->name);
+  if (element == NULL)
+    return NULL;
+
+  for (i = 0; i < templ->props->len; i++) {
+    TemplateProp *prop = &g_array_index (templ->props, TemplateProp, i);
+
+    g_object_set_property (G_OBJECT (element), prop->name, &prop->value);
+  }
+
+  if (templ->children == NULL)
+    return element;
+
+  children = g_newa (GstElement *, templ->children->len);
+  for (i = 0; i < templ->children->len; i++) {
+    children[i] =
+        instantiate_launch_template (g_ptr_array_index (templ->children, i));
+    if (children[i] == NULL)
+      goto failed;
+    gst_bin_add (GST_BIN (element), children[i]);
+  }
+
+  for (i = 0; i < templ->links->len; i++) {
+    TemplateLink *link = &g_array_index (templ->links, TemplateLink, i);
+
+    if (!gst_element_link_pads (children[link->src], link->src_pad,
+            children[link->sink], link->sink_pad))
+      goto failed;
+  }
+  return element;
+
+  /* ERRORS */
+failed:
+  {
+    gst_object_unref (gst_object_ref_sink (element));
+    return NULL;
+  }
+}
+
 static GstElement *
 default_create_element (GstRTSPMediaFactory * factory, const GstRTSPUrl * url)
 {
@@ -1413,6 +3091,18 @@ default_create_element (GstRTSPMediaFactory * factory, const GstRTSPUrl * url)
   if (priv->launch == NULL)
     goto no_launch;
 
+  /* the launch line was parsed before, make a copy of that pipeline */
+  if (priv->launch_template) {
+    element = instantiate_launch_template (priv->launch_template);
+    if (element) {
+      GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
+      return element;
+    }
+    GST_WARNING ("could not instantiate template, parsing launch line");
+    launch_template_free (priv->launch_template);
+    priv->launch_template = NULL;
+  }
+
   /* parse the user provided launch line */
   element =
       gst_parse_launch_full (priv->launch, NULL, GST_PARSE_FLAG_PLACE_IN_BIN,
@@ -1420,6 +3110,15 @@ default_create_element (GstRTSPMediaFactory * factory, const GstRTSPUrl * url)
   if (element == NULL)
     goto parse_error;
 
+  /* remember the parsed pipeline so that we don't have to parse again, not
+   * when the parser had to recover from an error */
+  if (!priv->launch_compiled) {
+    priv->launch_compiled = TRUE;
+    if (error == NULL)
+      priv->launch_template = compile_launch_template (element);
+    GST_DEBUG ("launch line %s compiled: %s", priv->launch,
+        priv->launch_template ? "yes" : "no");
+  }
   GST_RTSP_MEDIA_FACTORY_UNLOCK (factory);
 
   if (error != NULL) {
@@ -1522,6 +3221,14 @@ default_configure (GstRTSPMediaFactory * factory, GstRTSPMedia * media)
   GstRTSPMediaFactoryPrivate *priv = factory->priv;
   gboolean shared, eos_shutdown, stop_on_disconnect;
   guint size;
+  gboolean udp_fanout;
+  guint fanout_threads;
+  guint fanout_queue_size;
+  GstRTSPFanoutPartition fanout_partition;
+  guint gop_cache_size;
+  guint recv_batch_size;
+  guint prepare_timeout;
+  gboolean pacing;
   GstRTSPSuspendMode suspend_mode;
   GstRTSPProfile profiles;
   GstRTSPLowerTrans protocols;
@@ -1540,6 +3247,14 @@ default_configure (GstRTSPMediaFactory * factory, GstRTSPMedia * media)
   shared = priv->shared;
   eos_shutdown = priv->eos_shutdown;
   size = priv->buffer_size;
+  udp_fanout = priv->udp_fanout;
+  fanout_threads = priv->fanout_threads;
+  fanout_queue_size = priv->fanout_queue_size;
+  fanout_partition = priv->fanout_partition;
+  gop_cache_size = priv->gop_cache_size;
+  recv_batch_size = priv->recv_batch_size;
+  prepare_timeout = priv->prepare_timeout;
+  pacing = priv->pacing;
   profiles = priv->profiles;
   protocols = priv->protocols;
   rtx_time = priv->rtx_time;
@@ -1554,6 +3269,14 @@ default_configure (GstRTSPMediaFactory * factory, GstRTSPMedia * media)
   gst_rtsp_media_set_shared (media, shared);
   gst_rtsp_media_set_eos_shutdown (media, eos_shutdown);
   gst_rtsp_media_set_buffer_size (media, size);
+  gst_rtsp_media_set_udp_fanout (media, udp_fanout);
+  gst_rtsp_media_set_fanout_threads (media, fanout_threads);
+  gst_rtsp_media_set_fanout_queue_size (media, fanout_queue_size);
+  gst_rtsp_media_set_fanout_partition (media, fanout_partition);
+  gst_rtsp_media_set_gop_cache_size (media, gop_cache_size);
+  gst_rtsp_media_set_recv_batch_size (media, recv_batch_size);
+  gst_rtsp_media_set_prepare_timeout (media, prepare_timeout);
+  gst_rtsp_media_set_pacing (media, pacing);
   gst_rtsp_media_set_profiles (media, profiles);
   gst_rtsp_media_set_protocols (media, protocols);
   gst_rtsp_media_set_retransmission_time (media, rtx_time);
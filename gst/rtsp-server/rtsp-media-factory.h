@@ -188,6 +188,86 @@ void                  gst_rtsp_media_factory_set_buffer_size  (GstRTSPMediaFacto
 GST_EXPORT
 guint                 gst_rtsp_media_factory_get_buffer_size  (GstRTSPMediaFactory * factory);
 
+GST_EXPORT
+void                  gst_rtsp_media_factory_set_udp_fanout   (GstRTSPMediaFactory * factory,
+                                                               gboolean udp_fanout);
+
+GST_EXPORT
+gboolean              gst_rtsp_media_factory_get_udp_fanout   (GstRTSPMediaFactory * factory);
+
+GST_EXPORT
+void                  gst_rtsp_media_factory_set_fanout_threads (GstRTSPMediaFactory * factory,
+                                                                 guint n_threads);
+
+GST_EXPORT
+guint                 gst_rtsp_media_factory_get_fanout_threads (GstRTSPMediaFactory * factory);
+
+GST_EXPORT
+void                  gst_rtsp_media_factory_set_fanout_queue_size (GstRTSPMediaFactory * factory,
+                                                                    guint size);
+
+GST_EXPORT
+guint                 gst_rtsp_media_factory_get_fanout_queue_size (GstRTSPMediaFactory * factory);
+
+GST_EXPORT
+void                  gst_rtsp_media_factory_set_fanout_partition (GstRTSPMediaFactory * factory,
+                                                                   GstRTSPFanoutPartition partition);
+
+GST_EXPORT
+GstRTSPFanoutPartition gst_rtsp_media_factory_get_fanout_partition (GstRTSPMediaFactory * factory);
+
+GST_EXPORT
+void                  gst_rtsp_media_factory_set_gop_cache_size (GstRTSPMediaFactory * factory,
+                                                                 guint size);
+
+GST_EXPORT
+guint                 gst_rtsp_media_factory_get_gop_cache_size (GstRTSPMediaFactory * factory);
+
+GST_EXPORT
+void                  gst_rtsp_media_factory_set_recv_batch_size (GstRTSPMediaFactory * factory,
+                                                                  guint size);
+
+GST_EXPORT
+guint                 gst_rtsp_media_factory_get_recv_batch_size (GstRTSPMediaFactory * factory);
+
+GST_EXPORT
+void                  gst_rtsp_media_factory_set_prepare_timeout (GstRTSPMediaFactory * factory,
+                                                                  guint timeout);
+
+GST_EXPORT
+guint                 gst_rtsp_media_factory_get_prepare_timeout (GstRTSPMediaFactory * factory);
+
+GST_EXPORT
+void                  gst_rtsp_media_factory_set_pacing (GstRTSPMediaFactory * factory,
+                                                         gboolean pacing);
+
+GST_EXPORT
+gboolean              gst_rtsp_media_factory_get_pacing (GstRTSPMediaFactory * factory);
+
+GST_EXPORT
+void                  gst_rtsp_media_factory_set_warm_pool_size (GstRTSPMediaFactory * factory,
+                                                                 guint size);
+
+GST_EXPORT
+guint                 gst_rtsp_media_factory_get_warm_pool_size (GstRTSPMediaFactory * factory);
+
+GST_EXPORT
+void                  gst_rtsp_media_factory_set_warm_pool_timeout (GstRTSPMediaFactory * factory,
+                                                                    guint timeout);
+
+GST_EXPORT
+guint                 gst_rtsp_media_factory_get_warm_pool_timeout (GstRTSPMediaFactory * factory);
+
+GST_EXPORT
+GstStructure *        gst_rtsp_media_factory_get_warm_pool_stats (GstRTSPMediaFactory * factory);
+
+GST_EXPORT
+void                  gst_rtsp_media_factory_set_thread_pool (GstRTSPMediaFactory * factory,
+                                                              GstRTSPThreadPool * pool);
+
+GST_EXPORT
+GstRTSPThreadPool *   gst_rtsp_media_factory_get_thread_pool (GstRTSPMediaFactory * factory);
+
 GST_EXPORT
 void                  gst_rtsp_media_factory_set_retransmission_time (GstRTSPMediaFactory * factory,
                                                                       GstClockTime time);
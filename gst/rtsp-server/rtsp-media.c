@@ -80,6 +80,7 @@
 #define HMAC_80_KEY_LEN 10
 
 #include "rtsp-media.h"
+#include "rtsp-server-internal.h"
 
 #define GST_RTSP_MEDIA_GET_PRIVATE(obj)  \
      (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTSP_MEDIA, GstRTSPMediaPrivate))
@@ -99,6 +100,14 @@ struct _GstRTSPMediaPrivate
   gboolean reused;
   gboolean eos_shutdown;
   guint buffer_size;
+  gboolean udp_fanout;
+  guint fanout_threads;
+  guint fanout_queue_size;
+  GstRTSPFanoutPartition fanout_partition;
+  guint gop_cache_size;
+  guint recv_batch_size;
+  guint prepare_timeout;
+  gboolean pacing;
   GstRTSPAddressPool *pool;
   gchar *multicast_iface;
   gboolean blocked;
@@ -111,6 +120,14 @@ struct _GstRTSPMediaPrivate
   GList *dynamic;               /* protected by lock */
   GstRTSPMediaStatus status;    /* protected by lock */
   gint prepare_count;
+  GList *prepare_waiters;       /* protected by lock */
+  GSource *prepare_timeout_source;      /* protected by lock */
+
+  /* the media sections of the SDP for IPv4 and IPv6 clients, protected by
+   * lock */
+  GstSDPMessage *sdp_cache[2];
+  guint sdp_cache_cookie[2];
+  gint sdp_generation;          /* atomic */
   gint n_active;
   gboolean adding;
 
@@ -120,6 +137,7 @@ struct _GstRTSPMediaPrivate
   GSource *source;
   guint id;
   GstRTSPThread *thread;
+  gulong stream_status_id;
 
   gboolean time_provider;
   GstNetTimeProvider *nettime;
@@ -152,10 +170,18 @@ struct _GstRTSPMediaPrivate
                                         GST_RTSP_LOWER_TRANS_TCP
 #define DEFAULT_EOS_SHUTDOWN    FALSE
 #define DEFAULT_BUFFER_SIZE     0x80000
+#define DEFAULT_UDP_FANOUT      FALSE
 #define DEFAULT_TIME_PROVIDER   FALSE
 #define DEFAULT_LATENCY         200
 #define DEFAULT_TRANSPORT_MODE  GST_RTSP_TRANSPORT_MODE_PLAY
 #define DEFAULT_STOP_ON_DISCONNECT TRUE
+#define DEFAULT_FANOUT_THREADS  0
+#define DEFAULT_FANOUT_QUEUE_SIZE 256
+#define DEFAULT_FANOUT_PARTITION GST_RTSP_FANOUT_PARTITION_HASH
+#define DEFAULT_GOP_CACHE_SIZE  0
+#define DEFAULT_RECV_BATCH_SIZE 0
+#define DEFAULT_PREPARE_TIMEOUT 20
+#define DEFAULT_PACING          FALSE
 
 /* define to dump received RTCP packets */
 #undef DUMP_STATS
@@ -170,12 +196,20 @@ enum
   PROP_PROTOCOLS,
   PROP_EOS_SHUTDOWN,
   PROP_BUFFER_SIZE,
+  PROP_UDP_FANOUT,
   PROP_ELEMENT,
   PROP_TIME_PROVIDER,
   PROP_LATENCY,
   PROP_TRANSPORT_MODE,
   PROP_STOP_ON_DISCONNECT,
   PROP_CLOCK,
+  PROP_FANOUT_THREADS,
+  PROP_FANOUT_QUEUE_SIZE,
+  PROP_FANOUT_PARTITION,
+  PROP_GOP_CACHE_SIZE,
+  PROP_RECV_BATCH_SIZE,
+  PROP_PREPARE_TIMEOUT,
+  PROP_PACING,
   PROP_LAST
 };
 
@@ -217,6 +251,10 @@ static gboolean default_setup_sdp (GstRTSPMedia * media, GstSDPMessage * sdp,
 static gboolean default_handle_sdp (GstRTSPMedia * media, GstSDPMessage * sdp);
 
 static gboolean wait_preroll (GstRTSPMedia * media);
+static GList *take_prepare_waiters (GstRTSPMedia * media);
+static void clear_sdp_cache (GstRTSPMedia * media);
+static void notify_prepare_waiters (GstRTSPMedia * media, GList * waiters,
+    GstRTSPMediaStatus status);
 
 static GstElement *find_payload_element (GstElement * payloader);
 
@@ -338,6 +376,12 @@ gst_rtsp_media_class_init (GstRTSPMediaClass * klass)
           "The kernel UDP buffer size to use", 0, G_MAXUINT,
           DEFAULT_BUFFER_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_UDP_FANOUT,
+      g_param_spec_boolean ("udp-fanout", "UDP Fanout",
+          "Send to UDP unicast destinations with a dedicated sender that "
+          "batches packets",
+          DEFAULT_UDP_FANOUT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (gobject_class, PROP_ELEMENT,
       g_param_spec_object ("element", "The Element",
           "The GstBin to use for streaming the media", GST_TYPE_ELEMENT,
@@ -371,6 +415,48 @@ gst_rtsp_media_class_init (GstRTSPMediaClass * klass)
           "Clock to be used by the media pipeline",
           GST_TYPE_CLOCK, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_FANOUT_THREADS,
+      g_param_spec_uint ("fanout-threads", "Fan-out Threads",
+          "The number of threads sending the packets of each stream to the "
+          "clients (0 = streaming thread)", 0, G_MAXUINT,
+          DEFAULT_FANOUT_THREADS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FANOUT_QUEUE_SIZE,
+      g_param_spec_uint ("fanout-queue-size", "Fan-out Queue Size",
+          "The maximum number of packets queued for each fan-out thread",
+          1, G_MAXUINT, DEFAULT_FANOUT_QUEUE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FANOUT_PARTITION,
+      g_param_spec_enum ("fanout-partition", "Fan-out Partition",
+          "How the transports are spread over the fan-out threads",
+          GST_TYPE_RTSP_FANOUT_PARTITION, DEFAULT_FANOUT_PARTITION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_GOP_CACHE_SIZE,
+      g_param_spec_uint ("gop-cache-size", "GOP Cache Size",
+          "The maximum size in bytes of the packets since the last keyframe "
+          "that are sent to new clients (0 = disabled)", 0, G_MAXUINT,
+          DEFAULT_GOP_CACHE_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_RECV_BATCH_SIZE,
+      g_param_spec_uint ("recv-batch-size", "Receive Batch Size",
+          "The maximum number of UDP packets received with one system "
+          "call (0 = one at a time)", 0, 1024,
+          DEFAULT_RECV_BATCH_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PREPARE_TIMEOUT,
+      g_param_spec_uint ("prepare-timeout", "Prepare Timeout",
+          "Seconds to wait for the media to preroll before giving up",
+          1, G_MAXUINT,
+          DEFAULT_PREPARE_TIMEOUT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PACING,
+      g_param_spec_boolean ("pacing", "Pacing",
+          "Spread the RTP packets of a frame over the frame interval when "
+          "sending them to UDP unicast destinations",
+          DEFAULT_PACING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_rtsp_media_signals[SIGNAL_NEW_STREAM] =
       g_signal_new ("new-stream", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST,
       G_STRUCT_OFFSET (GstRTSPMediaClass, new_stream), NULL, NULL,
@@ -436,6 +522,14 @@ gst_rtsp_media_init (GstRTSPMedia * media)
   priv->protocols = DEFAULT_PROTOCOLS;
   priv->eos_shutdown = DEFAULT_EOS_SHUTDOWN;
   priv->buffer_size = DEFAULT_BUFFER_SIZE;
+  priv->udp_fanout = DEFAULT_UDP_FANOUT;
+  priv->fanout_threads = DEFAULT_FANOUT_THREADS;
+  priv->fanout_queue_size = DEFAULT_FANOUT_QUEUE_SIZE;
+  priv->fanout_partition = DEFAULT_FANOUT_PARTITION;
+  priv->gop_cache_size = DEFAULT_GOP_CACHE_SIZE;
+  priv->recv_batch_size = DEFAULT_RECV_BATCH_SIZE;
+  priv->prepare_timeout = DEFAULT_PREPARE_TIMEOUT;
+  priv->pacing = DEFAULT_PACING;
   priv->time_provider = DEFAULT_TIME_PROVIDER;
   priv->transport_mode = DEFAULT_TRANSPORT_MODE;
   priv->stop_on_disconnect = DEFAULT_STOP_ON_DISCONNECT;
@@ -456,9 +550,15 @@ gst_rtsp_media_finalize (GObject * obj)
   if (priv->permissions)
     gst_rtsp_permissions_unref (priv->permissions);
 
+  /* the streams can outlive us */
+  g_ptr_array_foreach (priv->streams,
+      (GFunc) gst_rtsp_stream_set_sdp_generation, NULL);
   g_ptr_array_unref (priv->streams);
 
   g_list_free_full (priv->dynamic, gst_object_unref);
+  clear_sdp_cache (media);
+  notify_prepare_waiters (media, take_prepare_waiters (media),
+      GST_RTSP_MEDIA_STATUS_ERROR);
 
   if (priv->pipeline)
     gst_object_unref (priv->pipeline);
@@ -508,6 +608,9 @@ gst_rtsp_media_get_property (GObject * object, guint propid,
     case PROP_BUFFER_SIZE:
       g_value_set_uint (value, gst_rtsp_media_get_buffer_size (media));
       break;
+    case PROP_UDP_FANOUT:
+      g_value_set_boolean (value, gst_rtsp_media_get_udp_fanout (media));
+      break;
     case PROP_TIME_PROVIDER:
       g_value_set_boolean (value, gst_rtsp_media_is_time_provider (media));
       break;
@@ -523,6 +626,27 @@ gst_rtsp_media_get_property (GObject * object, guint propid,
     case PROP_CLOCK:
       g_value_take_object (value, gst_rtsp_media_get_clock (media));
       break;
+    case PROP_FANOUT_THREADS:
+      g_value_set_uint (value, gst_rtsp_media_get_fanout_threads (media));
+      break;
+    case PROP_FANOUT_QUEUE_SIZE:
+      g_value_set_uint (value, gst_rtsp_media_get_fanout_queue_size (media));
+      break;
+    case PROP_FANOUT_PARTITION:
+      g_value_set_enum (value, gst_rtsp_media_get_fanout_partition (media));
+      break;
+    case PROP_GOP_CACHE_SIZE:
+      g_value_set_uint (value, gst_rtsp_media_get_gop_cache_size (media));
+      break;
+    case PROP_RECV_BATCH_SIZE:
+      g_value_set_uint (value, gst_rtsp_media_get_recv_batch_size (media));
+      break;
+    case PROP_PREPARE_TIMEOUT:
+      g_value_set_uint (value, gst_rtsp_media_get_prepare_timeout (media));
+      break;
+    case PROP_PACING:
+      g_value_set_boolean (value, gst_rtsp_media_get_pacing (media));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, propid, pspec);
   }
@@ -560,6 +684,9 @@ gst_rtsp_media_set_property (GObject * object, guint propid,
     case PROP_BUFFER_SIZE:
       gst_rtsp_media_set_buffer_size (media, g_value_get_uint (value));
       break;
+    case PROP_UDP_FANOUT:
+      gst_rtsp_media_set_udp_fanout (media, g_value_get_boolean (value));
+      break;
     case PROP_TIME_PROVIDER:
       gst_rtsp_media_use_time_provider (media, g_value_get_boolean (value));
       break;
@@ -576,6 +703,27 @@ gst_rtsp_media_set_property (GObject * object, guint propid,
     case PROP_CLOCK:
       gst_rtsp_media_set_clock (media, g_value_get_object (value));
       break;
+    case PROP_FANOUT_THREADS:
+      gst_rtsp_media_set_fanout_threads (media, g_value_get_uint (value));
+      break;
+    case PROP_FANOUT_QUEUE_SIZE:
+      gst_rtsp_media_set_fanout_queue_size (media, g_value_get_uint (value));
+      break;
+    case PROP_FANOUT_PARTITION:
+      gst_rtsp_media_set_fanout_partition (media, g_value_get_enum (value));
+      break;
+    case PROP_GOP_CACHE_SIZE:
+      gst_rtsp_media_set_gop_cache_size (media, g_value_get_uint (value));
+      break;
+    case PROP_RECV_BATCH_SIZE:
+      gst_rtsp_media_set_recv_batch_size (media, g_value_get_uint (value));
+      break;
+    case PROP_PREPARE_TIMEOUT:
+      gst_rtsp_media_set_prepare_timeout (media, g_value_get_uint (value));
+      break;
+    case PROP_PACING:
+      gst_rtsp_media_set_pacing (media, g_value_get_boolean (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, propid, pspec);
   }
@@ -1141,85 +1289,578 @@ gst_rtsp_media_set_eos_shutdown (GstRTSPMedia * media, gboolean eos_shutdown)
   priv = media->priv;
 
   g_mutex_lock (&priv->lock);
-  priv->eos_shutdown = eos_shutdown;
+  priv->eos_shutdown = eos_shutdown;
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * gst_rtsp_media_is_eos_shutdown:
+ * @media: a #GstRTSPMedia
+ *
+ * Check if the pipeline for @media will send an EOS down the pipeline before
+ * unpreparing.
+ *
+ * Returns: %TRUE if the media will send EOS before unpreparing.
+ */
+gboolean
+gst_rtsp_media_is_eos_shutdown (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv;
+  gboolean res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), FALSE);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  res = priv->eos_shutdown;
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_media_set_buffer_size:
+ * @media: a #GstRTSPMedia
+ * @size: the new value
+ *
+ * Set the kernel UDP buffer size.
+ */
+void
+gst_rtsp_media_set_buffer_size (GstRTSPMedia * media, guint size)
+{
+  GstRTSPMediaPrivate *priv;
+  guint i;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA (media));
+
+  GST_LOG_OBJECT (media, "set buffer size %u", size);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  priv->buffer_size = size;
+
+  for (i = 0; i < priv->streams->len; i++) {
+    GstRTSPStream *stream = g_ptr_array_index (priv->streams, i);
+    gst_rtsp_stream_set_buffer_size (stream, size);
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * gst_rtsp_media_get_buffer_size:
+ * @media: a #GstRTSPMedia
+ *
+ * Get the kernel UDP buffer size.
+ *
+ * Returns: the kernel UDP buffer size.
+ */
+guint
+gst_rtsp_media_get_buffer_size (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv;
+  guint res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), FALSE);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  res = priv->buffer_size;
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_media_set_udp_fanout:
+ * @media: a #GstRTSPMedia
+ * @udp_fanout: the new value
+ *
+ * Send the packets of the streams of @media to UDP unicast destinations with
+ * a dedicated sender that batches them. See gst_rtsp_stream_set_udp_fanout().
+ *
+ * This only has an effect on streams that are not prepared yet.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_media_set_udp_fanout (GstRTSPMedia * media, gboolean udp_fanout)
+{
+  GstRTSPMediaPrivate *priv;
+  guint i;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA (media));
+
+  GST_LOG_OBJECT (media, "set udp fanout %d", udp_fanout);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  priv->udp_fanout = udp_fanout;
+
+  for (i = 0; i < priv->streams->len; i++) {
+    GstRTSPStream *stream = g_ptr_array_index (priv->streams, i);
+    gst_rtsp_stream_set_udp_fanout (stream, udp_fanout);
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * gst_rtsp_media_get_udp_fanout:
+ * @media: a #GstRTSPMedia
+ *
+ * Check if the streams of @media use a dedicated sender for UDP unicast
+ * destinations.
+ *
+ * Returns: %TRUE if a dedicated sender is used.
+ *
+ * Since: 1.14
+ */
+gboolean
+gst_rtsp_media_get_udp_fanout (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv;
+  gboolean res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), FALSE);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  res = priv->udp_fanout;
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_media_set_fanout_threads:
+ * @media: a #GstRTSPMedia
+ * @n_threads: the number of threads
+ *
+ * Set the number of threads each stream of @media uses to send its packets
+ * to the clients. See gst_rtsp_stream_set_fanout_threads().
+ *
+ * This only has an effect on streams that are not prepared yet.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_media_set_fanout_threads (GstRTSPMedia * media, guint n_threads)
+{
+  GstRTSPMediaPrivate *priv;
+  guint i;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA (media));
+
+  GST_LOG_OBJECT (media, "set fanout threads %u", n_threads);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  priv->fanout_threads = n_threads;
+
+  for (i = 0; i < priv->streams->len; i++) {
+    GstRTSPStream *stream = g_ptr_array_index (priv->streams, i);
+    gst_rtsp_stream_set_fanout_threads (stream, n_threads);
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * gst_rtsp_media_get_fanout_threads:
+ * @media: a #GstRTSPMedia
+ *
+ * Get the number of threads each stream of @media uses to send its packets
+ * to the clients.
+ *
+ * Returns: the number of fan-out threads.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_media_get_fanout_threads (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv;
+  guint res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), 0);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  res = priv->fanout_threads;
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_media_set_fanout_queue_size:
+ * @media: a #GstRTSPMedia
+ * @size: the maximum number of packets
+ *
+ * Set the maximum number of packets queued for each fan-out thread of the
+ * streams of @media. See gst_rtsp_stream_set_fanout_queue_size().
+ *
+ * This only has an effect on streams that are not prepared yet.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_media_set_fanout_queue_size (GstRTSPMedia * media, guint size)
+{
+  GstRTSPMediaPrivate *priv;
+  guint i;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA (media));
+  g_return_if_fail (size > 0);
+
+  GST_LOG_OBJECT (media, "set fanout queue size %u", size);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  priv->fanout_queue_size = size;
+
+  for (i = 0; i < priv->streams->len; i++) {
+    GstRTSPStream *stream = g_ptr_array_index (priv->streams, i);
+    gst_rtsp_stream_set_fanout_queue_size (stream, size);
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * gst_rtsp_media_get_fanout_queue_size:
+ * @media: a #GstRTSPMedia
+ *
+ * Get the maximum number of packets queued for each fan-out thread of the
+ * streams of @media.
+ *
+ * Returns: the maximum number of packets.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_media_get_fanout_queue_size (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv;
+  guint res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), 0);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  res = priv->fanout_queue_size;
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_media_set_fanout_partition:
+ * @media: a #GstRTSPMedia
+ * @partition: a #GstRTSPFanoutPartition
+ *
+ * Configure how the transports of the streams of @media are spread over their
+ * fan-out threads. See gst_rtsp_stream_set_fanout_partition().
+ *
+ * This only has an effect on streams that are not prepared yet.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_media_set_fanout_partition (GstRTSPMedia * media,
+    GstRTSPFanoutPartition partition)
+{
+  GstRTSPMediaPrivate *priv;
+  guint i;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA (media));
+
+  GST_LOG_OBJECT (media, "set fanout partition %d", partition);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  priv->fanout_partition = partition;
+
+  for (i = 0; i < priv->streams->len; i++) {
+    GstRTSPStream *stream = g_ptr_array_index (priv->streams, i);
+    gst_rtsp_stream_set_fanout_partition (stream, partition);
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * gst_rtsp_media_get_fanout_partition:
+ * @media: a #GstRTSPMedia
+ *
+ * Get how the transports of the streams of @media are spread over their
+ * fan-out threads.
+ *
+ * Returns: the #GstRTSPFanoutPartition of @media.
+ *
+ * Since: 1.14
+ */
+GstRTSPFanoutPartition
+gst_rtsp_media_get_fanout_partition (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv;
+  GstRTSPFanoutPartition res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media),
+      GST_RTSP_FANOUT_PARTITION_HASH);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  res = priv->fanout_partition;
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_media_set_gop_cache_size:
+ * @media: a #GstRTSPMedia
+ * @size: the maximum size of the cache in bytes
+ *
+ * Set the maximum size of the cache of RTP packets since the last keyframe
+ * that each stream of @media sends to new clients. See
+ * gst_rtsp_stream_set_gop_cache_size().
+ *
+ * This only has an effect on streams that are not prepared yet.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_media_set_gop_cache_size (GstRTSPMedia * media, guint size)
+{
+  GstRTSPMediaPrivate *priv;
+  guint i;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA (media));
+
+  GST_LOG_OBJECT (media, "set gop cache size %u", size);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  priv->gop_cache_size = size;
+
+  for (i = 0; i < priv->streams->len; i++) {
+    GstRTSPStream *stream = g_ptr_array_index (priv->streams, i);
+    gst_rtsp_stream_set_gop_cache_size (stream, size);
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * gst_rtsp_media_get_gop_cache_size:
+ * @media: a #GstRTSPMedia
+ *
+ * Get the maximum size of the cache of RTP packets since the last keyframe
+ * of the streams of @media.
+ *
+ * Returns: the size of the cache in bytes, 0 when disabled.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_media_get_gop_cache_size (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv;
+  guint res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), 0);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  res = priv->gop_cache_size;
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_media_set_recv_batch_size:
+ * @media: a #GstRTSPMedia
+ * @size: the maximum number of packets
+ *
+ * Set the maximum number of UDP packets that each stream of @media receives
+ * at once. See gst_rtsp_stream_set_recv_batch_size().
+ *
+ * This only has an effect on streams that are not prepared yet.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_media_set_recv_batch_size (GstRTSPMedia * media, guint size)
+{
+  GstRTSPMediaPrivate *priv;
+  guint i;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA (media));
+
+  GST_LOG_OBJECT (media, "set recv batch size %u", size);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  priv->recv_batch_size = size;
+
+  for (i = 0; i < priv->streams->len; i++) {
+    GstRTSPStream *stream = g_ptr_array_index (priv->streams, i);
+    gst_rtsp_stream_set_recv_batch_size (stream, size);
+  }
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * gst_rtsp_media_get_recv_batch_size:
+ * @media: a #GstRTSPMedia
+ *
+ * Get the maximum number of UDP packets that the streams of @media receive
+ * at once.
+ *
+ * Returns: the batch size, 0 when packets are received one at a time.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_media_get_recv_batch_size (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv;
+  guint res;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), 0);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  res = priv->recv_batch_size;
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_media_set_prepare_timeout:
+ * @media: a #GstRTSPMedia
+ * @timeout: the timeout in seconds
+ *
+ * Configure how many seconds @media waits for its pipeline to preroll when it
+ * is prepared. When the pipeline is not prerolled in time, preparing @media
+ * fails.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_media_set_prepare_timeout (GstRTSPMedia * media, guint timeout)
+{
+  GstRTSPMediaPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA (media));
+  g_return_if_fail (timeout > 0);
+
+  GST_LOG_OBJECT (media, "set prepare timeout %u", timeout);
+
+  priv = media->priv;
+
+  g_mutex_lock (&priv->lock);
+  priv->prepare_timeout = timeout;
   g_mutex_unlock (&priv->lock);
 }
 
 /**
- * gst_rtsp_media_is_eos_shutdown:
+ * gst_rtsp_media_get_prepare_timeout:
  * @media: a #GstRTSPMedia
  *
- * Check if the pipeline for @media will send an EOS down the pipeline before
- * unpreparing.
+ * Get the prepare timeout of @media.
  *
- * Returns: %TRUE if the media will send EOS before unpreparing.
+ * Returns: the prepare timeout of @media in seconds.
+ *
+ * Since: 1.14
  */
-gboolean
-gst_rtsp_media_is_eos_shutdown (GstRTSPMedia * media)
+guint
+gst_rtsp_media_get_prepare_timeout (GstRTSPMedia * media)
 {
   GstRTSPMediaPrivate *priv;
-  gboolean res;
+  guint res;
 
-  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), FALSE);
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), 0);
 
   priv = media->priv;
 
   g_mutex_lock (&priv->lock);
-  res = priv->eos_shutdown;
+  res = priv->prepare_timeout;
   g_mutex_unlock (&priv->lock);
 
   return res;
 }
 
 /**
- * gst_rtsp_media_set_buffer_size:
+ * gst_rtsp_media_set_pacing:
  * @media: a #GstRTSPMedia
- * @size: the new value
+ * @pacing: the new value
  *
- * Set the kernel UDP buffer size.
+ * Spread the RTP packets of the streams of @media over the frame interval
+ * when sending them to UDP unicast destinations. See
+ * gst_rtsp_stream_set_pacing().
+ *
+ * This only has an effect on streams that are not prepared yet.
+ *
+ * Since: 1.14
  */
 void
-gst_rtsp_media_set_buffer_size (GstRTSPMedia * media, guint size)
+gst_rtsp_media_set_pacing (GstRTSPMedia * media, gboolean pacing)
 {
   GstRTSPMediaPrivate *priv;
   guint i;
 
   g_return_if_fail (GST_IS_RTSP_MEDIA (media));
 
-  GST_LOG_OBJECT (media, "set buffer size %u", size);
+  GST_LOG_OBJECT (media, "set pacing %d", pacing);
 
   priv = media->priv;
 
   g_mutex_lock (&priv->lock);
-  priv->buffer_size = size;
+  priv->pacing = pacing;
 
   for (i = 0; i < priv->streams->len; i++) {
     GstRTSPStream *stream = g_ptr_array_index (priv->streams, i);
-    gst_rtsp_stream_set_buffer_size (stream, size);
+    gst_rtsp_stream_set_pacing (stream, pacing);
   }
   g_mutex_unlock (&priv->lock);
 }
 
 /**
- * gst_rtsp_media_get_buffer_size:
+ * gst_rtsp_media_get_pacing:
  * @media: a #GstRTSPMedia
  *
- * Get the kernel UDP buffer size.
+ * Check if the RTP packets of the streams of @media are paced.
  *
- * Returns: the kernel UDP buffer size.
+ * Returns: %TRUE if the RTP packets are paced.
+ *
+ * Since: 1.14
  */
-guint
-gst_rtsp_media_get_buffer_size (GstRTSPMedia * media)
+gboolean
+gst_rtsp_media_get_pacing (GstRTSPMedia * media)
 {
   GstRTSPMediaPrivate *priv;
-  guint res;
+  gboolean res;
 
   g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), FALSE);
 
   priv = media->priv;
 
   g_mutex_lock (&priv->lock);
-  res = priv->buffer_size;
+  res = priv->pacing;
   g_mutex_unlock (&priv->lock);
 
   return res;
@@ -1822,9 +2463,18 @@ gst_rtsp_media_create_stream (GstRTSPMedia * media, GstElement * payloader,
   gst_rtsp_stream_set_protocols (stream, priv->protocols);
   gst_rtsp_stream_set_retransmission_time (stream, priv->rtx_time);
   gst_rtsp_stream_set_buffer_size (stream, priv->buffer_size);
+  gst_rtsp_stream_set_udp_fanout (stream, priv->udp_fanout);
+  gst_rtsp_stream_set_fanout_threads (stream, priv->fanout_threads);
+  gst_rtsp_stream_set_fanout_queue_size (stream, priv->fanout_queue_size);
+  gst_rtsp_stream_set_fanout_partition (stream, priv->fanout_partition);
+  gst_rtsp_stream_set_gop_cache_size (stream, priv->gop_cache_size);
+  gst_rtsp_stream_set_recv_batch_size (stream, priv->recv_batch_size);
+  gst_rtsp_stream_set_pacing (stream, priv->pacing);
   gst_rtsp_stream_set_publish_clock_mode (stream, priv->publish_clock_mode);
 
   g_ptr_array_add (priv->streams, stream);
+  gst_rtsp_stream_set_sdp_generation (stream, &priv->sdp_generation);
+  g_atomic_int_inc (&priv->sdp_generation);
 
   if (GST_PAD_IS_SRC (pad)) {
     gint i, n;
@@ -1873,6 +2523,8 @@ gst_rtsp_media_remove_stream (GstRTSPMedia * media, GstRTSPStream * stream)
   /* now remove the stream */
   g_object_ref (stream);
   g_ptr_array_remove (priv->streams, stream);
+  gst_rtsp_stream_set_sdp_generation (stream, NULL);
+  g_atomic_int_inc (&priv->sdp_generation);
   g_mutex_unlock (&priv->lock);
 
   g_signal_emit (media, gst_rtsp_media_signals[SIGNAL_REMOVED_STREAM], 0,
@@ -2067,16 +2719,98 @@ media_streams_set_blocked (GstRTSPMedia * media, gboolean blocked)
   g_ptr_array_foreach (priv->streams, (GFunc) stream_update_blocked, media);
 }
 
+typedef struct
+{
+  GstRTSPMediaPrepareFunc func;
+  gpointer user_data;
+  GDestroyNotify notify;
+} PrepareWaiter;
+
+/* called with lock. Take the waiters of an asynchronous prepare because the
+ * media is no longer preparing */
+static GList *
+take_prepare_waiters (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv = media->priv;
+  GList *waiters;
+
+  if (priv->prepare_timeout_source) {
+    g_source_destroy (priv->prepare_timeout_source);
+    g_source_unref (priv->prepare_timeout_source);
+    priv->prepare_timeout_source = NULL;
+  }
+  waiters = priv->prepare_waiters;
+  priv->prepare_waiters = NULL;
+
+  return waiters;
+}
+
+/* called without lock */
+static void
+notify_prepare_waiters (GstRTSPMedia * media, GList * waiters,
+    GstRTSPMediaStatus status)
+{
+  GList *walk;
+
+  for (walk = waiters; walk; walk = g_list_next (walk)) {
+    PrepareWaiter *waiter = walk->data;
+
+    /* like after gst_rtsp_media_prepare(), once for each caller */
+    if (status == GST_RTSP_MEDIA_STATUS_PREPARED)
+      g_signal_emit (media, gst_rtsp_media_signals[SIGNAL_PREPARED], 0, NULL);
+
+    waiter->func (media, status, waiter->user_data);
+    if (waiter->notify)
+      waiter->notify (waiter->user_data);
+    g_slice_free (PrepareWaiter, waiter);
+  }
+  g_list_free (waiters);
+}
+
+/* called with lock */
+static GList *
+prepare_timed_out (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv = media->priv;
+
+  GST_DEBUG ("timeout, assuming error status");
+  priv->status = GST_RTSP_MEDIA_STATUS_ERROR;
+  g_cond_broadcast (&priv->cond);
+
+  return take_prepare_waiters (media);
+}
+
+static gboolean
+prepare_timeout_cb (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv = media->priv;
+  GList *waiters = NULL;
+
+  g_mutex_lock (&priv->lock);
+  if (priv->status == GST_RTSP_MEDIA_STATUS_PREPARING)
+    waiters = prepare_timed_out (media);
+  g_mutex_unlock (&priv->lock);
+
+  notify_prepare_waiters (media, waiters, GST_RTSP_MEDIA_STATUS_ERROR);
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 gst_rtsp_media_set_status (GstRTSPMedia * media, GstRTSPMediaStatus status)
 {
   GstRTSPMediaPrivate *priv = media->priv;
+  GList *waiters = NULL;
 
   g_mutex_lock (&priv->lock);
   priv->status = status;
   GST_DEBUG ("setting new status to %d", status);
   g_cond_broadcast (&priv->cond);
+  if (status != GST_RTSP_MEDIA_STATUS_PREPARING)
+    waiters = take_prepare_waiters (media);
   g_mutex_unlock (&priv->lock);
+
+  notify_prepare_waiters (media, waiters, status);
 }
 
 /**
@@ -2084,7 +2818,8 @@ gst_rtsp_media_set_status (GstRTSPMedia * media, GstRTSPMediaStatus status)
  * @media: a #GstRTSPMedia
  *
  * Get the status of @media. When @media is busy preparing, this function waits
- * until @media is prepared or in error.
+ * until @media is prepared or in error, or until the prepare timeout of @media
+ * expired.
  *
  * Returns: the status of @media.
  */
@@ -2093,23 +2828,25 @@ gst_rtsp_media_get_status (GstRTSPMedia * media)
 {
   GstRTSPMediaPrivate *priv = media->priv;
   GstRTSPMediaStatus result;
+  GList *waiters = NULL;
   gint64 end_time;
 
   g_mutex_lock (&priv->lock);
-  end_time = g_get_monotonic_time () + 20 * G_TIME_SPAN_SECOND;
+  end_time =
+      g_get_monotonic_time () + priv->prepare_timeout * G_TIME_SPAN_SECOND;
   /* while we are preparing, wait */
   while (priv->status == GST_RTSP_MEDIA_STATUS_PREPARING) {
     GST_DEBUG ("waiting for status change");
-    if (!g_cond_wait_until (&priv->cond, &priv->lock, end_time)) {
-      GST_DEBUG ("timeout, assuming error status");
-      priv->status = GST_RTSP_MEDIA_STATUS_ERROR;
-    }
+    if (!g_cond_wait_until (&priv->cond, &priv->lock, end_time))
+      waiters = prepare_timed_out (media);
   }
   /* could be success or error */
   result = priv->status;
   GST_DEBUG ("got status %d", result);
   g_mutex_unlock (&priv->lock);
 
+  notify_prepare_waiters (media, waiters, result);
+
   return result;
 }
 
@@ -2503,15 +3240,18 @@ bus_message (GstBus * bus, GstMessage * message, GstRTSPMedia * media)
   GstRTSPMediaPrivate *priv = media->priv;
   GstRTSPMediaClass *klass;
   gboolean ret;
+  gint64 begin;
 
   klass = GST_RTSP_MEDIA_GET_CLASS (media);
 
+  begin = gst_rtsp_thread_dispatch_begin ();
   g_rec_mutex_lock (&priv->state_lock);
   if (klass->handle_message)
     ret = klass->handle_message (media, message);
   else
     ret = FALSE;
   g_rec_mutex_unlock (&priv->state_lock);
+  gst_rtsp_thread_dispatch_end (GST_RTSP_THREAD_SOURCE_MEDIA, begin);
 
   return ret;
 }
@@ -2523,6 +3263,45 @@ watch_destroyed (GstRTSPMedia * media)
   g_object_unref (media);
 }
 
+/* called from the streaming threads of the pipeline when they start and stop,
+ * bind them to the CPUs of the media thread */
+static void
+stream_status_sync (GstBus * bus, GstMessage * message, GstRTSPThread * thread)
+{
+  GstStreamStatusType type;
+  GstElement *owner;
+
+  gst_message_parse_stream_status (message, &type, &owner);
+
+  switch (type) {
+    case GST_STREAM_STATUS_TYPE_ENTER:
+      GST_DEBUG_OBJECT (owner, "bind streaming thread");
+      gst_rtsp_thread_bind_current (thread);
+      break;
+    case GST_STREAM_STATUS_TYPE_LEAVE:
+      gst_rtsp_thread_unbind_current ();
+      break;
+    default:
+      break;
+  }
+}
+
+static void
+disconnect_stream_status (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv = media->priv;
+  GstBus *bus;
+
+  if (priv->stream_status_id == 0)
+    return;
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE_CAST (priv->pipeline));
+  g_signal_handler_disconnect (bus, priv->stream_status_id);
+  gst_bus_disable_sync_message_emission (bus);
+  gst_object_unref (bus);
+  priv->stream_status_id = 0;
+}
+
 static GstElement *
 find_payload_element (GstElement * payloader)
 {
@@ -2874,6 +3653,16 @@ default_prepare (GstRTSPMedia * media, GstRTSPThread * thread)
 
   /* add the pipeline bus to our custom mainloop */
   priv->source = gst_bus_create_watch (bus);
+
+  /* the streaming threads run on the CPUs of the media thread */
+  disconnect_stream_status (media);
+  if (thread != NULL && gst_rtsp_thread_is_bound (thread)) {
+    gst_bus_enable_sync_message_emission (bus);
+    priv->stream_status_id =
+        g_signal_connect_data (bus, "sync-message::stream-status",
+        G_CALLBACK (stream_status_sync), gst_rtsp_thread_ref (thread),
+        (GClosureNotify) gst_rtsp_thread_unref, 0);
+  }
   gst_object_unref (bus);
 
   g_source_set_callback (priv->source, (GSourceFunc) bus_message,
@@ -2908,30 +3697,17 @@ no_rtpbin:
   }
 }
 
-/**
- * gst_rtsp_media_prepare:
- * @media: a #GstRTSPMedia
- * @thread: (transfer full) (allow-none): a #GstRTSPThread to run the
- *   bus handler or %NULL
- *
- * Prepare @media for streaming. This function will create the objects
- * to manage the streaming. A pipeline must have been set on @media with
- * gst_rtsp_media_take_pipeline().
- *
- * It will preroll the pipeline and collect vital information about the streams
- * such as the duration.
- *
- * Returns: %TRUE on success.
- */
-gboolean
-gst_rtsp_media_prepare (GstRTSPMedia * media, GstRTSPThread * thread)
+/* start preparing @media. Returns %FALSE when that failed, else @prepared
+ * tells if @media was prepared already or if the caller has to wait for the
+ * pipeline to preroll */
+static gboolean
+begin_prepare (GstRTSPMedia * media, GstRTSPThread * thread,
+    gboolean * prepared)
 {
-  GstRTSPMediaPrivate *priv;
+  GstRTSPMediaPrivate *priv = media->priv;
   GstRTSPMediaClass *klass;
 
-  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), FALSE);
-
-  priv = media->priv;
+  *prepared = FALSE;
 
   g_rec_mutex_lock (&priv->state_lock);
   priv->prepare_count++;
@@ -2964,19 +3740,8 @@ gst_rtsp_media_prepare (GstRTSPMedia * media, GstRTSPThread * thread)
     if (!klass->prepare (media, thread))
       goto prepare_failed;
   }
-
-wait_status:
   g_rec_mutex_unlock (&priv->state_lock);
 
-  /* now wait for all pads to be prerolled, FIXME, we should somehow be
-   * able to do this async so that we don't block the server thread. */
-  if (!wait_preroll (media))
-    goto preroll_failed;
-
-  g_signal_emit (media, gst_rtsp_media_signals[SIGNAL_PREPARED], 0, NULL);
-
-  GST_INFO ("object %p is prerolled", media);
-
   return TRUE;
 
   /* OK */
@@ -2985,7 +3750,8 @@ is_preparing:
     /* we are not going to use the giving thread, so stop it. */
     if (thread)
       gst_rtsp_thread_stop (thread);
-    goto wait_status;
+    g_rec_mutex_unlock (&priv->state_lock);
+    return TRUE;
   }
 was_prepared:
   {
@@ -2994,6 +3760,7 @@ was_prepared:
     if (thread)
       gst_rtsp_thread_stop (thread);
     g_rec_mutex_unlock (&priv->state_lock);
+    *prepared = TRUE;
     return TRUE;
   }
   /* ERRORS */
@@ -3027,6 +3794,47 @@ prepare_failed:
     GST_ERROR ("failed to prepare media");
     return FALSE;
   }
+}
+
+/**
+ * gst_rtsp_media_prepare:
+ * @media: a #GstRTSPMedia
+ * @thread: (transfer full) (allow-none): a #GstRTSPThread to run the
+ *   bus handler or %NULL
+ *
+ * Prepare @media for streaming. This function will create the objects
+ * to manage the streaming. A pipeline must have been set on @media with
+ * gst_rtsp_media_take_pipeline().
+ *
+ * It will preroll the pipeline and collect vital information about the streams
+ * such as the duration.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean
+gst_rtsp_media_prepare (GstRTSPMedia * media, GstRTSPThread * thread)
+{
+  gboolean prepared;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), FALSE);
+
+  if (!begin_prepare (media, thread, &prepared))
+    return FALSE;
+
+  if (prepared)
+    return TRUE;
+
+  /* now wait for all pads to be prerolled */
+  if (!wait_preroll (media))
+    goto preroll_failed;
+
+  g_signal_emit (media, gst_rtsp_media_signals[SIGNAL_PREPARED], 0, NULL);
+
+  GST_INFO ("object %p is prerolled", media);
+
+  return TRUE;
+
+  /* ERRORS */
 preroll_failed:
   {
     GST_WARNING ("failed to preroll pipeline");
@@ -3035,6 +3843,105 @@ preroll_failed:
   }
 }
 
+/* Like gst_rtsp_media_prepare() but without waiting for the pipeline to
+ * preroll. Returns GST_RTSP_MEDIA_STATUS_PREPARED when @media is prepared
+ * already and GST_RTSP_MEDIA_STATUS_ERROR when preparing failed, @media
+ * is then unprepared again.
+ *
+ * Returns GST_RTSP_MEDIA_STATUS_PREPARING while the pipeline is prerolling.
+ * @func is then called once, from the thread that finishes preparing, with the
+ * new status of @media. When that is not GST_RTSP_MEDIA_STATUS_PREPARED the
+ * caller must call gst_rtsp_media_unprepare(). When the pipeline did not
+ * preroll within the prepare timeout, @func is called with
+ * GST_RTSP_MEDIA_STATUS_ERROR. @notify is called for @user_data in all
+ * cases. */
+GstRTSPMediaStatus
+gst_rtsp_media_prepare_async (GstRTSPMedia * media, GstRTSPThread * thread,
+    GstRTSPMediaPrepareFunc func, gpointer user_data, GDestroyNotify notify)
+{
+  GstRTSPMediaPrivate *priv;
+  GstRTSPMediaStatus status;
+  gboolean prepared;
+
+  g_return_val_if_fail (GST_IS_RTSP_MEDIA (media), GST_RTSP_MEDIA_STATUS_ERROR);
+  g_return_val_if_fail (func != NULL, GST_RTSP_MEDIA_STATUS_ERROR);
+
+  priv = media->priv;
+
+  if (!begin_prepare (media, thread, &prepared)) {
+    status = GST_RTSP_MEDIA_STATUS_ERROR;
+    goto done;
+  }
+
+  if (prepared) {
+    status = GST_RTSP_MEDIA_STATUS_PREPARED;
+    goto done;
+  }
+
+  g_mutex_lock (&priv->lock);
+  status = priv->status;
+  if (status == GST_RTSP_MEDIA_STATUS_PREPARING) {
+    PrepareWaiter *waiter;
+
+    waiter = g_slice_new (PrepareWaiter);
+    waiter->func = func;
+    waiter->user_data = user_data;
+    waiter->notify = notify;
+    priv->prepare_waiters = g_list_append (priv->prepare_waiters, waiter);
+
+    if (priv->prepare_timeout_source == NULL) {
+      GSource *source;
+
+      source = g_timeout_source_new_seconds (priv->prepare_timeout);
+      g_source_set_callback (source, (GSourceFunc) prepare_timeout_cb,
+          g_object_ref (media), g_object_unref);
+      g_source_attach (source, priv->thread ? priv->thread->context : NULL);
+      priv->prepare_timeout_source = source;
+    }
+    GST_INFO ("media %p is prerolling, %d waiters", media,
+        g_list_length (priv->prepare_waiters));
+  }
+  g_mutex_unlock (&priv->lock);
+
+  switch (status) {
+    case GST_RTSP_MEDIA_STATUS_PREPARING:
+      return status;
+    case GST_RTSP_MEDIA_STATUS_PREPARED:
+      g_signal_emit (media, gst_rtsp_media_signals[SIGNAL_PREPARED], 0, NULL);
+      GST_INFO ("object %p is prerolled", media);
+      break;
+    default:
+      GST_WARNING ("failed to preroll pipeline");
+      gst_rtsp_media_unprepare (media);
+      status = GST_RTSP_MEDIA_STATUS_ERROR;
+      break;
+  }
+
+done:
+  if (notify)
+    notify (user_data);
+
+  return status;
+}
+
+/* Give up the prepare that was done by the warm pool of a factory without
+ * unpreparing @media, the next gst_rtsp_media_prepare() will find it
+ * prepared and own it. */
+void
+gst_rtsp_media_hand_over_prepared (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_MEDIA (media));
+
+  priv = media->priv;
+
+  g_rec_mutex_lock (&priv->state_lock);
+  if (priv->prepare_count > 0)
+    priv->prepare_count--;
+  g_rec_mutex_unlock (&priv->state_lock);
+}
+
 /* must be called with state-lock */
 static void
 finish_unprepare (GstRTSPMedia * media)
@@ -3051,6 +3958,9 @@ finish_unprepare (GstRTSPMedia * media)
   set_state (media, GST_STATE_NULL);
   g_rec_mutex_lock (&priv->state_lock);
 
+  /* no more streaming threads */
+  disconnect_stream_status (media);
+
   if (priv->status != GST_RTSP_MEDIA_STATUS_UNPREPARING)
     return;
 
@@ -3091,6 +4001,11 @@ finish_unprepare (GstRTSPMedia * media)
     gst_object_unref (priv->nettime);
   priv->nettime = NULL;
 
+  g_mutex_lock (&priv->lock);
+  clear_sdp_cache (media);
+  g_atomic_int_inc (&priv->sdp_generation);
+  g_mutex_unlock (&priv->lock);
+
   priv->reused = TRUE;
   gst_rtsp_media_set_status (media, GST_RTSP_MEDIA_STATUS_UNPREPARED);
 
@@ -3366,6 +4281,82 @@ no_setup_sdp:
   }
 }
 
+/* called with lock */
+static void
+clear_sdp_cache (GstRTSPMedia * media)
+{
+  GstRTSPMediaPrivate *priv = media->priv;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (priv->sdp_cache); i++) {
+    if (priv->sdp_cache[i]) {
+      gst_sdp_message_free (priv->sdp_cache[i]);
+      priv->sdp_cache[i] = NULL;
+    }
+  }
+}
+
+/* the generation of the SDP of @media, it is incremented whenever streams
+ * are added or removed or something that is used for their SDP changes */
+guint
+gst_rtsp_media_get_sdp_cookie (GstRTSPMedia * media)
+{
+  return g_atomic_int_get (&media->priv->sdp_generation);
+}
+
+/* add a copy of the cached media sections for @is_ipv6 to @sdp. Returns
+ * %FALSE when there are none or when they were made for another @cookie */
+gboolean
+gst_rtsp_media_add_cached_sdp (GstRTSPMedia * media, gboolean is_ipv6,
+    guint cookie, GstSDPMessage * sdp)
+{
+  GstRTSPMediaPrivate *priv = media->priv;
+  GstSDPMessage *cache;
+  guint i, len;
+
+  g_mutex_lock (&priv->lock);
+  cache = priv->sdp_cache[is_ipv6 ? 1 : 0];
+  if (cache == NULL || priv->sdp_cache_cookie[is_ipv6 ? 1 : 0] != cookie)
+    goto no_cache;
+
+  len = gst_sdp_message_medias_len (cache);
+  for (i = 0; i < len; i++) {
+    GstSDPMedia *smedia;
+
+    gst_sdp_media_copy (gst_sdp_message_get_media (cache, i), &smedia);
+    gst_sdp_message_add_media (sdp, smedia);
+    gst_sdp_media_free (smedia);
+  }
+  g_mutex_unlock (&priv->lock);
+
+  GST_DEBUG ("media %p: used %u cached SDP media sections", media, len);
+
+  return TRUE;
+
+no_cache:
+  {
+    g_mutex_unlock (&priv->lock);
+    return FALSE;
+  }
+}
+
+/* cache the media sections in @medias for @is_ipv6, they were made for
+ * @cookie. Takes ownership of @medias */
+void
+gst_rtsp_media_cache_sdp (GstRTSPMedia * media, gboolean is_ipv6,
+    guint cookie, GstSDPMessage * medias)
+{
+  GstRTSPMediaPrivate *priv = media->priv;
+  guint idx = is_ipv6 ? 1 : 0;
+
+  g_mutex_lock (&priv->lock);
+  if (priv->sdp_cache[idx])
+    gst_sdp_message_free (priv->sdp_cache[idx]);
+  priv->sdp_cache[idx] = medias;
+  priv->sdp_cache_cookie[idx] = cookie;
+  g_mutex_unlock (&priv->lock);
+}
+
 static gboolean
 default_handle_sdp (GstRTSPMedia * media, GstSDPMessage * sdp)
 {
@@ -273,6 +273,54 @@ void                  gst_rtsp_media_set_buffer_size  (GstRTSPMedia *media, guin
 GST_EXPORT
 guint                 gst_rtsp_media_get_buffer_size  (GstRTSPMedia *media);
 
+GST_EXPORT
+void                  gst_rtsp_media_set_udp_fanout   (GstRTSPMedia *media, gboolean udp_fanout);
+
+GST_EXPORT
+gboolean              gst_rtsp_media_get_udp_fanout   (GstRTSPMedia *media);
+
+GST_EXPORT
+void                  gst_rtsp_media_set_fanout_threads  (GstRTSPMedia *media, guint n_threads);
+
+GST_EXPORT
+guint                 gst_rtsp_media_get_fanout_threads  (GstRTSPMedia *media);
+
+GST_EXPORT
+void                  gst_rtsp_media_set_fanout_queue_size (GstRTSPMedia *media, guint size);
+
+GST_EXPORT
+guint                 gst_rtsp_media_get_fanout_queue_size (GstRTSPMedia *media);
+
+GST_EXPORT
+void                  gst_rtsp_media_set_fanout_partition (GstRTSPMedia *media, GstRTSPFanoutPartition partition);
+
+GST_EXPORT
+GstRTSPFanoutPartition gst_rtsp_media_get_fanout_partition (GstRTSPMedia *media);
+
+GST_EXPORT
+void                  gst_rtsp_media_set_gop_cache_size  (GstRTSPMedia *media, guint size);
+
+GST_EXPORT
+guint                 gst_rtsp_media_get_gop_cache_size  (GstRTSPMedia *media);
+
+GST_EXPORT
+void                  gst_rtsp_media_set_recv_batch_size (GstRTSPMedia *media, guint size);
+
+GST_EXPORT
+guint                 gst_rtsp_media_get_recv_batch_size (GstRTSPMedia *media);
+
+GST_EXPORT
+void                  gst_rtsp_media_set_prepare_timeout (GstRTSPMedia *media, guint timeout);
+
+GST_EXPORT
+guint                 gst_rtsp_media_get_prepare_timeout (GstRTSPMedia *media);
+
+GST_EXPORT
+void                  gst_rtsp_media_set_pacing (GstRTSPMedia *media, gboolean pacing);
+
+GST_EXPORT
+gboolean              gst_rtsp_media_get_pacing (GstRTSPMedia *media);
+
 GST_EXPORT
 void                  gst_rtsp_media_set_retransmission_time  (GstRTSPMedia *media, GstClockTime time);
 
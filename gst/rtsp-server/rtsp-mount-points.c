@@ -41,60 +41,108 @@
 #define GST_RTSP_MOUNT_POINTS_GET_PRIVATE(obj)  \
        (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTSP_MOUNT_POINTS, GstRTSPMountPointsPrivate))
 
+/* a node in the tree of path segments. The segments of a path are the parts
+ * between the '/' characters, the root node has the children for the first
+ * segment. A mount point matches all paths that start with its segments. */
+typedef struct _MountNode MountNode;
+
 typedef struct
 {
-  gchar *path;
-  gint len;
+  const gchar *str;
+  gsize len;
+} Segment;
+
+struct _MountNode
+{
+  Segment segment;              /* owns the string */
+  MountNode *parent;
+  GHashTable *children;         /* Segment -> MountNode, NULL when empty */
   GstRTSPMediaFactory *factory;
-} DataItem;
+  gint len;                     /* length of the path up to this node */
+};
 
-static DataItem *
-data_item_new (gchar * path, gint len, GstRTSPMediaFactory * factory)
+static guint
+segment_hash (gconstpointer key)
 {
-  DataItem *item;
+  const Segment *seg = key;
+  guint h = 5381;
+  gsize i;
 
-  item = g_slice_alloc (sizeof (DataItem));
-  item->path = path;
-  item->len = len;
-  item->factory = factory;
+  for (i = 0; i < seg->len; i++)
+    h = (h << 5) + h + (guchar) seg->str[i];
 
-  return item;
+  return h;
 }
 
-static void
-data_item_free (gpointer data)
+static gboolean
+segment_equal (gconstpointer a, gconstpointer b)
 {
-  DataItem *item = data;
+  const Segment *seg1 = a, *seg2 = b;
 
-  g_free (item->path);
-  g_object_unref (item->factory);
-  g_slice_free1 (sizeof (DataItem), item);
+  return seg1->len == seg2->len &&
+      memcmp (seg1->str, seg2->str, seg1->len) == 0;
 }
 
 static void
-data_item_dump (gconstpointer a, gconstpointer prefix)
+mount_node_free (MountNode * node)
+{
+  if (node->children)
+    g_hash_table_unref (node->children);
+  if (node->factory)
+    g_object_unref (node->factory);
+  g_free ((gchar *) node->segment.str);
+  g_slice_free (MountNode, node);
+}
+
+static MountNode *
+mount_node_lookup (MountNode * node, const Segment * seg)
+{
+  if (node->children == NULL)
+    return NULL;
+
+  return g_hash_table_lookup (node->children, seg);
+}
+
+static MountNode *
+mount_node_add_child (MountNode * node, const Segment * seg, gint len)
 {
-  const DataItem *item = a;
+  MountNode *child;
+
+  child = g_slice_new0 (MountNode);
+  child->segment.str = g_strndup (seg->str, seg->len);
+  child->segment.len = seg->len;
+  child->parent = node;
+  child->len = len;
+
+  if (node->children == NULL)
+    node->children = g_hash_table_new_full (segment_hash, segment_equal,
+        NULL, (GDestroyNotify) mount_node_free);
+  g_hash_table_insert (node->children, &child->segment, child);
 
-  GST_DEBUG ("%s%s %p", (gchar *) prefix, item->path, item->factory);
+  return child;
 }
 
-static gint
-data_item_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+/* get the next segment of @path starting at @pos. Returns the position after
+ * the segment, which is at the end of @path or at a '/' */
+static const gchar *
+next_segment (const gchar * pos, Segment * seg)
 {
-  const DataItem *item1 = a, *item2 = b;
-  gint res;
+  const gchar *end;
 
-  res = g_strcmp0 (item1->path, item2->path);
+  end = strchr (pos, '/');
+  if (end == NULL)
+    end = pos + strlen (pos);
 
-  return res;
+  seg->str = pos;
+  seg->len = end - pos;
+
+  return end;
 }
 
 struct _GstRTSPMountPointsPrivate
 {
-  GMutex lock;
-  GSequence *mounts;            /* protected by lock */
-  gboolean dirty;
+  GRWLock lock;
+  MountNode *root;              /* protected by lock */
 };
 
 G_DEFINE_TYPE (GstRTSPMountPoints, gst_rtsp_mount_points, G_TYPE_OBJECT);
@@ -132,9 +180,8 @@ gst_rtsp_mount_points_init (GstRTSPMountPoints * mounts)
 
   mounts->priv = priv;
 
-  g_mutex_init (&priv->lock);
-  priv->mounts = g_sequence_new (data_item_free);
-  priv->dirty = FALSE;
+  g_rw_lock_init (&priv->lock);
+  priv->root = g_slice_new0 (MountNode);
 }
 
 static void
@@ -145,8 +192,8 @@ gst_rtsp_mount_points_finalize (GObject * obj)
 
   GST_DEBUG_OBJECT (mounts, "finalized");
 
-  g_sequence_free (priv->mounts);
-  g_mutex_clear (&priv->lock);
+  mount_node_free (priv->root);
+  g_rw_lock_clear (&priv->lock);
 
   G_OBJECT_CLASS (gst_rtsp_mount_points_parent_class)->finalize (obj);
 }
@@ -203,20 +250,6 @@ gst_rtsp_mount_points_make_path (GstRTSPMountPoints * mounts,
   return result;
 }
 
-static gboolean
-has_prefix (DataItem * str, DataItem * prefix)
-{
-  /* prefix needs to be smaller than str */
-  if (str->len < prefix->len)
-    return FALSE;
-
-  /* if str is larger, it there should be a / following the prefix */
-  if (str->len > prefix->len && str->path[prefix->len] != '/')
-    return FALSE;
-
-  return strncmp (str->path, prefix->path, prefix->len) == 0;
-}
-
 /**
  * gst_rtsp_mount_points_match:
  * @mounts: a #GstRTSPMountPoints
@@ -237,59 +270,45 @@ gst_rtsp_mount_points_match (GstRTSPMountPoints * mounts,
 {
   GstRTSPMountPointsPrivate *priv;
   GstRTSPMediaFactory *result = NULL;
-  GSequenceIter *iter, *best;
-  DataItem item, *ritem;
+  MountNode *node, *best;
+  const gchar *pos;
+  Segment seg;
 
   g_return_val_if_fail (GST_IS_RTSP_MOUNT_POINTS (mounts), NULL);
   g_return_val_if_fail (path != NULL, NULL);
 
   priv = mounts->priv;
 
-  item.path = (gchar *) path;
-  item.len = strlen (path);
-
-  g_mutex_lock (&priv->lock);
-  if (priv->dirty) {
-    g_sequence_sort (priv->mounts, data_item_compare, mounts);
-    g_sequence_foreach (priv->mounts, (GFunc) data_item_dump,
-        (gpointer) "sort :");
-    priv->dirty = FALSE;
-  }
-
-  /* find the location of the media in the hashtable we only use the absolute
+  /* find the location of the media in the tree, we only use the absolute
    * path of the uri to find a media factory. If the factory depends on other
    * properties found in the url, this method should be overridden. */
-  iter = g_sequence_get_begin_iter (priv->mounts);
+  g_rw_lock_reader_lock (&priv->lock);
+  node = priv->root;
   best = NULL;
-  while (!g_sequence_iter_is_end (iter)) {
-    ritem = g_sequence_get (iter);
-
-    data_item_dump (ritem, "inspect: ");
-
-    if (best == NULL) {
-      if (has_prefix (&item, ritem)) {
-        data_item_dump (ritem, "prefix: ");
-        best = iter;
-      }
-    } else {
-      if (!has_prefix (&item, ritem))
-        break;
-
-      best = iter;
-      data_item_dump (ritem, "new best: ");
-    }
-    iter = g_sequence_iter_next (iter);
+  pos = path;
+  while (TRUE) {
+    pos = next_segment (pos, &seg);
+
+    node = mount_node_lookup (node, &seg);
+    if (node == NULL)
+      break;
+
+    /* the deepest node with a factory is the longest match */
+    if (node->factory)
+      best = node;
+
+    if (*pos == '\0')
+      break;
+    pos++;
   }
   if (best) {
-    ritem = g_sequence_get (best);
-    data_item_dump (ritem, "result: ");
-    if (matched || ritem->len == item.len) {
-      result = g_object_ref (ritem->factory);
+    if (matched || path[best->len] == '\0') {
+      result = g_object_ref (best->factory);
       if (matched)
-        *matched = ritem->len;
+        *matched = best->len;
     }
   }
-  g_mutex_unlock (&priv->lock);
+  g_rw_lock_reader_unlock (&priv->lock);
 
   GST_INFO ("found media factory %p for path %s", result, path);
 
@@ -314,7 +333,10 @@ gst_rtsp_mount_points_add_factory (GstRTSPMountPoints * mounts,
     const gchar * path, GstRTSPMediaFactory * factory)
 {
   GstRTSPMountPointsPrivate *priv;
-  DataItem *item;
+  GstRTSPMediaFactory *old;
+  MountNode *node, *child;
+  const gchar *pos;
+  Segment seg;
 
   g_return_if_fail (GST_IS_RTSP_MOUNT_POINTS (mounts));
   g_return_if_fail (GST_IS_RTSP_MEDIA_FACTORY (factory));
@@ -322,14 +344,29 @@ gst_rtsp_mount_points_add_factory (GstRTSPMountPoints * mounts,
 
   priv = mounts->priv;
 
-  item = data_item_new (g_strdup (path), strlen (path), factory);
-
   GST_INFO ("adding media factory %p for path %s", factory, path);
 
-  g_mutex_lock (&priv->lock);
-  g_sequence_append (priv->mounts, item);
-  priv->dirty = TRUE;
-  g_mutex_unlock (&priv->lock);
+  g_rw_lock_writer_lock (&priv->lock);
+  node = priv->root;
+  pos = path;
+  while (TRUE) {
+    pos = next_segment (pos, &seg);
+
+    child = mount_node_lookup (node, &seg);
+    if (child == NULL)
+      child = mount_node_add_child (node, &seg, pos - path);
+    node = child;
+
+    if (*pos == '\0')
+      break;
+    pos++;
+  }
+  old = node->factory;
+  node->factory = factory;
+  g_rw_lock_writer_unlock (&priv->lock);
+
+  if (old)
+    g_object_unref (old);
 }
 
 /**
@@ -344,27 +381,44 @@ gst_rtsp_mount_points_remove_factory (GstRTSPMountPoints * mounts,
     const gchar * path)
 {
   GstRTSPMountPointsPrivate *priv;
-  DataItem item;
-  GSequenceIter *iter;
+  GstRTSPMediaFactory *old = NULL;
+  MountNode *node;
+  const gchar *pos;
+  Segment seg;
 
   g_return_if_fail (GST_IS_RTSP_MOUNT_POINTS (mounts));
   g_return_if_fail (path != NULL);
 
   priv = mounts->priv;
 
-  item.path = (gchar *) path;
-
   GST_INFO ("removing media factory for path %s", path);
 
-  g_mutex_lock (&priv->lock);
-  if (priv->dirty) {
-    g_sequence_sort (priv->mounts, data_item_compare, mounts);
-    priv->dirty = FALSE;
+  g_rw_lock_writer_lock (&priv->lock);
+  node = priv->root;
+  pos = path;
+  while (node) {
+    pos = next_segment (pos, &seg);
+
+    node = mount_node_lookup (node, &seg);
+    if (node == NULL || *pos == '\0')
+      break;
+    pos++;
   }
-  iter = g_sequence_lookup (priv->mounts, &item, data_item_compare, mounts);
-  if (iter) {
-    g_sequence_remove (iter);
-    priv->dirty = TRUE;
+  if (node) {
+    old = node->factory;
+    node->factory = NULL;
+
+    /* remove the nodes that lead to nothing anymore */
+    while (node->parent && node->factory == NULL &&
+        (node->children == NULL || g_hash_table_size (node->children) == 0)) {
+      MountNode *parent = node->parent;
+
+      g_hash_table_remove (parent->children, &node->segment);
+      node = parent;
+    }
   }
-  g_mutex_unlock (&priv->lock);
+  g_rw_lock_writer_unlock (&priv->lock);
+
+  if (old)
+    g_object_unref (old);
 }
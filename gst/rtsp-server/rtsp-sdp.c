@@ -33,6 +33,7 @@
 #include <gst/sdp/gstmikey.h>
 
 #include "rtsp-sdp.h"
+#include "rtsp-server-internal.h"
 
 static gboolean
 get_info_from_tags (GstPad * pad, GstEvent ** event, gpointer user_data)
@@ -444,6 +445,30 @@ crypto_sessions_error:
   }
 }
 
+/* the key-mgmt attribute contains the current rollover counter of the SRTP
+ * encoder and the RFC 7273 media clock offset follows the RTP time, the media
+ * sections with those must be made again for each SDP */
+static gboolean
+stream_sdp_is_cacheable (GstRTSPStream * stream)
+{
+  GstCaps *caps;
+  gboolean res = TRUE;
+
+  if (gst_rtsp_stream_get_publish_clock_mode (stream) ==
+      GST_RTSP_PUBLISH_CLOCK_MODE_CLOCK_AND_OFFSET)
+    return FALSE;
+
+  if ((caps = gst_rtsp_stream_get_caps (stream))) {
+    GstStructure *s = gst_caps_get_structure (caps, 0);
+
+    if (s && gst_structure_has_field (s, "srtp-key"))
+      res = FALSE;
+    gst_caps_unref (caps);
+  }
+
+  return res;
+}
+
 /**
  * gst_rtsp_sdp_from_media:
  * @sdp: a #GstSDPMessage
@@ -459,10 +484,13 @@ gboolean
 gst_rtsp_sdp_from_media (GstSDPMessage * sdp, GstSDPInfo * info,
     GstRTSPMedia * media)
 {
-  guint i, n_streams;
+  guint i, n_streams, cookie;
   gchar *rangestr;
   gboolean res;
 
+  /* take this before we look at the streams so that we never cache media
+   * sections that are outdated already */
+  cookie = gst_rtsp_media_get_sdp_cookie (media);
   n_streams = gst_rtsp_media_n_streams (media);
 
   rangestr = gst_rtsp_media_get_range_string (media, FALSE, GST_RTSP_RANGE_NPT);
@@ -473,15 +501,39 @@ gst_rtsp_sdp_from_media (GstSDPMessage * sdp, GstSDPInfo * info,
   g_free (rangestr);
 
   res = TRUE;
-  for (i = 0; res && (i < n_streams); i++) {
-    GstRTSPStream *stream;
-
-    stream = gst_rtsp_media_get_stream (media, i);
-    res = gst_rtsp_sdp_from_stream (sdp, info, stream);
-    if (!res) {
-      GST_ERROR ("could not get SDP from stream %p", stream);
-      goto sdp_error;
+  /* the media sections only depend on the streams, reuse the ones that were
+   * made for a previous SDP when nothing changed */
+  if (!gst_rtsp_media_add_cached_sdp (media, info->is_ipv6, cookie, sdp)) {
+    GstSDPMessage *medias;
+    gboolean cacheable = TRUE;
+
+    gst_sdp_message_new (&medias);
+
+    for (i = 0; res && (i < n_streams); i++) {
+      GstRTSPStream *stream;
+
+      stream = gst_rtsp_media_get_stream (media, i);
+      res = gst_rtsp_sdp_from_stream (medias, info, stream);
+      if (!res) {
+        GST_ERROR ("could not get SDP from stream %p", stream);
+        gst_sdp_message_free (medias);
+        goto sdp_error;
+      }
+      cacheable &= stream_sdp_is_cacheable (stream);
     }
+
+    for (i = 0; i < gst_sdp_message_medias_len (medias); i++) {
+      GstSDPMedia *smedia;
+
+      gst_sdp_media_copy (gst_sdp_message_get_media (medias, i), &smedia);
+      gst_sdp_message_add_media (sdp, smedia);
+      gst_sdp_media_free (smedia);
+    }
+
+    if (cacheable)
+      gst_rtsp_media_cache_sdp (media, info->is_ipv6, cookie, medias);
+    else
+      gst_sdp_message_free (medias);
   }
 
   {
@@ -0,0 +1,138 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* private API shared between the objects of the library, not installed */
+
+#ifndef __GST_RTSP_SERVER_INTERNAL_H__
+#define __GST_RTSP_SERVER_INTERNAL_H__
+
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "rtsp-stream-transport.h"
+#include "rtsp-media.h"
+#include "rtsp-media-factory.h"
+#include "rtsp-auth.h"
+
+G_BEGIN_DECLS
+
+/* rtsp-auth.c */
+gboolean           gst_rtsp_auth_connect_uses_tls (GstRTSPAuth * auth);
+
+/* rtsp-media.c */
+typedef void (*GstRTSPMediaPrepareFunc) (GstRTSPMedia * media,
+                                         GstRTSPMediaStatus status,
+                                         gpointer user_data);
+
+GstRTSPMediaStatus gst_rtsp_media_prepare_async  (GstRTSPMedia * media,
+                                                  GstRTSPThread * thread,
+                                                  GstRTSPMediaPrepareFunc func,
+                                                  gpointer user_data,
+                                                  GDestroyNotify notify);
+
+guint              gst_rtsp_media_get_sdp_cookie (GstRTSPMedia * media);
+gboolean           gst_rtsp_media_add_cached_sdp (GstRTSPMedia * media,
+                                                  gboolean is_ipv6,
+                                                  guint cookie,
+                                                  GstSDPMessage * sdp);
+void               gst_rtsp_media_cache_sdp      (GstRTSPMedia * media,
+                                                  gboolean is_ipv6,
+                                                  guint cookie,
+                                                  GstSDPMessage * medias);
+
+void               gst_rtsp_media_hand_over_prepared (GstRTSPMedia * media);
+
+/* rtsp-media-factory.c */
+void               gst_rtsp_media_factory_set_fallback_thread_pool (GstRTSPMediaFactory * factory,
+                                                                    GstRTSPThreadPool * pool);
+
+/* rtsp-stream.c */
+void               gst_rtsp_stream_set_sdp_generation (GstRTSPStream * stream,
+                                                       gint * generation);
+GList *            gst_rtsp_stream_reserve_gop_burst (GstRTSPStream * stream,
+                                                      guint * seq,
+                                                      guint * rtptime,
+                                                      GstClockTime * running_time);
+
+/* rtsp-stream-transport.c */
+void               gst_rtsp_stream_transport_queue_burst (GstRTSPStreamTransport * trans,
+                                                          GList * packets,
+                                                          guint16 last_seqnum);
+void               gst_rtsp_stream_transport_set_burst_rtpinfo (GstRTSPStreamTransport * trans,
+                                                                guint seq,
+                                                                guint rtptime,
+                                                                GstClockTime running_time);
+void               gst_rtsp_stream_transport_clear_burst_rtpinfo (GstRTSPStreamTransport * trans);
+void               gst_rtsp_stream_transport_reserve_burst (GstRTSPStreamTransport * trans);
+GList *            gst_rtsp_stream_transport_take_reserved_burst (GstRTSPStreamTransport * trans);
+void               gst_rtsp_stream_transport_set_removed (GstRTSPStreamTransport * trans,
+                                                        gboolean removed);
+gboolean           gst_rtsp_stream_transport_is_removed (GstRTSPStreamTransport * trans);
+
+/* rtsp-udp-sender.c */
+typedef struct _GstRTSPUdpSender GstRTSPUdpSender;
+
+GstRTSPUdpSender * gst_rtsp_udp_sender_new       (void);
+void               gst_rtsp_udp_sender_free      (GstRTSPUdpSender * sender);
+
+void               gst_rtsp_udp_sender_set_pacing (GstRTSPUdpSender * sender,
+                                                   gboolean pacing);
+
+gboolean           gst_rtsp_udp_sender_add       (GstRTSPUdpSender * sender,
+                                                  GSocket * socket,
+                                                  GInetAddress * addr,
+                                                  guint port,
+                                                  gint * last_seqnum);
+gboolean           gst_rtsp_udp_sender_remove    (GstRTSPUdpSender * sender,
+                                                  GInetAddress * addr,
+                                                  guint port);
+
+void               gst_rtsp_udp_sender_send      (GstRTSPUdpSender * sender,
+                                                  GstBuffer * buffer);
+void               gst_rtsp_udp_sender_send_list (GstRTSPUdpSender * sender,
+                                                  GstBufferList * buffer_list);
+
+/* rtsp-thread-pool.c */
+typedef enum
+{
+  GST_RTSP_THREAD_SOURCE_CLIENT,
+  GST_RTSP_THREAD_SOURCE_SESSION_POOL,
+  GST_RTSP_THREAD_SOURCE_MEDIA,
+  GST_RTSP_THREAD_SOURCE_LAST
+} GstRTSPThreadSource;
+
+gint64             gst_rtsp_thread_dispatch_begin (void);
+void               gst_rtsp_thread_dispatch_end  (GstRTSPThreadSource source,
+                                                  gint64 begin);
+
+gboolean           gst_rtsp_thread_is_bound      (GstRTSPThread * thread);
+void               gst_rtsp_thread_bind_current  (GstRTSPThread * thread);
+void               gst_rtsp_thread_unbind_current (void);
+
+/* rtsp-udp-src.c */
+GstElement *       gst_rtsp_udp_src_new          (GSocket * socket,
+                                                  guint batch_size);
+gboolean           gst_rtsp_udp_src_is_batched   (GstElement * element);
+void               gst_rtsp_udp_src_get_stats    (GstElement * element,
+                                                  guint64 * batches,
+                                                  guint64 * packets,
+                                                  guint * max_batch);
+
+G_END_DECLS
+
+#endif /* __GST_RTSP_SERVER_INTERNAL_H__ */
@@ -58,6 +58,12 @@
 #include "rtsp-server.h"
 #include "rtsp-client.h"
 
+#ifdef G_OS_UNIX
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#endif
+
 #define GST_RTSP_SERVER_GET_PRIVATE(obj)  \
        (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTSP_SERVER, GstRTSPServerPrivate))
 
@@ -91,6 +97,11 @@ struct _GstRTSPServerPrivate
   /* the clients that are connected */
   GList *clients;
   guint clients_cookie;
+
+  /* number of extra listening sockets accepting in client threads */
+  guint accept_threads;
+  /* the GSource of each extra listening socket */
+  GList *listeners;
 };
 
 #define DEFAULT_ADDRESS         "0.0.0.0"
@@ -98,6 +109,7 @@ struct _GstRTSPServerPrivate
 /* #define DEFAULT_ADDRESS         "::0" */
 #define DEFAULT_SERVICE         "8554"
 #define DEFAULT_BACKLOG         5
+#define DEFAULT_ACCEPT_THREADS  0
 
 /* Define to use the SO_LINGER option so that the server sockets can be resused
  * sooner. Disabled for now because it is not very well implemented by various
@@ -114,6 +126,7 @@ enum
 
   PROP_SESSION_POOL,
   PROP_MOUNT_POINTS,
+  PROP_ACCEPT_THREADS,
   PROP_LAST
 };
 
@@ -222,6 +235,21 @@ gst_rtsp_server_class_init (GstRTSPServerClass * klass)
           "The mount points to use for client session",
           GST_TYPE_RTSP_MOUNT_POINTS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstRTSPServer::accept-threads:
+   *
+   * The number of extra listening sockets that accept connections in the
+   * client threads of the thread pool. The sockets share the port of the
+   * server with SO_REUSEPORT so that the kernel spreads the new connections
+   * over them. 0 accepts all connections in the context of the server source.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_ACCEPT_THREADS,
+      g_param_spec_uint ("accept-threads", "Accept Threads",
+          "The number of client threads that accept connections on their "
+          "own listening socket", 0, G_MAXUINT, DEFAULT_ACCEPT_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_rtsp_server_signals[SIGNAL_CLIENT_CONNECTED] =
       g_signal_new ("client-connected", G_TYPE_FROM_CLASS (gobject_class),
@@ -246,6 +274,7 @@ gst_rtsp_server_init (GstRTSPServer * server)
   priv->service = g_strdup (DEFAULT_SERVICE);
   priv->socket = NULL;
   priv->backlog = DEFAULT_BACKLOG;
+  priv->accept_threads = DEFAULT_ACCEPT_THREADS;
   priv->session_pool = gst_rtsp_session_pool_new ();
   priv->mount_points = gst_rtsp_mount_points_new ();
   priv->thread_pool = gst_rtsp_thread_pool_new ();
@@ -714,6 +743,66 @@ gst_rtsp_server_get_thread_pool (GstRTSPServer * server)
   return result;
 }
 
+/**
+ * gst_rtsp_server_set_accept_threads:
+ * @server: a #GstRTSPServer
+ * @n_threads: the number of accepting client threads
+ *
+ * Configure @server to open @n_threads extra listening sockets on its port,
+ * each one attached to a client thread of the #GstRTSPThreadPool. New
+ * connections accepted on such a socket are handled in the thread that
+ * accepted them. The kernel spreads the connections over the sockets with
+ * SO_REUSEPORT, on platforms without it this setting is ignored.
+ *
+ * Set the max-threads of the thread pool to at least @n_threads to get a
+ * separate thread for each socket.
+ *
+ * This function must be called before the server is bound.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_server_set_accept_threads (GstRTSPServer * server, guint n_threads)
+{
+  GstRTSPServerPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_SERVER (server));
+
+  priv = server->priv;
+
+  GST_RTSP_SERVER_LOCK (server);
+  priv->accept_threads = n_threads;
+  GST_RTSP_SERVER_UNLOCK (server);
+}
+
+/**
+ * gst_rtsp_server_get_accept_threads:
+ * @server: a #GstRTSPServer
+ *
+ * Get the number of client threads that accept connections on their own
+ * listening socket.
+ *
+ * Returns: the number of accepting client threads.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_server_get_accept_threads (GstRTSPServer * server)
+{
+  GstRTSPServerPrivate *priv;
+  guint result;
+
+  g_return_val_if_fail (GST_IS_RTSP_SERVER (server), 0);
+
+  priv = server->priv;
+
+  GST_RTSP_SERVER_LOCK (server);
+  result = priv->accept_threads;
+  GST_RTSP_SERVER_UNLOCK (server);
+
+  return result;
+}
+
 static void
 gst_rtsp_server_get_property (GObject * object, guint propid,
     GValue * value, GParamSpec * pspec)
@@ -739,6 +828,9 @@ gst_rtsp_server_get_property (GObject * object, guint propid,
     case PROP_MOUNT_POINTS:
       g_value_take_object (value, gst_rtsp_server_get_mount_points (server));
       break;
+    case PROP_ACCEPT_THREADS:
+      g_value_set_uint (value, gst_rtsp_server_get_accept_threads (server));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, propid, pspec);
   }
@@ -766,6 +858,9 @@ gst_rtsp_server_set_property (GObject * object, guint propid,
     case PROP_MOUNT_POINTS:
       gst_rtsp_server_set_mount_points (server, g_value_get_object (value));
       break;
+    case PROP_ACCEPT_THREADS:
+      gst_rtsp_server_set_accept_threads (server, g_value_get_uint (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, propid, pspec);
   }
@@ -845,6 +940,18 @@ gst_rtsp_server_create_socket (GstRTSPServer * server,
       continue;
     }
 
+#ifdef SO_REUSEPORT
+    if (priv->accept_threads > 0) {
+      gint reuse = 1;
+
+      /* let the listening sockets of the accept threads share the port */
+      if (setsockopt (g_socket_get_fd (socket), SOL_SOCKET, SO_REUSEPORT,
+              (void *) &reuse, sizeof (reuse)) < 0)
+        GST_WARNING_OBJECT (server, "failed to set SO_REUSEPORT: %s",
+            g_strerror (errno));
+    }
+#endif
+
     if (g_socket_bind (socket, sockaddr, TRUE, bind_error ? NULL : &bind_error)) {
       /* ask what port the socket has been bound to */
       if (port == 0 || !strcmp (priv->service, "0")) {
@@ -1016,9 +1123,11 @@ unmanage_client (GstRTSPClient * client, ClientContext * ctx)
 }
 
 /* add the client context to the active list of clients, takes ownership
- * of client */
+ * of client. When @thread is not %NULL, the client is handled in @thread
+ * instead of a thread from the thread pool */
 static void
-manage_client (GstRTSPServer * server, GstRTSPClient * client)
+manage_client (GstRTSPServer * server, GstRTSPClient * client,
+    GstRTSPThread * thread)
 {
   ClientContext *cctx;
   GstRTSPServerPrivate *priv = server->priv;
@@ -1039,8 +1148,11 @@ manage_client (GstRTSPServer * server, GstRTSPClient * client)
   ctx.server = server;
   ctx.client = client;
 
-  cctx->thread = gst_rtsp_thread_pool_get_thread (priv->thread_pool,
-      GST_RTSP_THREAD_TYPE_CLIENT, &ctx);
+  if (thread && gst_rtsp_thread_reuse (thread))
+    cctx->thread = thread;
+  else
+    cctx->thread = gst_rtsp_thread_pool_get_thread (priv->thread_pool,
+        GST_RTSP_THREAD_TYPE_CLIENT, &ctx);
   if (cctx->thread)
     mainctx = cctx->thread->context;
   else {
@@ -1121,7 +1233,7 @@ gst_rtsp_server_transfer_connection (GstRTSPServer * server, GSocket * socket,
   gst_rtsp_client_set_connection (client, conn);
 
   /* manage the client connection */
-  manage_client (server, client);
+  manage_client (server, client, NULL);
 
   return TRUE;
 
@@ -1142,20 +1254,11 @@ no_connection:
   }
 }
 
-/**
- * gst_rtsp_server_io_func:
- * @socket: a #GSocket
- * @condition: the condition on @source
- * @server: (transfer none): a #GstRTSPServer
- *
- * A default #GSocketSourceFunc that creates a new #GstRTSPClient to accept and handle a
- * new connection on @socket or @server.
- *
- * Returns: TRUE if the source could be connected, FALSE if an error occurred.
- */
-gboolean
-gst_rtsp_server_io_func (GSocket * socket, GIOCondition condition,
-    GstRTSPServer * server)
+/* accept a new connection on @socket and handle it in @thread, or in a
+ * thread from the thread pool when @thread is %NULL */
+static void
+accept_client (GstRTSPServer * server, GSocket * socket,
+    GstRTSPThread * thread)
 {
   GstRTSPServerPrivate *priv = server->priv;
   GstRTSPClient *client = NULL;
@@ -1164,40 +1267,34 @@ gst_rtsp_server_io_func (GSocket * socket, GIOCondition condition,
   GstRTSPConnection *conn = NULL;
   GstRTSPContext ctx = { NULL };
 
-  if (condition & G_IO_IN) {
-    /* a new client connected. */
-    GST_RTSP_CHECK (gst_rtsp_connection_accept (socket, &conn, NULL),
-        accept_failed);
-
-    ctx.server = server;
-    ctx.conn = conn;
-    ctx.auth = priv->auth;
-    gst_rtsp_context_push_current (&ctx);
-
-    if (!gst_rtsp_auth_check (GST_RTSP_AUTH_CHECK_CONNECT))
-      goto connection_refused;
-
-    klass = GST_RTSP_SERVER_GET_CLASS (server);
-    /* a new client connected, create a client object to handle the client. */
-    if (klass->create_client)
-      client = klass->create_client (server);
-    if (client == NULL)
-      goto client_failed;
-
-    /* set connection on the client now */
-    gst_rtsp_client_set_connection (client, conn);
-
-    /* manage the client connection */
-    manage_client (server, client);
-  } else {
-    GST_WARNING_OBJECT (server, "received unknown event %08x", condition);
-    goto exit_no_ctx;
-  }
+  /* a new client connected. */
+  GST_RTSP_CHECK (gst_rtsp_connection_accept (socket, &conn, NULL),
+      accept_failed);
+
+  ctx.server = server;
+  ctx.conn = conn;
+  ctx.auth = priv->auth;
+  gst_rtsp_context_push_current (&ctx);
+
+  if (!gst_rtsp_auth_check (GST_RTSP_AUTH_CHECK_CONNECT))
+    goto connection_refused;
+
+  klass = GST_RTSP_SERVER_GET_CLASS (server);
+  /* a new client connected, create a client object to handle the client. */
+  if (klass->create_client)
+    client = klass->create_client (server);
+  if (client == NULL)
+    goto client_failed;
+
+  /* set connection on the client now */
+  gst_rtsp_client_set_connection (client, conn);
+
+  /* manage the client connection */
+  manage_client (server, client, thread);
+
 exit:
   gst_rtsp_context_pop_current (&ctx);
-exit_no_ctx:
-
-  return G_SOURCE_CONTINUE;
+  return;
 
   /* ERRORS */
 accept_failed:
@@ -1207,7 +1304,7 @@ accept_failed:
         socket, str);
     g_free (str);
     /* We haven't pushed the context yet, so just return */
-    goto exit_no_ctx;
+    return;
   }
 connection_refused:
   {
@@ -1223,13 +1320,159 @@ client_failed:
   }
 }
 
+/**
+ * gst_rtsp_server_io_func:
+ * @socket: a #GSocket
+ * @condition: the condition on @source
+ * @server: (transfer none): a #GstRTSPServer
+ *
+ * A default #GSocketSourceFunc that creates a new #GstRTSPClient to accept and handle a
+ * new connection on @socket or @server.
+ *
+ * Returns: TRUE if the source could be connected, FALSE if an error occurred.
+ */
+gboolean
+gst_rtsp_server_io_func (GSocket * socket, GIOCondition condition,
+    GstRTSPServer * server)
+{
+  if (condition & G_IO_IN) {
+    accept_client (server, socket, NULL);
+  } else {
+    GST_WARNING_OBJECT (server, "received unknown event %08x", condition);
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* a listening socket that accepts connections in a client thread */
+typedef struct
+{
+  GstRTSPServer *server;
+  GstRTSPThread *thread;
+} Listener;
+
+static gboolean
+listener_io_func (GSocket * socket, GIOCondition condition,
+    Listener * listener)
+{
+  if (condition & G_IO_IN) {
+    accept_client (listener->server, socket, listener->thread);
+  } else {
+    GST_WARNING_OBJECT (listener->server, "received unknown event %08x",
+        condition);
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+listener_free (Listener * listener)
+{
+  GST_DEBUG_OBJECT (listener->server, "listener %p destroyed", listener);
+
+  gst_rtsp_thread_stop (listener->thread);
+  g_object_unref (listener->server);
+  g_slice_free (Listener, listener);
+}
+
+/* open the extra listening sockets on the port of the server socket and
+ * attach them to client threads */
+static void
+create_listeners (GstRTSPServer * server, GCancellable * cancellable)
+{
+  GstRTSPServerPrivate *priv = server->priv;
+  GstRTSPContext ctx = { NULL };
+  guint i, n_threads;
+
+  GST_RTSP_SERVER_LOCK (server);
+  n_threads = priv->accept_threads;
+  GST_RTSP_SERVER_UNLOCK (server);
+
+  if (n_threads == 0)
+    return;
+
+#ifndef SO_REUSEPORT
+  GST_WARNING_OBJECT (server, "no SO_REUSEPORT, not using accept threads");
+  return;
+#endif
+
+  ctx.server = server;
+
+  for (i = 0; i < n_threads; i++) {
+    GError *error = NULL;
+    GstRTSPThread *thread;
+    GSocket *socket;
+    GSource *source;
+    Listener *listener;
+
+    thread = gst_rtsp_thread_pool_get_thread (priv->thread_pool,
+        GST_RTSP_THREAD_TYPE_CLIENT, &ctx);
+    if (thread == NULL)
+      goto no_thread;
+
+    /* binds to the port the server socket was bound to */
+    socket = gst_rtsp_server_create_socket (server, NULL, &error);
+    if (socket == NULL)
+      goto no_socket;
+
+    listener = g_slice_new (Listener);
+    listener->server = g_object_ref (server);
+    listener->thread = thread;
+
+    source = g_socket_create_source (socket, G_IO_IN |
+        G_IO_ERR | G_IO_HUP | G_IO_NVAL, cancellable);
+    g_object_unref (socket);
+
+    g_source_set_callback (source, (GSourceFunc) listener_io_func, listener,
+        (GDestroyNotify) listener_free);
+
+    GST_RTSP_SERVER_LOCK (server);
+    priv->listeners = g_list_prepend (priv->listeners, source);
+    GST_RTSP_SERVER_UNLOCK (server);
+
+    GST_DEBUG_OBJECT (server, "listener %p accepts in thread %p", listener,
+        thread);
+    g_source_attach (source, thread->context);
+  }
+  return;
+
+  /* ERRORS */
+no_thread:
+  {
+    GST_WARNING_OBJECT (server, "no client thread for listener %u", i);
+    return;
+  }
+no_socket:
+  {
+    GST_WARNING_OBJECT (server, "failed to create listener socket: %s",
+        error ? error->message : "unknown error");
+    g_clear_error (&error);
+    gst_rtsp_thread_stop (thread);
+    return;
+  }
+}
+
 static void
 watch_destroyed (GstRTSPServer * server)
 {
   GstRTSPServerPrivate *priv = server->priv;
+  GList *listeners, *walk;
 
   GST_DEBUG_OBJECT (server, "source destroyed");
 
+  GST_RTSP_SERVER_LOCK (server);
+  listeners = priv->listeners;
+  priv->listeners = NULL;
+  GST_RTSP_SERVER_UNLOCK (server);
+
+  for (walk = listeners; walk; walk = g_list_next (walk)) {
+    GSource *source = walk->data;
+
+    g_source_destroy (source);
+    g_source_unref (source);
+  }
+  g_list_free (listeners);
+
   g_object_unref (priv->socket);
   priv->socket = NULL;
   g_object_unref (server);
@@ -1249,6 +1492,10 @@ watch_destroyed (GstRTSPServer * server)
  * unless cancellation happened at the same time as a condition change). You can
  * check for this in the callback using g_cancellable_is_cancelled().
  *
+ * When #GstRTSPServer:accept-threads is not 0, the extra listening sockets
+ * are created and attached to their client threads as well. They are removed
+ * again when the returned source is destroyed.
+ *
  * This takes a reference on @server until @source is destroyed.
  *
  * Returns: (transfer full): the #GSource for @server or %NULL when an error
@@ -1288,6 +1535,9 @@ gst_rtsp_server_create_source (GstRTSPServer * server,
       (GSourceFunc) gst_rtsp_server_io_func, g_object_ref (server),
       (GDestroyNotify) watch_destroyed);
 
+  /* accept in the client threads as well */
+  create_listeners (server, cancellable);
+
   return source;
 
 no_socket:
@@ -144,6 +144,12 @@ void                  gst_rtsp_server_set_thread_pool      (GstRTSPServer *serve
 GST_EXPORT
 GstRTSPThreadPool *   gst_rtsp_server_get_thread_pool      (GstRTSPServer *server);
 
+GST_EXPORT
+void                  gst_rtsp_server_set_accept_threads   (GstRTSPServer *server, guint n_threads);
+
+GST_EXPORT
+guint                 gst_rtsp_server_get_accept_threads   (GstRTSPServer *server);
+
 GST_EXPORT
 gboolean              gst_rtsp_server_transfer_connection  (GstRTSPServer * server, GSocket *socket,
                                                             const gchar * ip, gint port,
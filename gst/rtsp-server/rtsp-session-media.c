@@ -38,6 +38,7 @@
 #include <string.h>
 
 #include "rtsp-session.h"
+#include "rtsp-server-internal.h"
 
 #define GST_RTSP_SESSION_MEDIA_GET_PRIVATE(obj)  \
     (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTSP_SESSION_MEDIA, GstRTSPSessionMediaPrivate))
@@ -280,6 +281,10 @@ gst_rtsp_session_media_get_rtpinfo (GstRTSPSessionMedia * media)
       continue;
     }
 
+    /* a transport that is not sending yet starts with the cached packets of
+     * its stream, reserve them so that the RTP-Info reports the first */
+    gst_rtsp_stream_transport_reserve_burst (transport);
+
     stream = gst_rtsp_stream_transport_get_stream (transport);
     if (!gst_rtsp_stream_get_rtpinfo (stream, NULL, NULL, NULL, &running_time))
       continue;
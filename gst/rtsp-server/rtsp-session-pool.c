@@ -41,16 +41,42 @@
  */
 
 #include "rtsp-session-pool.h"
+#include "rtsp-server-internal.h"
 
 #define GST_RTSP_SESSION_POOL_GET_PRIVATE(obj)  \
          (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTSP_SESSION_POOL, GstRTSPSessionPoolPrivate))
 
-struct _GstRTSPSessionPoolPrivate
+/* the sessions are spread over shards by the hash of their id so that
+ * requests for different sessions don't wait for each other */
+#define N_SHARDS 16
+
+typedef struct
 {
-  GMutex lock;                  /* protects everything in this struct */
-  guint max_sessions;
+  GMutex lock;                  /* protects sessions and cookie */
   GHashTable *sessions;
-  guint sessions_cookie;
+  guint cookie;
+} SessionShard;
+
+/* the expiry time of a session in the timeouts heap. Touching a session only
+ * moves its expiry later so the deadline is checked again when it passed. */
+typedef struct
+{
+  GstRTSPSession *session;
+  gint64 deadline;              /* monotonic time in microseconds */
+  guint index;                  /* position in the heap */
+} TimeoutEntry;
+
+struct _GstRTSPSessionPoolPrivate
+{
+  gint max_sessions;            /* ATOMIC */
+  gint n_sessions;              /* ATOMIC */
+  SessionShard shards[N_SHARDS];
+
+  GMutex timeout_lock;
+  GPtrArray *timeouts;          /* min-heap of TimeoutEntry by deadline,
+                                 * protected by timeout_lock */
+  GHashTable *timeout_entries;  /* GstRTSPSession -> TimeoutEntry, protected
+                                 * by timeout_lock */
 };
 
 #define DEFAULT_MAX_SESSIONS 0
@@ -129,13 +155,185 @@ static void
 gst_rtsp_session_pool_init (GstRTSPSessionPool * pool)
 {
   GstRTSPSessionPoolPrivate *priv = GST_RTSP_SESSION_POOL_GET_PRIVATE (pool);
+  guint i;
 
   pool->priv = priv;
 
-  g_mutex_init (&priv->lock);
-  priv->sessions = g_hash_table_new_full (g_str_hash, g_str_equal,
-      NULL, g_object_unref);
+  for (i = 0; i < N_SHARDS; i++) {
+    SessionShard *shard = &priv->shards[i];
+
+    g_mutex_init (&shard->lock);
+    shard->sessions = g_hash_table_new_full (g_str_hash, g_str_equal,
+        NULL, g_object_unref);
+  }
   priv->max_sessions = DEFAULT_MAX_SESSIONS;
+
+  g_mutex_init (&priv->timeout_lock);
+  priv->timeouts = g_ptr_array_new ();
+  priv->timeout_entries = g_hash_table_new (NULL, NULL);
+}
+
+static SessionShard *
+get_shard (GstRTSPSessionPoolPrivate * priv, const gchar * sessionid)
+{
+  return &priv->shards[g_str_hash (sessionid) % N_SHARDS];
+}
+
+/* the monotonic time at which @session expires when it is not touched */
+static gint64
+session_deadline (GstRTSPSession * session, gint64 now)
+{
+  return now + gst_rtsp_session_next_timeout_usec (session, now) * 1000;
+}
+
+static void
+heap_swap (GPtrArray * heap, guint i, guint j)
+{
+  TimeoutEntry *a = g_ptr_array_index (heap, i);
+  TimeoutEntry *b = g_ptr_array_index (heap, j);
+
+  g_ptr_array_index (heap, i) = b;
+  b->index = i;
+  g_ptr_array_index (heap, j) = a;
+  a->index = j;
+}
+
+static void
+heap_sift_up (GPtrArray * heap, guint i)
+{
+  while (i > 0) {
+    guint parent = (i - 1) / 2;
+    TimeoutEntry *entry = g_ptr_array_index (heap, i);
+    TimeoutEntry *pentry = g_ptr_array_index (heap, parent);
+
+    if (pentry->deadline <= entry->deadline)
+      break;
+    heap_swap (heap, i, parent);
+    i = parent;
+  }
+}
+
+static void
+heap_sift_down (GPtrArray * heap, guint i)
+{
+  while (TRUE) {
+    guint left = 2 * i + 1, right = left + 1, smallest = i;
+
+    if (left < heap->len &&
+        ((TimeoutEntry *) g_ptr_array_index (heap, left))->deadline <
+        ((TimeoutEntry *) g_ptr_array_index (heap, smallest))->deadline)
+      smallest = left;
+    if (right < heap->len &&
+        ((TimeoutEntry *) g_ptr_array_index (heap, right))->deadline <
+        ((TimeoutEntry *) g_ptr_array_index (heap, smallest))->deadline)
+      smallest = right;
+    if (smallest == i)
+      break;
+    heap_swap (heap, i, smallest);
+    i = smallest;
+  }
+}
+
+/* must be called with timeout_lock */
+static void
+heap_remove (GPtrArray * heap, TimeoutEntry * entry)
+{
+  guint i = entry->index, last = heap->len - 1;
+
+  if (i != last) {
+    heap_swap (heap, i, last);
+    g_ptr_array_set_size (heap, last);
+    heap_sift_down (heap, i);
+    heap_sift_up (heap, i);
+  } else {
+    g_ptr_array_set_size (heap, last);
+  }
+}
+
+static void
+session_timeout_changed (GstRTSPSession * session, GParamSpec * pspec,
+    GstRTSPSessionPool * pool)
+{
+  GstRTSPSessionPoolPrivate *priv = pool->priv;
+  TimeoutEntry *entry;
+
+  g_mutex_lock (&priv->timeout_lock);
+  entry = g_hash_table_lookup (priv->timeout_entries, session);
+  if (entry) {
+    entry->deadline = session_deadline (session, g_get_monotonic_time ());
+    heap_sift_down (priv->timeouts, entry->index);
+    heap_sift_up (priv->timeouts, entry->index);
+  }
+  g_mutex_unlock (&priv->timeout_lock);
+}
+
+/* start tracking the expiry of @session */
+static void
+watch_session (GstRTSPSessionPool * pool, GstRTSPSession * session)
+{
+  GstRTSPSessionPoolPrivate *priv = pool->priv;
+  TimeoutEntry *entry;
+
+  g_signal_connect (session, "notify::timeout",
+      (GCallback) session_timeout_changed, pool);
+
+  entry = g_slice_new (TimeoutEntry);
+  entry->session = g_object_ref (session);
+
+  g_mutex_lock (&priv->timeout_lock);
+  entry->deadline = session_deadline (session, g_get_monotonic_time ());
+  entry->index = priv->timeouts->len;
+  g_ptr_array_add (priv->timeouts, entry);
+  heap_sift_up (priv->timeouts, entry->index);
+  g_hash_table_insert (priv->timeout_entries, session, entry);
+  g_mutex_unlock (&priv->timeout_lock);
+}
+
+/* stop tracking the expiry of @session after it was removed from @pool */
+static void
+unwatch_session (GstRTSPSessionPool * pool, GstRTSPSession * session)
+{
+  GstRTSPSessionPoolPrivate *priv = pool->priv;
+  TimeoutEntry *entry;
+
+  g_signal_handlers_disconnect_by_func (session, session_timeout_changed,
+      pool);
+
+  g_mutex_lock (&priv->timeout_lock);
+  entry = g_hash_table_lookup (priv->timeout_entries, session);
+  if (entry) {
+    heap_remove (priv->timeouts, entry);
+    g_hash_table_remove (priv->timeout_entries, session);
+  }
+  g_mutex_unlock (&priv->timeout_lock);
+
+  if (entry) {
+    g_object_unref (entry->session);
+    g_slice_free (TimeoutEntry, entry);
+  }
+}
+
+/* check the deadline of the first session in the heap again when it passed,
+ * the session might have been touched since. Returns the entry of an expired
+ * session or %NULL. Must be called with timeout_lock */
+static TimeoutEntry *
+peek_expired (GstRTSPSessionPoolPrivate * priv, gint64 now)
+{
+  while (priv->timeouts->len > 0) {
+    TimeoutEntry *entry = g_ptr_array_index (priv->timeouts, 0);
+    gint64 deadline;
+
+    if (entry->deadline > now)
+      break;
+
+    deadline = session_deadline (entry->session, now);
+    if (deadline <= now)
+      return entry;
+
+    entry->deadline = deadline;
+    heap_sift_down (priv->timeouts, 0);
+  }
+  return NULL;
 }
 
 static GstRTSPFilterResult
@@ -150,10 +348,16 @@ gst_rtsp_session_pool_finalize (GObject * object)
 {
   GstRTSPSessionPool *pool = GST_RTSP_SESSION_POOL (object);
   GstRTSPSessionPoolPrivate *priv = pool->priv;
+  guint i;
 
   gst_rtsp_session_pool_filter (pool, remove_sessions_func, NULL);
-  g_hash_table_unref (priv->sessions);
-  g_mutex_clear (&priv->lock);
+  for (i = 0; i < N_SHARDS; i++) {
+    g_hash_table_unref (priv->shards[i].sessions);
+    g_mutex_clear (&priv->shards[i].lock);
+  }
+  g_ptr_array_free (priv->timeouts, TRUE);
+  g_hash_table_unref (priv->timeout_entries);
+  g_mutex_clear (&priv->timeout_lock);
 
   G_OBJECT_CLASS (gst_rtsp_session_pool_parent_class)->finalize (object);
 }
@@ -225,9 +429,7 @@ gst_rtsp_session_pool_set_max_sessions (GstRTSPSessionPool * pool, guint max)
 
   priv = pool->priv;
 
-  g_mutex_lock (&priv->lock);
-  priv->max_sessions = max;
-  g_mutex_unlock (&priv->lock);
+  g_atomic_int_set (&priv->max_sessions, max);
 }
 
 /**
@@ -249,9 +451,7 @@ gst_rtsp_session_pool_get_max_sessions (GstRTSPSessionPool * pool)
 
   priv = pool->priv;
 
-  g_mutex_lock (&priv->lock);
-  result = priv->max_sessions;
-  g_mutex_unlock (&priv->lock);
+  result = g_atomic_int_get (&priv->max_sessions);
 
   return result;
 }
@@ -274,9 +474,7 @@ gst_rtsp_session_pool_get_n_sessions (GstRTSPSessionPool * pool)
 
   priv = pool->priv;
 
-  g_mutex_lock (&priv->lock);
-  result = g_hash_table_size (priv->sessions);
-  g_mutex_unlock (&priv->lock);
+  result = g_atomic_int_get (&priv->n_sessions);
 
   return result;
 }
@@ -295,21 +493,21 @@ gst_rtsp_session_pool_get_n_sessions (GstRTSPSessionPool * pool)
 GstRTSPSession *
 gst_rtsp_session_pool_find (GstRTSPSessionPool * pool, const gchar * sessionid)
 {
-  GstRTSPSessionPoolPrivate *priv;
+  SessionShard *shard;
   GstRTSPSession *result;
 
   g_return_val_if_fail (GST_IS_RTSP_SESSION_POOL (pool), NULL);
   g_return_val_if_fail (sessionid != NULL, NULL);
 
-  priv = pool->priv;
+  shard = get_shard (pool->priv, sessionid);
 
-  g_mutex_lock (&priv->lock);
-  result = g_hash_table_lookup (priv->sessions, sessionid);
+  g_mutex_lock (&shard->lock);
+  result = g_hash_table_lookup (shard->sessions, sessionid);
   if (result) {
     g_object_ref (result);
     gst_rtsp_session_touch (result);
   }
-  g_mutex_unlock (&priv->lock);
+  g_mutex_unlock (&shard->lock);
 
   return result;
 }
@@ -335,6 +533,25 @@ create_session (GstRTSPSessionPool * pool, const gchar * id)
   return gst_rtsp_session_new (id);
 }
 
+/* count a new session in @pool, fails when the maximum is reached */
+static gboolean
+reserve_session (GstRTSPSessionPoolPrivate * priv)
+{
+  gint max;
+
+  max = g_atomic_int_get (&priv->max_sessions);
+  if (max <= 0) {
+    g_atomic_int_inc (&priv->n_sessions);
+    return TRUE;
+  }
+
+  if (g_atomic_int_add (&priv->n_sessions, 1) >= max) {
+    g_atomic_int_add (&priv->n_sessions, -1);
+    return FALSE;
+  }
+  return TRUE;
+}
+
 /**
  * gst_rtsp_session_pool_create:
  * @pool: a #GstRTSPSessionPool
@@ -349,6 +566,7 @@ gst_rtsp_session_pool_create (GstRTSPSessionPool * pool)
   GstRTSPSessionPoolPrivate *priv;
   GstRTSPSession *result = NULL;
   GstRTSPSessionPoolClass *klass;
+  SessionShard *shard;
   gchar *id = NULL;
   guint retry;
 
@@ -358,6 +576,10 @@ gst_rtsp_session_pool_create (GstRTSPSessionPool * pool)
 
   klass = GST_RTSP_SESSION_POOL_GET_CLASS (pool);
 
+  /* check session limit */
+  if (!reserve_session (priv))
+    goto too_many_sessions;
+
   retry = 0;
   do {
     /* start by creating a new random session id, we assume that this is random
@@ -370,14 +592,11 @@ gst_rtsp_session_pool_create (GstRTSPSessionPool * pool)
     if (id == NULL)
       goto no_session;
 
-    g_mutex_lock (&priv->lock);
-    /* check session limit */
-    if (priv->max_sessions > 0) {
-      if (g_hash_table_size (priv->sessions) >= priv->max_sessions)
-        goto too_many_sessions;
-    }
+    shard = get_shard (priv, id);
+
+    g_mutex_lock (&shard->lock);
     /* check if the sessionid existed */
-    result = g_hash_table_lookup (priv->sessions, id);
+    result = g_hash_table_lookup (shard->sessions, id);
     if (result) {
       /* found, retry with a different session id */
       result = NULL;
@@ -389,45 +608,57 @@ gst_rtsp_session_pool_create (GstRTSPSessionPool * pool)
       if (klass->create_session)
         result = create_session (pool, id);
       if (result == NULL)
-        goto too_many_sessions;
+        goto create_failed;
       /* take additional ref for the pool */
       g_object_ref (result);
-      g_hash_table_insert (priv->sessions,
+      g_hash_table_insert (shard->sessions,
           (gchar *) gst_rtsp_session_get_sessionid (result), result);
-      priv->sessions_cookie++;
+      shard->cookie++;
     }
-    g_mutex_unlock (&priv->lock);
+    g_mutex_unlock (&shard->lock);
 
     g_free (id);
   } while (result == NULL);
 
+  watch_session (pool, result);
+
   return result;
 
   /* ERRORS */
 no_function:
   {
     GST_WARNING ("no create_session_id vmethod in GstRTSPSessionPool %p", pool);
+    g_atomic_int_add (&priv->n_sessions, -1);
     return NULL;
   }
 no_session:
   {
     GST_WARNING ("can't create session id with GstRTSPSessionPool %p", pool);
+    g_atomic_int_add (&priv->n_sessions, -1);
     return NULL;
   }
 collision:
   {
     GST_WARNING ("can't find unique sessionid for GstRTSPSessionPool %p", pool);
-    g_mutex_unlock (&priv->lock);
+    g_mutex_unlock (&shard->lock);
+    g_atomic_int_add (&priv->n_sessions, -1);
     g_free (id);
     return NULL;
   }
-too_many_sessions:
+create_failed:
   {
-    GST_WARNING ("session pool reached max sessions of %d", priv->max_sessions);
-    g_mutex_unlock (&priv->lock);
+    GST_WARNING ("can't create session with GstRTSPSessionPool %p", pool);
+    g_mutex_unlock (&shard->lock);
+    g_atomic_int_add (&priv->n_sessions, -1);
     g_free (id);
     return NULL;
   }
+too_many_sessions:
+  {
+    GST_WARNING ("session pool reached max sessions of %d",
+        g_atomic_int_get (&priv->max_sessions));
+    return NULL;
+  }
 }
 
 /**
@@ -443,53 +674,37 @@ gboolean
 gst_rtsp_session_pool_remove (GstRTSPSessionPool * pool, GstRTSPSession * sess)
 {
   GstRTSPSessionPoolPrivate *priv;
+  SessionShard *shard;
+  const gchar *sessionid;
   gboolean found;
 
   g_return_val_if_fail (GST_IS_RTSP_SESSION_POOL (pool), FALSE);
   g_return_val_if_fail (GST_IS_RTSP_SESSION (sess), FALSE);
 
   priv = pool->priv;
+  sessionid = gst_rtsp_session_get_sessionid (sess);
+  shard = get_shard (priv, sessionid);
 
-  g_mutex_lock (&priv->lock);
+  g_mutex_lock (&shard->lock);
   g_object_ref (sess);
-  found =
-      g_hash_table_remove (priv->sessions,
-      gst_rtsp_session_get_sessionid (sess));
-  if (found)
-    priv->sessions_cookie++;
-  g_mutex_unlock (&priv->lock);
-
-  if (found)
+  found = g_hash_table_remove (shard->sessions, sessionid);
+  if (found) {
+    shard->cookie++;
+    g_atomic_int_add (&priv->n_sessions, -1);
+  }
+  g_mutex_unlock (&shard->lock);
+
+  if (found) {
+    unwatch_session (pool, sess);
     g_signal_emit (pool, gst_rtsp_session_pool_signals[SIGNAL_SESSION_REMOVED],
         0, sess);
+  }
 
   g_object_unref (sess);
 
   return found;
 }
 
-typedef struct
-{
-  gint64 now_monotonic_time;
-  GstRTSPSessionPool *pool;
-  GList *removed;
-} CleanupData;
-
-static gboolean
-cleanup_func (gchar * sessionid, GstRTSPSession * sess, CleanupData * data)
-{
-  gboolean expired;
-
-  expired = gst_rtsp_session_is_expired_usec (sess, data->now_monotonic_time);
-
-  if (expired) {
-    GST_DEBUG ("session expired");
-    data->removed = g_list_prepend (data->removed, g_object_ref (sess));
-  }
-
-  return expired;
-}
-
 /**
  * gst_rtsp_session_pool_cleanup:
  * @pool: a #GstRTSPSessionPool
@@ -503,89 +718,70 @@ guint
 gst_rtsp_session_pool_cleanup (GstRTSPSessionPool * pool)
 {
   GstRTSPSessionPoolPrivate *priv;
-  guint result;
-  CleanupData data;
-  GList *walk;
+  guint result = 0;
+  TimeoutEntry *entry;
+  GList *expired = NULL, *walk;
+  gint64 now;
 
   g_return_val_if_fail (GST_IS_RTSP_SESSION_POOL (pool), 0);
 
   priv = pool->priv;
 
-  data.now_monotonic_time = g_get_monotonic_time ();
+  now = g_get_monotonic_time ();
 
-  data.pool = pool;
-  data.removed = NULL;
-
-  g_mutex_lock (&priv->lock);
-  result =
-      g_hash_table_foreach_remove (priv->sessions, (GHRFunc) cleanup_func,
-      &data);
-  if (result > 0)
-    priv->sessions_cookie++;
-  g_mutex_unlock (&priv->lock);
+  /* take the expired sessions from the front of the heap */
+  g_mutex_lock (&priv->timeout_lock);
+  while ((entry = peek_expired (priv, now))) {
+    GST_DEBUG ("session expired");
+    heap_remove (priv->timeouts, entry);
+    g_hash_table_remove (priv->timeout_entries, entry->session);
+    expired = g_list_prepend (expired, entry->session);
+    g_slice_free (TimeoutEntry, entry);
+  }
+  g_mutex_unlock (&priv->timeout_lock);
 
-  for (walk = data.removed; walk; walk = walk->next) {
+  for (walk = expired; walk; walk = walk->next) {
     GstRTSPSession *sess = walk->data;
+    const gchar *sessionid = gst_rtsp_session_get_sessionid (sess);
+    SessionShard *shard = get_shard (priv, sessionid);
+    gboolean removed;
+
+    g_mutex_lock (&shard->lock);
+    removed = g_hash_table_remove (shard->sessions, sessionid);
+    if (removed) {
+      shard->cookie++;
+      g_atomic_int_add (&priv->n_sessions, -1);
+    }
+    g_mutex_unlock (&shard->lock);
 
-    g_signal_emit (pool,
-        gst_rtsp_session_pool_signals[SIGNAL_SESSION_REMOVED], 0, sess);
-
+    if (removed) {
+      unwatch_session (pool, sess);
+      g_signal_emit (pool,
+          gst_rtsp_session_pool_signals[SIGNAL_SESSION_REMOVED], 0, sess);
+      result++;
+    }
     g_object_unref (sess);
   }
-  g_list_free (data.removed);
+  g_list_free (expired);
 
   return result;
 }
 
-/**
- * gst_rtsp_session_pool_filter:
- * @pool: a #GstRTSPSessionPool
- * @func: (scope call) (allow-none): a callback
- * @user_data: (closure): user data passed to @func
- *
- * Call @func for each session in @pool. The result value of @func determines
- * what happens to the session. @func will be called with the session pool
- * locked so no further actions on @pool can be performed from @func.
- *
- * If @func returns #GST_RTSP_FILTER_REMOVE, the session will be set to the
- * expired state with gst_rtsp_session_set_expired() and removed from
- * @pool.
- *
- * If @func returns #GST_RTSP_FILTER_KEEP, the session will remain in @pool.
- *
- * If @func returns #GST_RTSP_FILTER_REF, the session will remain in @pool but
- * will also be added with an additional ref to the result GList of this
- * function..
- *
- * When @func is %NULL, #GST_RTSP_FILTER_REF will be assumed for all sessions.
- *
- * Returns: (element-type GstRTSPSession) (transfer full): a GList with all
- * sessions for which @func returned #GST_RTSP_FILTER_REF. After usage, each
- * element in the GList should be unreffed before the list is freed.
- */
-GList *
-gst_rtsp_session_pool_filter (GstRTSPSessionPool * pool,
-    GstRTSPSessionPoolFilterFunc func, gpointer user_data)
+/* call @func for the sessions in @shard, see gst_rtsp_session_pool_filter() */
+static GList *
+filter_shard (GstRTSPSessionPool * pool, SessionShard * shard,
+    GstRTSPSessionPoolFilterFunc func, gpointer user_data,
+    GHashTable * visited, GList * result)
 {
-  GstRTSPSessionPoolPrivate *priv;
+  GstRTSPSessionPoolPrivate *priv = pool->priv;
   GHashTableIter iter;
   gpointer key, value;
-  GList *result;
-  GHashTable *visited;
   guint cookie;
 
-  g_return_val_if_fail (GST_IS_RTSP_SESSION_POOL (pool), NULL);
-
-  priv = pool->priv;
-
-  result = NULL;
-  if (func)
-    visited = g_hash_table_new_full (NULL, NULL, g_object_unref, NULL);
-
-  g_mutex_lock (&priv->lock);
+  g_mutex_lock (&shard->lock);
 restart:
-  g_hash_table_iter_init (&iter, priv->sessions);
-  cookie = priv->sessions_cookie;
+  g_hash_table_iter_init (&iter, shard->sessions);
+  cookie = shard->cookie;
   while (g_hash_table_iter_next (&iter, &key, &value)) {
     GstRTSPSession *session = value;
     GstRTSPFilterResult res;
@@ -597,15 +793,15 @@ restart:
         continue;
 
       g_hash_table_add (visited, g_object_ref (session));
-      g_mutex_unlock (&priv->lock);
+      g_mutex_unlock (&shard->lock);
 
       res = func (pool, session, user_data);
 
-      g_mutex_lock (&priv->lock);
+      g_mutex_lock (&shard->lock);
     } else
       res = GST_RTSP_FILTER_REF;
 
-    changed = (cookie != priv->sessions_cookie);
+    changed = (cookie != shard->cookie);
 
     switch (res) {
       case GST_RTSP_FILTER_REMOVE:
@@ -614,23 +810,25 @@ restart:
 
         if (changed)
           /* something changed, check if we still have the session */
-          removed = g_hash_table_remove (priv->sessions, key);
+          removed = g_hash_table_remove (shard->sessions, key);
         else
           g_hash_table_iter_remove (&iter);
 
         if (removed) {
           /* if we managed to remove the session, update the cookie and
            * signal */
-          cookie = ++priv->sessions_cookie;
-          g_mutex_unlock (&priv->lock);
+          cookie = ++shard->cookie;
+          g_atomic_int_add (&priv->n_sessions, -1);
+          g_mutex_unlock (&shard->lock);
 
+          unwatch_session (pool, session);
           g_signal_emit (pool,
               gst_rtsp_session_pool_signals[SIGNAL_SESSION_REMOVED], 0,
               session);
 
-          g_mutex_lock (&priv->lock);
+          g_mutex_lock (&shard->lock);
           /* cookie could have changed again, make sure we restart */
-          changed |= (cookie != priv->sessions_cookie);
+          changed |= (cookie != shard->cookie);
         }
         break;
       }
@@ -645,7 +843,58 @@ restart:
     if (changed)
       goto restart;
   }
-  g_mutex_unlock (&priv->lock);
+  g_mutex_unlock (&shard->lock);
+
+  return result;
+}
+
+/**
+ * gst_rtsp_session_pool_filter:
+ * @pool: a #GstRTSPSessionPool
+ * @func: (scope call) (allow-none): a callback
+ * @user_data: (closure): user data passed to @func
+ *
+ * Call @func for each session in @pool. The result value of @func determines
+ * what happens to the session. @func will be called without the session pool
+ * locked. The sessions are visited shard by shard, sessions that are added
+ * to @pool while filtering might not be visited.
+ *
+ * If @func returns #GST_RTSP_FILTER_REMOVE, the session will be set to the
+ * expired state with gst_rtsp_session_set_expired() and removed from
+ * @pool.
+ *
+ * If @func returns #GST_RTSP_FILTER_KEEP, the session will remain in @pool.
+ *
+ * If @func returns #GST_RTSP_FILTER_REF, the session will remain in @pool but
+ * will also be added with an additional ref to the result GList of this
+ * function..
+ *
+ * When @func is %NULL, #GST_RTSP_FILTER_REF will be assumed for all sessions.
+ *
+ * Returns: (element-type GstRTSPSession) (transfer full): a GList with all
+ * sessions for which @func returned #GST_RTSP_FILTER_REF. After usage, each
+ * element in the GList should be unreffed before the list is freed.
+ */
+GList *
+gst_rtsp_session_pool_filter (GstRTSPSessionPool * pool,
+    GstRTSPSessionPoolFilterFunc func, gpointer user_data)
+{
+  GstRTSPSessionPoolPrivate *priv;
+  GList *result;
+  GHashTable *visited = NULL;
+  guint i;
+
+  g_return_val_if_fail (GST_IS_RTSP_SESSION_POOL (pool), NULL);
+
+  priv = pool->priv;
+
+  result = NULL;
+  if (func)
+    visited = g_hash_table_new_full (NULL, NULL, g_object_unref, NULL);
+
+  for (i = 0; i < N_SHARDS; i++)
+    result = filter_shard (pool, &priv->shards[i], func, user_data, visited,
+        result);
 
   if (func)
     g_hash_table_unref (visited);
@@ -660,35 +909,30 @@ typedef struct
   gint timeout;
 } GstPoolSource;
 
-static void
-collect_timeout (gchar * sessionid, GstRTSPSession * sess, GstPoolSource * psrc)
-{
-  gint timeout;
-  gint64 now_monotonic_time;
-
-  now_monotonic_time = g_get_monotonic_time ();
-
-  timeout = gst_rtsp_session_next_timeout_usec (sess, now_monotonic_time);
-
-  GST_INFO ("%p: next timeout: %d", sess, timeout);
-  if (psrc->timeout == -1 || timeout < psrc->timeout)
-    psrc->timeout = timeout;
-}
-
 static gboolean
 gst_pool_source_prepare (GSource * source, gint * timeout)
 {
   GstRTSPSessionPoolPrivate *priv;
   GstPoolSource *psrc;
+  TimeoutEntry *entry;
   gboolean result;
+  gint64 now;
 
   psrc = (GstPoolSource *) source;
   psrc->timeout = -1;
   priv = psrc->pool->priv;
 
-  g_mutex_lock (&priv->lock);
-  g_hash_table_foreach (priv->sessions, (GHFunc) collect_timeout, psrc);
-  g_mutex_unlock (&priv->lock);
+  now = g_get_monotonic_time ();
+
+  /* only the session that expires first matters */
+  g_mutex_lock (&priv->timeout_lock);
+  if (peek_expired (priv, now)) {
+    psrc->timeout = 0;
+  } else if (priv->timeouts->len > 0) {
+    entry = g_ptr_array_index (priv->timeouts, 0);
+    psrc->timeout = MIN ((entry->deadline - now) / 1000, G_MAXINT);
+  }
+  g_mutex_unlock (&priv->timeout_lock);
 
   if (timeout)
     *timeout = psrc->timeout;
@@ -715,13 +959,16 @@ gst_pool_source_dispatch (GSource * source, GSourceFunc callback,
   gboolean res;
   GstPoolSource *psrc = (GstPoolSource *) source;
   GstRTSPSessionPoolFunc func = (GstRTSPSessionPoolFunc) callback;
+  gint64 begin;
 
   GST_INFO ("dispatch");
 
+  begin = gst_rtsp_thread_dispatch_begin ();
   if (func)
     res = func (psrc->pool, user_data);
   else
     res = FALSE;
+  gst_rtsp_thread_dispatch_end (GST_RTSP_THREAD_SOURCE_SESSION_POOL, begin);
 
   return res;
 }
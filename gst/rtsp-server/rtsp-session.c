@@ -57,9 +57,16 @@ struct _GstRTSPSessionPrivate
 
   guint timeout;
   gboolean timeout_always_visible;
+  gint64 create_monotonic_time;
+  gint64 create_real_time;
+  /* the monotonic time of the last access, in microseconds. It is read and
+   * updated without the lock where a pointer can hold it */
+#if GLIB_SIZEOF_VOID_P >= 8
+  gsize last_access;            /* ATOMIC */
+#else
   GMutex last_access_lock;
-  gint64 last_access_monotonic_time;
-  gint64 last_access_real_time;
+  gint64 last_access;           /* protected by last_access_lock */
+#endif
   gint expire_count;
 
   GList *medias;
@@ -133,10 +140,14 @@ gst_rtsp_session_init (GstRTSPSession * session)
   GST_INFO ("init session %p", session);
 
   g_mutex_init (&priv->lock);
-  g_mutex_init (&priv->last_access_lock);
   priv->timeout = DEFAULT_TIMEOUT;
 
-  gst_rtsp_session_touch (session);
+  priv->create_monotonic_time = g_get_monotonic_time ();
+  priv->create_real_time = g_get_real_time ();
+#if GLIB_SIZEOF_VOID_P < 8
+  g_mutex_init (&priv->last_access_lock);
+#endif
+  priv->last_access = priv->create_monotonic_time;
 }
 
 static void
@@ -155,7 +166,9 @@ gst_rtsp_session_finalize (GObject * obj)
 
   /* free session id */
   g_free (priv->sessionid);
+#if GLIB_SIZEOF_VOID_P < 8
   g_mutex_clear (&priv->last_access_lock);
+#endif
   g_mutex_clear (&priv->lock);
 
   G_OBJECT_CLASS (gst_rtsp_session_parent_class)->finalize (obj);
@@ -531,14 +544,20 @@ void
 gst_rtsp_session_set_timeout (GstRTSPSession * session, guint timeout)
 {
   GstRTSPSessionPrivate *priv;
+  gboolean changed;
 
   g_return_if_fail (GST_IS_RTSP_SESSION (session));
 
   priv = session->priv;
 
   g_mutex_lock (&priv->lock);
-  priv->timeout = timeout;
+  changed = priv->timeout != timeout;
+  g_atomic_int_set (&priv->timeout, timeout);
   g_mutex_unlock (&priv->lock);
+
+  /* the session pool reschedules the expiry of the session */
+  if (changed)
+    g_object_notify (G_OBJECT (session), "timeout");
 }
 
 /**
@@ -566,6 +585,52 @@ gst_rtsp_session_get_timeout (GstRTSPSession * session)
   return res;
 }
 
+static inline void
+store_last_access (GstRTSPSessionPrivate * priv, gint64 now)
+{
+#if GLIB_SIZEOF_VOID_P >= 8
+  g_atomic_pointer_set (&priv->last_access, (gsize) now);
+#else
+  g_mutex_lock (&priv->last_access_lock);
+  priv->last_access = now;
+  g_mutex_unlock (&priv->last_access_lock);
+#endif
+}
+
+static inline gint64
+get_last_access (GstRTSPSessionPrivate * priv)
+{
+  gint64 result;
+
+#if GLIB_SIZEOF_VOID_P >= 8
+  result = (gint64) (gsize) g_atomic_pointer_get (&priv->last_access);
+#else
+  g_mutex_lock (&priv->last_access_lock);
+  result = priv->last_access;
+  g_mutex_unlock (&priv->last_access_lock);
+#endif
+
+  return result;
+}
+
+/* get the monotonic time in microseconds at which @session expires */
+static gint64
+get_expire_time (GstRTSPSessionPrivate * priv)
+{
+  gint64 last_access;
+
+  if (g_atomic_int_get (&priv->expire_count) != 0) {
+    /* touch session when the expire count is not 0 */
+    store_last_access (priv, g_get_monotonic_time ());
+  }
+
+  last_access = get_last_access (priv);
+
+  /* add timeout allow for 5 seconds of extra time */
+  return last_access + ((gint64) g_atomic_int_get (&priv->timeout) + 5) *
+      G_USEC_PER_SEC;
+}
+
 /**
  * gst_rtsp_session_touch:
  * @session: a #GstRTSPSession
@@ -581,10 +646,7 @@ gst_rtsp_session_touch (GstRTSPSession * session)
 
   priv = session->priv;
 
-  g_mutex_lock (&priv->last_access_lock);
-  priv->last_access_monotonic_time = g_get_monotonic_time ();
-  priv->last_access_real_time = g_get_real_time ();
-  g_mutex_unlock (&priv->last_access_lock);
+  store_last_access (priv, g_get_monotonic_time ());
 }
 
 /**
@@ -626,31 +688,15 @@ gst_rtsp_session_allow_expire (GstRTSPSession * session)
 gint
 gst_rtsp_session_next_timeout_usec (GstRTSPSession * session, gint64 now)
 {
-  GstRTSPSessionPrivate *priv;
+  gint64 expire_time;
   gint res;
-  GstClockTime last_access, now_ns;
 
   g_return_val_if_fail (GST_IS_RTSP_SESSION (session), -1);
 
-  priv = session->priv;
-
-  g_mutex_lock (&priv->last_access_lock);
-  if (g_atomic_int_get (&priv->expire_count) != 0) {
-    /* touch session when the expire count is not 0 */
-    priv->last_access_monotonic_time = g_get_monotonic_time ();
-    priv->last_access_real_time = g_get_real_time ();
-  }
-
-  last_access = GST_USECOND * (priv->last_access_monotonic_time);
+  expire_time = get_expire_time (session->priv);
 
-  /* add timeout allow for 5 seconds of extra time */
-  last_access += priv->timeout * GST_SECOND + (5 * GST_SECOND);
-  g_mutex_unlock (&priv->last_access_lock);
-
-  now_ns = GST_USECOND * now;
-
-  if (last_access > now_ns) {
-    res = GST_TIME_AS_MSECONDS (last_access - now_ns);
+  if (expire_time > now) {
+    res = MIN ((expire_time - now) / 1000, G_MAXINT);
   } else {
     res = 0;
   }
@@ -688,18 +734,10 @@ gst_rtsp_session_next_timeout (GstRTSPSession * session, GTimeVal * now)
 
   priv = session->priv;
 
-  g_mutex_lock (&priv->last_access_lock);
-  if (g_atomic_int_get (&priv->expire_count) != 0) {
-    /* touch session when the expire count is not 0 */
-    priv->last_access_monotonic_time = g_get_monotonic_time ();
-    priv->last_access_real_time = g_get_real_time ();
-  }
-
-  last_access = GST_USECOND * (priv->last_access_real_time);
-
-  /* add timeout allow for 5 seconds of extra time */
-  last_access += priv->timeout * GST_SECOND + (5 * GST_SECOND);
-  g_mutex_unlock (&priv->last_access_lock);
+  /* the real time at which the session expires, assuming the clock was not
+   * changed since the session was created */
+  last_access = GST_USECOND * (get_expire_time (priv) -
+      priv->create_monotonic_time + priv->create_real_time);
 
   now_ns = GST_TIMEVAL_TO_TIME (*now);
 
@@ -26,7 +26,8 @@
  *
  * With gst_rtsp_stream_transport_set_callbacks(), callbacks can be configured
  * to handle the RTP and RTCP packets from the stream, for example when they
- * need to be sent over TCP.
+ * need to be sent over TCP. gst_rtsp_stream_transport_set_list_callbacks()
+ * installs callbacks that handle a whole #GstBufferList at once.
  *
  * With  gst_rtsp_stream_transport_set_active() the transports are added and
  * removed from the stream.
@@ -35,13 +36,25 @@
  * is received from the client. It will also call
  * gst_rtsp_stream_transport_set_timed_out() when a receiver has timed out.
  *
+ * With gst_rtsp_stream_transport_set_send_queue() a bounded send queue can be
+ * configured. Packets that could not be handed to the send callbacks are then
+ * kept in the queue until gst_rtsp_stream_transport_flush_send_queue() is
+ * called, instead of blocking the caller. The #GstRTSPSendQueuePolicy decides
+ * what happens when the queue is full. With
+ * #GST_RTSP_SEND_QUEUE_POLICY_DROP_FRAMES whole frames are dropped, using the
+ * RTP marker bit to find the end of a frame, so that a receiver that can't
+ * keep up gets fewer frames instead of corrupted ones.
+ *
  * Last reviewed on 2013-07-16 (1.0.0)
  */
 
 #include <string.h>
 #include <stdlib.h>
 
+#include <gst/rtp/gstrtpbuffer.h>
+
 #include "rtsp-stream-transport.h"
+#include "rtsp-server-internal.h"
 
 #define GST_RTSP_STREAM_TRANSPORT_GET_PRIVATE(obj)  \
        (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTSP_STREAM_TRANSPORT, GstRTSPStreamTransportPrivate))
@@ -55,18 +68,78 @@ struct _GstRTSPStreamTransportPrivate
   gpointer user_data;
   GDestroyNotify notify;
 
+  GstRTSPSendListFunc send_rtp_list;
+  GstRTSPSendListFunc send_rtcp_list;
+  gpointer list_user_data;
+  GDestroyNotify list_notify;
+
   GstRTSPKeepAliveFunc keep_alive;
   gpointer ka_user_data;
   GDestroyNotify ka_notify;
   gboolean active;
   gboolean timed_out;
+  gint removed;                 /* atomic, set when removed from the stream */
 
   GstRTSPTransport *transport;
   GstRTSPUrl *url;
 
   GObject *rtpsource;
+
+  /* bounded send queue, protected by send_queue_lock */
+  GMutex send_queue_lock;
+  GQueue send_queue;
+  guint send_queue_max;
+  GstRTSPSendQueuePolicy send_queue_policy;
+  gboolean waiting_keyframe;
+  gboolean overflowed;
+
+  /* frame tracking for GST_RTSP_SEND_QUEUE_POLICY_DROP_FRAMES, the frame
+   * number increments after each RTP packet with the marker bit */
+  guint next_frame;
+  guint sent_frame;
+  gboolean sent_frame_done;
+
+  GstRTSPOverflowFunc overflow;
+  gpointer ov_user_data;
+  GDestroyNotify ov_notify;
+
+  /* statistics, protected by send_queue_lock */
+  guint64 dropped_oldest;
+  guint64 dropped_until_keyframe;
+  guint64 keyframe_resyncs;
+  guint64 disconnects;
+  guint64 dropped_frames;
+  guint64 dropped_bytes;
+
+  /* RTP packets up to this seqnum were already queued, -1 when unset. Only
+   * used from the streaming thread after it is set. */
+  gint skip_rtp_seqnum;
+
+  /* number of packets queued for the burst of cached packets, the send queue
+   * is used until they are sent even when it is not configured. Protected by
+   * send_queue_lock, bursting is also read without it. */
+  guint burst_size;
+  gint bursting;
+
+  /* RTP-Info of the first packet of the burst, protected by send_queue_lock */
+  gboolean have_burst_rtpinfo;
+  guint burst_seq;
+  guint burst_rtptime;
+  GstClockTime burst_running_time;
+
+  /* cached packets that the burst starts with, reserved when the RTP-Info was
+   * made before the transport was added. Protected by send_queue_lock */
+  GList *reserved_burst;
 };
 
+typedef struct
+{
+  GstBuffer *buffer;
+  gboolean is_rtp;
+  guint frame;
+  gboolean marker;
+} QueuedPacket;
+
 enum
 {
   PROP_0,
@@ -76,6 +149,32 @@ enum
 GST_DEBUG_CATEGORY_STATIC (rtsp_stream_transport_debug);
 #define GST_CAT_DEFAULT rtsp_stream_transport_debug
 
+#define C_ENUM(v) ((gint) v)
+
+GType
+gst_rtsp_send_queue_policy_get_type (void)
+{
+  static gsize id = 0;
+  static const GEnumValue values[] = {
+    {C_ENUM (GST_RTSP_SEND_QUEUE_POLICY_DROP_OLDEST),
+        "GST_RTSP_SEND_QUEUE_POLICY_DROP_OLDEST", "drop-oldest"},
+    {C_ENUM (GST_RTSP_SEND_QUEUE_POLICY_DROP_UNTIL_KEYFRAME),
+        "GST_RTSP_SEND_QUEUE_POLICY_DROP_UNTIL_KEYFRAME",
+        "drop-until-keyframe"},
+    {C_ENUM (GST_RTSP_SEND_QUEUE_POLICY_DISCONNECT),
+        "GST_RTSP_SEND_QUEUE_POLICY_DISCONNECT", "disconnect"},
+    {C_ENUM (GST_RTSP_SEND_QUEUE_POLICY_DROP_FRAMES),
+        "GST_RTSP_SEND_QUEUE_POLICY_DROP_FRAMES", "drop-frames"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&id)) {
+    GType tmp = g_enum_register_static ("GstRTSPSendQueuePolicy", values);
+    g_once_init_leave (&id, tmp);
+  }
+  return (GType) id;
+}
+
 static void gst_rtsp_stream_transport_finalize (GObject * obj);
 
 G_DEFINE_TYPE (GstRTSPStreamTransport, gst_rtsp_stream_transport,
@@ -103,6 +202,28 @@ gst_rtsp_stream_transport_init (GstRTSPStreamTransport * trans)
       GST_RTSP_STREAM_TRANSPORT_GET_PRIVATE (trans);
 
   trans->priv = priv;
+
+  g_mutex_init (&priv->send_queue_lock);
+  g_queue_init (&priv->send_queue);
+  priv->skip_rtp_seqnum = -1;
+  priv->sent_frame_done = TRUE;
+}
+
+static void
+queued_packet_free (QueuedPacket * pkt)
+{
+  gst_buffer_unref (pkt->buffer);
+  g_slice_free (QueuedPacket, pkt);
+}
+
+/* must be called with send_queue_lock */
+static void
+clear_send_queue (GstRTSPStreamTransportPrivate * priv)
+{
+  QueuedPacket *pkt;
+
+  while ((pkt = g_queue_pop_head (&priv->send_queue)))
+    queued_packet_free (pkt);
 }
 
 static void
@@ -116,7 +237,13 @@ gst_rtsp_stream_transport_finalize (GObject * obj)
 
   /* remove callbacks now */
   gst_rtsp_stream_transport_set_callbacks (trans, NULL, NULL, NULL, NULL);
+  gst_rtsp_stream_transport_set_list_callbacks (trans, NULL, NULL, NULL, NULL);
   gst_rtsp_stream_transport_set_keepalive (trans, NULL, NULL, NULL);
+  gst_rtsp_stream_transport_set_overflow_callback (trans, NULL, NULL, NULL);
+
+  clear_send_queue (priv);
+  g_list_free_full (priv->reserved_burst, (GDestroyNotify) gst_buffer_unref);
+  g_mutex_clear (&priv->send_queue_lock);
 
   if (priv->stream)
     g_object_unref (priv->stream);
@@ -204,6 +331,40 @@ gst_rtsp_stream_transport_set_callbacks (GstRTSPStreamTransport * trans,
   priv->notify = notify;
 }
 
+/**
+ * gst_rtsp_stream_transport_set_list_callbacks:
+ * @trans: a #GstRTSPStreamTransport
+ * @send_rtp_list: (scope notified): a callback called when RTP should be sent
+ * @send_rtcp_list: (scope notified): a callback called when RTCP should be sent
+ * @user_data: (closure): user data passed to callbacks
+ * @notify: (allow-none): called with the user_data when no longer needed.
+ *
+ * Install callbacks that will be called when a list of data buffers for a
+ * stream should be sent to a client. When no list callbacks are installed, the
+ * callbacks from gst_rtsp_stream_transport_set_callbacks() are called for
+ * each buffer in the list.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_stream_transport_set_list_callbacks (GstRTSPStreamTransport * trans,
+    GstRTSPSendListFunc send_rtp_list, GstRTSPSendListFunc send_rtcp_list,
+    gpointer user_data, GDestroyNotify notify)
+{
+  GstRTSPStreamTransportPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans));
+
+  priv = trans->priv;
+
+  priv->send_rtp_list = send_rtp_list;
+  priv->send_rtcp_list = send_rtcp_list;
+  if (priv->list_notify)
+    priv->list_notify (priv->list_user_data);
+  priv->list_user_data = user_data;
+  priv->list_notify = notify;
+}
+
 /**
  * gst_rtsp_stream_transport_set_keepalive:
  * @trans: a #GstRTSPStreamTransport
@@ -343,6 +504,15 @@ gst_rtsp_stream_transport_get_rtpinfo (GstRTSPStreamTransport * trans,
           &running_time))
     return NULL;
 
+  /* the receiver starts with the cached packets it was sent first */
+  g_mutex_lock (&priv->send_queue_lock);
+  if (priv->have_burst_rtpinfo) {
+    seq = priv->burst_seq;
+    rtptime = priv->burst_rtptime;
+    running_time = clock_rate ? priv->burst_running_time : GST_CLOCK_TIME_NONE;
+  }
+  g_mutex_unlock (&priv->send_queue_lock);
+
   GST_DEBUG ("RTP time %u, seq %u, rate %u, running-time %" GST_TIME_FORMAT,
       rtptime, seq, clock_rate, GST_TIME_ARGS (running_time));
 
@@ -437,6 +607,303 @@ gst_rtsp_stream_transport_is_timed_out (GstRTSPStreamTransport * trans)
   return trans->priv->timed_out;
 }
 
+static gboolean
+do_send (GstRTSPStreamTransport * trans, GstBuffer * buffer, gboolean is_rtp)
+{
+  GstRTSPStreamTransportPrivate *priv = trans->priv;
+  gboolean res = FALSE;
+
+  if (is_rtp) {
+    if (priv->send_rtp)
+      res =
+          priv->send_rtp (buffer, priv->transport->interleaved.min,
+          priv->user_data);
+  } else {
+    if (priv->send_rtcp)
+      res =
+          priv->send_rtcp (buffer, priv->transport->interleaved.max,
+          priv->user_data);
+  }
+
+  if (res)
+    gst_rtsp_stream_transport_keep_alive (trans);
+
+  return res;
+}
+
+static gboolean
+has_rtp_marker (GstBuffer * buffer)
+{
+  guint8 b;
+
+  /* the marker is the highest bit of the second byte of the RTP header */
+  return gst_buffer_extract (buffer, 1, &b, 1) == 1 && (b & 0x80) != 0;
+}
+
+/* must be called with send_queue_lock. Drop all queued RTP packets of the
+ * frames that have @flag set, or only the oldest such frame when @all is
+ * %FALSE. The frame that is partially sent is kept. Returns %TRUE when
+ * something was dropped and sets @need_keyframe when delta packets were
+ * dropped after the last queued keyframe. */
+static gboolean
+drop_queued_frames (GstRTSPStreamTransportPrivate * priv,
+    GstBufferFlags flag, gboolean all, gboolean * need_keyframe)
+{
+  GList *walk, *next;
+  gboolean dropped = FALSE, have_frame = FALSE;
+  guint frame = 0;
+
+  *need_keyframe = FALSE;
+
+  for (walk = priv->send_queue.head; walk; walk = next) {
+    QueuedPacket *pkt = walk->data;
+
+    next = walk->next;
+
+    if (!pkt->is_rtp)
+      continue;
+
+    if (!priv->sent_frame_done && pkt->frame == priv->sent_frame)
+      continue;
+
+    if (!GST_BUFFER_FLAG_IS_SET (pkt->buffer, flag)) {
+      if (!GST_BUFFER_FLAG_IS_SET (pkt->buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+        *need_keyframe = FALSE;
+      continue;
+    }
+
+    if (!have_frame || pkt->frame != frame) {
+      if (have_frame && !all)
+        break;
+      frame = pkt->frame;
+      have_frame = TRUE;
+      priv->dropped_frames++;
+    }
+
+    priv->dropped_bytes += gst_buffer_get_size (pkt->buffer);
+    if (GST_BUFFER_FLAG_IS_SET (pkt->buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+      *need_keyframe = TRUE;
+    g_queue_delete_link (&priv->send_queue, walk);
+    queued_packet_free (pkt);
+    dropped = TRUE;
+  }
+  return dropped;
+}
+
+/* must be called with send_queue_lock. Make room in the send queue by
+ * dropping whole frames. */
+static gboolean
+drop_frames (GstRTSPStreamTransport * trans)
+{
+  GstRTSPStreamTransportPrivate *priv = trans->priv;
+  gboolean need_keyframe;
+
+  /* first a frame that no other frame depends on */
+  if (drop_queued_frames (priv, GST_BUFFER_FLAG_DROPPABLE, FALSE,
+          &need_keyframe)) {
+    GST_LOG ("transport %p: send queue full, dropped a droppable frame",
+        trans);
+    return TRUE;
+  }
+
+  /* then all delta frames, the frames after them can't be decoded anymore
+   * until the next keyframe */
+  if (drop_queued_frames (priv, GST_BUFFER_FLAG_DELTA_UNIT, TRUE,
+          &need_keyframe)) {
+    GST_DEBUG ("transport %p: send queue full, dropped delta frames", trans);
+    if (need_keyframe) {
+      priv->waiting_keyframe = TRUE;
+      priv->keyframe_resyncs++;
+    }
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* must be called with send_queue_lock, after @frame was sent */
+static inline void
+update_sent_frame (GstRTSPStreamTransportPrivate * priv, guint frame,
+    gboolean marker)
+{
+  priv->sent_frame = frame;
+  priv->sent_frame_done = marker;
+}
+
+/* must be called with send_queue_lock. The burst is over when all packets
+ * that were queued after it were sent too. */
+static inline void
+check_burst_done (GstRTSPStreamTransportPrivate * priv)
+{
+  if (priv->burst_size > 0 && g_queue_is_empty (&priv->send_queue)
+      && !priv->waiting_keyframe) {
+    priv->burst_size = 0;
+    g_atomic_int_set (&priv->bursting, FALSE);
+  }
+}
+
+/* must be called with send_queue_lock. Sends @buffer directly when nothing
+ * is queued and otherwise appends it to the send queue, applying the
+ * overflow policy. Sets @overflow when the receiver should be disconnected. */
+static gboolean
+queue_or_send (GstRTSPStreamTransport * trans, GstBuffer * buffer,
+    gboolean is_rtp, gboolean * overflow)
+{
+  GstRTSPStreamTransportPrivate *priv = trans->priv;
+  GstRTSPSendQueuePolicy policy;
+  gboolean track_frames;
+  QueuedPacket *pkt;
+  guint frame = 0, max;
+  gboolean marker = FALSE;
+
+  if (priv->overflowed)
+    return FALSE;
+
+  /* a burst also needs room for the live packets that arrive while it is
+   * sent. Without a configured queue, a receiver that can't take all of that
+   * continues at the next keyframe. */
+  max = priv->send_queue_max + priv->burst_size;
+  if (priv->send_queue_max > 0)
+    policy = priv->send_queue_policy;
+  else
+    policy = GST_RTSP_SEND_QUEUE_POLICY_DROP_UNTIL_KEYFRAME;
+
+  track_frames = is_rtp && policy == GST_RTSP_SEND_QUEUE_POLICY_DROP_FRAMES;
+  if (track_frames) {
+    frame = priv->next_frame;
+    marker = has_rtp_marker (buffer);
+    if (marker)
+      priv->next_frame++;
+  }
+
+  if (priv->waiting_keyframe && is_rtp) {
+    if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+      priv->dropped_until_keyframe++;
+      if (track_frames) {
+        priv->dropped_bytes += gst_buffer_get_size (buffer);
+        if (marker)
+          priv->dropped_frames++;
+      }
+      return TRUE;
+    }
+    GST_DEBUG ("transport %p: resuming at keyframe", trans);
+    priv->waiting_keyframe = FALSE;
+  }
+
+  /* fast path, nothing queued, try to send right away */
+  if (g_queue_is_empty (&priv->send_queue) && do_send (trans, buffer, is_rtp)) {
+    if (track_frames)
+      update_sent_frame (priv, frame, marker);
+    check_burst_done (priv);
+    return TRUE;
+  }
+
+  /* the burst was sent in the meantime and there is no queue */
+  if (max == 0)
+    return FALSE;
+
+  if (priv->send_queue.length >= max) {
+    switch (policy) {
+      case GST_RTSP_SEND_QUEUE_POLICY_DROP_OLDEST:
+        GST_LOG ("transport %p: send queue full, dropping oldest", trans);
+        queued_packet_free (g_queue_pop_head (&priv->send_queue));
+        priv->dropped_oldest++;
+        break;
+      case GST_RTSP_SEND_QUEUE_POLICY_DROP_UNTIL_KEYFRAME:
+        GST_DEBUG ("transport %p: send queue full, waiting for keyframe",
+            trans);
+        priv->dropped_until_keyframe += priv->send_queue.length;
+        clear_send_queue (priv);
+        priv->keyframe_resyncs++;
+        if (is_rtp
+            && GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+          priv->waiting_keyframe = TRUE;
+          priv->dropped_until_keyframe++;
+          return TRUE;
+        }
+        break;
+      case GST_RTSP_SEND_QUEUE_POLICY_DROP_FRAMES:
+        if (!drop_frames (trans)) {
+          /* only keyframes and RTCP queued, nothing better to do */
+          GST_LOG ("transport %p: send queue full, dropping oldest", trans);
+          queued_packet_free (g_queue_pop_head (&priv->send_queue));
+          priv->dropped_oldest++;
+        }
+        if (priv->waiting_keyframe && is_rtp
+            && GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+          priv->dropped_until_keyframe++;
+          priv->dropped_bytes += gst_buffer_get_size (buffer);
+          if (marker)
+            priv->dropped_frames++;
+          return TRUE;
+        }
+        break;
+      case GST_RTSP_SEND_QUEUE_POLICY_DISCONNECT:
+      default:
+        GST_WARNING ("transport %p: send queue full, disconnecting", trans);
+        clear_send_queue (priv);
+        priv->overflowed = TRUE;
+        priv->disconnects++;
+        *overflow = TRUE;
+        return FALSE;
+    }
+  }
+
+  pkt = g_slice_new (QueuedPacket);
+  pkt->buffer = gst_buffer_ref (buffer);
+  pkt->is_rtp = is_rtp;
+  pkt->frame = frame;
+  pkt->marker = marker;
+  g_queue_push_tail (&priv->send_queue, pkt);
+
+  return TRUE;
+}
+
+/* check if @buffer was already sent before the transport received the live
+ * packets. The check stops at the first newer packet. */
+static gboolean
+skip_rtp_packet (GstRTSPStreamTransportPrivate * priv, GstBuffer * buffer)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint16 seqnum;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
+    priv->skip_rtp_seqnum = -1;
+    return FALSE;
+  }
+  seqnum = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  if ((gint16) (seqnum - (guint16) priv->skip_rtp_seqnum) <= 0)
+    return TRUE;
+
+  priv->skip_rtp_seqnum = -1;
+  return FALSE;
+}
+
+static gboolean
+send_packet (GstRTSPStreamTransport * trans, GstBuffer * buffer,
+    gboolean is_rtp)
+{
+  GstRTSPStreamTransportPrivate *priv = trans->priv;
+  gboolean res, overflow = FALSE;
+
+  if (G_UNLIKELY (is_rtp && priv->skip_rtp_seqnum != -1)
+      && skip_rtp_packet (priv, buffer))
+    return TRUE;
+
+  if (priv->send_queue_max == 0 && !g_atomic_int_get (&priv->bursting))
+    return do_send (trans, buffer, is_rtp);
+
+  g_mutex_lock (&priv->send_queue_lock);
+  res = queue_or_send (trans, buffer, is_rtp, &overflow);
+  g_mutex_unlock (&priv->send_queue_lock);
+
+  if (overflow && priv->overflow)
+    priv->overflow (trans, priv->ov_user_data);
+
+  return res;
+}
+
 /**
  * gst_rtsp_stream_transport_send_rtp:
  * @trans: a #GstRTSPStreamTransport
@@ -444,26 +911,16 @@ gst_rtsp_stream_transport_is_timed_out (GstRTSPStreamTransport * trans)
  *
  * Send @buffer to the installed RTP callback for @trans.
  *
+ * When a send queue is configured, @buffer is queued when it can't be sent
+ * right away.
+ *
  * Returns: %TRUE on success
  */
 gboolean
 gst_rtsp_stream_transport_send_rtp (GstRTSPStreamTransport * trans,
     GstBuffer * buffer)
 {
-  GstRTSPStreamTransportPrivate *priv;
-  gboolean res = FALSE;
-
-  priv = trans->priv;
-
-  if (priv->send_rtp)
-    res =
-        priv->send_rtp (buffer, priv->transport->interleaved.min,
-        priv->user_data);
-
-  if (res)
-    gst_rtsp_stream_transport_keep_alive (trans);
-
-  return res;
+  return send_packet (trans, buffer, TRUE);
 }
 
 /**
@@ -473,28 +930,254 @@ gst_rtsp_stream_transport_send_rtp (GstRTSPStreamTransport * trans,
  *
  * Send @buffer to the installed RTCP callback for @trans.
  *
+ * When a send queue is configured, @buffer is queued when it can't be sent
+ * right away.
+ *
  * Returns: %TRUE on success
  */
 gboolean
 gst_rtsp_stream_transport_send_rtcp (GstRTSPStreamTransport * trans,
     GstBuffer * buffer)
+{
+  return send_packet (trans, buffer, FALSE);
+}
+
+static gboolean
+send_packet_list (GstRTSPStreamTransport * trans, GstBufferList * buffer_list,
+    gboolean is_rtp)
+{
+  GstRTSPStreamTransportPrivate *priv = trans->priv;
+  GstRTSPSendListFunc send_list;
+  gboolean res = TRUE, overflow = FALSE;
+  guint i, len;
+
+  len = gst_buffer_list_length (buffer_list);
+
+  if (G_UNLIKELY (is_rtp && priv->skip_rtp_seqnum != -1)) {
+    for (i = 0; i < len; i++) {
+      if (!send_packet (trans, gst_buffer_list_get (buffer_list, i), TRUE))
+        res = FALSE;
+    }
+    return res;
+  }
+
+  if (priv->send_queue_max == 0 && !g_atomic_int_get (&priv->bursting)) {
+    send_list = is_rtp ? priv->send_rtp_list : priv->send_rtcp_list;
+
+    if (send_list) {
+      res = send_list (buffer_list, is_rtp ? priv->transport->interleaved.min :
+          priv->transport->interleaved.max, priv->list_user_data);
+      if (res)
+        gst_rtsp_stream_transport_keep_alive (trans);
+    } else {
+      for (i = 0; i < len; i++) {
+        if (!do_send (trans, gst_buffer_list_get (buffer_list, i), is_rtp))
+          res = FALSE;
+      }
+    }
+    return res;
+  }
+
+  /* with a send queue, packets must be handed over one by one so that we know
+   * which ones need to be queued. Still only take the lock once. */
+  g_mutex_lock (&priv->send_queue_lock);
+  for (i = 0; i < len && !overflow; i++) {
+    if (!queue_or_send (trans, gst_buffer_list_get (buffer_list, i), is_rtp,
+            &overflow))
+      res = FALSE;
+  }
+  g_mutex_unlock (&priv->send_queue_lock);
+
+  if (overflow && priv->overflow)
+    priv->overflow (trans, priv->ov_user_data);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_stream_transport_send_rtp_list:
+ * @trans: a #GstRTSPStreamTransport
+ * @buffer_list: (transfer none): a #GstBufferList
+ *
+ * Send all buffers in @buffer_list to the installed RTP callbacks for @trans.
+ *
+ * Returns: %TRUE when all buffers were sent or queued
+ *
+ * Since: 1.14
+ */
+gboolean
+gst_rtsp_stream_transport_send_rtp_list (GstRTSPStreamTransport * trans,
+    GstBufferList * buffer_list)
+{
+  return send_packet_list (trans, buffer_list, TRUE);
+}
+
+/**
+ * gst_rtsp_stream_transport_send_rtcp_list:
+ * @trans: a #GstRTSPStreamTransport
+ * @buffer_list: (transfer none): a #GstBufferList
+ *
+ * Send all buffers in @buffer_list to the installed RTCP callbacks for @trans.
+ *
+ * Returns: %TRUE when all buffers were sent or queued
+ *
+ * Since: 1.14
+ */
+gboolean
+gst_rtsp_stream_transport_send_rtcp_list (GstRTSPStreamTransport * trans,
+    GstBufferList * buffer_list)
+{
+  return send_packet_list (trans, buffer_list, FALSE);
+}
+
+/**
+ * gst_rtsp_stream_transport_set_send_queue:
+ * @trans: a #GstRTSPStreamTransport
+ * @max_size: the maximum number of packets in the send queue or 0 to
+ *    disable the queue
+ * @policy: what to do when the send queue is full
+ *
+ * Configure a bounded send queue for @trans. When a send callback fails,
+ * because the receiver can't keep up, the packet is kept in the queue and
+ * all following packets are queued after it until
+ * gst_rtsp_stream_transport_flush_send_queue() managed to send them. This
+ * makes sure a slow receiver never blocks the thread that sends data to
+ * all other receivers of the stream.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_stream_transport_set_send_queue (GstRTSPStreamTransport * trans,
+    guint max_size, GstRTSPSendQueuePolicy policy)
 {
   GstRTSPStreamTransportPrivate *priv;
-  gboolean res = FALSE;
+
+  g_return_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans));
 
   priv = trans->priv;
 
-  if (priv->send_rtcp)
-    res =
-        priv->send_rtcp (buffer, priv->transport->interleaved.max,
-        priv->user_data);
+  g_mutex_lock (&priv->send_queue_lock);
+  priv->send_queue_max = max_size;
+  priv->send_queue_policy = policy;
+  if (max_size == 0) {
+    clear_send_queue (priv);
+    priv->burst_size = 0;
+    g_atomic_int_set (&priv->bursting, FALSE);
+  }
+  g_mutex_unlock (&priv->send_queue_lock);
+}
 
-  if (res)
-    gst_rtsp_stream_transport_keep_alive (trans);
+/**
+ * gst_rtsp_stream_transport_set_overflow_callback:
+ * @trans: a #GstRTSPStreamTransport
+ * @overflow: (scope notified): a callback called when the send queue
+ *    overflowed with #GST_RTSP_SEND_QUEUE_POLICY_DISCONNECT
+ * @user_data: (closure): user data passed to callback
+ * @notify: (allow-none): called with the user_data when no longer needed.
+ *
+ * Install a callback that will be called when the receiver of @trans should
+ * be disconnected because it could not keep up with the stream.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_stream_transport_set_overflow_callback (GstRTSPStreamTransport *
+    trans, GstRTSPOverflowFunc overflow, gpointer user_data,
+    GDestroyNotify notify)
+{
+  GstRTSPStreamTransportPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans));
+
+  priv = trans->priv;
+
+  priv->overflow = overflow;
+  if (priv->ov_notify)
+    priv->ov_notify (priv->ov_user_data);
+  priv->ov_user_data = user_data;
+  priv->ov_notify = notify;
+}
+
+/**
+ * gst_rtsp_stream_transport_flush_send_queue:
+ * @trans: a #GstRTSPStreamTransport
+ *
+ * Try to send the packets in the send queue of @trans. This is usually called
+ * when the connection to the receiver can accept more data again.
+ *
+ * Returns: %FALSE when the receiver of @trans was disconnected because
+ * its send queue overflowed.
+ *
+ * Since: 1.14
+ */
+gboolean
+gst_rtsp_stream_transport_flush_send_queue (GstRTSPStreamTransport * trans)
+{
+  GstRTSPStreamTransportPrivate *priv;
+  QueuedPacket *pkt;
+  gboolean res;
+
+  g_return_val_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans), FALSE);
+
+  priv = trans->priv;
+
+  g_mutex_lock (&priv->send_queue_lock);
+  while ((pkt = g_queue_peek_head (&priv->send_queue))) {
+    if (!do_send (trans, pkt->buffer, pkt->is_rtp))
+      break;
+    if (pkt->is_rtp)
+      update_sent_frame (priv, pkt->frame, pkt->marker);
+    queued_packet_free (g_queue_pop_head (&priv->send_queue));
+  }
+  check_burst_done (priv);
+  res = !priv->overflowed;
+  g_mutex_unlock (&priv->send_queue_lock);
 
   return res;
 }
 
+/**
+ * gst_rtsp_stream_transport_get_stats:
+ * @trans: a #GstRTSPStreamTransport
+ *
+ * Get the send statistics of @trans. The structure contains the current
+ * length of the send queue in "send-queue-length" and how often each
+ * #GstRTSPSendQueuePolicy fired in "dropped-oldest", "keyframe-resyncs" and
+ * "disconnects". "dropped-until-keyframe" contains the number of packets that
+ * were dropped while waiting for a keyframe. With
+ * #GST_RTSP_SEND_QUEUE_POLICY_DROP_FRAMES, "dropped-frames" and
+ * "dropped-bytes" contain the number of whole frames and the number of bytes
+ * that were dropped.
+ *
+ * Returns: (transfer full): a #GstStructure with the statistics of @trans.
+ * gst_structure_free() after usage.
+ *
+ * Since: 1.14
+ */
+GstStructure *
+gst_rtsp_stream_transport_get_stats (GstRTSPStreamTransport * trans)
+{
+  GstRTSPStreamTransportPrivate *priv;
+  GstStructure *stats;
+
+  g_return_val_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans), NULL);
+
+  priv = trans->priv;
+
+  g_mutex_lock (&priv->send_queue_lock);
+  stats = gst_structure_new ("application/x-rtsp-stream-transport-stats",
+      "send-queue-length", G_TYPE_UINT, priv->send_queue.length,
+      "dropped-oldest", G_TYPE_UINT64, priv->dropped_oldest,
+      "dropped-until-keyframe", G_TYPE_UINT64, priv->dropped_until_keyframe,
+      "keyframe-resyncs", G_TYPE_UINT64, priv->keyframe_resyncs,
+      "disconnects", G_TYPE_UINT64, priv->disconnects,
+      "dropped-frames", G_TYPE_UINT64, priv->dropped_frames,
+      "dropped-bytes", G_TYPE_UINT64, priv->dropped_bytes, NULL);
+  g_mutex_unlock (&priv->send_queue_lock);
+
+  return stats;
+}
+
 /**
  * gst_rtsp_stream_transport_keep_alive:
  * @trans: a #GstRTSPStreamTransport
@@ -543,3 +1226,194 @@ gst_rtsp_stream_transport_recv_data (GstRTSPStreamTransport * trans,
   }
   return res;
 }
+
+/**
+ * gst_rtsp_stream_transport_recv_data_list:
+ * @trans: a #GstRTSPStreamTransport
+ * @channel: a channel
+ * @buffer_list: (transfer full): a #GstBufferList
+ *
+ * Receive all buffers in @buffer_list on @channel @trans.
+ *
+ * Returns: a #GstFlowReturn. Returns GST_FLOW_NOT_LINKED when @channel is not
+ *    configured in the transport of @trans.
+ *
+ * Since: 1.14
+ */
+GstFlowReturn
+gst_rtsp_stream_transport_recv_data_list (GstRTSPStreamTransport * trans,
+    guint channel, GstBufferList * buffer_list)
+{
+  GstRTSPStreamTransportPrivate *priv;
+  const GstRTSPTransport *tr;
+  GstFlowReturn res;
+
+  priv = trans->priv;
+  tr = priv->transport;
+
+  if (tr->interleaved.min == channel) {
+    res = gst_rtsp_stream_recv_rtp_list (priv->stream, buffer_list);
+  } else if (tr->interleaved.max == channel) {
+    guint i, len = gst_buffer_list_length (buffer_list);
+
+    /* RTCP is rare, there is no need to push it in one go */
+    res = GST_FLOW_OK;
+    for (i = 0; i < len && res == GST_FLOW_OK; i++)
+      res = gst_rtsp_stream_recv_rtcp (priv->stream,
+          gst_buffer_ref (gst_buffer_list_get (buffer_list, i)));
+    gst_buffer_list_unref (buffer_list);
+  } else {
+    gst_buffer_list_unref (buffer_list);
+    res = GST_FLOW_NOT_LINKED;
+  }
+  return res;
+}
+
+/* called before @trans is added to the stream. Queues the RTP packets in
+ * @packets, that end with @last_seqnum, so that they are sent before the live
+ * packets by gst_rtsp_stream_transport_flush_send_queue(). Packets up to
+ * @last_seqnum that still arrive through the live flow are not sent again. */
+void
+gst_rtsp_stream_transport_queue_burst (GstRTSPStreamTransport * trans,
+    GList * packets, guint16 last_seqnum)
+{
+  GstRTSPStreamTransportPrivate *priv;
+  GList *walk;
+
+  g_return_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans));
+
+  priv = trans->priv;
+
+  g_mutex_lock (&priv->send_queue_lock);
+  for (walk = packets; walk; walk = walk->next) {
+    QueuedPacket *pkt;
+
+    pkt = g_slice_new (QueuedPacket);
+    pkt->buffer = gst_buffer_ref (walk->data);
+    pkt->is_rtp = TRUE;
+    pkt->frame = priv->next_frame;
+    pkt->marker = has_rtp_marker (pkt->buffer);
+    if (pkt->marker)
+      priv->next_frame++;
+    g_queue_push_tail (&priv->send_queue, pkt);
+    priv->burst_size++;
+  }
+  if (priv->burst_size > 0)
+    g_atomic_int_set (&priv->bursting, TRUE);
+  priv->skip_rtp_seqnum = last_seqnum;
+  g_mutex_unlock (&priv->send_queue_lock);
+}
+
+/* the receiver of @trans was sent cached packets, starting with @seq and
+ * @rtptime at @running_time. Reported in the RTP-Info instead of the current
+ * position of the stream. */
+void
+gst_rtsp_stream_transport_set_burst_rtpinfo (GstRTSPStreamTransport * trans,
+    guint seq, guint rtptime, GstClockTime running_time)
+{
+  GstRTSPStreamTransportPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans));
+
+  priv = trans->priv;
+
+  g_mutex_lock (&priv->send_queue_lock);
+  priv->have_burst_rtpinfo = TRUE;
+  priv->burst_seq = seq;
+  priv->burst_rtptime = rtptime;
+  priv->burst_running_time = running_time;
+  g_mutex_unlock (&priv->send_queue_lock);
+}
+
+/* called when @trans is removed from the stream, the next time it is added it
+ * doesn't start with the cached packets of before */
+void
+gst_rtsp_stream_transport_clear_burst_rtpinfo (GstRTSPStreamTransport * trans)
+{
+  GstRTSPStreamTransportPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans));
+
+  priv = trans->priv;
+
+  g_mutex_lock (&priv->send_queue_lock);
+  priv->have_burst_rtpinfo = FALSE;
+  g_list_free_full (priv->reserved_burst, (GDestroyNotify) gst_buffer_unref);
+  priv->reserved_burst = NULL;
+  g_mutex_unlock (&priv->send_queue_lock);
+}
+
+/* called before the RTP-Info of @trans is made. When @trans is not active
+ * yet, the cached packets of its stream are reserved for its burst, so that
+ * the RTP-Info reports the packet that the burst starts with when @trans is
+ * added. */
+void
+gst_rtsp_stream_transport_reserve_burst (GstRTSPStreamTransport * trans)
+{
+  GstRTSPStreamTransportPrivate *priv;
+  GList *packets;
+  guint seq, rtptime;
+  GstClockTime running_time;
+
+  g_return_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans));
+
+  priv = trans->priv;
+
+  if (priv->active)
+    return;
+
+  packets = gst_rtsp_stream_reserve_gop_burst (priv->stream, &seq, &rtptime,
+      &running_time);
+  if (packets == NULL)
+    return;
+
+  g_mutex_lock (&priv->send_queue_lock);
+  g_list_free_full (priv->reserved_burst, (GDestroyNotify) gst_buffer_unref);
+  priv->reserved_burst = packets;
+  priv->have_burst_rtpinfo = TRUE;
+  priv->burst_seq = seq;
+  priv->burst_rtptime = rtptime;
+  priv->burst_running_time = running_time;
+  g_mutex_unlock (&priv->send_queue_lock);
+}
+
+/* called when @trans is added to the stream, takes the packets that were
+ * reserved by gst_rtsp_stream_transport_reserve_burst() */
+GList *
+gst_rtsp_stream_transport_take_reserved_burst (GstRTSPStreamTransport * trans)
+{
+  GstRTSPStreamTransportPrivate *priv;
+  GList *res;
+
+  g_return_val_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans), NULL);
+
+  priv = trans->priv;
+
+  g_mutex_lock (&priv->send_queue_lock);
+  res = priv->reserved_burst;
+  priv->reserved_burst = NULL;
+  g_mutex_unlock (&priv->send_queue_lock);
+
+  return res;
+}
+
+/* called with the stream lock when @trans is added to or removed from its
+ * stream */
+void
+gst_rtsp_stream_transport_set_removed (GstRTSPStreamTransport * trans,
+    gboolean removed)
+{
+  g_return_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans));
+
+  g_atomic_int_set (&trans->priv->removed, removed);
+}
+
+/* called from the fan-out threads, which can still have packets queued for
+ * @trans after it was removed */
+gboolean
+gst_rtsp_stream_transport_is_removed (GstRTSPStreamTransport * trans)
+{
+  g_return_val_if_fail (GST_IS_RTSP_STREAM_TRANSPORT (trans), TRUE);
+
+  return g_atomic_int_get (&trans->priv->removed);
+}
@@ -54,6 +54,21 @@ typedef struct _GstRTSPStreamTransportPrivate GstRTSPStreamTransportPrivate;
  * Returns: %TRUE on success
  */
 typedef gboolean (*GstRTSPSendFunc)      (GstBuffer *buffer, guint8 channel, gpointer user_data);
+
+/**
+ * GstRTSPSendListFunc:
+ * @buffer_list: a #GstBufferList
+ * @channel: a channel
+ * @user_data: user data
+ *
+ * Function registered with gst_rtsp_stream_transport_set_list_callbacks() and
+ * called when all buffers in @buffer_list must be sent on @channel.
+ *
+ * Returns: %TRUE when all buffers were sent
+ *
+ * Since: 1.14
+ */
+typedef gboolean (*GstRTSPSendListFunc)  (GstBufferList *buffer_list, guint8 channel, gpointer user_data);
 /**
  * GstRTSPKeepAliveFunc:
  * @user_data: user data
@@ -63,6 +78,49 @@ typedef gboolean (*GstRTSPSendFunc)      (GstBuffer *buffer, guint8 channel, gpo
  */
 typedef void     (*GstRTSPKeepAliveFunc) (gpointer user_data);
 
+/**
+ * GstRTSPOverflowFunc:
+ * @trans: a #GstRTSPStreamTransport
+ * @user_data: user data
+ *
+ * Function registered with gst_rtsp_stream_transport_set_overflow_callback()
+ * and called when the send queue of @trans overflowed and the configured
+ * #GstRTSPSendQueuePolicy asks for the receiver to be disconnected.
+ *
+ * This function is called from the streaming thread.
+ *
+ * Since: 1.14
+ */
+typedef void     (*GstRTSPOverflowFunc)  (GstRTSPStreamTransport *trans, gpointer user_data);
+
+/**
+ * GstRTSPSendQueuePolicy:
+ * @GST_RTSP_SEND_QUEUE_POLICY_DROP_OLDEST: drop the oldest queued packet to
+ *     make room for the new one
+ * @GST_RTSP_SEND_QUEUE_POLICY_DROP_UNTIL_KEYFRAME: drop all queued packets and
+ *     all following RTP packets until the next keyframe
+ * @GST_RTSP_SEND_QUEUE_POLICY_DISCONNECT: drop all queued packets and
+ *     disconnect the receiver
+ * @GST_RTSP_SEND_QUEUE_POLICY_DROP_FRAMES: drop whole queued frames, first
+ *     the ones marked as #GST_BUFFER_FLAG_DROPPABLE, then the delta frames
+ *     after which all following RTP packets are dropped until the next
+ *     keyframe (Since: 1.14)
+ *
+ * What to do when the send queue of a #GstRTSPStreamTransport is full.
+ *
+ * Since: 1.14
+ */
+typedef enum {
+  GST_RTSP_SEND_QUEUE_POLICY_DROP_OLDEST,
+  GST_RTSP_SEND_QUEUE_POLICY_DROP_UNTIL_KEYFRAME,
+  GST_RTSP_SEND_QUEUE_POLICY_DISCONNECT,
+  GST_RTSP_SEND_QUEUE_POLICY_DROP_FRAMES
+} GstRTSPSendQueuePolicy;
+
+#define GST_TYPE_RTSP_SEND_QUEUE_POLICY (gst_rtsp_send_queue_policy_get_type())
+GST_EXPORT
+GType gst_rtsp_send_queue_policy_get_type (void);
+
 /**
  * GstRTSPStreamTransport:
  * @parent: parent instance
@@ -120,6 +178,13 @@ void                     gst_rtsp_stream_transport_set_callbacks (GstRTSPStreamT
                                                                   gpointer user_data,
                                                                   GDestroyNotify  notify);
 
+GST_EXPORT
+void                     gst_rtsp_stream_transport_set_list_callbacks (GstRTSPStreamTransport *trans,
+                                                                       GstRTSPSendListFunc send_rtp_list,
+                                                                       GstRTSPSendListFunc send_rtcp_list,
+                                                                       gpointer user_data,
+                                                                       GDestroyNotify  notify);
+
 GST_EXPORT
 void                     gst_rtsp_stream_transport_set_keepalive (GstRTSPStreamTransport *trans,
                                                                   GstRTSPKeepAliveFunc keep_alive,
@@ -150,10 +215,40 @@ GST_EXPORT
 gboolean                 gst_rtsp_stream_transport_send_rtcp     (GstRTSPStreamTransport *trans,
                                                                   GstBuffer *buffer);
 
+GST_EXPORT
+gboolean                 gst_rtsp_stream_transport_send_rtp_list (GstRTSPStreamTransport *trans,
+                                                                  GstBufferList *buffer_list);
+
+GST_EXPORT
+gboolean                 gst_rtsp_stream_transport_send_rtcp_list (GstRTSPStreamTransport *trans,
+                                                                   GstBufferList *buffer_list);
+
 GST_EXPORT
 GstFlowReturn            gst_rtsp_stream_transport_recv_data     (GstRTSPStreamTransport *trans,
                                                                   guint channel, GstBuffer *buffer);
 
+GST_EXPORT
+GstFlowReturn            gst_rtsp_stream_transport_recv_data_list (GstRTSPStreamTransport *trans,
+                                                                   guint channel,
+                                                                   GstBufferList *buffer_list);
+
+GST_EXPORT
+void                     gst_rtsp_stream_transport_set_send_queue (GstRTSPStreamTransport *trans,
+                                                                   guint max_size,
+                                                                   GstRTSPSendQueuePolicy policy);
+
+GST_EXPORT
+void                     gst_rtsp_stream_transport_set_overflow_callback (GstRTSPStreamTransport *trans,
+                                                                          GstRTSPOverflowFunc overflow,
+                                                                          gpointer user_data,
+                                                                          GDestroyNotify  notify);
+
+GST_EXPORT
+gboolean                 gst_rtsp_stream_transport_flush_send_queue (GstRTSPStreamTransport *trans);
+
+GST_EXPORT
+GstStructure *           gst_rtsp_stream_transport_get_stats     (GstRTSPStreamTransport *trans);
+
 #ifdef G_DEFINE_AUTOPTR_CLEANUP_FUNC
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GstRTSPStreamTransport, gst_object_unref)
 #endif
@@ -58,10 +58,127 @@
 #include <gst/rtp/gstrtpbuffer.h>
 
 #include "rtsp-stream.h"
+#include "rtsp-server-internal.h"
 
 #define GST_RTSP_STREAM_GET_PRIVATE(obj)  \
      (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTSP_STREAM, GstRTSPStreamPrivate))
 
+/* an immutable array of the transports of a stream. A new snapshot is
+ * published whenever the transports change so that the streaming threads can
+ * use them without taking the stream lock. */
+typedef struct
+{
+  gint refcount;
+  guint cookie;
+  guint n_transports;
+  GstRTSPStreamTransport **transports;
+} TransportSnapshot;
+
+static TransportSnapshot *
+transport_snapshot_new (GList * transports, guint cookie)
+{
+  TransportSnapshot *snap;
+  GList *walk;
+  guint n, i = 0;
+
+  n = g_list_length (transports);
+  snap = g_malloc (sizeof (TransportSnapshot) +
+      n * sizeof (GstRTSPStreamTransport *));
+  snap->refcount = 1;
+  snap->cookie = cookie;
+  snap->n_transports = n;
+  snap->transports = (GstRTSPStreamTransport **) (snap + 1);
+
+  for (walk = transports; walk; walk = g_list_next (walk))
+    snap->transports[i++] = g_object_ref (walk->data);
+
+  return snap;
+}
+
+static void
+transport_snapshot_unref (TransportSnapshot * snap)
+{
+  guint i;
+
+  if (!g_atomic_int_dec_and_test (&snap->refcount))
+    return;
+
+  for (i = 0; i < snap->n_transports; i++)
+    g_object_unref (snap->transports[i]);
+  g_free (snap);
+}
+
+/* key of the index of transports by the address and port of the receiver */
+typedef struct
+{
+  guint16 port;
+  guint8 len;
+  guint8 addr[16];
+} TransportKey;
+
+static void
+transport_key_init (TransportKey * key, GInetAddress * addr, guint port)
+{
+  gsize len = g_inet_address_get_native_size (addr);
+
+  memset (key, 0, sizeof (TransportKey));
+  key->port = port;
+  key->len = MIN (len, sizeof (key->addr));
+  memcpy (key->addr, g_inet_address_to_bytes (addr), key->len);
+}
+
+static guint
+transport_key_hash (gconstpointer data)
+{
+  const guint8 *p = data;
+  guint i, hash = 2166136261u;
+
+  for (i = 0; i < sizeof (TransportKey); i++)
+    hash = (hash ^ p[i]) * 16777619u;
+
+  return hash;
+}
+
+static gboolean
+transport_key_equal (gconstpointer a, gconstpointer b)
+{
+  return memcmp (a, b, sizeof (TransportKey)) == 0;
+}
+
+static void
+transport_key_free (gpointer key)
+{
+  g_slice_free (TransportKey, key);
+}
+
+/* the transports of a snapshot, partitioned over the fan-out workers. The
+ * transports of slice i are transports[start[i]] to transports[start[i+1]] */
+typedef struct
+{
+  gint refcount;
+  TransportSnapshot *snap;
+  guint n_slices;
+  guint *start;
+  GstRTSPStreamTransport **transports;
+} FanoutSlices;
+
+typedef struct
+{
+  GstRTSPStream *stream;
+  guint index;
+  GThread *thread;
+  GAsyncQueue *queue;
+} FanoutWorker;
+
+/* the cached packets for a new UDP transport, sent after the stream locks
+ * are released */
+typedef struct
+{
+  GSocket *socket;
+  GSocketAddress *address;
+  GList *packets;
+} GopBurst;
+
 struct _GstRTSPStreamPrivate
 {
   GMutex lock;
@@ -115,6 +232,13 @@ struct _GstRTSPStreamPrivate
   GstElement *tee[2];
   GstElement *funnel[2];
 
+  /* for batched sending to UDP unicast destinations */
+  gboolean udp_fanout;
+  gboolean pacing;
+  GstRTSPUdpSender *udp_sender[2];
+  GstElement *fanout_queue[2];
+  GstElement *fanout_sink[2];
+
   /* retransmission */
   GstElement *rtxsend;
   guint rtx_pt;
@@ -137,14 +261,53 @@ struct _GstRTSPStreamPrivate
   gulong caps_sig;
   GstCaps *caps;
 
+  /* probe for the tags that end up in the SDP */
+  gulong tag_probe;
+
   /* transports we stream to */
   guint n_active;
   GList *transports;
-  guint transports_cookie;
-  GList *tr_cache_rtp;
-  GList *tr_cache_rtcp;
-  guint tr_cache_cookie_rtp;
-  guint tr_cache_cookie_rtcp;
+  /* arrays of UDP transports by receiver address and port, and the
+   * transports that can't be indexed. Written with lock and tr_index_lock,
+   * read with only tr_index_lock so that RTCP doesn't wait for the stream */
+  GRWLock tr_index_lock;
+  GHashTable *tr_index;
+  GList *tr_unindexed;
+  guint transports_cookie;       /* atomic, written with lock */
+  /* the current TransportSnapshot, bit 0 is a lock for taking a ref */
+  gpointer tr_snapshot;
+  /* the snapshots used by the RTP and RTCP streaming threads */
+  TransportSnapshot *tr_cache_rtp;
+  TransportSnapshot *tr_cache_rtcp;
+
+  /* fan-out to the transports from multiple threads, the workers are started
+   * with the first TCP transport. n_workers, workers, fanout_queue_size and
+   * fanout_partition are written with lock and fanout_lock */
+  guint fanout_threads;
+  guint n_workers;
+  FanoutWorker *workers;
+  GMutex fanout_lock;
+  FanoutSlices *fanout_slices[2];
+  guint fanout_queue_size;
+  GstRTSPFanoutPartition fanout_partition;
+  guint64 fanout_dropped;       /* protected by fanout_lock */
+
+  /* the RTP packets since the last keyframe, for new clients */
+  guint gop_cache_size;
+  GMutex gop_lock;
+  GQueue gop_packets;           /* protected by gop_lock */
+  gsize gop_bytes;              /* protected by gop_lock */
+  gboolean gop_valid;           /* protected by gop_lock */
+  guint32 gop_rtptime;          /* protected by gop_lock */
+  GstClockTime gop_running_time;        /* protected by gop_lock */
+  gulong gop_probe_id;
+
+  /* receive UDP packets in batches instead of with udpsrc */
+  guint recv_batch_size;
+
+  /* generation counter of the SDP of the media, incremented whenever
+   * something that ends up in the SDP changes. Set with lock */
+  gint *sdp_generation;
 
   gint dscp_qos;
 
@@ -162,6 +325,8 @@ struct _GstRTSPStreamPrivate
 #define DEFAULT_PROFILES        GST_RTSP_PROFILE_AVP
 #define DEFAULT_PROTOCOLS       GST_RTSP_LOWER_TRANS_UDP | GST_RTSP_LOWER_TRANS_UDP_MCAST | \
                                         GST_RTSP_LOWER_TRANS_TCP
+#define DEFAULT_FANOUT_QUEUE_SIZE 256
+#define DEFAULT_FANOUT_PARTITION GST_RTSP_FANOUT_PARTITION_HASH
 
 enum
 {
@@ -195,6 +360,27 @@ static guint gst_rtsp_stream_signals[SIGNAL_LAST] = { 0 };
 
 G_DEFINE_TYPE (GstRTSPStream, gst_rtsp_stream, G_TYPE_OBJECT);
 
+#define C_ENUM(v) ((gint) v)
+
+GType
+gst_rtsp_fanout_partition_get_type (void)
+{
+  static gsize id = 0;
+  static const GEnumValue values[] = {
+    {C_ENUM (GST_RTSP_FANOUT_PARTITION_HASH), "GST_RTSP_FANOUT_PARTITION_HASH",
+        "hash"},
+    {C_ENUM (GST_RTSP_FANOUT_PARTITION_BALANCED),
+        "GST_RTSP_FANOUT_PARTITION_BALANCED", "balanced"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&id)) {
+    GType tmp = g_enum_register_static ("GstRTSPFanoutPartition", values);
+    g_once_init_leave (&id, tmp);
+  }
+  return (GType) id;
+}
+
 static void
 gst_rtsp_stream_class_init (GstRTSPStreamClass * klass)
 {
@@ -252,8 +438,19 @@ gst_rtsp_stream_init (GstRTSPStream * stream)
   priv->profiles = DEFAULT_PROFILES;
   priv->protocols = DEFAULT_PROTOCOLS;
   priv->publish_clock_mode = GST_RTSP_PUBLISH_CLOCK_MODE_CLOCK;
+  priv->fanout_queue_size = DEFAULT_FANOUT_QUEUE_SIZE;
+  priv->fanout_partition = DEFAULT_FANOUT_PARTITION;
 
   g_mutex_init (&priv->lock);
+  g_mutex_init (&priv->fanout_lock);
+  g_mutex_init (&priv->gop_lock);
+  g_queue_init (&priv->gop_packets);
+
+  priv->tr_snapshot = transport_snapshot_new (NULL, 0);
+  g_rw_lock_init (&priv->tr_index_lock);
+  priv->tr_index = g_hash_table_new_full (transport_key_hash,
+      transport_key_equal, transport_key_free,
+      (GDestroyNotify) g_ptr_array_unref);
 
   priv->keys = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, (GDestroyNotify) gst_caps_unref);
@@ -297,6 +494,13 @@ gst_rtsp_stream_finalize (GObject * obj)
     gst_object_unref (priv->sinkpad);
   g_free (priv->control);
   g_mutex_clear (&priv->lock);
+  g_mutex_clear (&priv->fanout_lock);
+  g_mutex_clear (&priv->gop_lock);
+
+  transport_snapshot_unref (priv->tr_snapshot);
+  g_hash_table_unref (priv->tr_index);
+  g_list_free (priv->tr_unindexed);
+  g_rw_lock_clear (&priv->tr_index_lock);
 
   g_hash_table_unref (priv->keys);
   g_hash_table_destroy (priv->ptmap);
@@ -346,6 +550,14 @@ gst_rtsp_stream_set_property (GObject * object, guint propid,
   }
 }
 
+/* something that ends up in the SDP of the stream changed, called with lock */
+static void
+invalidate_sdp (GstRTSPStreamPrivate * priv)
+{
+  if (priv->sdp_generation)
+    g_atomic_int_inc (priv->sdp_generation);
+}
+
 /**
  * gst_rtsp_stream_new:
  * @idx: an index
@@ -501,6 +713,7 @@ gst_rtsp_stream_set_control (GstRTSPStream * stream, const gchar * control)
   g_mutex_lock (&priv->lock);
   g_free (priv->control);
   priv->control = g_strdup (control);
+  invalidate_sdp (priv);
   g_mutex_unlock (&priv->lock);
 }
 
@@ -720,6 +933,7 @@ gst_rtsp_stream_set_profiles (GstRTSPStream * stream, GstRTSPProfile profiles)
 
   g_mutex_lock (&priv->lock);
   priv->profiles = profiles;
+  invalidate_sdp (priv);
   g_mutex_unlock (&priv->lock);
 }
 
@@ -767,6 +981,7 @@ gst_rtsp_stream_set_protocols (GstRTSPStream * stream,
 
   g_mutex_lock (&priv->lock);
   priv->protocols = protocols;
+  invalidate_sdp (priv);
   g_mutex_unlock (&priv->lock);
 }
 
@@ -821,6 +1036,7 @@ gst_rtsp_stream_set_address_pool (GstRTSPStream * stream,
     priv->pool = pool ? g_object_ref (pool) : NULL;
   else
     old = NULL;
+  invalidate_sdp (priv);
   g_mutex_unlock (&priv->lock);
 
   if (old)
@@ -880,6 +1096,7 @@ gst_rtsp_stream_set_multicast_iface (GstRTSPStream * stream,
     priv->multicast_iface = multicast_iface ? g_strdup (multicast_iface) : NULL;
   else
     old = NULL;
+  invalidate_sdp (priv);
   g_mutex_unlock (&priv->lock);
 
   if (old)
@@ -1155,10 +1372,17 @@ no_udp_protocol:
 /* must be called with lock */
 static gboolean
 create_and_configure_udpsources (GstElement * udpsrc_out[2],
-    GSocket * rtp_socket, GSocket * rtcp_socket)
+    GSocket * rtp_socket, GSocket * rtcp_socket, guint batch_size)
 {
   GstStateChangeReturn ret;
 
+  if (batch_size > 0) {
+    /* our own source, which needs none of the udpsrc configuration below */
+    udpsrc_out[0] = gst_rtsp_udp_src_new (rtp_socket, batch_size);
+    udpsrc_out[1] = gst_rtsp_udp_src_new (rtcp_socket, batch_size);
+    goto set_state;
+  }
+
   udpsrc_out[0] = gst_element_factory_make ("udpsrc", NULL);
   udpsrc_out[1] = gst_element_factory_make ("udpsrc", NULL);
 
@@ -1179,6 +1403,7 @@ create_and_configure_udpsources (GstElement * udpsrc_out[2],
   g_object_set (G_OBJECT (udpsrc_out[0]), "close-socket", FALSE, NULL);
   g_object_set (G_OBJECT (udpsrc_out[1]), "close-socket", FALSE, NULL);
 
+set_state:
   ret = gst_element_set_state (udpsrc_out[0], GST_STATE_READY);
   if (ret == GST_STATE_CHANGE_FAILURE)
     goto error;
@@ -1341,7 +1566,8 @@ again:
   addr_str = addr->address;
   g_clear_object (&inetaddr);
 
-  if (!create_and_configure_udpsources (udpsrc_out, rtp_socket, rtcp_socket)) {
+  if (!create_and_configure_udpsources (udpsrc_out, rtp_socket, rtcp_socket,
+          priv->recv_batch_size)) {
     goto no_udp_protocol;
   }
 
@@ -1638,6 +1864,7 @@ gst_rtsp_stream_set_retransmission_time (GstRTSPStream * stream,
 
   g_mutex_lock (&stream->priv->lock);
   stream->priv->rtx_time = time;
+  invalidate_sdp (stream->priv);
   if (stream->priv->rtxsend)
     g_object_set (stream->priv->rtxsend, "max-size-time",
         GST_TIME_AS_MSECONDS (time), NULL);
@@ -1682,6 +1909,7 @@ gst_rtsp_stream_set_retransmission_pt (GstRTSPStream * stream, guint rtx_pt)
 
   g_mutex_lock (&stream->priv->lock);
   stream->priv->rtx_pt = rtx_pt;
+  invalidate_sdp (stream->priv);
   if (stream->priv->rtxsend) {
     guint pt = gst_rtsp_stream_get_pt (stream);
     gchar *pt_s = g_strdup_printf ("%d", pt);
@@ -1756,150 +1984,760 @@ gst_rtsp_stream_get_buffer_size (GstRTSPStream * stream)
   return buffer_size;
 }
 
-/* executed from streaming thread */
-static void
-caps_notify (GstPad * pad, GParamSpec * unused, GstRTSPStream * stream)
+/**
+ * gst_rtsp_stream_set_udp_fanout:
+ * @stream: a #GstRTSPStream
+ * @fanout: whether to use batched sending
+ *
+ * Send the RTP and RTCP packets to UDP unicast destinations with a dedicated
+ * sender instead of the udpsink. The sender passes the packets for many
+ * destinations, and bursts of packets for one destination, to the kernel in
+ * one call where the platform allows it. This reduces the CPU usage with many
+ * unicast clients.
+ *
+ * This must be configured before @stream is joined to a bin.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_stream_set_udp_fanout (GstRTSPStream * stream, gboolean fanout)
 {
-  GstRTSPStreamPrivate *priv = stream->priv;
-  GstCaps *newcaps, *oldcaps;
+  g_return_if_fail (GST_IS_RTSP_STREAM (stream));
 
-  newcaps = gst_pad_get_current_caps (pad);
+  g_mutex_lock (&stream->priv->lock);
+  stream->priv->udp_fanout = fanout;
+  g_mutex_unlock (&stream->priv->lock);
+}
 
-  GST_INFO ("stream %p received caps %p, %" GST_PTR_FORMAT, stream, newcaps,
-      newcaps);
+/**
+ * gst_rtsp_stream_get_udp_fanout:
+ * @stream: a #GstRTSPStream
+ *
+ * Check if @stream uses a dedicated sender for UDP unicast destinations.
+ *
+ * Returns: %TRUE if batched sending is used
+ *
+ * Since: 1.14
+ */
+gboolean
+gst_rtsp_stream_get_udp_fanout (GstRTSPStream * stream)
+{
+  gboolean res;
 
-  g_mutex_lock (&priv->lock);
-  oldcaps = priv->caps;
-  priv->caps = newcaps;
-  g_mutex_unlock (&priv->lock);
+  g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), FALSE);
 
-  if (oldcaps)
-    gst_caps_unref (oldcaps);
+  g_mutex_lock (&stream->priv->lock);
+  res = stream->priv->udp_fanout;
+  g_mutex_unlock (&stream->priv->lock);
+
+  return res;
 }
 
-static void
-dump_structure (const GstStructure * s)
+/**
+ * gst_rtsp_stream_set_pacing:
+ * @stream: a #GstRTSPStream
+ * @pacing: whether to pace the RTP packets
+ *
+ * Spread the RTP packets of a frame over the frame interval instead of sending
+ * them back-to-back to each UDP unicast destination. The send rate follows the
+ * bitrate of @stream. This avoids bursts of packets that overflow the buffers
+ * of switches and wireless links, at the cost of up to one frame interval of
+ * extra latency.
+ *
+ * Pacing is done by the dedicated sender of gst_rtsp_stream_set_udp_fanout(),
+ * which sends to the unicast destinations whenever pacing is enabled. The
+ * paced packets are sent from a thread that is shared by all paced streams,
+ * so the TCP and multicast receivers of @stream are not delayed. Packets to destinations that the sender can't
+ * handle are sent by the udpsink and are not paced.
+ *
+ * This must be configured before @stream is joined to a bin.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_stream_set_pacing (GstRTSPStream * stream, gboolean pacing)
 {
-  gchar *sstr;
+  g_return_if_fail (GST_IS_RTSP_STREAM (stream));
 
-  sstr = gst_structure_to_string (s);
-  GST_INFO ("structure: %s", sstr);
-  g_free (sstr);
+  g_mutex_lock (&stream->priv->lock);
+  stream->priv->pacing = pacing;
+  g_mutex_unlock (&stream->priv->lock);
 }
 
-static GstRTSPStreamTransport *
-find_transport (GstRTSPStream * stream, const gchar * rtcp_from)
+/**
+ * gst_rtsp_stream_get_pacing:
+ * @stream: a #GstRTSPStream
+ *
+ * Check if the RTP packets of @stream are paced.
+ *
+ * Returns: %TRUE if the RTP packets are paced
+ *
+ * Since: 1.14
+ */
+gboolean
+gst_rtsp_stream_get_pacing (GstRTSPStream * stream)
 {
-  GstRTSPStreamPrivate *priv = stream->priv;
-  GList *walk;
-  GstRTSPStreamTransport *result = NULL;
-  const gchar *tmp;
-  gchar *dest;
-  guint port;
-
-  if (rtcp_from == NULL)
-    return NULL;
+  gboolean res;
 
-  tmp = g_strrstr (rtcp_from, ":");
-  if (tmp == NULL)
-    return NULL;
+  g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), FALSE);
 
-  port = atoi (tmp + 1);
-  dest = g_strndup (rtcp_from, tmp - rtcp_from);
+  g_mutex_lock (&stream->priv->lock);
+  res = stream->priv->pacing;
+  g_mutex_unlock (&stream->priv->lock);
 
-  g_mutex_lock (&priv->lock);
-  GST_INFO ("finding %s:%d in %d transports", dest, port,
-      g_list_length (priv->transports));
+  return res;
+}
 
-  for (walk = priv->transports; walk; walk = g_list_next (walk)) {
-    GstRTSPStreamTransport *trans = walk->data;
-    const GstRTSPTransport *tr;
-    gint min, max;
+/**
+ * gst_rtsp_stream_set_fanout_threads:
+ * @stream: a #GstRTSPStream
+ * @n_threads: the number of threads
+ *
+ * Send the packets of @stream to the transports from @n_threads threads
+ * instead of from the streaming thread. Each packet is handed to all threads
+ * and each thread sends it to its own part of the transports. This spreads
+ * the work over multiple cores when a shared media has many TCP clients. The
+ * threads are started when the first TCP transport is added.
+ *
+ * How the transports are spread over the threads is configured with
+ * gst_rtsp_stream_set_fanout_partition(). The number of packets queued for a
+ * thread is limited, see gst_rtsp_stream_set_fanout_queue_size(). When one of
+ * the transports of a thread blocks for too long, the transports of that
+ * thread miss packets, the other transports are not affected.
+ *
+ * A value of 0 sends from the streaming thread.
+ *
+ * This must be configured before @stream is joined to a bin.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_stream_set_fanout_threads (GstRTSPStream * stream, guint n_threads)
+{
+  g_return_if_fail (GST_IS_RTSP_STREAM (stream));
 
-    tr = gst_rtsp_stream_transport_get_transport (trans);
+  g_mutex_lock (&stream->priv->lock);
+  stream->priv->fanout_threads = n_threads;
+  g_mutex_unlock (&stream->priv->lock);
+}
 
-    if (priv->client_side) {
-      /* In client side mode the 'destination' is the RTSP server, so send
-       * to those ports */
-      min = tr->server_port.min;
-      max = tr->server_port.max;
-    } else {
-      min = tr->client_port.min;
-      max = tr->client_port.max;
-    }
+/**
+ * gst_rtsp_stream_get_fanout_threads:
+ * @stream: a #GstRTSPStream
+ *
+ * Get the number of threads used to send the packets of @stream to the
+ * transports.
+ *
+ * Returns: the number of fan-out threads, 0 when the streaming thread sends
+ * the packets.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_stream_get_fanout_threads (GstRTSPStream * stream)
+{
+  guint res;
 
-    if ((g_ascii_strcasecmp (tr->destination, dest) == 0) &&
-        (min == port || max == port)) {
-      result = trans;
-      break;
-    }
-  }
-  if (result)
-    g_object_ref (result);
-  g_mutex_unlock (&priv->lock);
+  g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), 0);
 
-  g_free (dest);
+  g_mutex_lock (&stream->priv->lock);
+  res = stream->priv->fanout_threads;
+  g_mutex_unlock (&stream->priv->lock);
 
-  return result;
+  return res;
 }
 
-static GstRTSPStreamTransport *
-check_transport (GObject * source, GstRTSPStream * stream)
+/**
+ * gst_rtsp_stream_set_fanout_queue_size:
+ * @stream: a #GstRTSPStream
+ * @size: the maximum number of packets
+ *
+ * Set the maximum number of packets queued for each fan-out thread, see
+ * gst_rtsp_stream_set_fanout_threads(). When the queue of a thread is full,
+ * new packets are dropped for all transports of that thread. A larger queue
+ * rides out longer stalls of a transport at the cost of more memory and
+ * latency. The dropped packets are counted in
+ * gst_rtsp_stream_get_fanout_stats().
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_stream_set_fanout_queue_size (GstRTSPStream * stream, guint size)
 {
-  GstStructure *stats;
-  GstRTSPStreamTransport *trans;
+  GstRTSPStreamPrivate *priv;
 
-  /* see if we have a stream to match with the origin of the RTCP packet */
-  trans = g_object_get_qdata (source, ssrc_stream_map_key);
-  if (trans == NULL) {
-    g_object_get (source, "stats", &stats, NULL);
-    if (stats) {
-      const gchar *rtcp_from;
+  g_return_if_fail (GST_IS_RTSP_STREAM (stream));
+  g_return_if_fail (size > 0);
 
-      dump_structure (stats);
+  priv = stream->priv;
 
-      rtcp_from = gst_structure_get_string (stats, "rtcp-from");
-      if ((trans = find_transport (stream, rtcp_from))) {
-        GST_INFO ("%p: found transport %p for source  %p", stream, trans,
-            source);
-        g_object_set_qdata_full (source, ssrc_stream_map_key, trans,
-            g_object_unref);
-      }
-      gst_structure_free (stats);
-    }
-  }
-  return trans;
+  g_mutex_lock (&priv->lock);
+  g_mutex_lock (&priv->fanout_lock);
+  priv->fanout_queue_size = size;
+  g_mutex_unlock (&priv->fanout_lock);
+  g_mutex_unlock (&priv->lock);
 }
 
-
-static void
-on_new_ssrc (GObject * session, GObject * source, GstRTSPStream * stream)
+/**
+ * gst_rtsp_stream_get_fanout_queue_size:
+ * @stream: a #GstRTSPStream
+ *
+ * Get the maximum number of packets queued for each fan-out thread.
+ *
+ * Returns: the maximum number of packets.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_stream_get_fanout_queue_size (GstRTSPStream * stream)
 {
-  GstRTSPStreamTransport *trans;
+  guint res;
 
-  GST_INFO ("%p: new source %p", stream, source);
+  g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), 0);
 
-  trans = check_transport (source, stream);
+  g_mutex_lock (&stream->priv->lock);
+  res = stream->priv->fanout_queue_size;
+  g_mutex_unlock (&stream->priv->lock);
 
-  if (trans)
-    GST_INFO ("%p: source %p for transport %p", stream, source, trans);
+  return res;
 }
 
-static void
-on_ssrc_sdes (GObject * session, GObject * source, GstRTSPStream * stream)
+/**
+ * gst_rtsp_stream_set_fanout_partition:
+ * @stream: a #GstRTSPStream
+ * @partition: a #GstRTSPFanoutPartition
+ *
+ * Configure how the transports of @stream are spread over the fan-out
+ * threads, see gst_rtsp_stream_set_fanout_threads(). A transport stays with
+ * the same thread for as long as it is part of @stream, so that its packets
+ * are sent in order.
+ *
+ * This must be configured before @stream is joined to a bin.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_stream_set_fanout_partition (GstRTSPStream * stream,
+    GstRTSPFanoutPartition partition)
 {
-  GST_INFO ("%p: new SDES %p", stream, source);
+  GstRTSPStreamPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_STREAM (stream));
+
+  priv = stream->priv;
+
+  g_mutex_lock (&priv->lock);
+  g_mutex_lock (&priv->fanout_lock);
+  priv->fanout_partition = partition;
+  g_mutex_unlock (&priv->fanout_lock);
+  g_mutex_unlock (&priv->lock);
 }
 
-static void
-on_ssrc_active (GObject * session, GObject * source, GstRTSPStream * stream)
+/**
+ * gst_rtsp_stream_get_fanout_partition:
+ * @stream: a #GstRTSPStream
+ *
+ * Get how the transports of @stream are spread over the fan-out threads.
+ *
+ * Returns: the #GstRTSPFanoutPartition of @stream.
+ *
+ * Since: 1.14
+ */
+GstRTSPFanoutPartition
+gst_rtsp_stream_get_fanout_partition (GstRTSPStream * stream)
 {
-  GstRTSPStreamTransport *trans;
+  GstRTSPFanoutPartition res;
 
-  trans = check_transport (source, stream);
+  g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), DEFAULT_FANOUT_PARTITION);
 
-  if (trans) {
-    GST_INFO ("%p: source %p in transport %p is active", stream, source, trans);
+  g_mutex_lock (&stream->priv->lock);
+  res = stream->priv->fanout_partition;
+  g_mutex_unlock (&stream->priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_stream_get_fanout_stats:
+ * @stream: a #GstRTSPStream
+ *
+ * Get the statistics of the fan-out threads of @stream, see
+ * gst_rtsp_stream_set_fanout_threads(). The structure contains the number
+ * of running threads in "threads", the maximum number of packets queued for
+ * each thread in "queue-size", the number of packets that are queued now in
+ * "queued" and the number of packets that were dropped for a thread because
+ * its queue was full in "dropped".
+ *
+ * Returns: (transfer full): a #GstStructure with the fan-out statistics of
+ * @stream. gst_structure_free() after usage.
+ *
+ * Since: 1.14
+ */
+GstStructure *
+gst_rtsp_stream_get_fanout_stats (GstRTSPStream * stream)
+{
+  GstRTSPStreamPrivate *priv;
+  guint i, n_workers, queue_size, queued = 0;
+  guint64 dropped;
+
+  g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), NULL);
+
+  priv = stream->priv;
+
+  g_mutex_lock (&priv->fanout_lock);
+  n_workers = priv->n_workers;
+  for (i = 0; i < n_workers; i++)
+    queued += MAX (g_async_queue_length (priv->workers[i].queue), 0);
+  queue_size = priv->fanout_queue_size;
+  dropped = priv->fanout_dropped;
+  g_mutex_unlock (&priv->fanout_lock);
+
+  return gst_structure_new ("application/x-rtsp-stream-fanout-stats",
+      "threads", G_TYPE_UINT, n_workers,
+      "queue-size", G_TYPE_UINT, queue_size,
+      "queued", G_TYPE_UINT, queued,
+      "dropped", G_TYPE_UINT64, dropped, NULL);
+}
+
+/**
+ * gst_rtsp_stream_set_gop_cache_size:
+ * @stream: a #GstRTSPStream
+ * @size: the maximum size of the cache in bytes
+ *
+ * Keep the RTP packets of @stream since the last keyframe, up to @size bytes.
+ * When a transport is added, the cached packets are sent to it first so that
+ * the client can start decoding right away instead of waiting for the next
+ * keyframe. This is useful for shared live media with a long keyframe
+ * interval. The packets are sent unmodified, so their sequence numbers and
+ * timestamps continue into the live packets.
+ *
+ * For TCP transports the cached packets are put in the send queue of the
+ * transport, also when no queue was configured with
+ * gst_rtsp_stream_transport_set_send_queue(), and sent whenever the
+ * connection has room. A receiver that can't take them together with the
+ * live packets continues at the next keyframe. Unicast UDP transports are
+ * sent the cached packets that went out before they were added, the others
+ * reach them with the live packets. Multicast transports don't receive the
+ * cached packets. The RTP-Info of a transport that receives the cached packets
+ * starts at the first of them.
+ *
+ * The start of a group of pictures is detected from the
+ * #GST_BUFFER_FLAG_DELTA_UNIT flag on the packets of the payloader. When a
+ * group of pictures does not fit in @size bytes, nothing is cached until the
+ * next keyframe. A value of 0 disables the cache.
+ *
+ * This must be configured before @stream is joined to a bin.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_stream_set_gop_cache_size (GstRTSPStream * stream, guint size)
+{
+  g_return_if_fail (GST_IS_RTSP_STREAM (stream));
+
+  g_mutex_lock (&stream->priv->lock);
+  stream->priv->gop_cache_size = size;
+  g_mutex_unlock (&stream->priv->lock);
+}
+
+/**
+ * gst_rtsp_stream_get_gop_cache_size:
+ * @stream: a #GstRTSPStream
+ *
+ * Get the maximum size of the cache of RTP packets since the last keyframe.
+ *
+ * Returns: the size of the cache in bytes, 0 when disabled.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_stream_get_gop_cache_size (GstRTSPStream * stream)
+{
+  guint res;
+
+  g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), 0);
+
+  g_mutex_lock (&stream->priv->lock);
+  res = stream->priv->gop_cache_size;
+  g_mutex_unlock (&stream->priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_stream_set_recv_batch_size:
+ * @stream: a #GstRTSPStream
+ * @size: the maximum number of packets
+ *
+ * Receive up to @size packets at a time from the UDP sockets of @stream,
+ * with recvmmsg() where available, into pre-allocated buffers and push them
+ * into the pipeline as one buffer list. This reduces the CPU usage of
+ * high-bitrate RECORD streams. A value of 0 uses udpsrc, which receives one
+ * packet at a time.
+ *
+ * See gst_rtsp_stream_get_recv_stats() for the batch sizes that are reached.
+ *
+ * This must be configured before @stream is joined to a bin.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_stream_set_recv_batch_size (GstRTSPStream * stream, guint size)
+{
+  g_return_if_fail (GST_IS_RTSP_STREAM (stream));
+  g_return_if_fail (size <= 1024);
+
+  g_mutex_lock (&stream->priv->lock);
+  stream->priv->recv_batch_size = size;
+  g_mutex_unlock (&stream->priv->lock);
+}
+
+/**
+ * gst_rtsp_stream_get_recv_batch_size:
+ * @stream: a #GstRTSPStream
+ *
+ * Get the maximum number of packets that are received at a time from the
+ * UDP sockets of @stream.
+ *
+ * Returns: the batch size, 0 when packets are received one at a time.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_stream_get_recv_batch_size (GstRTSPStream * stream)
+{
+  guint res;
+
+  g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), 0);
+
+  g_mutex_lock (&stream->priv->lock);
+  res = stream->priv->recv_batch_size;
+  g_mutex_unlock (&stream->priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_stream_get_recv_stats:
+ * @stream: a #GstRTSPStream
+ *
+ * Get the statistics of the batched UDP receive of @stream, see
+ * gst_rtsp_stream_set_recv_batch_size(). The structure contains the number
+ * of receive calls that returned packets in "batches", the number of packets
+ * in "packets", the average number of packets per call in
+ * "average-batch-size" and the largest batch in "max-batch-size", for all
+ * UDP sockets of @stream.
+ *
+ * Returns: (transfer full): a #GstStructure with the receive statistics of
+ * @stream. gst_structure_free() after usage.
+ *
+ * Since: 1.14
+ */
+GstStructure *
+gst_rtsp_stream_get_recv_stats (GstRTSPStream * stream)
+{
+  GstRTSPStreamPrivate *priv;
+  guint64 batches = 0, packets = 0;
+  guint max_batch = 0;
+  gint i;
+
+  g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), NULL);
+
+  priv = stream->priv;
+
+  g_mutex_lock (&priv->lock);
+  for (i = 0; i < 2; i++) {
+    GstElement *srcs[] = { priv->udpsrc_v4[i], priv->udpsrc_v6[i],
+      priv->mcast_udpsrc_v4[i], priv->mcast_udpsrc_v6[i]
+    };
+    guint j;
+
+    for (j = 0; j < G_N_ELEMENTS (srcs); j++) {
+      if (srcs[j] && gst_rtsp_udp_src_is_batched (srcs[j]))
+        gst_rtsp_udp_src_get_stats (srcs[j], &batches, &packets, &max_batch);
+    }
+  }
+  g_mutex_unlock (&priv->lock);
+
+  return gst_structure_new ("application/x-rtsp-stream-recv-stats",
+      "batches", G_TYPE_UINT64, batches,
+      "packets", G_TYPE_UINT64, packets,
+      "average-batch-size", G_TYPE_DOUBLE,
+      batches ? (gdouble) packets / batches : 0.0,
+      "max-batch-size", G_TYPE_UINT, max_batch, NULL);
+}
+
+/* executed from streaming thread */
+static void
+caps_notify (GstPad * pad, GParamSpec * unused, GstRTSPStream * stream)
+{
+  GstRTSPStreamPrivate *priv = stream->priv;
+  GstCaps *newcaps, *oldcaps;
+
+  newcaps = gst_pad_get_current_caps (pad);
+
+  GST_INFO ("stream %p received caps %p, %" GST_PTR_FORMAT, stream, newcaps,
+      newcaps);
+
+  g_mutex_lock (&priv->lock);
+  oldcaps = priv->caps;
+  priv->caps = newcaps;
+  invalidate_sdp (priv);
+  g_mutex_unlock (&priv->lock);
+
+  if (oldcaps)
+    gst_caps_unref (oldcaps);
+}
+
+/* executed from streaming thread, the tags end up in the SDP */
+static GstPadProbeReturn
+tag_event_probe (GstPad * pad, GstPadProbeInfo * info, GstRTSPStream * stream)
+{
+  GstRTSPStreamPrivate *priv = stream->priv;
+
+  if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_TAG) {
+    g_mutex_lock (&priv->lock);
+    invalidate_sdp (priv);
+    g_mutex_unlock (&priv->lock);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+dump_structure (const GstStructure * s)
+{
+  gchar *sstr;
+
+  sstr = gst_structure_to_string (s);
+  GST_INFO ("structure: %s", sstr);
+  g_free (sstr);
+}
+
+static void
+get_transport_ports (GstRTSPStreamPrivate * priv, const GstRTSPTransport * tr,
+    gint * min, gint * max)
+{
+  if (priv->client_side) {
+    /* In client side mode the 'destination' is the RTSP server, so send
+     * to those ports */
+    *min = tr->server_port.min;
+    *max = tr->server_port.max;
+  } else {
+    *min = tr->client_port.min;
+    *max = tr->client_port.max;
+  }
+}
+
+/* with lock and tr_index_lock. Several transports can have the same
+ * receiver, they are all kept so that removing one doesn't lose the others */
+static void
+index_port (GstRTSPStreamPrivate * priv, GstRTSPStreamTransport * trans,
+    GInetAddress * addr, gint port, gboolean add)
+{
+  GPtrArray *transports;
+  TransportKey key;
+
+  if (port < 0 || port > G_MAXUINT16)
+    return;
+
+  transport_key_init (&key, addr, port);
+  transports = g_hash_table_lookup (priv->tr_index, &key);
+  if (add) {
+    if (transports == NULL) {
+      transports = g_ptr_array_new ();
+      g_hash_table_insert (priv->tr_index, g_slice_dup (TransportKey, &key),
+          transports);
+    }
+    g_ptr_array_add (transports, trans);
+  } else if (transports) {
+    g_ptr_array_remove (transports, trans);
+    if (transports->len == 0)
+      g_hash_table_remove (priv->tr_index, &key);
+  }
+}
+
+/* with lock, keep the index used to find the transport of an RTCP sender up
+ * to date. Multicast transports are left out, RTCP from the receivers never
+ * comes from the multicast address. */
+static void
+update_transport_index (GstRTSPStreamPrivate * priv,
+    GstRTSPStreamTransport * trans, const GstRTSPTransport * tr, gboolean add)
+{
+  GInetAddress *addr = NULL;
+  gint min, max;
+
+  if (tr->lower_transport == GST_RTSP_LOWER_TRANS_UDP_MCAST)
+    return;
+
+  if (tr->lower_transport == GST_RTSP_LOWER_TRANS_UDP && tr->destination)
+    addr = g_inet_address_new_from_string (tr->destination);
+
+  g_rw_lock_writer_lock (&priv->tr_index_lock);
+  if (addr == NULL) {
+    /* host names and TCP transports are matched on the string */
+    if (add)
+      priv->tr_unindexed = g_list_prepend (priv->tr_unindexed, trans);
+    else
+      priv->tr_unindexed = g_list_remove (priv->tr_unindexed, trans);
+  } else {
+    get_transport_ports (priv, tr, &min, &max);
+    index_port (priv, trans, addr, min, add);
+    if (max != min)
+      index_port (priv, trans, addr, max, add);
+    g_object_unref (addr);
+  }
+  g_rw_lock_writer_unlock (&priv->tr_index_lock);
+}
+
+/* parse the "rtcp-from" field of the source stats, "host:port" or
+ * "[host]:port" for IPv6 */
+static GSocketAddress *
+parse_rtcp_from (const gchar * rtcp_from)
+{
+  GInetAddress *addr;
+  GSocketAddress *result;
+  const gchar *tmp;
+  gchar *host;
+  guint64 port;
+
+  if (rtcp_from == NULL)
+    return NULL;
+
+  tmp = g_strrstr (rtcp_from, ":");
+  if (tmp == NULL)
+    return NULL;
+
+  port = g_ascii_strtoull (tmp + 1, NULL, 10);
+  if (port > G_MAXUINT16)
+    return NULL;
+
+  if (rtcp_from[0] == '[' && tmp > rtcp_from + 1 && tmp[-1] == ']')
+    host = g_strndup (rtcp_from + 1, tmp - rtcp_from - 2);
+  else
+    host = g_strndup (rtcp_from, tmp - rtcp_from);
+
+  addr = g_inet_address_new_from_string (host);
+  g_free (host);
+  if (addr == NULL)
+    return NULL;
+
+  result = g_inet_socket_address_new (addr, port);
+  g_object_unref (addr);
+
+  return result;
+}
+
+static GstRTSPStreamTransport *
+find_transport (GstRTSPStream * stream, GSocketAddress * from)
+{
+  GstRTSPStreamPrivate *priv = stream->priv;
+  GstRTSPStreamTransport *result = NULL;
+  GInetSocketAddress *isa = G_INET_SOCKET_ADDRESS (from);
+  GInetAddress *addr;
+  GPtrArray *transports;
+  TransportKey key;
+  GList *walk;
+  gchar *dest;
+  guint port;
+
+  addr = g_inet_socket_address_get_address (isa);
+  port = g_inet_socket_address_get_port (isa);
+
+  g_rw_lock_reader_lock (&priv->tr_index_lock);
+  transport_key_init (&key, addr, port);
+  transports = g_hash_table_lookup (priv->tr_index, &key);
+  if (transports)
+    result = g_ptr_array_index (transports, 0);
+
+  /* the transports that are not in the index, usually only a few */
+  if (result == NULL && priv->tr_unindexed) {
+    dest = g_inet_address_to_string (addr);
+    GST_INFO ("finding %s:%d in %d transports", dest, port,
+        g_list_length (priv->tr_unindexed));
+
+    for (walk = priv->tr_unindexed; walk; walk = g_list_next (walk)) {
+      GstRTSPStreamTransport *trans = walk->data;
+      const GstRTSPTransport *tr;
+      gint min, max;
+
+      tr = gst_rtsp_stream_transport_get_transport (trans);
+      get_transport_ports (priv, tr, &min, &max);
+
+      if ((g_ascii_strcasecmp (tr->destination, dest) == 0) &&
+          (min == port || max == port)) {
+        result = trans;
+        break;
+      }
+    }
+    g_free (dest);
+  }
+  if (result)
+    g_object_ref (result);
+  g_rw_lock_reader_unlock (&priv->tr_index_lock);
+
+  return result;
+}
+
+static GstRTSPStreamTransport *
+check_transport (GObject * source, GstRTSPStream * stream)
+{
+  GstStructure *stats;
+  GstRTSPStreamTransport *trans;
+
+  /* see if we have a stream to match with the origin of the RTCP packet */
+  trans = g_object_get_qdata (source, ssrc_stream_map_key);
+  if (trans == NULL) {
+    g_object_get (source, "stats", &stats, NULL);
+    if (stats) {
+      GSocketAddress *from;
+
+      dump_structure (stats);
+
+      from = parse_rtcp_from (gst_structure_get_string (stats, "rtcp-from"));
+      if (from && (trans = find_transport (stream, from))) {
+        GST_INFO ("%p: found transport %p for source  %p", stream, trans,
+            source);
+        g_object_set_qdata_full (source, ssrc_stream_map_key, trans,
+            g_object_unref);
+      }
+      if (from)
+        g_object_unref (from);
+      gst_structure_free (stats);
+    }
+  }
+  return trans;
+}
+
+
+static void
+on_new_ssrc (GObject * session, GObject * source, GstRTSPStream * stream)
+{
+  GstRTSPStreamTransport *trans;
+
+  GST_INFO ("%p: new source %p", stream, source);
+
+  trans = check_transport (source, stream);
+
+  if (trans)
+    GST_INFO ("%p: source %p for transport %p", stream, source, trans);
+}
+
+static void
+on_ssrc_sdes (GObject * session, GObject * source, GstRTSPStream * stream)
+{
+  GST_INFO ("%p: new SDES %p", stream, source);
+}
+
+static void
+on_ssrc_active (GObject * session, GObject * source, GstRTSPStream * stream)
+{
+  GstRTSPStreamTransport *trans;
+
+  trans = check_transport (source, stream);
+
+  if (trans) {
+    GST_INFO ("%p: source %p in transport %p is active", stream, source, trans);
     gst_rtsp_stream_transport_keep_alive (trans);
   }
 #ifdef DUMP_STATS
@@ -1981,24 +2819,410 @@ on_sender_ssrc_active (GObject * session, GObject * source,
 static void
 clear_tr_cache (GstRTSPStreamPrivate * priv, gboolean is_rtp)
 {
+  TransportSnapshot **cache;
+
+  cache = is_rtp ? &priv->tr_cache_rtp : &priv->tr_cache_rtcp;
+  if (*cache) {
+    transport_snapshot_unref (*cache);
+    *cache = NULL;
+  }
+}
+
+/* get a ref to the current snapshot of the transports, can be called without
+ * the stream lock. The bit lock only protects against the snapshot being
+ * freed between reading the pointer and taking the ref. */
+static TransportSnapshot *
+get_transport_snapshot (GstRTSPStreamPrivate * priv)
+{
+  TransportSnapshot *snap;
+
+  g_pointer_bit_lock (&priv->tr_snapshot, 0);
+  snap = (TransportSnapshot *)
+      ((gsize) g_atomic_pointer_get (&priv->tr_snapshot) & ~(gsize) 1);
+  g_atomic_int_inc (&snap->refcount);
+  g_pointer_bit_unlock (&priv->tr_snapshot, 0);
+
+  return snap;
+}
+
+/* must be called with lock. Publish a new snapshot of priv->transports */
+static void
+publish_transports (GstRTSPStreamPrivate * priv)
+{
+  TransportSnapshot *snap, *old;
+  guint cookie;
+
+  cookie = priv->transports_cookie + 1;
+  snap = transport_snapshot_new (priv->transports, cookie);
+
+  g_pointer_bit_lock (&priv->tr_snapshot, 0);
+  old = (TransportSnapshot *)
+      ((gsize) g_atomic_pointer_get (&priv->tr_snapshot) & ~(gsize) 1);
+  /* keep the lock bit set, it is cleared by the unlock */
+  g_atomic_pointer_set (&priv->tr_snapshot, (gpointer) ((gsize) snap | 1));
+  g_pointer_bit_unlock (&priv->tr_snapshot, 0);
+
+  /* bump the cookie after the new snapshot is in place so that the streaming
+   * threads never pick up an old snapshot for a new cookie */
+  g_atomic_int_set (&priv->transports_cookie, cookie);
+
+  transport_snapshot_unref (old);
+}
+
+/* called from the streaming threads, @cache is only used by one thread */
+static TransportSnapshot *
+update_tr_cache (GstRTSPStreamPrivate * priv, TransportSnapshot ** cache)
+{
+  guint cookie = g_atomic_int_get (&priv->transports_cookie);
+
+  if (*cache == NULL || (*cache)->cookie != cookie) {
+    if (*cache)
+      transport_snapshot_unref (*cache);
+    *cache = get_transport_snapshot (priv);
+  }
+  return *cache;
+}
+
+/* a packet handed to the fan-out workers. The slices keep a ref on their
+ * transports, the ones that were removed after the packet was queued are
+ * skipped */
+typedef struct
+{
+  gint refcount;
+  FanoutSlices *slices;
+  GstSample *sample;
+  gboolean is_rtp;
+} FanoutPacket;
+
+/* marker to stop a worker */
+static gint fanout_stop_marker;
+#define FANOUT_STOP ((gpointer) &fanout_stop_marker)
+
+static void
+fanout_slices_unref (FanoutSlices * slices)
+{
+  if (!g_atomic_int_dec_and_test (&slices->refcount))
+    return;
+
+  transport_snapshot_unref (slices->snap);
+  g_free (slices);
+}
+
+/* the worker of a transport, the same transport always ends up in the same
+ * worker so that its packets are sent in order */
+static guint
+fanout_worker_for (GstRTSPStreamTransport * trans, guint n_workers)
+{
+  guint64 h = GPOINTER_TO_SIZE (trans);
+
+  h ^= h >> 33;
+  h *= G_GUINT64_CONSTANT (0xff51afd7ed558ccd);
+  h ^= h >> 33;
+
+  return (guint) (h % n_workers);
+}
+
+/* spread the transports of @snap evenly over the workers. The transports of
+ * the @prev slices stay with their worker, new transports go to the worker
+ * with the least transports */
+static void
+fanout_partition_balanced (TransportSnapshot * snap, guint n_slices,
+    FanoutSlices * prev, guint * index)
+{
+  GHashTable *assigned = NULL;
+  guint i, j, *count;
+
+  count = g_newa (guint, n_slices);
+  memset (count, 0, n_slices * sizeof (guint));
+
+  if (prev && prev->n_slices == n_slices) {
+    assigned = g_hash_table_new (NULL, NULL);
+    for (i = 0; i < n_slices; i++) {
+      for (j = prev->start[i]; j < prev->start[i + 1]; j++)
+        g_hash_table_insert (assigned, prev->transports[j],
+            GUINT_TO_POINTER (i + 1));
+    }
+  }
+
+  for (i = 0; i < snap->n_transports; i++) {
+    gpointer slice = NULL;
+
+    if (assigned)
+      slice = g_hash_table_lookup (assigned, snap->transports[i]);
+
+    if (slice) {
+      index[i] = GPOINTER_TO_UINT (slice) - 1;
+      count[index[i]]++;
+    } else {
+      index[i] = G_MAXUINT;
+    }
+  }
+  for (i = 0; i < snap->n_transports; i++) {
+    guint min = 0;
+
+    if (index[i] != G_MAXUINT)
+      continue;
+
+    for (j = 1; j < n_slices; j++) {
+      if (count[j] < count[min])
+        min = j;
+    }
+    index[i] = min;
+    count[min]++;
+  }
+
+  if (assigned)
+    g_hash_table_unref (assigned);
+}
+
+static FanoutSlices *
+fanout_slices_new (TransportSnapshot * snap, guint n_slices,
+    GstRTSPFanoutPartition partition, FanoutSlices * prev)
+{
+  FanoutSlices *slices;
+  guint i, *index, *fill;
+
+  slices = g_malloc (sizeof (FanoutSlices) + (n_slices + 1) * sizeof (guint) +
+      snap->n_transports * sizeof (GstRTSPStreamTransport *));
+  slices->refcount = 1;
+  slices->snap = snap;
+  g_atomic_int_inc (&snap->refcount);
+  slices->n_slices = n_slices;
+  slices->transports = (GstRTSPStreamTransport **) (slices + 1);
+  slices->start = (guint *) (slices->transports + snap->n_transports);
+
+  index = g_newa (guint, snap->n_transports);
+  fill = g_newa (guint, n_slices);
+  memset (slices->start, 0, (n_slices + 1) * sizeof (guint));
+
+  /* count the transports of each slice */
+  if (partition == GST_RTSP_FANOUT_PARTITION_BALANCED) {
+    fanout_partition_balanced (snap, n_slices, prev, index);
+  } else {
+    for (i = 0; i < snap->n_transports; i++)
+      index[i] = fanout_worker_for (snap->transports[i], n_slices);
+  }
+  for (i = 0; i < snap->n_transports; i++)
+    slices->start[index[i] + 1]++;
+  for (i = 0; i < n_slices; i++) {
+    slices->start[i + 1] += slices->start[i];
+    fill[i] = slices->start[i];
+  }
+  /* and put them in place, keeping the order of the snapshot */
+  for (i = 0; i < snap->n_transports; i++)
+    slices->transports[fill[index[i]]++] = snap->transports[i];
+
+  return slices;
+}
+
+static void
+fanout_packet_unref (FanoutPacket * packet)
+{
+  if (!g_atomic_int_dec_and_test (&packet->refcount))
+    return;
+
+  fanout_slices_unref (packet->slices);
+  gst_sample_unref (packet->sample);
+  g_slice_free (FanoutPacket, packet);
+}
+
+static void
+send_sample (GstSample * sample, gboolean is_rtp,
+    GstRTSPStreamTransport ** transports, guint n_transports)
+{
+  GstBuffer *buffer;
+  GstBufferList *buffer_list = NULL;
+  guint i;
+
+  buffer = gst_sample_get_buffer (sample);
+#if GST_CHECK_VERSION(1,13,1)
+  if (buffer == NULL)
+    buffer_list = gst_sample_get_buffer_list (sample);
+#endif
+
+  for (i = 0; i < n_transports; i++) {
+    if (gst_rtsp_stream_transport_is_removed (transports[i]))
+      continue;
+
+    if (is_rtp) {
+      if (buffer_list)
+        gst_rtsp_stream_transport_send_rtp_list (transports[i], buffer_list);
+      else
+        gst_rtsp_stream_transport_send_rtp (transports[i], buffer);
+    } else {
+      if (buffer_list)
+        gst_rtsp_stream_transport_send_rtcp_list (transports[i], buffer_list);
+      else
+        gst_rtsp_stream_transport_send_rtcp (transports[i], buffer);
+    }
+  }
+}
+
+static gpointer
+fanout_worker_func (FanoutWorker * worker)
+{
+  gpointer item;
+
+  while ((item = g_async_queue_pop (worker->queue)) != FANOUT_STOP) {
+    FanoutPacket *packet = item;
+    FanoutSlices *slices = packet->slices;
+    guint start = slices->start[worker->index];
+
+    send_sample (packet->sample, packet->is_rtp,
+        &slices->transports[start], slices->start[worker->index + 1] - start);
+    fanout_packet_unref (packet);
+  }
+  return NULL;
+}
+
+/* with lock, called when a TCP transport is added */
+static void
+start_fanout_workers (GstRTSPStream * stream)
+{
+  GstRTSPStreamPrivate *priv = stream->priv;
+  FanoutWorker *workers;
+  guint i;
+
+  if (priv->fanout_threads == 0 || priv->workers != NULL)
+    return;
+
+  GST_INFO ("stream %p starting %u fan-out threads", stream,
+      priv->fanout_threads);
+
+  workers = g_new0 (FanoutWorker, priv->fanout_threads);
+  for (i = 0; i < priv->fanout_threads; i++) {
+    FanoutWorker *worker = &workers[i];
+    gchar *name;
+
+    worker->stream = stream;
+    worker->index = i;
+    worker->queue = g_async_queue_new ();
+    name = g_strdup_printf ("rtsp-fanout-%u", i);
+    worker->thread = g_thread_new (name, (GThreadFunc) fanout_worker_func,
+        worker);
+    g_free (name);
+  }
+
+  g_mutex_lock (&priv->fanout_lock);
+  priv->workers = workers;
+  g_atomic_int_set (&priv->n_workers, priv->fanout_threads);
+  g_mutex_unlock (&priv->fanout_lock);
+}
+
+/* with lock, the appsinks must be stopped */
+static void
+stop_fanout_workers (GstRTSPStream * stream)
+{
+  GstRTSPStreamPrivate *priv = stream->priv;
+  FanoutWorker *workers;
+  guint i, n_workers;
+
+  g_mutex_lock (&priv->fanout_lock);
+  for (i = 0; i < 2; i++) {
+    if (priv->fanout_slices[i]) {
+      fanout_slices_unref (priv->fanout_slices[i]);
+      priv->fanout_slices[i] = NULL;
+    }
+  }
+  workers = priv->workers;
+  n_workers = priv->n_workers;
+  priv->workers = NULL;
+  g_atomic_int_set (&priv->n_workers, 0);
+  if (workers != NULL && priv->fanout_dropped > 0)
+    GST_INFO ("fan-out dropped %" G_GUINT64_FORMAT " packets",
+        priv->fanout_dropped);
+  g_mutex_unlock (&priv->fanout_lock);
+
+  if (workers == NULL)
+    return;
+
+  /* the workers send the packets that are still queued before they stop */
+  for (i = 0; i < n_workers; i++)
+    g_async_queue_push (workers[i].queue, FANOUT_STOP);
+  for (i = 0; i < n_workers; i++) {
+    g_thread_join (workers[i].thread);
+    g_async_queue_unref (workers[i].queue);
+  }
+  g_free (workers);
+}
+
+/* called from the streaming thread, hand the sample to the fan-out workers.
+ * Returns FALSE when there are no workers and the sample must be sent from
+ * the streaming thread. */
+static gboolean
+queue_fanout_sample (GstRTSPStreamPrivate * priv, GstSample * sample,
+    gboolean is_rtp)
+{
+  TransportSnapshot *snap;
+  FanoutSlices **slices;
+  FanoutPacket *packet;
+  gboolean *queue;
+  guint i, n_queue = 0;
+
+  /* the workers can be stopped from another thread */
+  g_mutex_lock (&priv->fanout_lock);
+  if (priv->n_workers == 0) {
+    g_mutex_unlock (&priv->fanout_lock);
+    return FALSE;
+  }
+
   if (is_rtp) {
-    g_list_foreach (priv->tr_cache_rtp, (GFunc) g_object_unref, NULL);
-    g_list_free (priv->tr_cache_rtp);
-    priv->tr_cache_rtp = NULL;
+    snap = update_tr_cache (priv, &priv->tr_cache_rtp);
+    slices = &priv->fanout_slices[0];
   } else {
-    g_list_foreach (priv->tr_cache_rtcp, (GFunc) g_object_unref, NULL);
-    g_list_free (priv->tr_cache_rtcp);
-    priv->tr_cache_rtcp = NULL;
+    snap = update_tr_cache (priv, &priv->tr_cache_rtcp);
+    slices = &priv->fanout_slices[1];
+  }
+  if (*slices == NULL || (*slices)->snap != snap) {
+    FanoutSlices *prev = *slices;
+
+    *slices = fanout_slices_new (snap, priv->n_workers,
+        priv->fanout_partition, prev);
+    if (prev)
+      fanout_slices_unref (prev);
+  }
+
+  /* only queue for the workers that have transports and room left */
+  queue = g_newa (gboolean, priv->n_workers);
+  for (i = 0; i < priv->n_workers; i++) {
+    queue[i] = (*slices)->start[i + 1] > (*slices)->start[i];
+    if (queue[i] &&
+        g_async_queue_length (priv->workers[i].queue) >=
+        priv->fanout_queue_size) {
+      GST_LOG ("fan-out thread %u is full, dropping packet", i);
+      priv->fanout_dropped++;
+      queue[i] = FALSE;
+    }
+    if (queue[i])
+      n_queue++;
   }
+
+  if (n_queue > 0) {
+    packet = g_slice_new (FanoutPacket);
+    packet->refcount = n_queue;
+    packet->slices = *slices;
+    g_atomic_int_inc (&(*slices)->refcount);
+    packet->sample = gst_sample_ref (sample);
+    packet->is_rtp = is_rtp;
+
+    for (i = 0; i < priv->n_workers; i++) {
+      if (queue[i])
+        g_async_queue_push (priv->workers[i].queue, packet);
+    }
+  }
+  g_mutex_unlock (&priv->fanout_lock);
+
+  return TRUE;
 }
 
 static GstFlowReturn
 handle_new_sample (GstAppSink * sink, gpointer user_data)
 {
   GstRTSPStreamPrivate *priv;
-  GList *walk;
+  TransportSnapshot *snap;
   GstSample *sample;
   GstBuffer *buffer;
+  GstBufferList *buffer_list = NULL;
   GstRTSPStream *stream;
   gboolean is_rtp;
 
@@ -2009,53 +3233,80 @@ handle_new_sample (GstAppSink * sink, gpointer user_data)
   stream = (GstRTSPStream *) user_data;
   priv = stream->priv;
   buffer = gst_sample_get_buffer (sample);
+#if GST_CHECK_VERSION(1,13,1)
+  /* with buffer-list support enabled on the appsink, a whole batch of
+   * packets arrives in one sample and is handed to the transports at once */
+  if (buffer == NULL)
+    buffer_list = gst_sample_get_buffer_list (sample);
+#endif
+  if (buffer == NULL && buffer_list == NULL)
+    goto done;
 
   is_rtp = GST_ELEMENT_CAST (sink) == priv->appsink[0];
 
-  g_mutex_lock (&priv->lock);
-  if (is_rtp) {
-    if (priv->tr_cache_cookie_rtp != priv->transports_cookie) {
-      clear_tr_cache (priv, is_rtp);
-      for (walk = priv->transports; walk; walk = g_list_next (walk)) {
-        GstRTSPStreamTransport *tr = (GstRTSPStreamTransport *) walk->data;
-        priv->tr_cache_rtp =
-            g_list_prepend (priv->tr_cache_rtp, g_object_ref (tr));
-      }
-      priv->tr_cache_cookie_rtp = priv->transports_cookie;
-    }
-  } else {
-    if (priv->tr_cache_cookie_rtcp != priv->transports_cookie) {
-      clear_tr_cache (priv, is_rtp);
-      for (walk = priv->transports; walk; walk = g_list_next (walk)) {
-        GstRTSPStreamTransport *tr = (GstRTSPStreamTransport *) walk->data;
-        priv->tr_cache_rtcp =
-            g_list_prepend (priv->tr_cache_rtcp, g_object_ref (tr));
-      }
-      priv->tr_cache_cookie_rtcp = priv->transports_cookie;
-    }
+  if (g_atomic_int_get (&priv->n_workers) == 0 ||
+      !queue_fanout_sample (priv, sample, is_rtp)) {
+    if (is_rtp)
+      snap = update_tr_cache (priv, &priv->tr_cache_rtp);
+    else
+      snap = update_tr_cache (priv, &priv->tr_cache_rtcp);
+    send_sample (sample, is_rtp, snap->transports, snap->n_transports);
   }
-  g_mutex_unlock (&priv->lock);
 
-  if (is_rtp) {
-    for (walk = priv->tr_cache_rtp; walk; walk = g_list_next (walk)) {
-      GstRTSPStreamTransport *tr = (GstRTSPStreamTransport *) walk->data;
-      gst_rtsp_stream_transport_send_rtp (tr, buffer);
-    }
-  } else {
-    for (walk = priv->tr_cache_rtcp; walk; walk = g_list_next (walk)) {
-      GstRTSPStreamTransport *tr = (GstRTSPStreamTransport *) walk->data;
-      gst_rtsp_stream_transport_send_rtcp (tr, buffer);
-    }
-  }
+done:
+  gst_sample_unref (sample);
+
+  return GST_FLOW_OK;
+}
+
+static GstAppSinkCallbacks sink_cb = {
+  NULL,                         /* not interested in EOS */
+  NULL,                         /* not interested in preroll samples */
+  handle_new_sample,
+};
+
+static GstFlowReturn
+handle_new_fanout_sample (GstAppSink * sink, gpointer user_data)
+{
+  GstRTSPStreamPrivate *priv;
+  GstRTSPUdpSender *sender;
+  GstSample *sample;
+  GstBuffer *buffer;
+  GstBufferList *buffer_list = NULL;
+  GstRTSPStream *stream;
+
+  sample = gst_app_sink_pull_sample (sink);
+  if (!sample)
+    return GST_FLOW_OK;
+
+  stream = (GstRTSPStream *) user_data;
+  priv = stream->priv;
+
+  if (GST_ELEMENT_CAST (sink) == priv->fanout_sink[0])
+    sender = priv->udp_sender[0];
+  else
+    sender = priv->udp_sender[1];
+
+  buffer = gst_sample_get_buffer (sample);
+#if GST_CHECK_VERSION(1,13,1)
+  if (buffer == NULL)
+    buffer_list = gst_sample_get_buffer_list (sample);
+#endif
+
+  if (buffer)
+    gst_rtsp_udp_sender_send (sender, buffer);
+  else if (buffer_list)
+    gst_rtsp_udp_sender_send_list (sender, buffer_list);
+
   gst_sample_unref (sample);
 
   return GST_FLOW_OK;
 }
 
-static GstAppSinkCallbacks sink_cb = {
+static GstAppSinkCallbacks fanout_sink_cb = {
   NULL,                         /* not interested in EOS */
   NULL,                         /* not interested in preroll samples */
-  handle_new_sample,
+  handle_new_fanout_sample,
 };
 
 static GstElement *
@@ -2258,6 +3509,7 @@ gst_rtsp_stream_set_publish_clock_mode (GstRTSPStream * stream,
   priv = stream->priv;
   g_mutex_lock (&priv->lock);
   priv->publish_clock_mode = mode;
+  invalidate_sdp (priv);
   g_mutex_unlock (&priv->lock);
 }
 
@@ -2438,6 +3690,14 @@ create_sender_part (GstRTSPStream * stream, GstBin * bin, GstState state)
       /* make appsink */
       priv->appsink[i] = gst_element_factory_make ("appsink", NULL);
       g_object_set (priv->appsink[i], "emit-signals", FALSE, NULL);
+#if GST_CHECK_VERSION(1,13,1)
+      /* accept buffer lists from upstream so that we can fan out a whole
+       * batch of packets per callback instead of one by one. Only when we
+       * were built to read them from the samples */
+      if (g_object_class_find_property (G_OBJECT_GET_CLASS (priv->appsink[i]),
+              "buffer-list"))
+        g_object_set (priv->appsink[i], "buffer-list", TRUE, NULL);
+#endif
       gst_app_sink_set_callbacks (GST_APP_SINK_CAST (priv->appsink[i]),
           &sink_cb, stream, NULL);
     }
@@ -2462,6 +3722,32 @@ create_sender_part (GstRTSPStream * stream, GstBin * bin, GstState state)
         plug_sink (bin, priv->tee[i], priv->mcast_udpsink[i],
             &priv->mcast_udpqueue[i]);
 
+      /* unicast destinations are served by our own sender, the udpsink only
+       * sends to destinations that the sender can't handle. Only the sender
+       * can pace the packets, so pacing also uses it */
+      if ((priv->udp_fanout || priv->pacing) && priv->udpsink[i]) {
+        priv->udp_sender[i] = gst_rtsp_udp_sender_new ();
+        if (i == 0 && priv->pacing)
+          gst_rtsp_udp_sender_set_pacing (priv->udp_sender[i], TRUE);
+        priv->fanout_sink[i] = gst_element_factory_make ("appsink", NULL);
+        g_object_set (priv->fanout_sink[i], "emit-signals", FALSE,
+            "enable-last-sample", FALSE, NULL);
+#if GST_CHECK_VERSION(1,13,1)
+        if (g_object_class_find_property (G_OBJECT_GET_CLASS
+                (priv->fanout_sink[i]), "buffer-list"))
+          g_object_set (priv->fanout_sink[i], "buffer-list", TRUE, NULL);
+#endif
+        /* same sync and preroll behaviour as the udpsink */
+        if (i == 1)
+          g_object_set (priv->fanout_sink[i], "sync", FALSE, NULL);
+        if (i == 1 || priv->sinkpad)
+          g_object_set (priv->fanout_sink[i], "async", FALSE, NULL);
+        gst_app_sink_set_callbacks (GST_APP_SINK_CAST (priv->fanout_sink[i]),
+            &fanout_sink_cb, stream, NULL);
+        plug_sink (bin, priv->tee[i], priv->fanout_sink[i],
+            &priv->fanout_queue[i]);
+      }
+
       if (is_tcp) {
         g_object_set (priv->appsink[i], "async", FALSE, "sync", FALSE, NULL);
         plug_sink (bin, priv->tee[i], priv->appsink[i], &priv->appqueue[i]);
@@ -2494,6 +3780,10 @@ create_sender_part (GstRTSPStream * stream, GstBin * bin, GstState state)
         gst_element_set_state (priv->udpqueue[i], state);
       if (priv->mcast_udpqueue[i])
         gst_element_set_state (priv->mcast_udpqueue[i], state);
+      if (priv->fanout_sink[i])
+        gst_element_set_state (priv->fanout_sink[i], state);
+      if (priv->fanout_queue[i])
+        gst_element_set_state (priv->fanout_queue[i], state);
       if (priv->tee[i])
         gst_element_set_state (priv->tee[i], state);
     }
@@ -2646,6 +3936,330 @@ wrong_addr:
   }
 }
 
+/* with gop_lock */
+static void
+clear_gop_cache (GstRTSPStreamPrivate * priv)
+{
+  GstBuffer *buffer;
+
+  while ((buffer = g_queue_pop_head (&priv->gop_packets)))
+    gst_buffer_unref (buffer);
+  priv->gop_bytes = 0;
+  priv->gop_valid = FALSE;
+}
+
+/* with gop_lock, executed from streaming thread */
+static void
+cache_rtp_packet (GstRTSPStreamPrivate * priv, GstPad * pad,
+    GstBuffer * buffer)
+{
+  gsize size;
+
+  if (!GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    guint32 rtptime;
+
+    if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp))
+      return;
+    rtptime = gst_rtp_buffer_get_timestamp (&rtp);
+    gst_rtp_buffer_unmap (&rtp);
+
+    /* all packets of the keyframe have the same timestamp, a keyframe with
+     * another timestamp starts a new group of pictures */
+    if (!priv->gop_valid || rtptime != priv->gop_rtptime) {
+      GstEvent *event;
+
+      clear_gop_cache (priv);
+      priv->gop_valid = TRUE;
+      priv->gop_rtptime = rtptime;
+      priv->gop_running_time = GST_CLOCK_TIME_NONE;
+
+      event = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+      if (event) {
+        const GstSegment *segment;
+
+        gst_event_parse_segment (event, &segment);
+        priv->gop_running_time = gst_segment_to_running_time (segment,
+            GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+        gst_event_unref (event);
+      }
+    }
+  } else if (!priv->gop_valid) {
+    /* waiting for a keyframe */
+    return;
+  }
+
+  size = gst_buffer_get_size (buffer);
+  if (priv->gop_bytes + size > priv->gop_cache_size) {
+    GST_DEBUG ("group of pictures exceeds %u bytes, waiting for keyframe",
+        priv->gop_cache_size);
+    clear_gop_cache (priv);
+    return;
+  }
+
+  g_queue_push_tail (&priv->gop_packets, gst_buffer_ref (buffer));
+  priv->gop_bytes += size;
+}
+
+static GstPadProbeReturn
+gop_cache_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstRTSPStream *stream = user_data;
+  GstRTSPStreamPrivate *priv = stream->priv;
+
+  g_mutex_lock (&priv->gop_lock);
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    cache_rtp_packet (priv, pad, GST_PAD_PROBE_INFO_BUFFER (info));
+  } else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *buffer_list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    guint i, len;
+
+    len = gst_buffer_list_length (buffer_list);
+    for (i = 0; i < len; i++)
+      cache_rtp_packet (priv, pad, gst_buffer_list_get (buffer_list, i));
+  }
+  g_mutex_unlock (&priv->gop_lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* get the seqnum of the RTP packet in @buffer, -1 when it is not valid */
+static gint
+get_rtp_seqnum (GstBuffer * buffer)
+{
+  guint8 seq[2];
+
+  /* the seqnum is in the third and fourth byte of the RTP header */
+  if (gst_buffer_extract (buffer, 2, seq, 2) != 2)
+    return -1;
+
+  return GST_READ_UINT16_BE (seq);
+}
+
+/* get the seqnum of the last RTP packet that @sink rendered, -1 when it
+ * didn't render anything yet */
+static gint
+get_last_rendered_seqnum (GstElement * sink)
+{
+  GstSample *last_sample;
+  GstBuffer *buffer;
+  gint res = -1;
+
+  g_object_get (sink, "last-sample", &last_sample, NULL);
+  if (last_sample == NULL)
+    return -1;
+
+  buffer = gst_sample_get_buffer (last_sample);
+#if GST_CHECK_VERSION(1,13,1)
+  if (buffer == NULL) {
+    GstBufferList *buffer_list = gst_sample_get_buffer_list (last_sample);
+    guint len;
+
+    if (buffer_list && (len = gst_buffer_list_length (buffer_list)) > 0)
+      buffer = gst_buffer_list_get (buffer_list, len - 1);
+  }
+#endif
+  if (buffer)
+    res = get_rtp_seqnum (buffer);
+  gst_sample_unref (last_sample);
+
+  return res;
+}
+
+/* with gop_lock, the receiver of @trans starts with the cached packet
+ * @first */
+static void
+set_gop_burst_rtpinfo (GstRTSPStreamPrivate * priv,
+    GstRTSPStreamTransport * trans, GstBuffer * first)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  if (!gst_rtp_buffer_map (first, GST_MAP_READ, &rtp))
+    return;
+
+  gst_rtsp_stream_transport_set_burst_rtpinfo (trans,
+      gst_rtp_buffer_get_seq (&rtp), gst_rtp_buffer_get_timestamp (&rtp),
+      priv->gop_running_time);
+  gst_rtp_buffer_unmap (&rtp);
+}
+
+/* with gop_lock, the packets of the burst for a new transport: the packets in
+ * @reserved, that were reserved when the RTP-Info of the transport was made,
+ * followed by the cached packets after them. Without reserved packets, all
+ * the cached packets. */
+static GList *
+get_gop_burst_packets (GstRTSPStreamPrivate * priv, GList * reserved)
+{
+  GList *walk, *packets = NULL;
+  gint last_seqnum = -1;
+
+  for (walk = reserved; walk; walk = walk->next) {
+    gint seqnum = get_rtp_seqnum (walk->data);
+
+    packets = g_list_prepend (packets, gst_buffer_ref (walk->data));
+    if (seqnum >= 0)
+      last_seqnum = seqnum;
+  }
+  /* the cache can have moved on to the next group of pictures since then,
+   * the receiver then misses the packets in between */
+  for (walk = priv->gop_packets.head; walk; walk = walk->next) {
+    gint seqnum = get_rtp_seqnum (walk->data);
+
+    if (last_seqnum >= 0 && (seqnum < 0
+            || (gint16) (seqnum - last_seqnum) <= 0))
+      continue;
+    packets = g_list_prepend (packets, gst_buffer_ref (walk->data));
+  }
+
+  return g_list_reverse (packets);
+}
+
+/* with gop_lock, queue the @packets of the burst for the new TCP transport
+ * @trans. They are sent from the send queue of @trans, from where the client
+ * sends them when its connection has room. */
+static void
+queue_gop_burst_tcp (GstRTSPStream * stream, GstRTSPStreamTransport * trans,
+    GList * packets, gboolean reserved)
+{
+  GstRTSPStreamPrivate *priv = stream->priv;
+  GList *last;
+  gint seqnum;
+
+  last = g_list_last (packets);
+  if (last == NULL || (seqnum = get_rtp_seqnum (last->data)) < 0)
+    return;
+
+  /* the cached packets can still be on their way to the appsink, make sure
+   * they are not sent twice */
+  gst_rtsp_stream_transport_queue_burst (trans, packets, seqnum);
+  if (!reserved)
+    set_gop_burst_rtpinfo (priv, trans, packets->data);
+}
+
+/* with gop_lock, collect the @packets of the burst for the new UDP transport
+ * @trans with destination @dest:@port in @burst. Only the packets up to
+ * @last_seqnum, that were sent before the destination was added, are needed,
+ * the others reach it through the live flow. */
+static void
+collect_gop_burst_udp (GstRTSPStream * stream, GstRTSPStreamTransport * trans,
+    const gchar * dest, gint port, gint last_seqnum, GList * packets,
+    gboolean reserved, GopBurst * burst)
+{
+  GstRTSPStreamPrivate *priv = stream->priv;
+  GInetAddress *addr;
+  GSocket *socket = NULL;
+  GList *walk, *send = NULL;
+
+  if (last_seqnum < 0)
+    return;
+
+  for (walk = packets; walk; walk = walk->next) {
+    gint seqnum = get_rtp_seqnum (walk->data);
+
+    if (seqnum < 0 || (gint16) (seqnum - last_seqnum) > 0)
+      break;
+    send = g_list_prepend (send, gst_buffer_ref (walk->data));
+  }
+  if (send == NULL)
+    return;
+  send = g_list_reverse (send);
+
+  /* host names are resolved by the udpsink, skip those */
+  addr = g_inet_address_new_from_string (dest);
+  if (addr == NULL)
+    goto done;
+
+  if (g_inet_address_get_family (addr) == G_SOCKET_FAMILY_IPV6)
+    g_object_get (priv->udpsink[0], "socket-v6", &socket, NULL);
+  else
+    g_object_get (priv->udpsink[0], "socket", &socket, NULL);
+
+  if (socket) {
+    burst->socket = socket;
+    burst->address = g_inet_socket_address_new (addr, port);
+    burst->packets = send;
+    send = NULL;
+    if (!reserved)
+      set_gop_burst_rtpinfo (priv, trans, burst->packets->data);
+  }
+  g_object_unref (addr);
+
+done:
+  g_list_free_full (send, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* called when the RTP-Info of a transport that is not added yet is made.
+ * Returns a copy of the cached packets, the burst of the transport starts
+ * with them when it is added. The RTP-Info of the first of them is returned
+ * in @seq, @rtptime and @running_time. */
+GList *
+gst_rtsp_stream_reserve_gop_burst (GstRTSPStream * stream, guint * seq,
+    guint * rtptime, GstClockTime * running_time)
+{
+  GstRTSPStreamPrivate *priv;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GList *packets = NULL;
+
+  g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), NULL);
+
+  priv = stream->priv;
+
+  g_mutex_lock (&priv->lock);
+  if (priv->gop_probe_id == 0)
+    goto done;
+
+  g_mutex_lock (&priv->gop_lock);
+  packets = get_gop_burst_packets (priv, NULL);
+  if (packets && gst_rtp_buffer_map (packets->data, GST_MAP_READ, &rtp)) {
+    *seq = gst_rtp_buffer_get_seq (&rtp);
+    *rtptime = gst_rtp_buffer_get_timestamp (&rtp);
+    *running_time = priv->gop_running_time;
+    gst_rtp_buffer_unmap (&rtp);
+  } else {
+    g_list_free_full (packets, (GDestroyNotify) gst_buffer_unref);
+    packets = NULL;
+  }
+  g_mutex_unlock (&priv->gop_lock);
+
+done:
+  g_mutex_unlock (&priv->lock);
+
+  return packets;
+}
+
+static void
+free_gop_burst_packets (GList * reserved, GList * packets)
+{
+  g_list_free_full (reserved, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (packets, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* send the packets in @burst, without the stream locks, and clear it */
+static void
+send_gop_burst (GopBurst * burst)
+{
+  GList *walk;
+
+  for (walk = burst->packets; walk; walk = walk->next) {
+    GstMapInfo map;
+
+    if (!gst_buffer_map (walk->data, &map, GST_MAP_READ))
+      continue;
+    /* a client that doesn't keep up will lose packets, like with the
+     * udpsink */
+    g_socket_send_to (burst->socket, burst->address,
+        (const gchar *) map.data, map.size, NULL, NULL);
+    gst_buffer_unmap (walk->data, &map);
+  }
+
+  g_list_free_full (burst->packets, (GDestroyNotify) gst_buffer_unref);
+  if (burst->socket)
+    g_object_unref (burst->socket);
+  if (burst->address)
+    g_object_unref (burst->address);
+  memset (burst, 0, sizeof (GopBurst));
+}
+
 /**
  * gst_rtsp_stream_join_bin:
  * @stream: a #GstRTSPStream
@@ -2722,6 +4336,12 @@ gst_rtsp_stream_join_bin (GstRTSPStream * stream, GstBin * bin,
     name = g_strdup_printf ("send_rtp_src_%u", idx);
     priv->send_src[0] = gst_element_get_static_pad (rtpbin, name);
     g_free (name);
+
+    if (priv->gop_cache_size > 0) {
+      priv->gop_probe_id = gst_pad_add_probe (priv->send_src[0],
+          GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+          gop_cache_probe, stream, NULL);
+    }
   } else {
     /* Need to connect our sinkpad from here */
     g_signal_connect (rtpbin, "pad-added", (GCallback) pad_added, stream);
@@ -2770,6 +4390,10 @@ gst_rtsp_stream_join_bin (GstRTSPStream * stream, GstBin * bin,
     priv->caps_sig = g_signal_connect (priv->send_src[0], "notify::caps",
         (GCallback) caps_notify, stream);
     priv->caps = gst_pad_get_current_caps (priv->send_src[0]);
+    /* and of tag changes */
+    priv->tag_probe = gst_pad_add_probe (priv->srcpad,
+        GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+        (GstPadProbeCallback) tag_event_probe, stream, NULL);
   }
 
   priv->joined_bin = bin;
@@ -2848,15 +4472,14 @@ gst_rtsp_stream_leave_bin (GstRTSPStream * stream, GstBin * bin,
   if (priv->transports != NULL)
     goto transports_not_removed;
 
-  clear_tr_cache (priv, TRUE);
-  clear_tr_cache (priv, FALSE);
-
   GST_INFO ("stream %p leaving bin", stream);
 
   if (priv->srcpad) {
     gst_pad_unlink (priv->srcpad, priv->send_rtp_sink);
 
     g_signal_handler_disconnect (priv->send_src[0], priv->caps_sig);
+    gst_pad_remove_probe (priv->srcpad, priv->tag_probe);
+    priv->tag_probe = 0;
     gst_element_release_request_pad (rtpbin, priv->send_rtp_sink);
     gst_object_unref (priv->send_rtp_sink);
     priv->send_rtp_sink = NULL;
@@ -2881,6 +4504,13 @@ gst_rtsp_stream_leave_bin (GstRTSPStream * stream, GstBin * bin,
     clear_element (bin, &priv->appqueue[i]);
     clear_element (bin, &priv->appsink[i]);
 
+    clear_element (bin, &priv->fanout_queue[i]);
+    clear_element (bin, &priv->fanout_sink[i]);
+    if (priv->udp_sender[i]) {
+      gst_rtsp_udp_sender_free (priv->udp_sender[i]);
+      priv->udp_sender[i] = NULL;
+    }
+
     clear_element (bin, &priv->tee[i]);
     clear_element (bin, &priv->funnel[i]);
 
@@ -2891,7 +4521,20 @@ gst_rtsp_stream_leave_bin (GstRTSPStream * stream, GstBin * bin,
     }
   }
 
+  /* the appsinks are stopped now, nothing uses the caches anymore */
+  stop_fanout_workers (stream);
+  clear_tr_cache (priv, TRUE);
+  clear_tr_cache (priv, FALSE);
+
   if (priv->srcpad) {
+    if (priv->gop_probe_id) {
+      gst_pad_remove_probe (priv->send_src[0], priv->gop_probe_id);
+      priv->gop_probe_id = 0;
+    }
+    g_mutex_lock (&priv->gop_lock);
+    clear_gop_cache (priv);
+    g_mutex_unlock (&priv->gop_lock);
+
     gst_object_unref (priv->send_src[0]);
     priv->send_src[0] = NULL;
   }
@@ -3023,10 +4666,20 @@ gst_rtsp_stream_get_rtpinfo (GstRTSPStream * stream,
 
       caps = gst_sample_get_caps (last_sample);
       buffer = gst_sample_get_buffer (last_sample);
+#if GST_CHECK_VERSION(1,13,1)
+      if (buffer == NULL) {
+        GstBufferList *buffer_list = gst_sample_get_buffer_list (last_sample);
+        guint len;
+
+        /* the last buffer of the list is the most recent one */
+        if (buffer_list && (len = gst_buffer_list_length (buffer_list)) > 0)
+          buffer = gst_buffer_list_get (buffer_list, len - 1);
+      }
+#endif
       segment = gst_sample_get_segment (last_sample);
       s = gst_caps_get_structure (caps, 0);
 
-      if (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp_buffer)) {
+      if (buffer && gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp_buffer)) {
         guint ssrc_buf = gst_rtp_buffer_get_ssrc (&rtp_buffer);
         guint ssrc_stream = 0;
         if (gst_structure_has_field_typed (s, "ssrc", G_TYPE_UINT) &&
@@ -3149,6 +4802,55 @@ gst_rtsp_stream_get_caps (GstRTSPStream * stream)
   return result;
 }
 
+/* make the SDP of @stream use the generation counter @generation of its
+ * media, or none when @generation is %NULL */
+void
+gst_rtsp_stream_set_sdp_generation (GstRTSPStream * stream, gint * generation)
+{
+  GstRTSPStreamPrivate *priv = stream->priv;
+
+  g_mutex_lock (&priv->lock);
+  priv->sdp_generation = generation;
+  g_mutex_unlock (&priv->lock);
+}
+
+/* get the running time of the first buffer we push into the RTP appsrc,
+ * or GST_CLOCK_TIME_NONE when it was already pushed */
+static GstClockTime
+get_first_buffer_time (GstRTSPStream * stream, GstElement * element)
+{
+  GstRTSPStreamPrivate *priv = stream->priv;
+  GstClockTime res = GST_CLOCK_TIME_NONE;
+
+  if (priv->appsrc_base_time[0] != -1)
+    return res;
+
+  /* Take current running_time. This timestamp will be put on
+   * the first buffer of each stream because we are a live source and so we
+   * timestamp with the running_time. When we are dealing with TCP, we also
+   * only timestamp the first buffer (using the DISCONT flag) because a server
+   * typically bursts data, for which we don't want to compensate by speeding
+   * up the media. The other timestamps will be interpollated from this one
+   * using the RTP timestamps. */
+  GST_OBJECT_LOCK (element);
+  if (GST_ELEMENT_CLOCK (element)) {
+    GstClockTime now;
+    GstClockTime base_time;
+
+    now = gst_clock_get_time (GST_ELEMENT_CLOCK (element));
+    base_time = GST_ELEMENT_CAST (element)->base_time;
+
+    priv->appsrc_base_time[0] = now - base_time;
+    res = priv->appsrc_base_time[0];
+    GST_DEBUG ("stream %p: first buffer at time %" GST_TIME_FORMAT
+        ", base %" GST_TIME_FORMAT, stream, GST_TIME_ARGS (now),
+        GST_TIME_ARGS (base_time));
+  }
+  GST_OBJECT_UNLOCK (element);
+
+  return res;
+}
+
 /**
  * gst_rtsp_stream_recv_rtp:
  * @stream: a #GstRTSPStream
@@ -3181,30 +4883,10 @@ gst_rtsp_stream_recv_rtp (GstRTSPStream * stream, GstBuffer * buffer)
   g_mutex_unlock (&priv->lock);
 
   if (element) {
-    if (priv->appsrc_base_time[0] == -1) {
-      /* Take current running_time. This timestamp will be put on
-       * the first buffer of each stream because we are a live source and so we
-       * timestamp with the running_time. When we are dealing with TCP, we also
-       * only timestamp the first buffer (using the DISCONT flag) because a server
-       * typically bursts data, for which we don't want to compensate by speeding
-       * up the media. The other timestamps will be interpollated from this one
-       * using the RTP timestamps. */
-      GST_OBJECT_LOCK (element);
-      if (GST_ELEMENT_CLOCK (element)) {
-        GstClockTime now;
-        GstClockTime base_time;
-
-        now = gst_clock_get_time (GST_ELEMENT_CLOCK (element));
-        base_time = GST_ELEMENT_CAST (element)->base_time;
+    GstClockTime time = get_first_buffer_time (stream, element);
 
-        priv->appsrc_base_time[0] = now - base_time;
-        GST_BUFFER_TIMESTAMP (buffer) = priv->appsrc_base_time[0];
-        GST_DEBUG ("stream %p: first buffer at time %" GST_TIME_FORMAT
-            ", base %" GST_TIME_FORMAT, stream, GST_TIME_ARGS (now),
-            GST_TIME_ARGS (base_time));
-      }
-      GST_OBJECT_UNLOCK (element);
-    }
+    if (GST_CLOCK_TIME_IS_VALID (time))
+      GST_BUFFER_TIMESTAMP (buffer) = time;
 
     ret = gst_app_src_push_buffer (GST_APP_SRC_CAST (element), buffer);
     gst_object_unref (element);
@@ -3214,6 +4896,87 @@ gst_rtsp_stream_recv_rtp (GstRTSPStream * stream, GstBuffer * buffer)
   return ret;
 }
 
+/**
+ * gst_rtsp_stream_recv_rtp_list:
+ * @stream: a #GstRTSPStream
+ * @buffer_list: (transfer full): a #GstBufferList
+ *
+ * Handle a list of RTP buffers for the stream. This is the same as calling
+ * gst_rtsp_stream_recv_rtp() for each buffer in @buffer_list but the buffers
+ * are pushed into the pipeline in one go.
+ *
+ * This function takes ownership of @buffer_list.
+ *
+ * Returns: a GstFlowReturn.
+ *
+ * Since: 1.14
+ */
+GstFlowReturn
+gst_rtsp_stream_recv_rtp_list (GstRTSPStream * stream,
+    GstBufferList * buffer_list)
+{
+  GstRTSPStreamPrivate *priv;
+  GstFlowReturn ret;
+  GstElement *element;
+  GstClockTime time;
+
+  g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), GST_FLOW_ERROR);
+  priv = stream->priv;
+  g_return_val_if_fail (GST_IS_BUFFER_LIST (buffer_list), GST_FLOW_ERROR);
+
+  if (priv->joined_bin == NULL) {
+    gst_buffer_list_unref (buffer_list);
+    return GST_FLOW_NOT_LINKED;
+  }
+
+  /* taken once for the whole list, the appsrc is released in leave_bin so it
+   * can't be used without a ref */
+  g_mutex_lock (&priv->lock);
+  if (priv->appsrc[0])
+    element = gst_object_ref (priv->appsrc[0]);
+  else
+    element = NULL;
+  g_mutex_unlock (&priv->lock);
+
+  if (element == NULL || gst_buffer_list_length (buffer_list) == 0) {
+    gst_buffer_list_unref (buffer_list);
+    ret = GST_FLOW_OK;
+    goto done;
+  }
+
+  time = get_first_buffer_time (stream, element);
+  if (GST_CLOCK_TIME_IS_VALID (time)) {
+    GstBuffer *buffer;
+
+    buffer_list = gst_buffer_list_make_writable (buffer_list);
+    buffer = gst_buffer_ref (gst_buffer_list_get (buffer_list, 0));
+    gst_buffer_list_remove (buffer_list, 0, 1);
+    buffer = gst_buffer_make_writable (buffer);
+    GST_BUFFER_TIMESTAMP (buffer) = time;
+    gst_buffer_list_insert (buffer_list, 0, buffer);
+  }
+
+#if GST_CHECK_VERSION(1,13,1)
+  ret = gst_app_src_push_buffer_list (GST_APP_SRC_CAST (element), buffer_list);
+#else
+  {
+    guint i, len = gst_buffer_list_length (buffer_list);
+
+    ret = GST_FLOW_OK;
+    for (i = 0; i < len && ret == GST_FLOW_OK; i++)
+      ret = gst_app_src_push_buffer (GST_APP_SRC_CAST (element),
+          gst_buffer_ref (gst_buffer_list_get (buffer_list, i)));
+    gst_buffer_list_unref (buffer_list);
+  }
+#endif
+
+done:
+  if (element)
+    gst_object_unref (element);
+
+  return ret;
+}
+
 /**
  * gst_rtsp_stream_recv_rtcp:
  * @stream: a #GstRTSPStream
@@ -3283,16 +5046,79 @@ gst_rtsp_stream_recv_rtcp (GstRTSPStream * stream, GstBuffer * buffer)
   return ret;
 }
 
-/* must be called with lock */
+/* must be called with lock. Add or remove a unicast destination to the
+ * sender for RTP (@idx 0) or RTCP (@idx 1). Returns FALSE when the udpsink
+ * needs to handle the destination instead. When adding, @last_seqnum is set
+ * to the last RTP packet the sender sent before, if not %NULL. */
+static gboolean
+update_udp_sender (GstRTSPStream * stream, gint idx, const gchar * dest,
+    gint port, gboolean add, gint * last_seqnum)
+{
+  GstRTSPStreamPrivate *priv = stream->priv;
+  GInetAddress *addr;
+  GSocket *socket = NULL;
+  gboolean res;
+
+  if (priv->udp_sender[idx] == NULL || dest == NULL)
+    return FALSE;
+
+  /* host names are resolved by the udpsink */
+  addr = g_inet_address_new_from_string (dest);
+  if (addr == NULL)
+    return FALSE;
+
+  if (add) {
+    /* send from the same socket as the udpsink so that the client sees the
+     * server port it was told about */
+    if (g_inet_address_get_family (addr) == G_SOCKET_FAMILY_IPV6)
+      g_object_get (priv->udpsink[idx], "socket-v6", &socket, NULL);
+    else
+      g_object_get (priv->udpsink[idx], "socket", &socket, NULL);
+
+    res = socket != NULL &&
+        gst_rtsp_udp_sender_add (priv->udp_sender[idx], socket, addr, port,
+        last_seqnum);
+
+    if (socket)
+      g_object_unref (socket);
+  } else {
+    res = gst_rtsp_udp_sender_remove (priv->udp_sender[idx], addr, port);
+  }
+  g_object_unref (addr);
+
+  return res;
+}
+
+/* must be called with lock. When adding, the cached packets for a UDP
+ * transport are collected in @burst, they must be sent after releasing the
+ * lock. */
 static gboolean
 update_transport (GstRTSPStream * stream, GstRTSPStreamTransport * trans,
-    gboolean add)
+    gboolean add, GopBurst * burst)
 {
   GstRTSPStreamPrivate *priv = stream->priv;
   const GstRTSPTransport *tr;
+  gboolean do_burst;
+  GList *reserved = NULL, *packets = NULL;
 
   tr = gst_rtsp_stream_transport_get_transport (trans);
 
+  /* the fan-out threads skip the removed transports that are still in the
+   * packets they have queued */
+  gst_rtsp_stream_transport_set_removed (trans, !add);
+
+  /* the cache must not change until the new transport is in the snapshot, so
+   * that it doesn't miss any packets */
+  do_burst = add && burst != NULL && priv->gop_probe_id != 0;
+  if (add)
+    reserved = gst_rtsp_stream_transport_take_reserved_burst (trans);
+  else
+    gst_rtsp_stream_transport_clear_burst_rtpinfo (trans);
+  if (do_burst) {
+    g_mutex_lock (&priv->gop_lock);
+    packets = get_gop_burst_packets (priv, reserved);
+  }
+
   switch (tr->lower_transport) {
     case GST_RTSP_LOWER_TRANS_UDP_MCAST:
     {
@@ -3327,47 +5153,76 @@ update_transport (GstRTSPStream * stream, GstRTSPStreamTransport * trans,
       }
 
       if (add) {
+        gint last_seqnum = -1;
+
         if (ttl > 0) {
           GST_INFO ("setting ttl-mc %d", ttl);
           g_object_set (G_OBJECT (priv->udpsink[0]), "ttl-mc", ttl, NULL);
           g_object_set (G_OBJECT (priv->udpsink[1]), "ttl-mc", ttl, NULL);
         }
         GST_INFO ("adding %s:%d-%d", dest, min, max);
-        g_signal_emit_by_name (priv->udpsink[0], "add", dest, min, NULL);
-        g_signal_emit_by_name (priv->udpsink[1], "add", dest, max, NULL);
+        /* the cached packets after the last one that was sent before the
+         * destination is added reach it through the live flow. The udpsink
+         * can still be rendering its last packet, which is then sent twice
+         * at worst. */
+        if (do_burst && priv->udp_sender[0] == NULL)
+          last_seqnum = get_last_rendered_seqnum (priv->udpsink[0]);
+        if (!update_udp_sender (stream, 0, dest, min, TRUE,
+                do_burst ? &last_seqnum : NULL))
+          g_signal_emit_by_name (priv->udpsink[0], "add", dest, min, NULL);
+        if (!update_udp_sender (stream, 1, dest, max, TRUE, NULL))
+          g_signal_emit_by_name (priv->udpsink[1], "add", dest, max, NULL);
+        if (do_burst)
+          collect_gop_burst_udp (stream, trans, dest, min, last_seqnum,
+              packets, reserved != NULL, burst);
         priv->transports = g_list_prepend (priv->transports, trans);
       } else {
         GST_INFO ("removing %s:%d-%d", dest, min, max);
-        g_signal_emit_by_name (priv->udpsink[0], "remove", dest, min, NULL);
-        g_signal_emit_by_name (priv->udpsink[1], "remove", dest, max, NULL);
+        if (!update_udp_sender (stream, 0, dest, min, FALSE, NULL))
+          g_signal_emit_by_name (priv->udpsink[0], "remove", dest, min, NULL);
+        if (!update_udp_sender (stream, 1, dest, max, FALSE, NULL))
+          g_signal_emit_by_name (priv->udpsink[1], "remove", dest, max, NULL);
         priv->transports = g_list_remove (priv->transports, trans);
       }
-      priv->transports_cookie++;
       break;
     }
     case GST_RTSP_LOWER_TRANS_TCP:
       if (add) {
         GST_INFO ("adding TCP %s", tr->destination);
+        start_fanout_workers (stream);
+        if (do_burst)
+          queue_gop_burst_tcp (stream, trans, packets, reserved != NULL);
         priv->transports = g_list_prepend (priv->transports, trans);
       } else {
         GST_INFO ("removing TCP %s", tr->destination);
         priv->transports = g_list_remove (priv->transports, trans);
       }
-      priv->transports_cookie++;
       break;
     default:
       goto unknown_transport;
   }
+  update_transport_index (priv, trans, tr, add);
+  publish_transports (priv);
+  if (do_burst)
+    g_mutex_unlock (&priv->gop_lock);
+  free_gop_burst_packets (reserved, packets);
+
   return TRUE;
 
   /* ERRORS */
 unknown_transport:
   {
     GST_INFO ("Unknown transport %d", tr->lower_transport);
+    if (do_burst)
+      g_mutex_unlock (&priv->gop_lock);
+    free_gop_burst_packets (reserved, packets);
     return FALSE;
   }
 mcast_error:
   {
+    if (do_burst)
+      g_mutex_unlock (&priv->gop_lock);
+    free_gop_burst_packets (reserved, packets);
     return FALSE;
   }
 }
@@ -3392,6 +5247,7 @@ gst_rtsp_stream_add_transport (GstRTSPStream * stream,
     GstRTSPStreamTransport * trans)
 {
   GstRTSPStreamPrivate *priv;
+  GopBurst burst = { NULL, };
   gboolean res;
 
   g_return_val_if_fail (GST_IS_RTSP_STREAM (stream), FALSE);
@@ -3400,9 +5256,16 @@ gst_rtsp_stream_add_transport (GstRTSPStream * stream,
   g_return_val_if_fail (priv->joined_bin != NULL, FALSE);
 
   g_mutex_lock (&priv->lock);
-  res = update_transport (stream, trans, TRUE);
+  res = update_transport (stream, trans, TRUE, &burst);
   g_mutex_unlock (&priv->lock);
 
+  if (res) {
+    send_gop_burst (&burst);
+    /* start sending the cached packets that were queued for a TCP
+     * transport, the rest is sent when the receiver has room */
+    gst_rtsp_stream_transport_flush_send_queue (trans);
+  }
+
   return res;
 }
 
@@ -3433,7 +5296,7 @@ gst_rtsp_stream_remove_transport (GstRTSPStream * stream,
   g_return_val_if_fail (priv->joined_bin != NULL, FALSE);
 
   g_mutex_lock (&priv->lock);
-  res = update_transport (stream, trans, FALSE);
+  res = update_transport (stream, trans, FALSE, NULL);
   g_mutex_unlock (&priv->lock);
 
   return res;
@@ -3471,6 +5334,7 @@ gst_rtsp_stream_update_crypto (GstRTSPStream * stream,
         gst_caps_ref (crypto));
   else
     g_hash_table_remove (priv->keys, GINT_TO_POINTER (ssrc));
+  invalidate_sdp (priv);
   g_mutex_unlock (&priv->lock);
 
   return TRUE;
@@ -3656,7 +5520,7 @@ restart:
 
     switch (res) {
       case GST_RTSP_FILTER_REMOVE:
-        update_transport (stream, trans, FALSE);
+        update_transport (stream, trans, FALSE, NULL);
         break;
       case GST_RTSP_FILTER_REF:
         result = g_list_prepend (result, g_object_ref (trans));
@@ -40,6 +40,27 @@ typedef struct _GstRTSPStream GstRTSPStream;
 typedef struct _GstRTSPStreamClass GstRTSPStreamClass;
 typedef struct _GstRTSPStreamPrivate GstRTSPStreamPrivate;
 
+/**
+ * GstRTSPFanoutPartition:
+ * @GST_RTSP_FANOUT_PARTITION_HASH: spread the transports by a hash of the
+ *     transport, this needs no state but can leave some threads with more
+ *     transports than others
+ * @GST_RTSP_FANOUT_PARTITION_BALANCED: give each new transport to the thread
+ *     with the least transports
+ *
+ * How the transports of a stream are spread over its fan-out threads.
+ *
+ * Since: 1.14
+ */
+typedef enum {
+  GST_RTSP_FANOUT_PARTITION_HASH,
+  GST_RTSP_FANOUT_PARTITION_BALANCED
+} GstRTSPFanoutPartition;
+
+#define GST_TYPE_RTSP_FANOUT_PARTITION (gst_rtsp_fanout_partition_get_type())
+GST_EXPORT
+GType gst_rtsp_fanout_partition_get_type (void);
+
 #include "rtsp-stream-transport.h"
 #include "rtsp-address-pool.h"
 #include "rtsp-session.h"
@@ -199,6 +220,10 @@ GST_EXPORT
 GstFlowReturn     gst_rtsp_stream_recv_rtp         (GstRTSPStream *stream,
                                                     GstBuffer *buffer);
 
+GST_EXPORT
+GstFlowReturn     gst_rtsp_stream_recv_rtp_list    (GstRTSPStream *stream,
+                                                    GstBufferList *buffer_list);
+
 GST_EXPORT
 GstFlowReturn     gst_rtsp_stream_recv_rtcp        (GstRTSPStream *stream,
                                                     GstBuffer *buffer);
@@ -272,6 +297,55 @@ void                    gst_rtsp_stream_set_publish_clock_mode (GstRTSPStream *
 GST_EXPORT
 GstRTSPPublishClockMode gst_rtsp_stream_get_publish_clock_mode (GstRTSPStream * stream);
 
+GST_EXPORT
+void              gst_rtsp_stream_set_udp_fanout             (GstRTSPStream * stream, gboolean fanout);
+
+GST_EXPORT
+gboolean          gst_rtsp_stream_get_udp_fanout             (GstRTSPStream * stream);
+
+GST_EXPORT
+void              gst_rtsp_stream_set_pacing                 (GstRTSPStream * stream, gboolean pacing);
+
+GST_EXPORT
+gboolean          gst_rtsp_stream_get_pacing                 (GstRTSPStream * stream);
+
+GST_EXPORT
+void              gst_rtsp_stream_set_fanout_threads         (GstRTSPStream * stream, guint n_threads);
+
+GST_EXPORT
+guint             gst_rtsp_stream_get_fanout_threads         (GstRTSPStream * stream);
+
+GST_EXPORT
+void              gst_rtsp_stream_set_fanout_queue_size      (GstRTSPStream * stream, guint size);
+
+GST_EXPORT
+guint             gst_rtsp_stream_get_fanout_queue_size      (GstRTSPStream * stream);
+
+GST_EXPORT
+void              gst_rtsp_stream_set_fanout_partition       (GstRTSPStream * stream,
+                                                              GstRTSPFanoutPartition partition);
+
+GST_EXPORT
+GstRTSPFanoutPartition gst_rtsp_stream_get_fanout_partition  (GstRTSPStream * stream);
+
+GST_EXPORT
+GstStructure *    gst_rtsp_stream_get_fanout_stats           (GstRTSPStream * stream);
+
+GST_EXPORT
+void              gst_rtsp_stream_set_gop_cache_size         (GstRTSPStream * stream, guint size);
+
+GST_EXPORT
+guint             gst_rtsp_stream_get_gop_cache_size         (GstRTSPStream * stream);
+
+GST_EXPORT
+void              gst_rtsp_stream_set_recv_batch_size        (GstRTSPStream * stream, guint size);
+
+GST_EXPORT
+guint             gst_rtsp_stream_get_recv_batch_size        (GstRTSPStream * stream);
+
+GST_EXPORT
+GstStructure *    gst_rtsp_stream_get_recv_stats             (GstRTSPStream * stream);
+
 /**
  * GstRTSPStreamTransportFilterFunc:
  * @stream: a #GstRTSPStream object
@@ -30,12 +30,28 @@
  * same thread for multiple clients.
  *
  * Threads of type #GST_RTSP_THREAD_TYPE_MEDIA will be used to perform the state
- * changes of the media pipelines and handle its bus messages.
+ * changes of the media pipelines and handle its bus messages. By default each
+ * media gets its own thread. With gst_rtsp_thread_pool_set_max_media_threads()
+ * the media are spread over a fixed number of threads instead.
  *
  * gst_rtsp_thread_pool_get_thread() can be used to create a #GstRTSPThread
  * object of the right type. The thread object contains a mainloop and context
  * that run in a seperate thread and can be used to attached sources to.
  *
+ * When the maximum number of client threads is reached, new clients are given
+ * to the least loaded thread. The load of a thread is the fraction of time its
+ * mainloop spends dispatching, see gst_rtsp_thread_get_load(). Threads with a
+ * similar load are balanced by the number of users of the thread.
+ * gst_rtsp_thread_pool_get_client_threads() gives the current client threads.
+ *
+ * The threads of each type can be bound to a set of CPUs with
+ * gst_rtsp_thread_pool_set_cpus(). With
+ * gst_rtsp_thread_pool_set_colocate_media() the media thread made for a client
+ * request is bound to the CPUs of the NUMA node the client thread runs on, so
+ * that the media and the client that plays it share the memory of that node.
+ * The streaming threads of the pipeline of a media are bound to the CPUs of
+ * its media thread while they run.
+ *
  * gst_rtsp_thread_reuse() can be used to reuse a thread for multiple purposes.
  * If all gst_rtsp_thread_reuse() calls are matched with a
  * gst_rtsp_thread_stop() call, the mainloop will be quit and the thread will
@@ -47,9 +63,41 @@
  * Last reviewed on 2013-07-11 (1.0.0)
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             /* for sched_setaffinity() */
+#endif
+
 #include <string.h>
 
 #include "rtsp-thread-pool.h"
+#include "rtsp-server-internal.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <sched.h>
+#endif
+
+enum
+{
+  SIGNAL_THREAD_STATS,
+  SIGNAL_LAST
+};
+
+static guint gst_rtsp_thread_pool_signals[SIGNAL_LAST] = { 0 };
+
+static GQuark thread_pool;
+
+typedef struct
+{
+  guint64 iterations;
+  guint64 dispatches;
+  /* time between the sources becoming ready and a dispatch */
+  gint64 latency_total;
+  gint64 latency_max;
+  /* time spent outside of poll, in total and for each source type */
+  gint64 busy_total;
+  gint64 busy[GST_RTSP_THREAD_SOURCE_LAST];
+} ThreadStats;
 
 typedef struct _GstRTSPThreadImpl
 {
@@ -59,8 +107,46 @@ typedef struct _GstRTSPThreadImpl
   GSource *source;
   /* FIXME, the source has to be part of GstRTSPThreadImpl, due to a bug in GLib:
    * https://bugzilla.gnome.org/show_bug.cgi?id=720186 */
+
+  /* load accounting, updated by the thread running the mainloop with
+   * stats_lock. load is the permille of time spent outside of poll at
+   * window_start, gst_rtsp_thread_get_load() decays it to the current time */
+  gint64 wakeup;
+  /* the time since which the dispatched sources are ready at the latest */
+  gint64 ready;
+  gint64 window_start;
+  gint64 busy;
+  gboolean polling;
+  gint load;
+
+  /* the cpu_set_t the thread is bound to or %NULL */
+  gpointer affinity;
+
+  /* statistics, updated by the thread running the mainloop and published
+   * in stats at the end of each load window */
+  ThreadStats acc;
+  GMutex stats_lock;
+  ThreadStats stats;
 } GstRTSPThreadImpl;
 
+/* the time over which the load of a thread is measured */
+#define LOAD_WINDOW     (G_USEC_PER_SEC)
+/* threads with less than this difference in load are compared by users */
+#define LOAD_SIMILAR    50
+
+#ifdef CPU_SET
+#define MAX_CPUS        CPU_SETSIZE
+#else
+#define MAX_CPUS        1024
+#endif
+
+/* the thread running the current mainloop */
+static GPrivate current_thread;
+
+/* the CPUs of a streaming thread before it was bound to those of a media
+ * thread */
+static GPrivate saved_affinity = G_PRIVATE_INIT (g_free);
+
 GST_DEFINE_MINI_OBJECT_TYPE (GstRTSPThread, gst_rtsp_thread);
 
 static void gst_rtsp_thread_init (GstRTSPThreadImpl * impl);
@@ -71,6 +157,8 @@ _gst_rtsp_thread_free (GstRTSPThreadImpl * impl)
   GST_DEBUG ("free thread %p", impl);
 
   g_source_unref (impl->source);
+  g_free (impl->affinity);
+  g_mutex_clear (&impl->stats_lock);
   g_main_loop_unref (impl->thread.loop);
   g_main_context_unref (impl->thread.context);
   g_slice_free1 (sizeof (GstRTSPThreadImpl), impl);
@@ -100,6 +188,7 @@ gst_rtsp_thread_init (GstRTSPThreadImpl * impl)
       (GstMiniObjectFreeFunction) _gst_rtsp_thread_free);
 
   g_atomic_int_set (&impl->reused, 1);
+  g_mutex_init (&impl->stats_lock);
 }
 
 /**
@@ -184,6 +273,338 @@ gst_rtsp_thread_stop (GstRTSPThread * thread)
     gst_rtsp_thread_unref (thread);
 }
 
+static GstStructure *thread_get_stats (GstRTSPThread * thread);
+
+/* the load after @elapsed microseconds of which @busy were spent outside of
+ * poll, averaged with the previous @load once for every window */
+static gint
+decay_load (gint load, gint64 busy, gint64 elapsed)
+{
+  gint n, cur;
+
+  n = MIN (elapsed / LOAD_WINDOW, 30);
+  cur = MIN (busy * 1000 / elapsed, 1000);
+
+  return cur + (load - cur) / (1 << n);
+}
+
+/**
+ * gst_rtsp_thread_get_load:
+ * @thread: a #GstRTSPThread
+ *
+ * Get the load of the mainloop of @thread, measured as the fraction of time
+ * it spends dispatching instead of waiting for events. The load is averaged
+ * over the last seconds and only measured for threads made by a
+ * #GstRTSPThreadPool. The load of a thread that waits for events decays
+ * without waking up the thread.
+ *
+ * Returns: the load of @thread in permille.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_thread_get_load (GstRTSPThread * thread)
+{
+  GstRTSPThreadImpl *impl = (GstRTSPThreadImpl *) thread;
+  gint64 now, elapsed, busy;
+  gint load;
+
+  g_return_val_if_fail (GST_IS_RTSP_THREAD (thread), 0);
+
+  g_mutex_lock (&impl->stats_lock);
+  load = impl->load;
+  if (impl->window_start != 0) {
+    /* the thread updates the load when it wakes up, account the windows
+     * that passed since then */
+    now = g_get_monotonic_time ();
+    elapsed = now - impl->window_start;
+    if (elapsed >= LOAD_WINDOW) {
+      busy = impl->busy;
+      if (!impl->polling)
+        busy += now - impl->wakeup;
+      load = decay_load (load, busy, elapsed);
+    }
+  }
+  g_mutex_unlock (&impl->stats_lock);
+
+  return load;
+}
+
+/**
+ * gst_rtsp_thread_get_n_users:
+ * @thread: a #GstRTSPThread
+ *
+ * Get the number of users of the mainloop of @thread, this is the number of
+ * gst_rtsp_thread_reuse() calls that are not matched by a
+ * gst_rtsp_thread_stop() yet, plus one for the first user.
+ *
+ * Returns: the number of users of @thread.
+ *
+ * Since: 1.14
+ */
+guint
+gst_rtsp_thread_get_n_users (GstRTSPThread * thread)
+{
+  GstRTSPThreadImpl *impl = (GstRTSPThreadImpl *) thread;
+
+  g_return_val_if_fail (GST_IS_RTSP_THREAD (thread), 0);
+
+  return MAX (g_atomic_int_get (&impl->reused), 0);
+}
+
+/* account the time since the last wakeup as busy and update the load when
+ * the window is complete, with stats_lock. Returns %TRUE when new statistics
+ * were published */
+static gboolean
+update_load (GstRTSPThreadImpl * impl, gint64 now)
+{
+  gint64 elapsed;
+
+  impl->busy += now - impl->wakeup;
+  impl->acc.busy_total += now - impl->wakeup;
+
+  elapsed = now - impl->window_start;
+  if (elapsed >= LOAD_WINDOW) {
+    impl->load = decay_load (impl->load, impl->busy, elapsed);
+    impl->window_start = now;
+    impl->busy = 0;
+    impl->stats = impl->acc;
+
+    GST_LOG ("thread %p: load %d, %" G_GUINT64_FORMAT " iterations, %"
+        G_GUINT64_FORMAT " dispatches, max latency %" G_GINT64_FORMAT " us",
+        impl, impl->load, impl->acc.iterations, impl->acc.dispatches,
+        impl->acc.latency_max);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* let the pool of @impl know about the published statistics */
+static void
+emit_thread_stats (GstRTSPThreadImpl * impl)
+{
+  GstRTSPThread *thread = (GstRTSPThread *) impl;
+  GstRTSPThreadPool *pool;
+  GstStructure *stats;
+
+  pool = gst_mini_object_get_qdata (GST_MINI_OBJECT (thread), thread_pool);
+  if (pool == NULL)
+    return;
+
+  stats = thread_get_stats (thread);
+  g_signal_emit (pool, gst_rtsp_thread_pool_signals[SIGNAL_THREAD_STATS], 0,
+      thread, stats);
+  gst_structure_free (stats);
+}
+
+static gint
+thread_poll (GPollFD * ufds, guint nfds, gint timeout)
+{
+  GstRTSPThreadImpl *impl = g_private_get (&current_thread);
+  gboolean published, waited = FALSE;
+  gint64 now;
+  gint res;
+
+  if (impl == NULL)
+    return g_poll (ufds, nfds, timeout);
+
+  g_mutex_lock (&impl->stats_lock);
+  published = update_load (impl, g_get_monotonic_time ());
+  impl->polling = TRUE;
+  g_mutex_unlock (&impl->stats_lock);
+
+  if (published)
+    emit_thread_stats (impl);
+
+  /* sources that are ready without waiting became ready while the mainloop
+   * was busy, their latency is measured from the previous wakeup */
+  res = g_poll (ufds, nfds, 0);
+  if (res == 0 && timeout != 0) {
+    res = g_poll (ufds, nfds, timeout);
+    waited = TRUE;
+  }
+
+  g_mutex_lock (&impl->stats_lock);
+  now = g_get_monotonic_time ();
+  impl->ready = waited ? now : impl->wakeup;
+  impl->wakeup = now;
+  impl->polling = FALSE;
+  impl->acc.iterations++;
+  g_mutex_unlock (&impl->stats_lock);
+
+  return res;
+}
+
+/* called when a source of the library is dispatched, returns the start time
+ * to pass to gst_rtsp_thread_dispatch_end() */
+gint64
+gst_rtsp_thread_dispatch_begin (void)
+{
+  GstRTSPThreadImpl *impl = g_private_get (&current_thread);
+  gint64 now, latency;
+
+  if (impl == NULL)
+    return 0;
+
+  now = g_get_monotonic_time ();
+  latency = now - impl->ready;
+
+  impl->acc.dispatches++;
+  impl->acc.latency_total += latency;
+  impl->acc.latency_max = MAX (impl->acc.latency_max, latency);
+
+  return now;
+}
+
+void
+gst_rtsp_thread_dispatch_end (GstRTSPThreadSource source, gint64 begin)
+{
+  GstRTSPThreadImpl *impl = g_private_get (&current_thread);
+
+  if (impl == NULL || begin == 0)
+    return;
+
+  impl->acc.busy[source] += g_get_monotonic_time () - begin;
+}
+
+/* check if @thread is bound to a set of CPUs */
+gboolean
+gst_rtsp_thread_is_bound (GstRTSPThread * thread)
+{
+  g_return_val_if_fail (GST_IS_RTSP_THREAD (thread), FALSE);
+
+  return ((GstRTSPThreadImpl *) thread)->affinity != NULL;
+}
+
+/* bind the calling thread, a streaming thread of a pipeline, to the CPUs of
+ * @thread until gst_rtsp_thread_unbind_current() */
+void
+gst_rtsp_thread_bind_current (GstRTSPThread * thread)
+{
+#ifdef CPU_SET
+  GstRTSPThreadImpl *impl = (GstRTSPThreadImpl *) thread;
+
+  g_return_if_fail (GST_IS_RTSP_THREAD (thread));
+
+  if (impl->affinity == NULL)
+    return;
+
+  /* the streaming threads come from a pool and run other tasks later */
+  if (g_private_get (&saved_affinity) == NULL) {
+    cpu_set_t *saved = g_new (cpu_set_t, 1);
+
+    if (sched_getaffinity (0, sizeof (cpu_set_t), saved) < 0) {
+      g_free (saved);
+      return;
+    }
+    g_private_set (&saved_affinity, saved);
+  }
+
+  if (sched_setaffinity (0, sizeof (cpu_set_t), impl->affinity) < 0)
+    GST_WARNING ("failed to bind streaming thread to the CPUs of %p: %s",
+        thread, g_strerror (errno));
+#endif
+}
+
+/* restore the CPUs of the calling thread after
+ * gst_rtsp_thread_bind_current() */
+void
+gst_rtsp_thread_unbind_current (void)
+{
+#ifdef CPU_SET
+  cpu_set_t *saved = g_private_get (&saved_affinity);
+
+  if (saved == NULL)
+    return;
+
+  sched_setaffinity (0, sizeof (cpu_set_t), saved);
+  g_private_replace (&saved_affinity, NULL);
+#endif
+}
+
+static GstStructure *
+thread_get_stats (GstRTSPThread * thread)
+{
+  GstRTSPThreadImpl *impl = (GstRTSPThreadImpl *) thread;
+  ThreadStats stats;
+  gint64 other;
+  gint i;
+
+  g_mutex_lock (&impl->stats_lock);
+  stats = impl->stats;
+  g_mutex_unlock (&impl->stats_lock);
+
+  other = stats.busy_total;
+  for (i = 0; i < GST_RTSP_THREAD_SOURCE_LAST; i++)
+    other -= stats.busy[i];
+
+  return gst_structure_new ("application/x-rtsp-thread-stats",
+      "type", G_TYPE_STRING,
+      thread->type == GST_RTSP_THREAD_TYPE_MEDIA ? "media" : "client",
+      "load", G_TYPE_UINT, gst_rtsp_thread_get_load (thread),
+      "users", G_TYPE_UINT, gst_rtsp_thread_get_n_users (thread),
+      "iterations", G_TYPE_UINT64, stats.iterations,
+      "dispatches", G_TYPE_UINT64, stats.dispatches,
+      "latency-avg", G_TYPE_UINT64, stats.dispatches ?
+      (guint64) (stats.latency_total / stats.dispatches) * GST_USECOND : 0,
+      "latency-max", G_TYPE_UINT64,
+      (guint64) stats.latency_max * GST_USECOND,
+      "busy", G_TYPE_UINT64, (guint64) stats.busy_total * GST_USECOND,
+      "busy-client", G_TYPE_UINT64,
+      (guint64) stats.busy[GST_RTSP_THREAD_SOURCE_CLIENT] * GST_USECOND,
+      "busy-session-pool", G_TYPE_UINT64,
+      (guint64) stats.busy[GST_RTSP_THREAD_SOURCE_SESSION_POOL] * GST_USECOND,
+      "busy-media", G_TYPE_UINT64,
+      (guint64) stats.busy[GST_RTSP_THREAD_SOURCE_MEDIA] * GST_USECOND,
+      "busy-other", G_TYPE_UINT64, (guint64) MAX (other, 0) * GST_USECOND,
+      NULL);
+}
+
+/**
+ * gst_rtsp_thread_get_stats:
+ * @thread: a #GstRTSPThread
+ *
+ * Get the statistics of the mainloop of @thread. The statistics are updated
+ * at most once per second when the mainloop wakes up and only measured for
+ * threads made by a #GstRTSPThreadPool, which emits
+ * #GstRTSPThreadPool::thread-stats after every update.
+ *
+ * The "application/x-rtsp-thread-stats" structure contains:
+ *
+ * "type" G_TYPE_STRING: "client" or "media"
+ *
+ * "load" G_TYPE_UINT: see gst_rtsp_thread_get_load()
+ *
+ * "users" G_TYPE_UINT: see gst_rtsp_thread_get_n_users()
+ *
+ * "iterations" G_TYPE_UINT64: the number of mainloop iterations
+ *
+ * "dispatches" G_TYPE_UINT64: the number of measured dispatches of client
+ * watches, session pool sources and media bus watches
+ *
+ * "latency-avg" G_TYPE_UINT64, "latency-max" G_TYPE_UINT64: the average and
+ * maximum time in nanoseconds between the sources becoming ready and a
+ * measured dispatch. Sources that became ready while the mainloop was busy
+ * are measured from the end of the previous poll, the others from the
+ * wakeup of the mainloop
+ *
+ * "busy" G_TYPE_UINT64: the time in nanoseconds the mainloop spent outside of
+ * poll, split into "busy-client", "busy-session-pool", "busy-media" and
+ * "busy-other" G_TYPE_UINT64
+ *
+ * Returns: (transfer full): a #GstStructure with the statistics of @thread.
+ * gst_structure_free() after usage.
+ *
+ * Since: 1.14
+ */
+GstStructure *
+gst_rtsp_thread_get_stats (GstRTSPThread * thread)
+{
+  g_return_val_if_fail (GST_IS_RTSP_THREAD (thread), NULL);
+
+  return thread_get_stats (thread);
+}
+
 #define GST_RTSP_THREAD_POOL_GET_PRIVATE(obj)  \
    (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GST_TYPE_RTSP_THREAD_POOL, GstRTSPThreadPoolPrivate))
 
@@ -194,22 +615,35 @@ struct _GstRTSPThreadPoolPrivate
   gint max_threads;
   /* currently used mainloops */
   GQueue threads;
+
+  gint max_media_threads;
+  /* currently used media mainloops */
+  GQueue media_threads;
+
+  /* the CPUs for each thread type, %NULL for any CPU */
+  gchar *cpus[2];
+  gboolean colocate_media;
 };
 
-#define DEFAULT_MAX_THREADS 1
+#define DEFAULT_MAX_THREADS     1
+#define DEFAULT_MAX_MEDIA_THREADS -1
+#define DEFAULT_CPUS            NULL
+#define DEFAULT_COLOCATE_MEDIA  FALSE
 
 enum
 {
   PROP_0,
   PROP_MAX_THREADS,
+  PROP_MAX_MEDIA_THREADS,
+  PROP_CLIENT_CPUS,
+  PROP_MEDIA_CPUS,
+  PROP_COLOCATE_MEDIA,
   PROP_LAST
 };
 
 GST_DEBUG_CATEGORY_STATIC (rtsp_thread_pool_debug);
 #define GST_CAT_DEFAULT rtsp_thread_pool_debug
 
-static GQuark thread_pool;
-
 static void gst_rtsp_thread_pool_get_property (GObject * object, guint propid,
     GValue * value, GParamSpec * pspec);
 static void gst_rtsp_thread_pool_set_property (GObject * object, guint propid,
@@ -248,6 +682,80 @@ gst_rtsp_thread_pool_class_init (GstRTSPThreadPoolClass * klass)
           "(0 = only mainloop, -1 = unlimited)", -1, G_MAXINT,
           DEFAULT_MAX_THREADS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRTSPThreadPool::max-media-threads:
+   *
+   * The maximum amount of threads to use for media. When the maximum is
+   * reached, new media share the least loaded media thread. A value of -1
+   * or 0 means a new thread for each media.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_MEDIA_THREADS,
+      g_param_spec_int ("max-media-threads", "Max Media Threads",
+          "The maximum amount of threads to use for media "
+          "(-1 = a thread for each media)", -1, G_MAXINT,
+          DEFAULT_MAX_MEDIA_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRTSPThreadPool::client-cpus:
+   *
+   * The CPUs the client threads run on as a list of CPU numbers and ranges,
+   * like "0-3,8". %NULL means any CPU.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_CLIENT_CPUS,
+      g_param_spec_string ("client-cpus", "Client CPUs",
+          "The CPUs to run the client threads on (NULL = any CPU)",
+          DEFAULT_CPUS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRTSPThreadPool::media-cpus:
+   *
+   * The CPUs the media threads run on as a list of CPU numbers and ranges,
+   * like "0-3,8". %NULL means any CPU.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_MEDIA_CPUS,
+      g_param_spec_string ("media-cpus", "Media CPUs",
+          "The CPUs to run the media threads on (NULL = any CPU)",
+          DEFAULT_CPUS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRTSPThreadPool::colocate-media:
+   *
+   * Run the media thread made for a client request on the NUMA node of the
+   * client thread.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_COLOCATE_MEDIA,
+      g_param_spec_boolean ("colocate-media", "Colocate Media",
+          "Run the media thread of a client on the NUMA node of the client "
+          "thread", DEFAULT_COLOCATE_MEDIA,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRTSPThreadPool::thread-stats:
+   * @pool: a #GstRTSPThreadPool
+   * @thread: the #GstRTSPThread
+   * @stats: the statistics of @thread, see gst_rtsp_thread_get_stats()
+   *
+   * Emitted from @thread when its statistics were updated, about once per
+   * second while the mainloop of @thread is active.
+   *
+   * Since: 1.14
+   */
+  gst_rtsp_thread_pool_signals[SIGNAL_THREAD_STATS] =
+      g_signal_new ("thread-stats", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, G_STRUCT_OFFSET (GstRTSPThreadPoolClass,
+          thread_stats), NULL, NULL, g_cclosure_marshal_generic, G_TYPE_NONE,
+      2, GST_TYPE_RTSP_THREAD,
+      GST_TYPE_STRUCTURE | G_SIGNAL_TYPE_STATIC_SCOPE);
+
   klass->get_thread = default_get_thread;
 
   GST_DEBUG_CATEGORY_INIT (rtsp_thread_pool_debug, "rtspthreadpool", 0,
@@ -266,6 +774,9 @@ gst_rtsp_thread_pool_init (GstRTSPThreadPool * pool)
   g_mutex_init (&priv->lock);
   priv->max_threads = DEFAULT_MAX_THREADS;
   g_queue_init (&priv->threads);
+  priv->max_media_threads = DEFAULT_MAX_MEDIA_THREADS;
+  g_queue_init (&priv->media_threads);
+  priv->colocate_media = DEFAULT_COLOCATE_MEDIA;
 }
 
 static void
@@ -277,6 +788,9 @@ gst_rtsp_thread_pool_finalize (GObject * obj)
   GST_INFO ("finalize pool %p", pool);
 
   g_queue_clear (&priv->threads);
+  g_queue_clear (&priv->media_threads);
+  g_free (priv->cpus[GST_RTSP_THREAD_TYPE_CLIENT]);
+  g_free (priv->cpus[GST_RTSP_THREAD_TYPE_MEDIA]);
   g_mutex_clear (&priv->lock);
 
   G_OBJECT_CLASS (gst_rtsp_thread_pool_parent_class)->finalize (obj);
@@ -292,6 +806,22 @@ gst_rtsp_thread_pool_get_property (GObject * object, guint propid,
     case PROP_MAX_THREADS:
       g_value_set_int (value, gst_rtsp_thread_pool_get_max_threads (pool));
       break;
+    case PROP_MAX_MEDIA_THREADS:
+      g_value_set_int (value,
+          gst_rtsp_thread_pool_get_max_media_threads (pool));
+      break;
+    case PROP_CLIENT_CPUS:
+      g_value_take_string (value, gst_rtsp_thread_pool_get_cpus (pool,
+              GST_RTSP_THREAD_TYPE_CLIENT));
+      break;
+    case PROP_MEDIA_CPUS:
+      g_value_take_string (value, gst_rtsp_thread_pool_get_cpus (pool,
+              GST_RTSP_THREAD_TYPE_MEDIA));
+      break;
+    case PROP_COLOCATE_MEDIA:
+      g_value_set_boolean (value,
+          gst_rtsp_thread_pool_get_colocate_media (pool));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, propid, pspec);
   }
@@ -307,6 +837,22 @@ gst_rtsp_thread_pool_set_property (GObject * object, guint propid,
     case PROP_MAX_THREADS:
       gst_rtsp_thread_pool_set_max_threads (pool, g_value_get_int (value));
       break;
+    case PROP_MAX_MEDIA_THREADS:
+      gst_rtsp_thread_pool_set_max_media_threads (pool,
+          g_value_get_int (value));
+      break;
+    case PROP_CLIENT_CPUS:
+      gst_rtsp_thread_pool_set_cpus (pool, GST_RTSP_THREAD_TYPE_CLIENT,
+          g_value_get_string (value));
+      break;
+    case PROP_MEDIA_CPUS:
+      gst_rtsp_thread_pool_set_cpus (pool, GST_RTSP_THREAD_TYPE_MEDIA,
+          g_value_get_string (value));
+      break;
+    case PROP_COLOCATE_MEDIA:
+      gst_rtsp_thread_pool_set_colocate_media (pool,
+          g_value_get_boolean (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, propid, pspec);
   }
@@ -315,27 +861,61 @@ gst_rtsp_thread_pool_set_property (GObject * object, guint propid,
 static gpointer
 do_loop (GstRTSPThread * thread)
 {
+  GstRTSPThreadImpl *impl = (GstRTSPThreadImpl *) thread;
   GstRTSPThreadPoolPrivate *priv;
   GstRTSPThreadPoolClass *klass;
   GstRTSPThreadPool *pool;
+#ifdef CPU_SET
+  cpu_set_t saved;
+  gboolean restore = FALSE;
+#endif
 
   pool = gst_mini_object_get_qdata (GST_MINI_OBJECT (thread), thread_pool);
   priv = pool->priv;
 
   klass = GST_RTSP_THREAD_POOL_GET_CLASS (pool);
 
+#ifdef CPU_SET
+  if (impl->affinity) {
+    /* the thread of the GThreadPool runs other mainloops later */
+    restore = sched_getaffinity (0, sizeof (cpu_set_t), &saved) == 0;
+
+    GST_DEBUG ("bind thread %p to %d CPUs", thread,
+        CPU_COUNT ((cpu_set_t *) impl->affinity));
+    if (sched_setaffinity (0, sizeof (cpu_set_t), impl->affinity) < 0)
+      GST_WARNING ("failed to set the CPUs of thread %p: %s", thread,
+          g_strerror (errno));
+  }
+#endif
+
   if (klass->thread_enter)
     klass->thread_enter (pool, thread);
 
+  g_mutex_lock (&impl->stats_lock);
+  impl->wakeup = impl->ready = impl->window_start = g_get_monotonic_time ();
+  g_mutex_unlock (&impl->stats_lock);
+  g_private_set (&current_thread, impl);
+  g_main_context_set_poll_func (thread->context, thread_poll);
+
   GST_INFO ("enter mainloop of thread %p", thread);
   g_main_loop_run (thread->loop);
   GST_INFO ("exit mainloop of thread %p", thread);
 
+  g_private_set (&current_thread, NULL);
+
   if (klass->thread_leave)
     klass->thread_leave (pool, thread);
 
+#ifdef CPU_SET
+  if (restore)
+    sched_setaffinity (0, sizeof (cpu_set_t), &saved);
+#endif
+
   g_mutex_lock (&priv->lock);
-  g_queue_remove (&priv->threads, thread);
+  if (thread->type == GST_RTSP_THREAD_TYPE_MEDIA)
+    g_queue_remove (&priv->media_threads, thread);
+  else
+    g_queue_remove (&priv->threads, thread);
   g_mutex_unlock (&priv->lock);
 
   gst_rtsp_thread_unref (thread);
@@ -410,6 +990,242 @@ gst_rtsp_thread_pool_get_max_threads (GstRTSPThreadPool * pool)
   return res;
 }
 
+/**
+ * gst_rtsp_thread_pool_set_max_media_threads:
+ * @pool: a #GstRTSPThreadPool
+ * @max_threads: maximum media threads
+ *
+ * Set the maximum threads used by the pool to handle media. When the maximum
+ * is reached, the bus and state changes of new media are handled by the least
+ * loaded media thread, which is shared with the media it already handles.
+ * A value of -1 or 0 will use a new thread for each media.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_thread_pool_set_max_media_threads (GstRTSPThreadPool * pool,
+    gint max_threads)
+{
+  GstRTSPThreadPoolPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_THREAD_POOL (pool));
+
+  priv = pool->priv;
+
+  g_mutex_lock (&priv->lock);
+  priv->max_media_threads = max_threads;
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * gst_rtsp_thread_pool_get_max_media_threads:
+ * @pool: a #GstRTSPThreadPool
+ *
+ * Get the maximum number of threads used for media.
+ * See gst_rtsp_thread_pool_set_max_media_threads().
+ *
+ * Returns: the maximum number of media threads.
+ *
+ * Since: 1.14
+ */
+gint
+gst_rtsp_thread_pool_get_max_media_threads (GstRTSPThreadPool * pool)
+{
+  GstRTSPThreadPoolPrivate *priv;
+  gint res;
+
+  g_return_val_if_fail (GST_IS_RTSP_THREAD_POOL (pool), -1);
+
+  priv = pool->priv;
+
+  g_mutex_lock (&priv->lock);
+  res = priv->max_media_threads;
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
+/* parse a list of CPU numbers and ranges like "0-3,8" into @set, which may
+ * be %NULL to only check the list */
+static gboolean
+parse_cpu_list (const gchar * cpus, gpointer set)
+{
+  gchar **ranges;
+  guint i, n_cpus = 0;
+
+#ifdef CPU_SET
+  if (set)
+    CPU_ZERO ((cpu_set_t *) set);
+#endif
+
+  ranges = g_strsplit (cpus, ",", -1);
+  for (i = 0; ranges[i]; i++) {
+    gchar *str = g_strstrip (ranges[i]), *end;
+    guint64 first, last;
+
+    if (*str == '\0')
+      continue;
+
+    first = last = g_ascii_strtoull (str, &end, 10);
+    if (end == str)
+      goto invalid;
+    if (*end == '-') {
+      str = end + 1;
+      last = g_ascii_strtoull (str, &end, 10);
+      if (end == str)
+        goto invalid;
+    }
+    if (*end != '\0' || last < first || last >= MAX_CPUS)
+      goto invalid;
+
+    n_cpus += last - first + 1;
+#ifdef CPU_SET
+    if (set) {
+      for (; first <= last; first++)
+        CPU_SET (first, (cpu_set_t *) set);
+    }
+#endif
+  }
+  g_strfreev (ranges);
+
+  return n_cpus > 0;
+
+  /* ERRORS */
+invalid:
+  {
+    GST_WARNING ("invalid CPU list '%s'", cpus);
+    g_strfreev (ranges);
+    return FALSE;
+  }
+}
+
+/**
+ * gst_rtsp_thread_pool_set_cpus:
+ * @pool: a #GstRTSPThreadPool
+ * @type: the #GstRTSPThreadType
+ * @cpus: (allow-none): a list of CPU numbers and ranges or %NULL
+ *
+ * Bind the threads of @type that are made from now on to @cpus. @cpus is a
+ * comma separated list of CPU numbers and ranges, like "0-3,8". When @cpus is
+ * %NULL, the threads can run on any CPU.
+ *
+ * This has no effect on platforms that cannot bind threads to CPUs.
+ *
+ * Returns: %TRUE when @cpus is a valid list of CPUs.
+ *
+ * Since: 1.14
+ */
+gboolean
+gst_rtsp_thread_pool_set_cpus (GstRTSPThreadPool * pool,
+    GstRTSPThreadType type, const gchar * cpus)
+{
+  GstRTSPThreadPoolPrivate *priv;
+
+  g_return_val_if_fail (GST_IS_RTSP_THREAD_POOL (pool), FALSE);
+  g_return_val_if_fail (type == GST_RTSP_THREAD_TYPE_CLIENT ||
+      type == GST_RTSP_THREAD_TYPE_MEDIA, FALSE);
+
+  priv = pool->priv;
+
+  if (cpus && !parse_cpu_list (cpus, NULL))
+    return FALSE;
+
+  g_mutex_lock (&priv->lock);
+  g_free (priv->cpus[type]);
+  priv->cpus[type] = g_strdup (cpus);
+  g_mutex_unlock (&priv->lock);
+
+  return TRUE;
+}
+
+/**
+ * gst_rtsp_thread_pool_get_cpus:
+ * @pool: a #GstRTSPThreadPool
+ * @type: the #GstRTSPThreadType
+ *
+ * Get the CPUs the threads of @type are bound to.
+ * See gst_rtsp_thread_pool_set_cpus().
+ *
+ * Returns: (transfer full) (nullable): the list of CPUs or %NULL when the
+ * threads can run on any CPU. g_free() after usage.
+ *
+ * Since: 1.14
+ */
+gchar *
+gst_rtsp_thread_pool_get_cpus (GstRTSPThreadPool * pool,
+    GstRTSPThreadType type)
+{
+  GstRTSPThreadPoolPrivate *priv;
+  gchar *res;
+
+  g_return_val_if_fail (GST_IS_RTSP_THREAD_POOL (pool), NULL);
+  g_return_val_if_fail (type == GST_RTSP_THREAD_TYPE_CLIENT ||
+      type == GST_RTSP_THREAD_TYPE_MEDIA, NULL);
+
+  priv = pool->priv;
+
+  g_mutex_lock (&priv->lock);
+  res = g_strdup (priv->cpus[type]);
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
+/**
+ * gst_rtsp_thread_pool_set_colocate_media:
+ * @pool: a #GstRTSPThreadPool
+ * @colocate: the new value
+ *
+ * When @colocate is %TRUE, a media thread that is made for a client request
+ * is bound to the CPUs of the NUMA node the client thread runs on. When
+ * media CPUs are configured with gst_rtsp_thread_pool_set_cpus(), only the
+ * media CPUs of that node are used.
+ *
+ * Since: 1.14
+ */
+void
+gst_rtsp_thread_pool_set_colocate_media (GstRTSPThreadPool * pool,
+    gboolean colocate)
+{
+  GstRTSPThreadPoolPrivate *priv;
+
+  g_return_if_fail (GST_IS_RTSP_THREAD_POOL (pool));
+
+  priv = pool->priv;
+
+  g_mutex_lock (&priv->lock);
+  priv->colocate_media = colocate;
+  g_mutex_unlock (&priv->lock);
+}
+
+/**
+ * gst_rtsp_thread_pool_get_colocate_media:
+ * @pool: a #GstRTSPThreadPool
+ *
+ * Check if media threads are colocated with the client thread.
+ * See gst_rtsp_thread_pool_set_colocate_media().
+ *
+ * Returns: %TRUE if media threads are colocated with the client thread.
+ *
+ * Since: 1.14
+ */
+gboolean
+gst_rtsp_thread_pool_get_colocate_media (GstRTSPThreadPool * pool)
+{
+  GstRTSPThreadPoolPrivate *priv;
+  gboolean res;
+
+  g_return_val_if_fail (GST_IS_RTSP_THREAD_POOL (pool), FALSE);
+
+  priv = pool->priv;
+
+  g_mutex_lock (&priv->lock);
+  res = priv->colocate_media;
+  g_mutex_unlock (&priv->lock);
+
+  return res;
+}
+
 static GstRTSPThread *
 make_thread (GstRTSPThreadPool * pool, GstRTSPThreadType type,
     GstRTSPContext * ctx)
@@ -431,6 +1247,122 @@ make_thread (GstRTSPThreadPool * pool, GstRTSPThreadType type,
   return thread;
 }
 
+/* get the CPUs of the NUMA node the current thread runs on, or the CPUs of
+ * the current thread when the node is unknown. This reads sysfs, so it is
+ * done before taking the lock of the pool. Returns a cpu_set_t to free with
+ * g_free() or %NULL. */
+static gpointer
+get_node_cpus (void)
+{
+#ifdef CPU_SET
+  cpu_set_t *set;
+  gboolean res = FALSE;
+  GDir *dir = NULL;
+  gchar *path;
+  gint cpu;
+
+  set = g_new (cpu_set_t, 1);
+
+  cpu = sched_getcpu ();
+  if (cpu >= 0) {
+    path = g_strdup_printf ("/sys/devices/system/cpu/cpu%d", cpu);
+    dir = g_dir_open (path, 0, NULL);
+    g_free (path);
+  }
+  if (dir) {
+    const gchar *name;
+
+    while (!res && (name = g_dir_read_name (dir))) {
+      gchar *contents;
+
+      if (!g_str_has_prefix (name, "node") || !g_ascii_isdigit (name[4]))
+        continue;
+
+      path = g_strdup_printf ("/sys/devices/system/node/%s/cpulist", name);
+      if (g_file_get_contents (path, &contents, NULL, NULL)) {
+        res = parse_cpu_list (g_strstrip (contents), set);
+        g_free (contents);
+      }
+      g_free (path);
+    }
+    g_dir_close (dir);
+  }
+  if (!res)
+    res = sched_getaffinity (0, sizeof (cpu_set_t), set) == 0;
+
+  if (!res) {
+    g_free (set);
+    set = NULL;
+  }
+  return set;
+#else
+  return NULL;
+#endif
+}
+
+/* configure the CPUs @thread will run on, from the configured @cpus and the
+ * CPUs of the NUMA node @node, which can be %NULL */
+static void
+bind_thread (GstRTSPThread * thread, const gchar * cpus, gpointer node)
+{
+#ifdef CPU_SET
+  GstRTSPThreadImpl *impl = (GstRTSPThreadImpl *) thread;
+  cpu_set_t set;
+  gboolean bound = FALSE;
+
+  if (cpus)
+    bound = parse_cpu_list (cpus, &set);
+
+  if (node) {
+    if (bound) {
+      cpu_set_t both;
+
+      /* the configured CPUs win when none of them are on the node */
+      CPU_AND (&both, &set, (cpu_set_t *) node);
+      if (CPU_COUNT (&both) > 0)
+        set = both;
+    } else {
+      set = *(cpu_set_t *) node;
+      bound = TRUE;
+    }
+  }
+
+  if (bound) {
+    impl->affinity = g_new (cpu_set_t, 1);
+    memcpy (impl->affinity, &set, sizeof (cpu_set_t));
+  }
+#else
+  if (cpus || node)
+    GST_FIXME ("binding threads to CPUs is not supported");
+#endif
+}
+
+/* find the thread with the lowest load, use the number of users to choose
+ * between threads with a similar load */
+static GstRTSPThread *
+least_loaded_thread (GQueue * threads)
+{
+  GstRTSPThread *best = NULL;
+  guint best_load = 0, best_users = 0;
+  GList *walk;
+
+  for (walk = threads->head; walk; walk = walk->next) {
+    GstRTSPThread *thread = walk->data;
+    guint load, users;
+
+    load = gst_rtsp_thread_get_load (thread);
+    users = gst_rtsp_thread_get_n_users (thread);
+
+    if (best == NULL || load + LOAD_SIMILAR <= best_load ||
+        (load < best_load + LOAD_SIMILAR && users < best_users)) {
+      best = thread;
+      best_load = load;
+      best_users = users;
+    }
+  }
+  return best;
+}
+
 static GstRTSPThread *
 default_get_thread (GstRTSPThreadPool * pool,
     GstRTSPThreadType type, GstRTSPContext * ctx)
@@ -439,6 +1371,7 @@ default_get_thread (GstRTSPThreadPool * pool,
   GstRTSPThreadPoolClass *klass;
   GstRTSPThread *thread;
   GError *error = NULL;
+  gpointer node = NULL;
 
   klass = GST_RTSP_THREAD_POOL_GET_CLASS (pool);
 
@@ -453,8 +1386,8 @@ default_get_thread (GstRTSPThreadPool * pool,
       retry:
         if (priv->max_threads > 0 &&
             g_queue_get_length (&priv->threads) >= priv->max_threads) {
-          /* max threads reached, recycle from queue */
-          thread = g_queue_pop_head (&priv->threads);
+          /* max threads reached, recycle the least loaded thread */
+          thread = least_loaded_thread (&priv->threads);
           GST_DEBUG_OBJECT (pool, "recycle client thread %p", thread);
           if (!gst_rtsp_thread_reuse (thread)) {
             GST_DEBUG_OBJECT (pool, "thread %p stopping, retry", thread);
@@ -463,38 +1396,69 @@ default_get_thread (GstRTSPThreadPool * pool,
              * the thread out of the queue now, there is no point to add it
              * again, it will be removed from the mainloop otherwise after it
              * stops. */
+            g_queue_remove (&priv->threads, thread);
             goto retry;
           }
         } else {
           /* make more threads */
           GST_DEBUG_OBJECT (pool, "make new client thread");
           thread = make_thread (pool, type, ctx);
+          bind_thread (thread, priv->cpus[type], NULL);
 
           if (!g_thread_pool_push (klass->pool, gst_rtsp_thread_ref (thread),
                   &error))
             goto thread_error;
+
+          g_queue_push_tail (&priv->threads, thread);
         }
-        g_queue_push_tail (&priv->threads, thread);
         g_mutex_unlock (&priv->lock);
       }
       break;
     case GST_RTSP_THREAD_TYPE_MEDIA:
-      GST_DEBUG_OBJECT (pool, "make new media thread");
-      thread = make_thread (pool, type, ctx);
+      /* we are called from the client thread for a client request, look up
+       * the NUMA node it runs on before taking the lock */
+      if (ctx && ctx->client && gst_rtsp_thread_pool_get_colocate_media (pool))
+        node = get_node_cpus ();
+
+      g_mutex_lock (&priv->lock);
+    retry_media:
+      if (priv->max_media_threads > 0 &&
+          g_queue_get_length (&priv->media_threads) >=
+          priv->max_media_threads) {
+        /* max media threads reached, share the least loaded thread */
+        thread = least_loaded_thread (&priv->media_threads);
+        GST_DEBUG_OBJECT (pool, "share media thread %p", thread);
+        if (!gst_rtsp_thread_reuse (thread)) {
+          GST_DEBUG_OBJECT (pool, "thread %p stopping, retry", thread);
+          g_queue_remove (&priv->media_threads, thread);
+          goto retry_media;
+        }
+      } else {
+        GST_DEBUG_OBJECT (pool, "make new media thread");
+        thread = make_thread (pool, type, ctx);
+        bind_thread (thread, priv->cpus[type], node);
+
+        if (!g_thread_pool_push (klass->pool, gst_rtsp_thread_ref (thread),
+                &error))
+          goto thread_error;
 
-      if (!g_thread_pool_push (klass->pool, gst_rtsp_thread_ref (thread),
-              &error))
-        goto thread_error;
+        g_queue_push_tail (&priv->media_threads, thread);
+      }
+      g_mutex_unlock (&priv->lock);
       break;
     default:
       thread = NULL;
       break;
   }
+  g_free (node);
+
   return thread;
 
   /* ERRORS */
 thread_error:
   {
+    g_mutex_unlock (&priv->lock);
+    g_free (node);
     GST_ERROR_OBJECT (pool, "failed to push thread %s", error->message);
     gst_rtsp_thread_unref (thread);
     /* drop also the ref dedicated for the pool */
@@ -541,6 +1505,123 @@ gst_rtsp_thread_pool_get_thread (GstRTSPThreadPool * pool,
   return result;
 }
 
+/**
+ * gst_rtsp_thread_pool_get_client_threads:
+ * @pool: a #GstRTSPThreadPool
+ *
+ * Get the threads of @pool that are currently used for client connections.
+ * Use gst_rtsp_thread_get_load() and gst_rtsp_thread_get_n_users() to query
+ * their load.
+ *
+ * Returns: (element-type GstRTSPThread) (transfer full): a #GList of
+ * #GstRTSPThread. After usage, each element in the #GList should be unreffed
+ * before the list is freed.
+ *
+ * Since: 1.14
+ */
+GList *
+gst_rtsp_thread_pool_get_client_threads (GstRTSPThreadPool * pool)
+{
+  GstRTSPThreadPoolPrivate *priv;
+  GList *result = NULL, *walk;
+
+  g_return_val_if_fail (GST_IS_RTSP_THREAD_POOL (pool), NULL);
+
+  priv = pool->priv;
+
+  g_mutex_lock (&priv->lock);
+  for (walk = priv->threads.tail; walk; walk = walk->prev)
+    result = g_list_prepend (result, gst_rtsp_thread_ref (walk->data));
+  g_mutex_unlock (&priv->lock);
+
+  return result;
+}
+
+/**
+ * gst_rtsp_thread_pool_get_media_threads:
+ * @pool: a #GstRTSPThreadPool
+ *
+ * Get the threads of @pool that are currently used for media. The number of
+ * media handled by a thread is given by gst_rtsp_thread_get_n_users().
+ *
+ * Returns: (element-type GstRTSPThread) (transfer full): a #GList of
+ * #GstRTSPThread. After usage, each element in the #GList should be unreffed
+ * before the list is freed.
+ *
+ * Since: 1.14
+ */
+GList *
+gst_rtsp_thread_pool_get_media_threads (GstRTSPThreadPool * pool)
+{
+  GstRTSPThreadPoolPrivate *priv;
+  GList *result = NULL, *walk;
+
+  g_return_val_if_fail (GST_IS_RTSP_THREAD_POOL (pool), NULL);
+
+  priv = pool->priv;
+
+  g_mutex_lock (&priv->lock);
+  for (walk = priv->media_threads.tail; walk; walk = walk->prev)
+    result = g_list_prepend (result, gst_rtsp_thread_ref (walk->data));
+  g_mutex_unlock (&priv->lock);
+
+  return result;
+}
+
+static void
+append_thread_stats (GValue * array, GQueue * threads)
+{
+  GList *walk;
+
+  for (walk = threads->head; walk; walk = walk->next) {
+    GValue value = G_VALUE_INIT;
+
+    g_value_init (&value, GST_TYPE_STRUCTURE);
+    g_value_take_boxed (&value, thread_get_stats (walk->data));
+    gst_value_array_append_and_take_value (array, &value);
+  }
+}
+
+/**
+ * gst_rtsp_thread_pool_get_stats:
+ * @pool: a #GstRTSPThreadPool
+ *
+ * Get the statistics of the threads of @pool. The
+ * "application/x-rtsp-thread-pool-stats" structure contains the
+ * "client-threads" and "media-threads" arrays with the structure of each
+ * thread as returned by gst_rtsp_thread_get_stats().
+ *
+ * Returns: (transfer full): a #GstStructure with the statistics of @pool.
+ * gst_structure_free() after usage.
+ *
+ * Since: 1.14
+ */
+GstStructure *
+gst_rtsp_thread_pool_get_stats (GstRTSPThreadPool * pool)
+{
+  GstRTSPThreadPoolPrivate *priv;
+  GValue clients = G_VALUE_INIT, medias = G_VALUE_INIT;
+  GstStructure *result;
+
+  g_return_val_if_fail (GST_IS_RTSP_THREAD_POOL (pool), NULL);
+
+  priv = pool->priv;
+
+  g_value_init (&clients, GST_TYPE_ARRAY);
+  g_value_init (&medias, GST_TYPE_ARRAY);
+
+  g_mutex_lock (&priv->lock);
+  append_thread_stats (&clients, &priv->threads);
+  append_thread_stats (&medias, &priv->media_threads);
+  g_mutex_unlock (&priv->lock);
+
+  result = gst_structure_new_empty ("application/x-rtsp-thread-pool-stats");
+  gst_structure_take_value (result, "client-threads", &clients);
+  gst_structure_take_value (result, "media-threads", &medias);
+
+  return result;
+}
+
 /**
  * gst_rtsp_thread_pool_cleanup:
  *
@@ -87,6 +87,15 @@ gboolean          gst_rtsp_thread_reuse    (GstRTSPThread * thread);
 GST_EXPORT
 void              gst_rtsp_thread_stop     (GstRTSPThread * thread);
 
+GST_EXPORT
+guint             gst_rtsp_thread_get_load (GstRTSPThread * thread);
+
+GST_EXPORT
+guint             gst_rtsp_thread_get_n_users (GstRTSPThread * thread);
+
+GST_EXPORT
+GstStructure *    gst_rtsp_thread_get_stats (GstRTSPThread * thread);
+
 /**
  * gst_rtsp_thread_ref:
  * @thread: The thread to refcount
@@ -135,6 +144,8 @@ struct _GstRTSPThreadPool {
  *       a new thread has been created and should be configured.
  * @thread_enter: called from the thread when it is entered
  * @thread_leave: called from the thread when it is left
+ * @thread_stats: called from the thread when its statistics were updated.
+ *       Since: 1.14
  *
  * Class for managing threads.
  */
@@ -155,8 +166,13 @@ struct _GstRTSPThreadPoolClass {
   void            (*thread_leave)      (GstRTSPThreadPool *pool,
                                         GstRTSPThread *thread);
 
+  /* signals */
+  void            (*thread_stats)      (GstRTSPThreadPool *pool,
+                                        GstRTSPThread *thread,
+                                        const GstStructure *stats);
+
   /*< private >*/
-  gpointer         _gst_reserved[GST_PADDING];
+  gpointer         _gst_reserved[GST_PADDING - 1];
 };
 
 GST_EXPORT
@@ -171,11 +187,41 @@ void                gst_rtsp_thread_pool_set_max_threads (GstRTSPThreadPool * po
 GST_EXPORT
 gint                gst_rtsp_thread_pool_get_max_threads (GstRTSPThreadPool * pool);
 
+GST_EXPORT
+void                gst_rtsp_thread_pool_set_max_media_threads (GstRTSPThreadPool * pool, gint max_threads);
+
+GST_EXPORT
+gint                gst_rtsp_thread_pool_get_max_media_threads (GstRTSPThreadPool * pool);
+
+GST_EXPORT
+gboolean            gst_rtsp_thread_pool_set_cpus        (GstRTSPThreadPool * pool,
+                                                          GstRTSPThreadType type,
+                                                          const gchar * cpus);
+
+GST_EXPORT
+gchar *             gst_rtsp_thread_pool_get_cpus        (GstRTSPThreadPool * pool,
+                                                          GstRTSPThreadType type);
+
+GST_EXPORT
+void                gst_rtsp_thread_pool_set_colocate_media (GstRTSPThreadPool * pool, gboolean colocate);
+
+GST_EXPORT
+gboolean            gst_rtsp_thread_pool_get_colocate_media (GstRTSPThreadPool * pool);
+
 GST_EXPORT
 GstRTSPThread *     gst_rtsp_thread_pool_get_thread      (GstRTSPThreadPool *pool,
                                                           GstRTSPThreadType type,
                                                           GstRTSPContext *ctx);
 
+GST_EXPORT
+GList *             gst_rtsp_thread_pool_get_client_threads (GstRTSPThreadPool * pool);
+
+GST_EXPORT
+GList *             gst_rtsp_thread_pool_get_media_threads (GstRTSPThreadPool * pool);
+
+GST_EXPORT
+GstStructure *      gst_rtsp_thread_pool_get_stats       (GstRTSPThreadPool * pool);
+
 GST_EXPORT
 void                gst_rtsp_thread_pool_cleanup         (void);
 #ifdef G_DEFINE_AUTOPTR_CLEANUP_FUNC
@@ -0,0 +1,1003 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* GstRTSPUdpSender sends the RTP or RTCP packets of a stream to all of its
+ * unicast UDP destinations.
+ *
+ * Where multiudpsink does one syscall per packet and destination, the sender
+ * builds one message for every packet/destination pair and passes as many of
+ * them as possible to the kernel at once with g_socket_send_messages(), which
+ * uses sendmmsg() when available. When a whole list of packets is sent and the
+ * kernel supports UDP generic segmentation offload, all packets for one
+ * destination are passed as one message with the UDP_SEGMENT option.
+ *
+ * When pacing is enabled, the packets of a frame are not sent back-to-back but
+ * spread over the frame interval. The send rate is derived from the average
+ * frame size and interval of the stream, seen through the timestamps of the
+ * packets, with some headroom so that the sender keeps up with bitrate peaks.
+ * The packets are queued and sent from a timer source that is dispatched when
+ * the first of them is due, in a thread that is shared by all senders that
+ * pace. The streaming thread, that also feeds the other outputs of the stream,
+ * never waits.
+ *
+ * The sender does not own any sockets, it uses the sockets that were allocated
+ * for the stream and that are also used by its udpsinks and udpsrcs.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             /* for sendmmsg() */
+#endif
+
+#include <string.h>
+
+#include "rtsp-server-internal.h"
+
+#ifdef G_OS_UNIX
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#endif
+
+GST_DEBUG_CATEGORY_STATIC (rtsp_udp_sender_debug);
+#define GST_CAT_DEFAULT rtsp_udp_sender_debug
+
+/* maximum number of messages passed to the kernel in one call */
+#define MAX_MESSAGES            256
+/* maximum number of memories of a packet that are sent without merging */
+#define MAX_VECTORS             16
+/* maximum number of segments the kernel accepts for one GSO send */
+#define MAX_GSO_SEGMENTS        64
+/* maximum size of a UDP datagram */
+#define MAX_GSO_SIZE            65507
+
+/* send rate in percent of the measured stream bitrate */
+#define PACING_HEADROOM         125
+/* depth of the token bucket, the microseconds worth of data that can be sent
+ * at once */
+#define PACING_BURST            500
+/* packets that are due within this many microseconds are sent together, the
+ * main loop wakes up the timer with millisecond resolution */
+#define PACING_GRANULARITY      1000
+/* frame intervals outside of this range are not used for pacing */
+#define PACING_MIN_INTERVAL     (GST_MSECOND)
+#define PACING_MAX_INTERVAL     (GST_SECOND)
+/* maximum number of packets waiting to be sent when pacing, more are dropped
+ * like by a full socket */
+#define PACING_MAX_QUEUE        4096
+/* maximum number of paced packets passed to the kernel together */
+#define PACING_MAX_BATCH        MAX_GSO_SEGMENTS
+
+#if !GLIB_CHECK_VERSION(2,44,0)
+/* GOutputMessage and g_socket_send_messages() are only available since 2.44,
+ * we send the messages one by one with older versions */
+typedef struct
+{
+  GSocketAddress *address;
+  GOutputVector *vectors;
+  guint num_vectors;
+  guint bytes_sent;
+  GSocketControlMessage **control_messages;
+  guint num_control_messages;
+} GOutputMessage;
+#endif
+
+typedef struct
+{
+  GInetAddress *addr;
+  guint port;
+  GSocketAddress *address;
+  GSocket *socket;
+  /* number of times this destination was added */
+  guint count;
+#ifdef UDP_SEGMENT
+  struct sockaddr_storage sa;
+  socklen_t sa_len;
+#endif
+} Destination;
+
+typedef struct
+{
+  GstBuffer *buffer;
+  GstMapInfo maps[MAX_VECTORS];
+  GOutputVector vectors[MAX_VECTORS];
+  guint n_vectors;
+  gboolean merged;
+  gsize size;
+} Packet;
+
+/* a packet waiting in the pacing queue */
+typedef struct
+{
+  GstBuffer *buffer;
+  /* monotonic time when the packet may be sent */
+  gint64 due;
+} PacedPacket;
+
+/* the timer that sends the paced packets of a sender. The lock is held while
+ * it is dispatched, it is in the source because the source outlives the
+ * sender when it is destroyed during a dispatch */
+typedef struct
+{
+  GSource source;
+  GMutex lock;
+  GstRTSPUdpSender *sender;
+} PacingSource;
+
+struct _GstRTSPUdpSender
+{
+  GMutex lock;
+
+  /* array of Destination, grouped by socket */
+  GPtrArray *destinations;
+  gboolean use_gso;
+
+  /* RTP seqnum of the last packet that was sent, -1 when nothing was sent.
+   * Protected by lock. */
+  gint last_seqnum;
+
+  /* scratch space for building messages, protected by lock */
+  GOutputMessage *messages;
+#ifdef UDP_SEGMENT
+  struct mmsghdr *mmsgs;
+#endif
+
+  /* the timer that sends the paced packets from the shared pacing thread.
+   * pacing_queue of PacedPacket is protected by pacing_lock, the ready time
+   * of pacing_source is set with it. pacing_packets is only used from the
+   * timer. */
+  PacingSource *pacing_source;
+  GMutex pacing_lock;
+  GQueue pacing_queue;
+  Packet *pacing_packets;
+
+  /* pacing state, only used from the streaming thread */
+  gboolean pacing;
+  GstClockTime last_pts;
+  GstClockTime frame_interval;
+  gsize frame_bytes;
+  gsize avg_frame_bytes;
+  /* theoretical send time of the next packet */
+  gint64 next_due;
+};
+
+static void
+destination_free (Destination * dest)
+{
+  g_object_unref (dest->addr);
+  g_object_unref (dest->address);
+  g_object_unref (dest->socket);
+  g_slice_free (Destination, dest);
+}
+
+/* create a new sender without destinations */
+GstRTSPUdpSender *
+gst_rtsp_udp_sender_new (void)
+{
+  static gsize debug_initialized = 0;
+  GstRTSPUdpSender *sender;
+
+  if (g_once_init_enter (&debug_initialized)) {
+    GST_DEBUG_CATEGORY_INIT (rtsp_udp_sender_debug, "rtspudpsender", 0,
+        "GstRTSPUdpSender");
+    g_once_init_leave (&debug_initialized, 1);
+  }
+
+  sender = g_slice_new0 (GstRTSPUdpSender);
+  g_mutex_init (&sender->lock);
+  g_mutex_init (&sender->pacing_lock);
+  g_queue_init (&sender->pacing_queue);
+  sender->destinations =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) destination_free);
+  sender->messages = g_new0 (GOutputMessage, MAX_MESSAGES);
+#ifdef UDP_SEGMENT
+  sender->use_gso = TRUE;
+  sender->mmsgs = g_new0 (struct mmsghdr, MAX_MESSAGES);
+#endif
+  sender->last_pts = GST_CLOCK_TIME_NONE;
+  sender->last_seqnum = -1;
+
+  return sender;
+}
+
+/* the thread that runs the pacing timers of all senders */
+static GMutex pacing_thread_lock;
+static guint pacing_thread_users;
+static GMainContext *pacing_context;
+static GMainLoop *pacing_loop;
+static GThread *pacing_thread;
+
+static gboolean
+quit_pacing_loop (GMainLoop * loop)
+{
+  g_main_loop_quit (loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer
+pacing_thread_func (GMainLoop * loop)
+{
+  g_main_context_push_thread_default (g_main_loop_get_context (loop));
+  g_main_loop_run (loop);
+  g_main_context_pop_thread_default (g_main_loop_get_context (loop));
+
+  return NULL;
+}
+
+/* get the context of the pacing thread, starts the thread for the first
+ * user */
+static GMainContext *
+pacing_thread_ref (void)
+{
+  GMainContext *context;
+
+  g_mutex_lock (&pacing_thread_lock);
+  if (pacing_thread_users++ == 0) {
+    pacing_context = g_main_context_new ();
+    pacing_loop = g_main_loop_new (pacing_context, FALSE);
+    pacing_thread = g_thread_new ("rtsp-pacing",
+        (GThreadFunc) pacing_thread_func, pacing_loop);
+  }
+  context = g_main_context_ref (pacing_context);
+  g_mutex_unlock (&pacing_thread_lock);
+
+  return context;
+}
+
+/* stops the pacing thread after the last user */
+static void
+pacing_thread_unref (void)
+{
+  g_mutex_lock (&pacing_thread_lock);
+  if (--pacing_thread_users == 0) {
+    GSource *source;
+
+    /* from the loop, it might not be running yet */
+    source = g_idle_source_new ();
+    g_source_set_callback (source, (GSourceFunc) quit_pacing_loop,
+        pacing_loop, NULL);
+    g_source_attach (source, pacing_context);
+    g_source_unref (source);
+    g_thread_join (pacing_thread);
+    pacing_thread = NULL;
+    g_main_loop_unref (pacing_loop);
+    pacing_loop = NULL;
+    g_main_context_unref (pacing_context);
+    pacing_context = NULL;
+  }
+  g_mutex_unlock (&pacing_thread_lock);
+}
+
+static void
+paced_packet_free (PacedPacket * paced)
+{
+  gst_buffer_unref (paced->buffer);
+  g_slice_free (PacedPacket, paced);
+}
+
+static void send_paced (GstRTSPUdpSender * sender);
+
+static gboolean
+pacing_source_dispatch (GSource * source, GSourceFunc callback,
+    gpointer user_data)
+{
+  PacingSource *psrc = (PacingSource *) source;
+
+  /* the sender is gone when the source was destroyed while we waited */
+  g_mutex_lock (&psrc->lock);
+  if (!g_source_is_destroyed (source))
+    send_paced (psrc->sender);
+  g_mutex_unlock (&psrc->lock);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+pacing_source_finalize (GSource * source)
+{
+  PacingSource *psrc = (PacingSource *) source;
+
+  g_mutex_clear (&psrc->lock);
+}
+
+static GSourceFuncs pacing_source_funcs = {
+  NULL,
+  NULL,
+  pacing_source_dispatch,
+  pacing_source_finalize
+};
+
+static void
+start_pacing (GstRTSPUdpSender * sender)
+{
+  GMainContext *context;
+  PacingSource *psrc;
+
+  if (sender->pacing_source)
+    return;
+
+  psrc = (PacingSource *) g_source_new (&pacing_source_funcs,
+      sizeof (PacingSource));
+  g_mutex_init (&psrc->lock);
+  psrc->sender = sender;
+  g_source_set_priority ((GSource *) psrc, G_PRIORITY_HIGH);
+  sender->pacing_source = psrc;
+  sender->pacing_packets = g_new (Packet, PACING_MAX_BATCH);
+
+  context = pacing_thread_ref ();
+  g_source_attach ((GSource *) psrc, context);
+  g_main_context_unref (context);
+}
+
+static void
+stop_pacing (GstRTSPUdpSender * sender)
+{
+  PacingSource *psrc = sender->pacing_source;
+
+  if (psrc == NULL)
+    return;
+
+  /* wait until the timer is not running anymore, it doesn't use the sender
+   * after it was destroyed */
+  g_mutex_lock (&psrc->lock);
+  g_source_destroy ((GSource *) psrc);
+  g_mutex_unlock (&psrc->lock);
+  g_source_unref ((GSource *) psrc);
+  sender->pacing_source = NULL;
+  g_free (sender->pacing_packets);
+  sender->pacing_packets = NULL;
+  pacing_thread_unref ();
+
+  g_mutex_lock (&sender->pacing_lock);
+  g_queue_foreach (&sender->pacing_queue, (GFunc) paced_packet_free, NULL);
+  g_queue_clear (&sender->pacing_queue);
+  g_mutex_unlock (&sender->pacing_lock);
+}
+
+/* free @sender and all its destinations */
+void
+gst_rtsp_udp_sender_free (GstRTSPUdpSender * sender)
+{
+  g_return_if_fail (sender != NULL);
+
+  stop_pacing (sender);
+  g_ptr_array_unref (sender->destinations);
+  g_free (sender->messages);
+#ifdef UDP_SEGMENT
+  g_free (sender->mmsgs);
+#endif
+  g_mutex_clear (&sender->lock);
+  g_mutex_clear (&sender->pacing_lock);
+  g_slice_free (GstRTSPUdpSender, sender);
+}
+
+/* enable or disable pacing, must be called from the streaming thread or before
+ * any packets are sent. The paced packets are sent from a thread that is
+ * shared by all senders. */
+void
+gst_rtsp_udp_sender_set_pacing (GstRTSPUdpSender * sender, gboolean pacing)
+{
+  g_return_if_fail (sender != NULL);
+
+  if (pacing)
+    start_pacing (sender);
+  else
+    stop_pacing (sender);
+
+  sender->pacing = pacing;
+  sender->last_pts = GST_CLOCK_TIME_NONE;
+  sender->frame_interval = 0;
+  sender->frame_bytes = 0;
+  sender->avg_frame_bytes = 0;
+  sender->next_due = 0;
+}
+
+/* must be called with lock */
+static gint
+find_destination (GstRTSPUdpSender * sender, GInetAddress * addr, guint port)
+{
+  guint i;
+
+  for (i = 0; i < sender->destinations->len; i++) {
+    Destination *dest = g_ptr_array_index (sender->destinations, i);
+
+    if (dest->port == port && g_inet_address_equal (dest->addr, addr))
+      return i;
+  }
+  return -1;
+}
+
+/* start sending to @addr and @port from @socket. A destination can be added
+ * multiple times, it is only removed again after the same number of calls to
+ * gst_rtsp_udp_sender_remove(). When @last_seqnum is not %NULL, it is set to
+ * the RTP seqnum of the last packet that was sent before the destination was
+ * added, or -1. */
+gboolean
+gst_rtsp_udp_sender_add (GstRTSPUdpSender * sender, GSocket * socket,
+    GInetAddress * addr, guint port, gint * last_seqnum)
+{
+  Destination *dest;
+  gint idx;
+  guint i;
+
+  g_return_val_if_fail (sender != NULL, FALSE);
+  g_return_val_if_fail (G_IS_SOCKET (socket), FALSE);
+  g_return_val_if_fail (G_IS_INET_ADDRESS (addr), FALSE);
+
+  g_mutex_lock (&sender->lock);
+  if (last_seqnum)
+    *last_seqnum = sender->last_seqnum;
+  idx = find_destination (sender, addr, port);
+  if (idx >= 0) {
+    dest = g_ptr_array_index (sender->destinations, idx);
+    dest->count++;
+    g_mutex_unlock (&sender->lock);
+    return TRUE;
+  }
+
+  dest = g_slice_new0 (Destination);
+  dest->addr = g_object_ref (addr);
+  dest->port = port;
+  dest->address = g_inet_socket_address_new (addr, port);
+  dest->socket = g_object_ref (socket);
+  dest->count = 1;
+#ifdef UDP_SEGMENT
+  if (g_socket_address_to_native (dest->address, &dest->sa, sizeof (dest->sa),
+          NULL))
+    dest->sa_len = g_socket_address_get_native_size (dest->address);
+#endif
+
+  /* keep destinations with the same socket together so that they can be sent
+   * to in one go */
+  for (i = 0; i < sender->destinations->len; i++) {
+    Destination *d = g_ptr_array_index (sender->destinations, i);
+
+    if (d->socket == socket)
+      break;
+  }
+  g_ptr_array_insert (sender->destinations, i, dest);
+  g_mutex_unlock (&sender->lock);
+
+  if (gst_debug_category_get_threshold (rtsp_udp_sender_debug) >=
+      GST_LEVEL_DEBUG) {
+    gchar *host = g_inet_address_to_string (addr);
+    GST_DEBUG ("sender %p: added destination %s:%u", sender, host, port);
+    g_free (host);
+  }
+
+  return TRUE;
+}
+
+/* stop sending to @addr and @port, returns FALSE when the destination was not
+ * known */
+gboolean
+gst_rtsp_udp_sender_remove (GstRTSPUdpSender * sender, GInetAddress * addr,
+    guint port)
+{
+  Destination *dest;
+  gint idx;
+
+  g_return_val_if_fail (sender != NULL, FALSE);
+  g_return_val_if_fail (G_IS_INET_ADDRESS (addr), FALSE);
+
+  g_mutex_lock (&sender->lock);
+  idx = find_destination (sender, addr, port);
+  if (idx < 0) {
+    g_mutex_unlock (&sender->lock);
+    return FALSE;
+  }
+
+  dest = g_ptr_array_index (sender->destinations, idx);
+  if (--dest->count == 0)
+    g_ptr_array_remove_index (sender->destinations, idx);
+  g_mutex_unlock (&sender->lock);
+
+  if (gst_debug_category_get_threshold (rtsp_udp_sender_debug) >=
+      GST_LEVEL_DEBUG) {
+    gchar *host = g_inet_address_to_string (addr);
+    GST_DEBUG ("sender %p: removed destination %s:%u", sender, host, port);
+    g_free (host);
+  }
+
+  return TRUE;
+}
+
+static gboolean
+packet_init (Packet * packet, GstBuffer * buffer)
+{
+  guint i, n_mem;
+
+  packet->buffer = buffer;
+  packet->size = gst_buffer_get_size (buffer);
+  packet->merged = FALSE;
+
+  n_mem = gst_buffer_n_memory (buffer);
+  if (n_mem > MAX_VECTORS) {
+    /* too many pieces, this copies */
+    if (!gst_buffer_map (buffer, &packet->maps[0], GST_MAP_READ))
+      return FALSE;
+    packet->merged = TRUE;
+    packet->vectors[0].buffer = packet->maps[0].data;
+    packet->vectors[0].size = packet->maps[0].size;
+    packet->n_vectors = 1;
+    return TRUE;
+  }
+
+  for (i = 0; i < n_mem; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+
+    if (!gst_memory_map (mem, &packet->maps[i], GST_MAP_READ))
+      goto map_failed;
+    packet->vectors[i].buffer = packet->maps[i].data;
+    packet->vectors[i].size = packet->maps[i].size;
+  }
+  packet->n_vectors = n_mem;
+
+  return TRUE;
+
+  /* ERRORS */
+map_failed:
+  {
+    while (i > 0) {
+      i--;
+      gst_memory_unmap (gst_buffer_peek_memory (buffer, i), &packet->maps[i]);
+    }
+    return FALSE;
+  }
+}
+
+static void
+packet_clear (Packet * packet)
+{
+  guint i;
+
+  if (packet->merged) {
+    gst_buffer_unmap (packet->buffer, &packet->maps[0]);
+    return;
+  }
+
+  for (i = 0; i < packet->n_vectors; i++)
+    gst_memory_unmap (gst_buffer_peek_memory (packet->buffer, i),
+        &packet->maps[i]);
+}
+
+static void
+flush_messages (GstRTSPUdpSender * sender, GSocket * socket, guint n_messages)
+{
+  GOutputMessage *messages = sender->messages;
+  GError *err = NULL;
+  guint offset = 0;
+
+#if GLIB_CHECK_VERSION(2,44,0)
+  while (offset < n_messages) {
+    gint ret;
+
+    ret = g_socket_send_messages (socket, messages + offset,
+        n_messages - offset, 0, NULL, &err);
+
+    if (ret < 0) {
+      /* the first message could not be sent, like multiudpsink we don't stop
+       * streaming to the others because of one bad destination */
+      GST_LOG ("sender %p: failed to send message: %s", sender, err->message);
+      g_clear_error (&err);
+      offset++;
+    } else if (ret == 0) {
+      offset++;
+    } else {
+      offset += ret;
+    }
+  }
+#else
+  for (offset = 0; offset < n_messages; offset++) {
+    GOutputMessage *msg = &messages[offset];
+
+    if (g_socket_send_message (socket, msg->address, msg->vectors,
+            msg->num_vectors, NULL, 0, 0, NULL, &err) < 0) {
+      GST_LOG ("sender %p: failed to send message: %s", sender, err->message);
+      g_clear_error (&err);
+    }
+  }
+#endif
+}
+
+/* must be called with lock. Sends every packet to every destination, as many
+ * at a time as possible */
+static void
+send_batched (GstRTSPUdpSender * sender, Destination ** dests, guint n_dests,
+    Packet * packets, guint n_packets)
+{
+  GSocket *socket = dests[0]->socket;
+  guint i, j, n_messages = 0;
+
+  for (i = 0; i < n_packets; i++) {
+    for (j = 0; j < n_dests; j++) {
+      GOutputMessage *msg = &sender->messages[n_messages];
+
+      msg->address = dests[j]->address;
+      msg->vectors = packets[i].vectors;
+      msg->num_vectors = packets[i].n_vectors;
+      msg->bytes_sent = 0;
+      msg->control_messages = NULL;
+      msg->num_control_messages = 0;
+
+      if (++n_messages == MAX_MESSAGES) {
+        flush_messages (sender, socket, n_messages);
+        n_messages = 0;
+      }
+    }
+  }
+  if (n_messages > 0)
+    flush_messages (sender, socket, n_messages);
+}
+
+#ifdef UDP_SEGMENT
+/* check if @packets can be sent as one GSO message and return the segment
+ * size. All packets must have the same size, only the last one can be
+ * smaller */
+static guint
+get_gso_segment_size (Packet * packets, guint n_packets)
+{
+  gsize segment_size, total = 0;
+  guint i, n_vectors = 0;
+
+  if (n_packets < 2 || n_packets > MAX_GSO_SEGMENTS)
+    return 0;
+
+  segment_size = packets[0].size;
+  if (segment_size == 0)
+    return 0;
+
+  for (i = 0; i < n_packets; i++) {
+    if (packets[i].size > segment_size)
+      return 0;
+    if (packets[i].size < segment_size && i != n_packets - 1)
+      return 0;
+    total += packets[i].size;
+    n_vectors += packets[i].n_vectors;
+  }
+
+  if (total > MAX_GSO_SIZE || n_vectors > MAX_GSO_SEGMENTS * MAX_VECTORS)
+    return 0;
+
+  return segment_size;
+}
+
+/* must be called with lock. Send all @packets to each destination as one
+ * segmented message and return the number of destinations that were sent
+ * to. */
+static guint
+send_gso (GstRTSPUdpSender * sender, Destination ** dests, guint n_dests,
+    Packet * packets, guint n_packets, guint segment_size)
+{
+  struct iovec iov[MAX_GSO_SEGMENTS * MAX_VECTORS];
+  union
+  {
+    struct cmsghdr hdr;
+    gchar buf[CMSG_SPACE (sizeof (guint16))];
+  } control;
+  struct cmsghdr *cmsg;
+  struct msghdr hdr;
+  guint16 gso_size = segment_size;
+  guint i, j, n_iov = 0, n_sent = 0;
+  gint fd;
+
+  for (i = 0; i < n_packets; i++) {
+    for (j = 0; j < packets[i].n_vectors; j++) {
+      iov[n_iov].iov_base = (gpointer) packets[i].vectors[j].buffer;
+      iov[n_iov].iov_len = packets[i].vectors[j].size;
+      n_iov++;
+    }
+  }
+
+  /* the data and the control message are the same for all destinations */
+  memset (&control, 0, sizeof (control));
+  memset (&hdr, 0, sizeof (hdr));
+  hdr.msg_iov = iov;
+  hdr.msg_iovlen = n_iov;
+  hdr.msg_control = control.buf;
+  hdr.msg_controllen = sizeof (control.buf);
+  cmsg = CMSG_FIRSTHDR (&hdr);
+  cmsg->cmsg_level = IPPROTO_UDP;
+  cmsg->cmsg_type = UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (guint16));
+  memcpy (CMSG_DATA (cmsg), &gso_size, sizeof (guint16));
+
+  fd = g_socket_get_fd (dests[0]->socket);
+
+  while (n_sent < n_dests) {
+    guint n = MIN (n_dests - n_sent, MAX_MESSAGES);
+    gint ret;
+
+    for (i = 0; i < n; i++) {
+      Destination *dest = dests[n_sent + i];
+
+      sender->mmsgs[i].msg_hdr = hdr;
+      sender->mmsgs[i].msg_hdr.msg_name = &dest->sa;
+      sender->mmsgs[i].msg_hdr.msg_namelen = dest->sa_len;
+      sender->mmsgs[i].msg_len = 0;
+    }
+
+    do {
+      ret = sendmmsg (fd, sender->mmsgs, n, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret <= 0) {
+      if (ret < 0 && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT
+              || errno == EOPNOTSUPP)) {
+        GST_INFO ("sender %p: no UDP segmentation offload: %s", sender,
+            g_strerror (errno));
+        sender->use_gso = FALSE;
+      }
+      /* let the caller send the rest without segmentation offload, which also
+       * waits when the socket is full */
+      break;
+    }
+    n_sent += ret;
+  }
+
+  return n_sent;
+}
+#endif
+
+/* must be called with lock, all @dests use the same socket */
+static void
+send_to_group (GstRTSPUdpSender * sender, Destination ** dests, guint n_dests,
+    Packet * packets, guint n_packets)
+{
+#ifdef UDP_SEGMENT
+  guint segment_size, n_sent;
+
+  if (sender->use_gso &&
+      (segment_size = get_gso_segment_size (packets, n_packets)) > 0) {
+    n_sent = send_gso (sender, dests, n_dests, packets, n_packets,
+        segment_size);
+    dests += n_sent;
+    n_dests -= n_sent;
+  }
+#endif
+
+  if (n_dests > 0)
+    send_batched (sender, dests, n_dests, packets, n_packets);
+}
+
+static void
+send_packets (GstRTSPUdpSender * sender, Packet * packets, guint n_packets)
+{
+  Destination **dests;
+  guint i, start, len;
+  guint8 seq[2];
+
+  g_mutex_lock (&sender->lock);
+  dests = (Destination **) sender->destinations->pdata;
+  len = sender->destinations->len;
+
+  for (start = 0, i = 1; start < len; i++) {
+    if (i == len || dests[i]->socket != dests[start]->socket) {
+      send_to_group (sender, dests + start, i - start, packets, n_packets);
+      start = i;
+    }
+  }
+  /* the seqnum is in the third and fourth byte of the RTP header */
+  if (gst_buffer_extract (packets[n_packets - 1].buffer, 2, seq, 2) == 2)
+    sender->last_seqnum = GST_READ_UINT16_BE (seq);
+  g_mutex_unlock (&sender->lock);
+}
+
+/* update the frame statistics with @buffer and return the time it may be
+ * sent. A frame is made of the consecutive packets with the same timestamp. */
+static gint64
+schedule_packet (GstRTSPUdpSender * sender, GstBuffer * buffer, gint64 now)
+{
+  GstClockTime pts = GST_BUFFER_PTS (buffer);
+  gsize size = gst_buffer_get_size (buffer);
+  gint64 due, duration;
+
+  if (GST_CLOCK_TIME_IS_VALID (pts) && pts != sender->last_pts) {
+    if (GST_CLOCK_TIME_IS_VALID (sender->last_pts) && pts > sender->last_pts &&
+        sender->frame_bytes > 0) {
+      GstClockTime interval = pts - sender->last_pts;
+
+      if (interval >= PACING_MIN_INTERVAL && interval <= PACING_MAX_INTERVAL) {
+        if (sender->frame_interval == 0) {
+          sender->frame_interval = interval;
+          sender->avg_frame_bytes = sender->frame_bytes;
+        } else {
+          sender->frame_interval = (7 * sender->frame_interval + interval) / 8;
+          sender->avg_frame_bytes =
+              (7 * sender->avg_frame_bytes + sender->frame_bytes) / 8;
+        }
+      }
+    }
+    sender->last_pts = pts;
+    sender->frame_bytes = 0;
+  }
+  sender->frame_bytes += size;
+
+  /* no estimate of the bitrate yet */
+  if (sender->frame_interval == 0 || sender->avg_frame_bytes == 0)
+    return now;
+
+  /* the time it takes to send this packet at the paced rate */
+  duration = gst_util_uint64_scale (size,
+      GST_TIME_AS_USECONDS (sender->frame_interval) * 100,
+      (guint64) sender->avg_frame_bytes * PACING_HEADROOM);
+
+  /* when we are more than a frame behind, the stream is sending faster than
+   * the estimate. Don't let the delay build up but start over. */
+  if (sender->next_due - now >
+      (gint64) GST_TIME_AS_USECONDS (sender->frame_interval))
+    sender->next_due = now;
+
+  due = MAX (now, sender->next_due - PACING_BURST);
+  sender->next_due = MAX (sender->next_due, due) + duration;
+
+  return due;
+}
+
+/* schedule @buffer and queue it for the pacing timer, called from the
+ * streaming thread */
+static void
+queue_paced (GstRTSPUdpSender * sender, GstBuffer * buffer, gint64 now)
+{
+  PacedPacket *paced;
+  gint64 due;
+
+  due = schedule_packet (sender, buffer, now);
+
+  g_mutex_lock (&sender->pacing_lock);
+  if (sender->pacing_queue.length >= PACING_MAX_QUEUE)
+    goto queue_full;
+
+  paced = g_slice_new (PacedPacket);
+  paced->buffer = gst_buffer_ref (buffer);
+  paced->due = due;
+  g_queue_push_tail (&sender->pacing_queue, paced);
+  /* the timer is set for the first packet, it sets itself for the next ones */
+  if (sender->pacing_queue.length == 1)
+    g_source_set_ready_time ((GSource *) sender->pacing_source, due);
+  g_mutex_unlock (&sender->pacing_lock);
+
+  return;
+
+  /* ERRORS */
+queue_full:
+  {
+    g_mutex_unlock (&sender->pacing_lock);
+    GST_LOG ("sender %p: pacing queue full, dropping packet", sender);
+    return;
+  }
+}
+
+/* called from the pacing thread when the first queued packet is due. Sends
+ * it and the packets that are due at about the same time together, then sets
+ * the timer for the next one. */
+static void
+send_paced (GstRTSPUdpSender * sender)
+{
+  Packet *packets = sender->pacing_packets;
+  PacedPacket *paced;
+  guint i, n_packets = 0;
+  gint64 now;
+
+  now = g_get_monotonic_time ();
+
+  g_mutex_lock (&sender->pacing_lock);
+  while (n_packets < PACING_MAX_BATCH &&
+      (paced = g_queue_peek_head (&sender->pacing_queue)) &&
+      paced->due <= now + PACING_GRANULARITY) {
+    g_queue_pop_head (&sender->pacing_queue);
+    if (packet_init (&packets[n_packets], paced->buffer)) {
+      /* the packet keeps the ref of the buffer */
+      paced->buffer = NULL;
+      n_packets++;
+    } else {
+      GST_WARNING ("sender %p: could not map buffer %p", sender,
+          paced->buffer);
+      gst_buffer_unref (paced->buffer);
+    }
+    g_slice_free (PacedPacket, paced);
+  }
+  paced = g_queue_peek_head (&sender->pacing_queue);
+  g_source_set_ready_time ((GSource *) sender->pacing_source,
+      paced ? paced->due : -1);
+  g_mutex_unlock (&sender->pacing_lock);
+
+  if (n_packets > 0)
+    send_packets (sender, packets, n_packets);
+
+  for (i = 0; i < n_packets; i++) {
+    packet_clear (&packets[i]);
+    gst_buffer_unref (packets[i].buffer);
+  }
+}
+
+/* send @buffer to all destinations, when pacing it is sent later from the
+ * pacing timer */
+void
+gst_rtsp_udp_sender_send (GstRTSPUdpSender * sender, GstBuffer * buffer)
+{
+  Packet packet;
+
+  g_return_if_fail (sender != NULL);
+  g_return_if_fail (GST_IS_BUFFER (buffer));
+
+  if (sender->pacing) {
+    queue_paced (sender, buffer, g_get_monotonic_time ());
+    return;
+  }
+
+  if (!packet_init (&packet, buffer))
+    goto map_failed;
+
+  send_packets (sender, &packet, 1);
+  packet_clear (&packet);
+
+  return;
+
+  /* ERRORS */
+map_failed:
+  {
+    GST_WARNING ("sender %p: could not map buffer %p", sender, buffer);
+    return;
+  }
+}
+
+/* send all buffers in @buffer_list to all destinations, when pacing they are
+ * sent later from the pacing timer */
+void
+gst_rtsp_udp_sender_send_list (GstRTSPUdpSender * sender,
+    GstBufferList * buffer_list)
+{
+  Packet *packets;
+  guint i, len, n_packets = 0;
+
+  g_return_if_fail (sender != NULL);
+  g_return_if_fail (GST_IS_BUFFER_LIST (buffer_list));
+
+  len = gst_buffer_list_length (buffer_list);
+  if (len == 0)
+    return;
+
+  if (sender->pacing) {
+    gint64 now = g_get_monotonic_time ();
+
+    for (i = 0; i < len; i++)
+      queue_paced (sender, gst_buffer_list_get (buffer_list, i), now);
+    return;
+  }
+
+  packets = g_new (Packet, len);
+  for (i = 0; i < len; i++) {
+    GstBuffer *buffer = gst_buffer_list_get (buffer_list, i);
+
+    if (packet_init (&packets[n_packets], buffer))
+      n_packets++;
+    else
+      GST_WARNING ("sender %p: could not map buffer %p", sender, buffer);
+  }
+
+  if (n_packets > 0)
+    send_packets (sender, packets, n_packets);
+
+  for (i = 0; i < n_packets; i++)
+    packet_clear (&packets[i]);
+  g_free (packets);
+}
@@ -0,0 +1,602 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* GstRTSPUdpSrc receives the RTP or RTCP packets of a stream from one of its
+ * UDP sockets.
+ *
+ * Where udpsrc does one syscall per datagram, this source reads all datagrams
+ * that are available, up to the batch size, with one call to
+ * g_socket_receive_messages(), which uses recvmmsg() when available. The
+ * datagrams are received into buffers from a buffer pool and pushed
+ * downstream as one buffer list.
+ *
+ * Like the udpsrc it replaces, the source does not own the socket and does
+ * not join multicast groups, the udpsink that shares the socket does that.
+ */
+
+#include <string.h>
+
+#include <gst/base/gstpushsrc.h>
+#include <gst/net/gstnetaddressmeta.h>
+
+#include "rtsp-server-internal.h"
+
+GST_DEBUG_CATEGORY_STATIC (rtsp_udp_src_debug);
+#define GST_CAT_DEFAULT rtsp_udp_src_debug
+
+/* size of the pooled buffers, datagrams up to this size are not copied */
+#define PACKET_SIZE             2048
+/* maximum size of a UDP datagram */
+#define MAX_PACKET_SIZE         65536
+
+#if !GLIB_CHECK_VERSION(2,48,0)
+/* GInputMessage and g_socket_receive_messages() are only available since
+ * 2.48, we receive the messages one by one with older versions */
+typedef struct
+{
+  GSocketAddress **address;
+  GInputVector *vectors;
+  guint num_vectors;
+  gsize bytes_received;
+  gint flags;
+  GSocketControlMessage ***control_messages;
+  guint *num_control_messages;
+} GInputMessage;
+#endif
+
+#define GST_TYPE_RTSP_UDP_SRC   (gst_rtsp_udp_src_get_type ())
+#define GST_RTSP_UDP_SRC(obj)   (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_RTSP_UDP_SRC, GstRTSPUdpSrc))
+
+typedef struct _GstRTSPUdpSrc GstRTSPUdpSrc;
+typedef struct _GstRTSPUdpSrcClass GstRTSPUdpSrcClass;
+
+struct _GstRTSPUdpSrc
+{
+  GstPushSrc parent;
+
+  GSocket *socket;
+  guint batch_size;
+  GCancellable *cancellable;
+  GstBufferPool *pool;
+
+  /* one slot per datagram of a batch. The buffers that were not used in a
+   * batch are kept for the next one */
+  GInputMessage *messages;
+  GInputVector *vectors;
+  GstBuffer **buffers;
+  GstMapInfo *maps;
+  GSocketAddress **addresses;
+  /* the part of each datagram that doesn't fit in a pooled buffer. The
+   * memory is only touched for large datagrams */
+  guint8 *overflow;
+
+  /* received buffers that still need to be pushed when buffer lists can't
+   * be pushed from create() */
+  GQueue pending;
+
+  /* statistics, protected by the object lock */
+  guint64 batches;
+  guint64 packets;
+  guint max_batch;
+};
+
+struct _GstRTSPUdpSrcClass
+{
+  GstPushSrcClass parent_class;
+};
+
+enum
+{
+  PROP_0,
+  PROP_PORT,
+};
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+GType gst_rtsp_udp_src_get_type (void);
+
+G_DEFINE_TYPE (GstRTSPUdpSrc, gst_rtsp_udp_src, GST_TYPE_PUSH_SRC);
+
+static void gst_rtsp_udp_src_finalize (GObject * object);
+static void gst_rtsp_udp_src_get_property (GObject * object, guint propid,
+    GValue * value, GParamSpec * pspec);
+static gboolean gst_rtsp_udp_src_start (GstBaseSrc * bsrc);
+static gboolean gst_rtsp_udp_src_stop (GstBaseSrc * bsrc);
+static gboolean gst_rtsp_udp_src_unlock (GstBaseSrc * bsrc);
+static gboolean gst_rtsp_udp_src_unlock_stop (GstBaseSrc * bsrc);
+static GstFlowReturn gst_rtsp_udp_src_create (GstPushSrc * psrc,
+    GstBuffer ** buf);
+
+static void
+gst_rtsp_udp_src_class_init (GstRTSPUdpSrcClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstElementClass *element_class;
+  GstBaseSrcClass *basesrc_class;
+  GstPushSrcClass *pushsrc_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  element_class = GST_ELEMENT_CLASS (klass);
+  basesrc_class = GST_BASE_SRC_CLASS (klass);
+  pushsrc_class = GST_PUSH_SRC_CLASS (klass);
+
+  gobject_class->finalize = gst_rtsp_udp_src_finalize;
+  gobject_class->get_property = gst_rtsp_udp_src_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_PORT,
+      g_param_spec_int ("port", "Port", "The port the socket is bound to",
+          0, G_MAXUINT16, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_set_static_metadata (element_class,
+      "RTSP UDP batched source", "Source/Network",
+      "Receive the UDP packets of an RTSP stream in batches",
+      "GStreamer developers");
+
+  basesrc_class->start = gst_rtsp_udp_src_start;
+  basesrc_class->stop = gst_rtsp_udp_src_stop;
+  basesrc_class->unlock = gst_rtsp_udp_src_unlock;
+  basesrc_class->unlock_stop = gst_rtsp_udp_src_unlock_stop;
+  pushsrc_class->create = gst_rtsp_udp_src_create;
+
+  GST_DEBUG_CATEGORY_INIT (rtsp_udp_src_debug, "rtspudpsrc", 0,
+      "GstRTSPUdpSrc");
+}
+
+static void
+gst_rtsp_udp_src_init (GstRTSPUdpSrc * src)
+{
+  src->cancellable = g_cancellable_new ();
+  g_queue_init (&src->pending);
+
+  gst_base_src_set_live (GST_BASE_SRC (src), TRUE);
+  gst_base_src_set_format (GST_BASE_SRC (src), GST_FORMAT_TIME);
+}
+
+static void
+gst_rtsp_udp_src_finalize (GObject * object)
+{
+  GstRTSPUdpSrc *src = GST_RTSP_UDP_SRC (object);
+
+  g_object_unref (src->socket);
+  g_object_unref (src->cancellable);
+
+  G_OBJECT_CLASS (gst_rtsp_udp_src_parent_class)->finalize (object);
+}
+
+static void
+gst_rtsp_udp_src_get_property (GObject * object, guint propid,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRTSPUdpSrc *src = GST_RTSP_UDP_SRC (object);
+
+  switch (propid) {
+    case PROP_PORT:
+    {
+      GSocketAddress *addr;
+      gint port = 0;
+
+      addr = g_socket_get_local_address (src->socket, NULL);
+      if (addr) {
+        port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr));
+        g_object_unref (addr);
+      }
+      g_value_set_int (value, port);
+      break;
+    }
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, propid, pspec);
+  }
+}
+
+static gboolean
+gst_rtsp_udp_src_start (GstBaseSrc * bsrc)
+{
+  GstRTSPUdpSrc *src = GST_RTSP_UDP_SRC (bsrc);
+  GstStructure *config;
+
+  src->pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (src->pool);
+  gst_buffer_pool_config_set_params (config, NULL, PACKET_SIZE, 0, 0);
+  if (!gst_buffer_pool_set_config (src->pool, config) ||
+      !gst_buffer_pool_set_active (src->pool, TRUE))
+    goto no_pool;
+
+  src->messages = g_new0 (GInputMessage, src->batch_size);
+  src->vectors = g_new0 (GInputVector, 2 * src->batch_size);
+  src->buffers = g_new0 (GstBuffer *, src->batch_size);
+  src->maps = g_new0 (GstMapInfo, src->batch_size);
+  src->addresses = g_new0 (GSocketAddress *, src->batch_size);
+  src->overflow = g_malloc ((gsize) src->batch_size *
+      (MAX_PACKET_SIZE - PACKET_SIZE));
+
+  return TRUE;
+
+  /* ERRORS */
+no_pool:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, SETTINGS, (NULL),
+        ("Could not configure the buffer pool"));
+    gst_object_unref (src->pool);
+    src->pool = NULL;
+    return FALSE;
+  }
+}
+
+static gboolean
+gst_rtsp_udp_src_stop (GstBaseSrc * bsrc)
+{
+  GstRTSPUdpSrc *src = GST_RTSP_UDP_SRC (bsrc);
+  guint i;
+
+  g_queue_foreach (&src->pending, (GFunc) gst_buffer_unref, NULL);
+  g_queue_clear (&src->pending);
+
+  for (i = 0; i < src->batch_size; i++) {
+    if (src->buffers[i])
+      gst_buffer_unref (src->buffers[i]);
+  }
+  g_free (src->messages);
+  g_free (src->vectors);
+  g_free (src->buffers);
+  g_free (src->maps);
+  g_free (src->addresses);
+  g_free (src->overflow);
+  src->messages = NULL;
+  src->vectors = NULL;
+  src->buffers = NULL;
+  src->maps = NULL;
+  src->addresses = NULL;
+  src->overflow = NULL;
+
+  gst_buffer_pool_set_active (src->pool, FALSE);
+  gst_object_unref (src->pool);
+  src->pool = NULL;
+
+  return TRUE;
+}
+
+static gboolean
+gst_rtsp_udp_src_unlock (GstBaseSrc * bsrc)
+{
+  GstRTSPUdpSrc *src = GST_RTSP_UDP_SRC (bsrc);
+
+  g_cancellable_cancel (src->cancellable);
+
+  return TRUE;
+}
+
+static gboolean
+gst_rtsp_udp_src_unlock_stop (GstBaseSrc * bsrc)
+{
+  GstRTSPUdpSrc *src = GST_RTSP_UDP_SRC (bsrc);
+
+  g_object_unref (src->cancellable);
+  src->cancellable = g_cancellable_new ();
+
+  return TRUE;
+}
+
+/* get a buffer for each slot and point the vectors of the message to it */
+static GstFlowReturn
+prepare_messages (GstRTSPUdpSrc * src)
+{
+  GstFlowReturn ret;
+  guint i;
+
+  for (i = 0; i < src->batch_size; i++) {
+    GInputMessage *msg = &src->messages[i];
+    GInputVector *vectors = &src->vectors[2 * i];
+
+    if (src->buffers[i] == NULL) {
+      ret = gst_buffer_pool_acquire_buffer (src->pool, &src->buffers[i], NULL);
+      if (ret != GST_FLOW_OK)
+        goto failed;
+    }
+    if (!gst_buffer_map (src->buffers[i], &src->maps[i], GST_MAP_WRITE)) {
+      ret = GST_FLOW_ERROR;
+      goto failed;
+    }
+
+    vectors[0].buffer = src->maps[i].data;
+    vectors[0].size = src->maps[i].size;
+    vectors[1].buffer = src->overflow + (gsize) i * (MAX_PACKET_SIZE -
+        PACKET_SIZE);
+    vectors[1].size = MAX_PACKET_SIZE - PACKET_SIZE;
+
+    src->addresses[i] = NULL;
+    msg->address = &src->addresses[i];
+    msg->vectors = vectors;
+    msg->num_vectors = 2;
+    msg->bytes_received = 0;
+    msg->flags = 0;
+    msg->control_messages = NULL;
+    msg->num_control_messages = NULL;
+  }
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+failed:
+  {
+    while (i > 0) {
+      i--;
+      gst_buffer_unmap (src->buffers[i], &src->maps[i]);
+    }
+    return ret;
+  }
+}
+
+/* receive as many datagrams as are available, waiting for the first one */
+static gint
+receive_messages (GstRTSPUdpSrc * src, GError ** err)
+{
+#if GLIB_CHECK_VERSION(2,48,0)
+  return g_socket_receive_messages (src->socket, src->messages,
+      src->batch_size, 0, src->cancellable, err);
+#else
+  guint i;
+
+  for (i = 0; i < src->batch_size; i++) {
+    GInputMessage *msg = &src->messages[i];
+    gssize res;
+
+    if (i > 0 && !(g_socket_condition_check (src->socket, G_IO_IN) & G_IO_IN))
+      break;
+
+    res = g_socket_receive_message (src->socket, msg->address, msg->vectors,
+        msg->num_vectors, NULL, NULL, &msg->flags, src->cancellable,
+        i == 0 ? err : NULL);
+    if (res < 0) {
+      if (i == 0)
+        return -1;
+      break;
+    }
+    msg->bytes_received = res;
+  }
+  return i;
+#endif
+}
+
+/* make a buffer of the datagram in slot @i */
+static GstBuffer *
+take_buffer (GstRTSPUdpSrc * src, guint i, GstClockTime timestamp)
+{
+  GInputMessage *msg = &src->messages[i];
+  GstBuffer *buffer;
+  gsize size = msg->bytes_received;
+
+  if (size <= PACKET_SIZE) {
+    buffer = src->buffers[i];
+    src->buffers[i] = NULL;
+    gst_buffer_unmap (buffer, &src->maps[i]);
+    gst_buffer_set_size (buffer, size);
+  } else {
+    /* the datagram continues in the overflow area, copy it together */
+    buffer = gst_buffer_new_allocate (NULL, size, NULL);
+    gst_buffer_fill (buffer, 0, src->maps[i].data, PACKET_SIZE);
+    gst_buffer_fill (buffer, PACKET_SIZE, msg->vectors[1].buffer,
+        size - PACKET_SIZE);
+  }
+
+  GST_BUFFER_DTS (buffer) = timestamp;
+
+  if (src->addresses[i]) {
+    gst_buffer_add_net_address_meta (buffer, src->addresses[i]);
+    g_object_unref (src->addresses[i]);
+    src->addresses[i] = NULL;
+  }
+
+  return buffer;
+}
+
+static GstClockTime
+get_running_time (GstRTSPUdpSrc * src)
+{
+  GstElement *element = GST_ELEMENT_CAST (src);
+  GstClockTime res = GST_CLOCK_TIME_NONE;
+  GstClock *clock;
+
+  GST_OBJECT_LOCK (element);
+  if ((clock = GST_ELEMENT_CLOCK (element))) {
+    GstClockTime base_time = element->base_time;
+
+    gst_object_ref (clock);
+    GST_OBJECT_UNLOCK (element);
+    res = gst_clock_get_time (clock) - base_time;
+    gst_object_unref (clock);
+  } else {
+    GST_OBJECT_UNLOCK (element);
+  }
+  return res;
+}
+
+static GstFlowReturn
+gst_rtsp_udp_src_create (GstPushSrc * psrc, GstBuffer ** buf)
+{
+  GstRTSPUdpSrc *src = GST_RTSP_UDP_SRC (psrc);
+  GstFlowReturn ret;
+  GstClockTime timestamp;
+  GError *err = NULL;
+  gint i, n;
+
+  if (!g_queue_is_empty (&src->pending)) {
+    *buf = g_queue_pop_head (&src->pending);
+    return GST_FLOW_OK;
+  }
+
+  ret = prepare_messages (src);
+  if (ret != GST_FLOW_OK)
+    goto prepare_failed;
+
+  while (TRUE) {
+    if (!g_socket_condition_wait (src->socket, G_IO_IN | G_IO_PRI,
+            src->cancellable, &err))
+      goto wait_failed;
+
+    n = receive_messages (src, &err);
+    if (n > 0)
+      break;
+
+    if (n == 0)
+      continue;
+
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      goto flushing;
+    if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK) &&
+        !g_error_matches (err, G_IO_ERROR, G_IO_ERROR_HOST_UNREACHABLE)
+#if GLIB_CHECK_VERSION(2,44,0)
+        && !g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CONNECTION_REFUSED)
+#endif
+        )
+      goto receive_failed;
+
+    /* ICMP errors of earlier sends are reported on the socket, like udpsrc
+     * we ignore them */
+    GST_LOG_OBJECT (src, "ignoring error: %s", err->message);
+    g_clear_error (&err);
+  }
+
+  timestamp = get_running_time (src);
+  for (i = 0; i < n; i++) {
+    GstBuffer *buffer = take_buffer (src, i, timestamp);
+
+    g_queue_push_tail (&src->pending, buffer);
+  }
+  for (i = 0; i < (gint) src->batch_size; i++) {
+    if (src->buffers[i])
+      gst_buffer_unmap (src->buffers[i], &src->maps[i]);
+    if (src->addresses[i]) {
+      g_object_unref (src->addresses[i]);
+      src->addresses[i] = NULL;
+    }
+  }
+
+  GST_OBJECT_LOCK (src);
+  src->batches++;
+  src->packets += n;
+  src->max_batch = MAX (src->max_batch, (guint) n);
+  GST_OBJECT_UNLOCK (src);
+
+  GST_LOG_OBJECT (src, "received %d packets", n);
+
+#if GST_CHECK_VERSION(1,13,1)
+  if (n > 1) {
+    GstBufferList *list = gst_buffer_list_new_sized (n);
+    GstBuffer *buffer;
+
+    while ((buffer = g_queue_pop_head (&src->pending)))
+      gst_buffer_list_add (list, buffer);
+
+    gst_base_src_submit_buffer_list (GST_BASE_SRC (src), list);
+    *buf = NULL;
+    return GST_FLOW_OK;
+  }
+#endif
+
+  *buf = g_queue_pop_head (&src->pending);
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+prepare_failed:
+  {
+    if (ret == GST_FLOW_ERROR)
+      GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+          ("Could not map buffer"));
+    return ret;
+  }
+wait_failed:
+  {
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      goto flushing;
+
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("Select error: %s", err->message));
+    g_clear_error (&err);
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+receive_failed:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("Receive error: %s", err->message));
+    g_clear_error (&err);
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+flushing:
+  {
+    GST_DEBUG_OBJECT (src, "cancelled");
+    g_clear_error (&err);
+    ret = GST_FLOW_FLUSHING;
+    goto done;
+  }
+done:
+  {
+    for (i = 0; i < (gint) src->batch_size; i++) {
+      if (src->buffers[i])
+        gst_buffer_unmap (src->buffers[i], &src->maps[i]);
+    }
+    return ret;
+  }
+}
+
+/* create a source that receives up to @batch_size datagrams at a time from
+ * @socket */
+GstElement *
+gst_rtsp_udp_src_new (GSocket * socket, guint batch_size)
+{
+  GstRTSPUdpSrc *src;
+
+  g_return_val_if_fail (G_IS_SOCKET (socket), NULL);
+  g_return_val_if_fail (batch_size > 0, NULL);
+
+  src = g_object_new (GST_TYPE_RTSP_UDP_SRC, NULL);
+  src->socket = g_object_ref (socket);
+  src->batch_size = batch_size;
+
+  return GST_ELEMENT_CAST (src);
+}
+
+/* check if @element was made with gst_rtsp_udp_src_new() */
+gboolean
+gst_rtsp_udp_src_is_batched (GstElement * element)
+{
+  return G_TYPE_CHECK_INSTANCE_TYPE (element, GST_TYPE_RTSP_UDP_SRC);
+}
+
+/* add the receive statistics of @element to the counters */
+void
+gst_rtsp_udp_src_get_stats (GstElement * element, guint64 * batches,
+    guint64 * packets, guint * max_batch)
+{
+  GstRTSPUdpSrc *src;
+
+  g_return_if_fail (gst_rtsp_udp_src_is_batched (element));
+
+  src = GST_RTSP_UDP_SRC (element);
+
+  GST_OBJECT_LOCK (src);
+  *batches += src->batches;
+  *packets += src->packets;
+  *max_batch = MAX (*max_batch, src->max_batch);
+  GST_OBJECT_UNLOCK (src);
+}
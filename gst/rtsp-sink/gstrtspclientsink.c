@@ -3484,6 +3484,108 @@ static const guint profile_masks[] = {
   0
 };
 
+/* maximum number of memories in a buffer we write without copying */
+#define DIRECT_SEND_MAX_MEMORIES 16
+
+/* Write the interleaved header and the memory of @buffer to the socket with
+ * one vectored write, without copying the data into a message first. TLS and
+ * tunneled connections need the data to be encoded, for those this returns
+ * GST_RTSP_EINTR without writing anything and the regular path is used. */
+static GstRTSPResult
+send_data_direct (GstRTSPClientSink * sink, GstRTSPConnInfo * conninfo,
+    GstBuffer * buffer, guint8 channel)
+{
+  GOutputVector vectors[DIRECT_SEND_MAX_MEMORIES + 1];
+  GstMapInfo maps[DIRECT_SEND_MAX_MEMORIES];
+  GstRTSPResult res = GST_RTSP_OK;
+  GstRTSPUrl *url;
+  GSocket *socket;
+  GError *err = NULL;
+  guint8 header[4];
+  gint64 timeout = -1;
+  gsize size;
+  gssize written;
+  guint i, n_mem, first = 0;
+
+  if (conninfo->connection == NULL || sink->debug ||
+      gst_rtsp_connection_is_tunneled (conninfo->connection))
+    return GST_RTSP_EINTR;
+
+  url = gst_rtsp_connection_get_url (conninfo->connection);
+  if (url == NULL || (url->transports & GST_RTSP_LOWER_TRANS_TLS))
+    return GST_RTSP_EINTR;
+
+  n_mem = gst_buffer_n_memory (buffer);
+  size = gst_buffer_get_size (buffer);
+  if (n_mem == 0 || n_mem > DIRECT_SEND_MAX_MEMORIES || size > G_MAXUINT16)
+    return GST_RTSP_EINTR;
+
+  header[0] = '$';
+  header[1] = channel;
+  GST_WRITE_UINT16_BE (&header[2], size);
+  vectors[0].buffer = header;
+  vectors[0].size = sizeof (header);
+
+  for (i = 0; i < n_mem; i++) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+
+    if (!gst_memory_map (mem, &maps[i], GST_MAP_READ)) {
+      n_mem = i;
+      res = GST_RTSP_EINTR;
+      goto done;
+    }
+    vectors[i + 1].buffer = maps[i].data;
+    vectors[i + 1].size = maps[i].size;
+  }
+
+  if (sink->ptcp_timeout)
+    timeout = GST_TIMEVAL_TO_TIME (*sink->ptcp_timeout) / GST_USECOND;
+
+  g_mutex_lock (&conninfo->send_lock);
+  socket = gst_rtsp_connection_get_write_socket (conninfo->connection);
+  while (first < n_mem + 1) {
+    written = g_socket_send_message (socket, NULL, &vectors[first],
+        n_mem + 1 - first, NULL, 0, G_SOCKET_MSG_NONE, NULL, &err);
+
+    if (written < 0) {
+      if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+        break;
+      g_clear_error (&err);
+      if (!g_socket_condition_timed_wait (socket, G_IO_OUT, timeout, NULL,
+              &err))
+        break;
+      continue;
+    }
+
+    /* skip what was written, a blocking socket can still write less than we
+     * asked for when interrupted */
+    while (first < n_mem + 1 && (gsize) written >= vectors[first].size) {
+      written -= vectors[first].size;
+      first++;
+    }
+    if (first < n_mem + 1) {
+      vectors[first].buffer = (const guint8 *) vectors[first].buffer + written;
+      vectors[first].size -= written;
+    }
+  }
+  g_mutex_unlock (&conninfo->send_lock);
+
+  if (err) {
+    GST_DEBUG_OBJECT (sink, "failed to send data: %s", err->message);
+    res = g_error_matches (err, G_IO_ERROR, G_IO_ERROR_TIMED_OUT) ?
+        GST_RTSP_ETIMEOUT : GST_RTSP_ESYS;
+    g_clear_error (&err);
+  } else {
+    gst_rtsp_connection_reset_timeout (conninfo->connection);
+  }
+
+done:
+  for (i = 0; i < n_mem; i++)
+    gst_memory_unmap (gst_buffer_peek_memory (buffer, i), &maps[i]);
+
+  return res;
+}
+
 static gboolean
 do_send_data (GstBuffer * buffer, guint8 channel,
     GstRTSPStreamContext * context)
@@ -3495,9 +3597,14 @@ do_send_data (GstBuffer * buffer, guint8 channel,
   guint8 *data;
   guint usize;
 
+  g_mutex_lock (&sink->send_lock);
+  res = send_data_direct (sink, &sink->conninfo, buffer, channel);
+  g_mutex_unlock (&sink->send_lock);
+  if (res != GST_RTSP_EINTR)
+    return res == GST_RTSP_OK;
+
   gst_rtsp_message_init_data (&message, channel);
 
-  /* FIXME, need some sort of iovec RTSPMessage here */
   if (!gst_buffer_map (buffer, &map_info, GST_MAP_READ))
     return FALSE;
 
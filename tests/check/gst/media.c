@@ -210,6 +210,286 @@ GST_START_TEST (test_media_prepare)
 
 GST_END_TEST;
 
+GST_START_TEST (test_media_prepare_timeout)
+{
+  GstRTSPMediaFactory *factory;
+  GstRTSPMedia *media;
+  GstRTSPUrl *url;
+  GstRTSPThreadPool *pool;
+  GstRTSPThread *thread;
+  gint64 start;
+
+  pool = gst_rtsp_thread_pool_new ();
+
+  factory = gst_rtsp_media_factory_new ();
+  fail_unless (gst_rtsp_url_parse ("rtsp://localhost:8554/test",
+          &url) == GST_RTSP_OK);
+
+  /* appsrc never produces data, so this pipeline never prerolls */
+  gst_rtsp_media_factory_set_launch (factory,
+      "( appsrc ! rtpgstpay pt=96 name=pay0 )");
+  fail_unless_equals_int (gst_rtsp_media_factory_get_prepare_timeout (factory),
+      20);
+  gst_rtsp_media_factory_set_prepare_timeout (factory, 1);
+
+  media = gst_rtsp_media_factory_construct (factory, url);
+  fail_unless (GST_IS_RTSP_MEDIA (media));
+  fail_unless_equals_int (gst_rtsp_media_get_prepare_timeout (media), 1);
+
+  thread = gst_rtsp_thread_pool_get_thread (pool,
+      GST_RTSP_THREAD_TYPE_MEDIA, NULL);
+  start = g_get_monotonic_time ();
+  fail_if (gst_rtsp_media_prepare (media, thread));
+  fail_unless (g_get_monotonic_time () - start < 10 * G_TIME_SPAN_SECOND);
+
+  g_object_unref (media);
+  gst_rtsp_url_free (url);
+  g_object_unref (factory);
+
+  g_object_unref (pool);
+  gst_rtsp_thread_pool_cleanup ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_media_pacing)
+{
+  GstRTSPMediaFactory *factory;
+  GstRTSPMedia *media;
+  GstRTSPStream *stream;
+  GstRTSPUrl *url;
+
+  factory = gst_rtsp_media_factory_new ();
+  fail_unless (gst_rtsp_url_parse ("rtsp://localhost:8554/test",
+          &url) == GST_RTSP_OK);
+
+  gst_rtsp_media_factory_set_launch (factory,
+      "( videotestsrc ! rtpvrawpay pt=96 name=pay0 )");
+  fail_if (gst_rtsp_media_factory_get_pacing (factory));
+  g_object_set (factory, "pacing", TRUE, NULL);
+  fail_unless (gst_rtsp_media_factory_get_pacing (factory));
+
+  media = gst_rtsp_media_factory_construct (factory, url);
+  fail_unless (GST_IS_RTSP_MEDIA (media));
+  fail_unless (gst_rtsp_media_get_pacing (media));
+
+  stream = gst_rtsp_media_get_stream (media, 0);
+  fail_unless (stream != NULL);
+  fail_unless (gst_rtsp_stream_get_pacing (stream));
+
+  g_object_unref (media);
+  gst_rtsp_url_free (url);
+  g_object_unref (factory);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_media_sdp_cache)
+{
+  GstRTSPMediaFactory *factory;
+  GstRTSPMedia *media;
+  GstRTSPStream *stream;
+  GstRTSPUrl *url;
+  GstRTSPThreadPool *pool;
+  GstRTSPThread *thread;
+  GstSDPMessage *sdp1, *sdp2, *sdp3, *sdp4;
+  GstSDPInfo info;
+  const GstSDPMedia *smedia;
+  GstPad *srcpad;
+  gchar *str1, *str2;
+
+  pool = gst_rtsp_thread_pool_new ();
+
+  factory = gst_rtsp_media_factory_new ();
+  fail_unless (gst_rtsp_url_parse ("rtsp://localhost:8554/test",
+          &url) == GST_RTSP_OK);
+  gst_rtsp_media_factory_set_launch (factory,
+      "( videotestsrc ! rtpvrawpay pt=96 name=pay0 )");
+
+  media = gst_rtsp_media_factory_construct (factory, url);
+  fail_unless (GST_IS_RTSP_MEDIA (media));
+  thread = gst_rtsp_thread_pool_get_thread (pool,
+      GST_RTSP_THREAD_TYPE_MEDIA, NULL);
+  fail_unless (gst_rtsp_media_prepare (media, thread));
+
+  info.is_ipv6 = FALSE;
+  info.server_ip = (gchar *) "127.0.0.1";
+
+  /* the second SDP gets the same media sections */
+  gst_sdp_message_new (&sdp1);
+  fail_unless (gst_rtsp_media_setup_sdp (media, sdp1, &info));
+  gst_sdp_message_new (&sdp2);
+  fail_unless (gst_rtsp_media_setup_sdp (media, sdp2, &info));
+  fail_unless_equals_int (gst_sdp_message_medias_len (sdp1), 1);
+  fail_unless_equals_int (gst_sdp_message_medias_len (sdp2), 1);
+  str1 = gst_sdp_message_as_text (sdp1);
+  str2 = gst_sdp_message_as_text (sdp2);
+  fail_unless_equals_string (str1, str2);
+  g_free (str1);
+  g_free (str2);
+
+  /* changing the stream updates the media section */
+  stream = gst_rtsp_media_get_stream (media, 0);
+  gst_rtsp_stream_set_control (stream, "changed");
+  gst_sdp_message_new (&sdp3);
+  fail_unless (gst_rtsp_media_setup_sdp (media, sdp3, &info));
+  fail_unless_equals_int (gst_sdp_message_medias_len (sdp3), 1);
+  smedia = gst_sdp_message_get_media (sdp3, 0);
+  fail_unless_equals_string (gst_sdp_media_get_attribute_val (smedia,
+          "control"), "changed");
+
+  /* and so does a new bitrate tag */
+  srcpad = gst_rtsp_stream_get_srcpad (stream);
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_tag (gst_tag_list_new (GST_TAG_BITRATE, 128000,
+                  NULL))));
+  gst_object_unref (srcpad);
+  gst_sdp_message_new (&sdp4);
+  fail_unless (gst_rtsp_media_setup_sdp (media, sdp4, &info));
+  smedia = gst_sdp_message_get_media (sdp4, 0);
+  fail_unless_equals_int (gst_sdp_media_bandwidths_len (smedia), 1);
+  fail_unless_equals_int (gst_sdp_media_get_bandwidth (smedia, 0)->bandwidth,
+      128);
+
+  gst_sdp_message_free (sdp1);
+  gst_sdp_message_free (sdp2);
+  gst_sdp_message_free (sdp3);
+  gst_sdp_message_free (sdp4);
+
+  fail_unless (gst_rtsp_media_unprepare (media));
+  g_object_unref (media);
+  gst_rtsp_url_free (url);
+  g_object_unref (factory);
+
+  g_object_unref (pool);
+  gst_rtsp_thread_pool_cleanup ();
+}
+
+GST_END_TEST;
+
+static gboolean
+udpsinks_have_client (GstBin * bin, const gchar * host)
+{
+  GstIterator *it;
+  GValue item = G_VALUE_INIT;
+  gboolean found = FALSE;
+
+  it = gst_bin_iterate_recurse (bin);
+  while (gst_iterator_next (it, &item) == GST_ITERATOR_OK) {
+    GstElement *element = g_value_get_object (&item);
+    GstElementFactory *factory = gst_element_get_factory (element);
+    gchar *clients = NULL;
+
+    if (factory && !g_strcmp0 (GST_OBJECT_NAME (factory), "multiudpsink")) {
+      g_object_get (element, "clients", &clients, NULL);
+      if (clients && strstr (clients, host))
+        found = TRUE;
+      g_free (clients);
+    }
+    g_value_reset (&item);
+  }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  return found;
+}
+
+/* prepare a media with @udp_fanout and check if a unicast destination ends up
+ * on the udpsinks of the pipeline */
+static void
+check_udp_fanout (GstRTSPThreadPool * pool, gboolean udp_fanout)
+{
+  GstRTSPMediaFactory *factory;
+  GstRTSPAddressPool *addresses;
+  GstRTSPMedia *media;
+  GstRTSPStream *stream;
+  GstRTSPThread *thread;
+  GstRTSPTransport *tr;
+  GstRTSPStreamTransport *trans;
+  GstRTSPUrl *url;
+  GstElement *element;
+  GSocket *socket;
+
+  factory = gst_rtsp_media_factory_new ();
+  fail_unless (gst_rtsp_url_parse ("rtsp://localhost:8554/test",
+          &url) == GST_RTSP_OK);
+  gst_rtsp_media_factory_set_launch (factory,
+      "( videotestsrc ! rtpvrawpay pt=96 name=pay0 )");
+
+  addresses = gst_rtsp_address_pool_new ();
+  fail_unless (gst_rtsp_address_pool_add_range (addresses,
+          GST_RTSP_ADDRESS_POOL_ANY_IPV4, GST_RTSP_ADDRESS_POOL_ANY_IPV4, 50000,
+          60000, 0));
+  gst_rtsp_media_factory_set_address_pool (factory, addresses);
+  g_object_unref (addresses);
+
+  fail_if (gst_rtsp_media_factory_get_udp_fanout (factory));
+  g_object_set (factory, "udp-fanout", udp_fanout, NULL);
+
+  media = gst_rtsp_media_factory_construct (factory, url);
+  fail_unless (GST_IS_RTSP_MEDIA (media));
+  fail_unless (gst_rtsp_media_get_udp_fanout (media) == udp_fanout);
+
+  thread = gst_rtsp_thread_pool_get_thread (pool,
+      GST_RTSP_THREAD_TYPE_MEDIA, NULL);
+  fail_unless (gst_rtsp_media_prepare (media, thread));
+
+  stream = gst_rtsp_media_get_stream (media, 0);
+  fail_unless (stream != NULL);
+  fail_unless (gst_rtsp_stream_get_udp_fanout (stream) == udp_fanout);
+
+  socket = gst_rtsp_stream_get_rtp_socket (stream, G_SOCKET_FAMILY_IPV4);
+  if (socket == NULL) {
+    GST_INFO ("no IPv4 support, skipping");
+    goto done;
+  }
+  g_object_unref (socket);
+
+  fail_unless (gst_rtsp_transport_new (&tr) == GST_RTSP_OK);
+  tr->lower_transport = GST_RTSP_LOWER_TRANS_UDP;
+  tr->destination = g_strdup ("127.0.0.1");
+  tr->client_port.min = 5000;
+  tr->client_port.max = 5001;
+  trans = gst_rtsp_stream_transport_new (stream, tr);
+  fail_unless (gst_rtsp_stream_add_transport (stream, trans));
+
+  /* the pipeline of the media contains the udpsinks of the stream */
+  element = gst_rtsp_media_get_element (media);
+  if (udp_fanout)
+    fail_if (udpsinks_have_client (GST_BIN (GST_OBJECT_PARENT (element)),
+            "127.0.0.1"));
+  else
+    fail_unless (udpsinks_have_client (GST_BIN (GST_OBJECT_PARENT (element)),
+            "127.0.0.1"));
+  gst_object_unref (element);
+
+  fail_unless (gst_rtsp_stream_remove_transport (stream, trans));
+  g_object_unref (trans);
+
+done:
+  fail_unless (gst_rtsp_media_unprepare (media));
+  g_object_unref (media);
+  gst_rtsp_url_free (url);
+  g_object_unref (factory);
+}
+
+GST_START_TEST (test_media_udp_fanout)
+{
+  GstRTSPThreadPool *pool;
+
+  pool = gst_rtsp_thread_pool_new ();
+
+  /* unicast destinations go to the udpsinks, or to the sender of the stream
+   * with udp-fanout */
+  check_udp_fanout (pool, FALSE);
+  check_udp_fanout (pool, TRUE);
+
+  g_object_unref (pool);
+  gst_rtsp_thread_pool_cleanup ();
+}
+
+GST_END_TEST;
+
 #define FLAG_HAVE_CAPS GST_ELEMENT_FLAG_LAST
 static void
 on_notify_caps (GstPad * pad, GParamSpec * pspec, GstElement * pay)
@@ -457,6 +737,10 @@ rtspmedia_suite (void)
   tcase_add_test (tc, test_launch);
   tcase_add_test (tc, test_media);
   tcase_add_test (tc, test_media_prepare);
+  tcase_add_test (tc, test_media_prepare_timeout);
+  tcase_add_test (tc, test_media_pacing);
+  tcase_add_test (tc, test_media_sdp_cache);
+  tcase_add_test (tc, test_media_udp_fanout);
   tcase_add_test (tc, test_media_dyn_prepare);
   tcase_add_test (tc, test_media_take_pipeline);
   tcase_add_test (tc, test_media_reset);
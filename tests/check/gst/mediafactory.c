@@ -65,6 +65,140 @@ GST_START_TEST (test_launch)
 
 GST_END_TEST;
 
+GST_START_TEST (test_launch_template)
+{
+  GstRTSPMediaFactory *factory;
+  GstElement *element, *pay, *filter, *src;
+  GstRTSPUrl *url;
+  GstPad *pad, *peer;
+  GstCaps *caps, *expected;
+  gchar *src_name = NULL;
+  gboolean is_live;
+  guint pt, i;
+
+  factory = gst_rtsp_media_factory_new ();
+  fail_unless (gst_rtsp_url_parse ("rtsp://localhost:8554/test",
+          &url) == GST_RTSP_OK);
+
+  gst_rtsp_media_factory_set_launch (factory,
+      "( videotestsrc is-live=true ! video/x-raw,width=320 ! "
+      "rtpvrawpay pt=97 name=pay0 )");
+
+  expected = gst_caps_from_string ("video/x-raw,width=320");
+
+  /* the first element is parsed, the others are copies of it */
+  for (i = 0; i < 3; i++) {
+    element = gst_rtsp_media_factory_create_element (factory, url);
+    fail_unless (GST_IS_BIN (element));
+    fail_unless (GST_BIN_NUMCHILDREN (element) == 3);
+
+    pay = gst_bin_get_by_name (GST_BIN (element), "pay0");
+    fail_unless (pay != NULL);
+    g_object_get (pay, "pt", &pt, NULL);
+    fail_unless (pt == 97);
+
+    /* the capsfilter is linked to the payloader */
+    pad = gst_element_get_static_pad (pay, "sink");
+    peer = gst_pad_get_peer (pad);
+    fail_unless (peer != NULL);
+    filter = gst_pad_get_parent_element (peer);
+    g_object_get (filter, "caps", &caps, NULL);
+    fail_unless (gst_caps_is_equal (caps, expected));
+    gst_caps_unref (caps);
+    gst_object_unref (peer);
+    gst_object_unref (pad);
+
+    /* and the source to the capsfilter */
+    pad = gst_element_get_static_pad (filter, "sink");
+    peer = gst_pad_get_peer (pad);
+    fail_unless (peer != NULL);
+    src = gst_pad_get_parent_element (peer);
+    g_object_get (src, "is-live", &is_live, NULL);
+    fail_unless (is_live);
+
+    /* the parser gives every new element a new name, the copies have the
+     * names of the parsed element */
+    if (i == 0)
+      src_name = gst_element_get_name (src);
+    else
+      fail_unless_equals_string (GST_OBJECT_NAME (src), src_name);
+
+    gst_object_unref (src);
+    gst_object_unref (filter);
+    gst_object_unref (peer);
+    gst_object_unref (pad);
+    gst_object_unref (pay);
+    gst_object_unref (element);
+  }
+  gst_caps_unref (expected);
+  g_free (src_name);
+
+  gst_rtsp_url_free (url);
+  g_object_unref (factory);
+}
+
+GST_END_TEST;
+
+static gchar *
+get_source_name (GstElement * element)
+{
+  GstElement *pay, *src;
+  GstPad *pad, *peer;
+  gchar *name;
+
+  pay = gst_bin_get_by_name (GST_BIN (element), "pay0");
+  fail_unless (pay != NULL);
+  pad = gst_element_get_static_pad (pay, "sink");
+  peer = gst_pad_get_peer (pad);
+  fail_unless (peer != NULL);
+  src = gst_pad_get_parent_element (peer);
+  name = gst_element_get_name (src);
+
+  gst_object_unref (src);
+  gst_object_unref (peer);
+  gst_object_unref (pad);
+  gst_object_unref (pay);
+
+  return name;
+}
+
+GST_START_TEST (test_launch_template_child_proxy)
+{
+  GstRTSPMediaFactory *factory;
+  GstElement *element;
+  GstRTSPUrl *url;
+  gchar *name, *name2;
+
+  factory = gst_rtsp_media_factory_new ();
+  fail_unless (gst_rtsp_url_parse ("rtsp://localhost:8554/test",
+          &url) == GST_RTSP_OK);
+
+  /* the launch line could set properties of the children of rtpbin, which
+   * the template can't copy, so it is parsed every time */
+  gst_rtsp_media_factory_set_launch (factory,
+      "( videotestsrc ! rtpvrawpay pt=97 name=pay0 rtpbin name=rb )");
+
+  element = gst_rtsp_media_factory_create_element (factory, url);
+  fail_unless (GST_IS_BIN (element));
+  name = get_source_name (element);
+  gst_object_unref (element);
+
+  element = gst_rtsp_media_factory_create_element (factory, url);
+  fail_unless (GST_IS_BIN (element));
+  name2 = get_source_name (element);
+  gst_object_unref (element);
+
+  /* the parser gave the source a new name */
+  fail_if (g_str_equal (name, name2));
+  g_free (name);
+  g_free (name2);
+
+  gst_rtsp_url_free (url);
+  g_object_unref (factory);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_launch_construct)
 {
   GstRTSPMediaFactory *factory;
@@ -314,6 +448,134 @@ GST_START_TEST (test_reset)
 
 GST_END_TEST;
 
+static guint
+get_warm_pool_stat (GstRTSPMediaFactory * factory, const gchar * field)
+{
+  GstStructure *stats;
+  guint64 value64;
+  guint value;
+
+  stats = gst_rtsp_media_factory_get_warm_pool_stats (factory);
+  if (g_str_equal (field, "ready")) {
+    fail_unless (gst_structure_get_uint (stats, field, &value));
+  } else {
+    fail_unless (gst_structure_get_uint64 (stats, field, &value64));
+    value = value64;
+  }
+  gst_structure_free (stats);
+
+  return value;
+}
+
+GST_START_TEST (test_warm_pool)
+{
+  GstRTSPMediaFactory *factory;
+  GstRTSPMedia *media;
+  GstRTSPUrl *url;
+  GstRTSPThreadPool *pool, *tmp;
+  GstRTSPThread *thread;
+  gint i;
+
+  factory = gst_rtsp_media_factory_new ();
+  fail_unless (gst_rtsp_media_factory_get_warm_pool_size (factory) == 0);
+
+  /* we construct without a client, give the warm pool a thread pool */
+  fail_unless (gst_rtsp_media_factory_get_thread_pool (factory) == NULL);
+  pool = gst_rtsp_thread_pool_new ();
+  gst_rtsp_media_factory_set_thread_pool (factory, pool);
+  tmp = gst_rtsp_media_factory_get_thread_pool (factory);
+  fail_unless (tmp == pool);
+  g_object_unref (tmp);
+
+  gst_rtsp_media_factory_set_warm_pool_size (factory, 1);
+  fail_unless (gst_rtsp_media_factory_get_warm_pool_size (factory) == 1);
+  gst_rtsp_url_parse ("rtsp://localhost:8554/test", &url);
+
+  gst_rtsp_media_factory_set_launch (factory,
+      "( videotestsrc ! rtpvrawpay pt=96 name=pay0 )");
+
+  /* nothing was requested yet, the first media is constructed */
+  media = gst_rtsp_media_factory_construct (factory, url);
+  fail_unless (GST_IS_RTSP_MEDIA (media));
+  fail_unless (gst_rtsp_media_get_status (media) ==
+      GST_RTSP_MEDIA_STATUS_UNPREPARED);
+  g_object_unref (media);
+  fail_unless (get_warm_pool_stat (factory, "misses") == 1);
+
+  /* wait for the pool to prepare a media for the url */
+  for (i = 0; i < 100 && get_warm_pool_stat (factory, "ready") == 0; i++)
+    g_usleep (50 * 1000);
+  fail_unless (get_warm_pool_stat (factory, "ready") == 1);
+
+  media = gst_rtsp_media_factory_construct (factory, url);
+  fail_unless (GST_IS_RTSP_MEDIA (media));
+  fail_unless (gst_rtsp_media_get_status (media) ==
+      GST_RTSP_MEDIA_STATUS_PREPARED);
+  fail_unless (get_warm_pool_stat (factory, "hits") == 1);
+  fail_unless (get_warm_pool_stat (factory, "misses") == 1);
+
+  thread = gst_rtsp_thread_pool_get_thread (pool,
+      GST_RTSP_THREAD_TYPE_MEDIA, NULL);
+  fail_unless (gst_rtsp_media_prepare (media, thread));
+  fail_unless (gst_rtsp_media_unprepare (media));
+  fail_unless (gst_rtsp_media_get_status (media) ==
+      GST_RTSP_MEDIA_STATUS_UNPREPARED);
+  g_object_unref (media);
+
+  /* disabling the pool releases the prepared media */
+  gst_rtsp_media_factory_set_warm_pool_size (factory, 0);
+  fail_unless (get_warm_pool_stat (factory, "ready") == 0);
+
+  gst_rtsp_url_free (url);
+  g_object_unref (factory);
+  g_object_unref (pool);
+
+  gst_rtsp_thread_pool_cleanup ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_warm_pool_shared_thread)
+{
+  GstRTSPMediaFactory *factory;
+  GstRTSPMedia *media;
+  GstRTSPUrl *url;
+  GstRTSPThreadPool *pool;
+  gint i;
+
+  /* the warm pool fills from the only media thread, which also runs the
+   * media it prepares */
+  pool = gst_rtsp_thread_pool_new ();
+  gst_rtsp_thread_pool_set_max_media_threads (pool, 1);
+
+  factory = gst_rtsp_media_factory_new ();
+  gst_rtsp_media_factory_set_thread_pool (factory, pool);
+  gst_rtsp_media_factory_set_warm_pool_size (factory, 2);
+  gst_rtsp_media_factory_set_launch (factory,
+      "( videotestsrc ! rtpvrawpay pt=96 name=pay0 )");
+  gst_rtsp_url_parse ("rtsp://localhost:8554/test", &url);
+
+  media = gst_rtsp_media_factory_construct (factory, url);
+  fail_unless (GST_IS_RTSP_MEDIA (media));
+  g_object_unref (media);
+
+  /* both are prepared well within the prepare timeout */
+  for (i = 0; i < 100 && get_warm_pool_stat (factory, "ready") < 2; i++)
+    g_usleep (50 * 1000);
+  fail_unless (get_warm_pool_stat (factory, "ready") == 2);
+
+  gst_rtsp_media_factory_set_warm_pool_size (factory, 0);
+  fail_unless (get_warm_pool_stat (factory, "ready") == 0);
+
+  gst_rtsp_url_free (url);
+  g_object_unref (factory);
+  g_object_unref (pool);
+
+  gst_rtsp_thread_pool_cleanup ();
+}
+
+GST_END_TEST;
+
 static Suite *
 rtspmediafactory_suite (void)
 {
@@ -325,10 +587,14 @@ rtspmediafactory_suite (void)
   tcase_add_test (tc, test_parse_error);
   tcase_add_test (tc, test_launch);
   tcase_add_test (tc, test_launch_construct);
+  tcase_add_test (tc, test_launch_template);
+  tcase_add_test (tc, test_launch_template_child_proxy);
   tcase_add_test (tc, test_shared);
   tcase_add_test (tc, test_addresspool);
   tcase_add_test (tc, test_permissions);
   tcase_add_test (tc, test_reset);
+  tcase_add_test (tc, test_warm_pool);
+  tcase_add_test (tc, test_warm_pool_shared_thread);
 
   return s;
 }
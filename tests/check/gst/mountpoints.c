@@ -17,6 +17,8 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <string.h>
+
 #include <gst/check/gstcheck.h>
 
 #include <rtsp-mount-points.h>
@@ -130,6 +132,122 @@ GST_START_TEST (test_match)
 
 GST_END_TEST;
 
+GST_START_TEST (test_replace_remove)
+{
+  GstRTSPMountPoints *mounts;
+  GstRTSPMediaFactory *f1, *f2, *tmp;
+  gint matched;
+
+  mounts = gst_rtsp_mount_points_new ();
+
+  f1 = gst_rtsp_media_factory_new ();
+  f2 = gst_rtsp_media_factory_new ();
+  gst_rtsp_mount_points_add_factory (mounts, "/cam/main", f1);
+  gst_rtsp_mount_points_add_factory (mounts, "/cam/main/hd", f2);
+
+  /* removing a path that is not mounted leaves the others */
+  gst_rtsp_mount_points_remove_factory (mounts, "/cam");
+  gst_rtsp_mount_points_remove_factory (mounts, "/cam/main/sd");
+  tmp = gst_rtsp_mount_points_match (mounts, "/cam/main/hd/stream=0",
+      &matched);
+  fail_unless (tmp == f2);
+  fail_unless (matched == 12);
+  g_object_unref (tmp);
+
+  /* the shorter mount point matches again after removing the longer one */
+  gst_rtsp_mount_points_remove_factory (mounts, "/cam/main/hd");
+  tmp = gst_rtsp_mount_points_match (mounts, "/cam/main/hd/stream=0",
+      &matched);
+  fail_unless (tmp == f1);
+  fail_unless (matched == 9);
+  g_object_unref (tmp);
+
+  /* adding to the same path replaces the factory */
+  f2 = gst_rtsp_media_factory_new ();
+  gst_rtsp_mount_points_add_factory (mounts, "/cam/main", f2);
+  tmp = gst_rtsp_mount_points_match (mounts, "/cam/main", NULL);
+  fail_unless (tmp == f2);
+  g_object_unref (tmp);
+
+  gst_rtsp_mount_points_remove_factory (mounts, "/cam/main");
+  fail_unless (gst_rtsp_mount_points_match (mounts, "/cam/main",
+          &matched) == NULL);
+
+  g_object_unref (mounts);
+}
+
+GST_END_TEST;
+
+#define N_CAMERAS       10000
+#define N_PROFILES      3
+#define N_MATCHES       100000
+
+GST_START_TEST (test_match_large)
+{
+  GstRTSPMountPoints *mounts;
+  GstRTSPMediaFactory *factory, *tmp;
+  gint64 start;
+  gchar path[64];
+  gint i, j, matched;
+
+  mounts = gst_rtsp_mount_points_new ();
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_CAMERAS; i++) {
+    for (j = 0; j < N_PROFILES; j++) {
+      g_snprintf (path, sizeof (path), "/cameras/cam%d/profile%d", i, j);
+      gst_rtsp_mount_points_add_factory (mounts, path,
+          gst_rtsp_media_factory_new ());
+    }
+  }
+  GST_INFO ("added %d mount points in %" G_GINT64_FORMAT " us",
+      N_CAMERAS * N_PROFILES, g_get_monotonic_time () - start);
+
+  factory = gst_rtsp_media_factory_new ();
+  gst_rtsp_mount_points_add_factory (mounts, "/cameras/cam42/profile1",
+      g_object_ref (factory));
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_MATCHES; i++) {
+    g_snprintf (path, sizeof (path), "/cameras/cam%d/profile%d/stream=0",
+        i % N_CAMERAS, i % N_PROFILES);
+    tmp = gst_rtsp_mount_points_match (mounts, path, &matched);
+    fail_unless (tmp != NULL);
+    fail_unless (matched == (gint) (strlen (path) - strlen ("/stream=0")));
+    g_object_unref (tmp);
+  }
+  GST_INFO ("%d matches in %" G_GINT64_FORMAT " us", N_MATCHES,
+      g_get_monotonic_time () - start);
+
+  tmp = gst_rtsp_mount_points_match (mounts, "/cameras/cam42/profile1", NULL);
+  fail_unless (tmp == factory);
+  g_object_unref (tmp);
+  fail_unless (gst_rtsp_mount_points_match (mounts, "/cameras/cam42",
+          &matched) == NULL);
+  fail_unless (gst_rtsp_mount_points_match (mounts,
+          "/cameras/cam42/profile9", &matched) == NULL);
+
+  /* removing does not disturb the other mount points */
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_CAMERAS; i += 2) {
+    g_snprintf (path, sizeof (path), "/cameras/cam%d/profile0", i);
+    gst_rtsp_mount_points_remove_factory (mounts, path);
+  }
+  GST_INFO ("removed %d mount points in %" G_GINT64_FORMAT " us",
+      N_CAMERAS / 2, g_get_monotonic_time () - start);
+
+  fail_unless (gst_rtsp_mount_points_match (mounts,
+          "/cameras/cam42/profile0", NULL) == NULL);
+  tmp = gst_rtsp_mount_points_match (mounts, "/cameras/cam43/profile0", NULL);
+  fail_unless (tmp != NULL);
+  g_object_unref (tmp);
+
+  g_object_unref (factory);
+  g_object_unref (mounts);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtspmountpoints_suite (void)
 {
@@ -140,6 +258,8 @@ rtspmountpoints_suite (void)
   tcase_set_timeout (tc, 20);
   tcase_add_test (tc, test_create);
   tcase_add_test (tc, test_match);
+  tcase_add_test (tc, test_replace_remove);
+  tcase_add_test (tc, test_match_large);
 
   return s;
 }
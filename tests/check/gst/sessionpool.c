@@ -181,6 +181,186 @@ GST_START_TEST (test_pool)
 
 GST_END_TEST;
 
+#define N_THREADS       8
+#define N_CREATE        200
+#define MAX_SESSIONS    1000
+
+static gpointer
+create_sessions (GstRTSPSessionPool * pool)
+{
+  GList *created = NULL, *walk;
+  gint i;
+
+  for (i = 0; i < N_CREATE; i++) {
+    GstRTSPSession *session, *compare;
+
+    session = gst_rtsp_session_pool_create (pool);
+    if (session == NULL)
+      continue;
+
+    compare = gst_rtsp_session_pool_find (pool,
+        gst_rtsp_session_get_sessionid (session));
+    fail_unless (compare == session);
+    g_object_unref (compare);
+    created = g_list_prepend (created, session);
+  }
+
+  for (walk = created; walk; walk = walk->next)
+    g_object_unref (walk->data);
+
+  return GUINT_TO_POINTER (g_list_length (created));
+}
+
+static GstRTSPFilterResult
+remove_func (GstRTSPSessionPool * pool, GstRTSPSession * session,
+    gpointer user_data)
+{
+  return GST_RTSP_FILTER_REMOVE;
+}
+
+GST_START_TEST (test_pool_threads)
+{
+  GstRTSPSessionPool *pool;
+  GThread *threads[N_THREADS];
+  guint i, created = 0;
+  GList *list;
+
+  pool = gst_rtsp_session_pool_new ();
+  gst_rtsp_session_pool_set_max_sessions (pool, MAX_SESSIONS);
+
+  for (i = 0; i < N_THREADS; i++)
+    threads[i] = g_thread_new ("create", (GThreadFunc) create_sessions, pool);
+  for (i = 0; i < N_THREADS; i++)
+    created += GPOINTER_TO_UINT (g_thread_join (threads[i]));
+
+  /* the limit holds for all shards together */
+  fail_unless_equals_int (created, MAX_SESSIONS);
+  fail_unless_equals_int (gst_rtsp_session_pool_get_n_sessions (pool),
+      MAX_SESSIONS);
+
+  list = gst_rtsp_session_pool_filter (pool, NULL, NULL);
+  fail_unless_equals_int (g_list_length (list), MAX_SESSIONS);
+  g_list_free_full (list, (GDestroyNotify) g_object_unref);
+
+  list = gst_rtsp_session_pool_filter (pool, remove_func, NULL);
+  fail_unless (list == NULL);
+  fail_unless_equals_int (gst_rtsp_session_pool_get_n_sessions (pool), 0);
+
+  g_object_unref (pool);
+}
+
+GST_END_TEST;
+
+static gint
+get_watch_timeout (GMainContext * context)
+{
+  gint priority, timeout;
+  GPollFD fds[4];
+
+  g_main_context_prepare (context, &priority);
+  g_main_context_query (context, priority, &timeout, fds, G_N_ELEMENTS (fds));
+  g_main_context_check (context, priority, fds, 0);
+
+  return timeout;
+}
+
+GST_START_TEST (test_pool_watch_timeout)
+{
+  GstRTSPSessionPool *pool;
+  GstRTSPSession *session1, *session2;
+  GMainContext *context;
+  GSource *source;
+  gint timeout;
+
+  pool = gst_rtsp_session_pool_new ();
+  context = g_main_context_new ();
+  source = gst_rtsp_session_pool_create_watch (pool);
+  g_source_attach (source, context);
+
+  fail_unless_equals_int (get_watch_timeout (context), -1);
+
+  /* the default timeout of 60 seconds plus 5 seconds of slack */
+  session1 = gst_rtsp_session_pool_create (pool);
+  timeout = get_watch_timeout (context);
+  fail_unless (timeout > 60000 && timeout <= 65000);
+
+  /* the session that expires first determines the timeout */
+  session2 = gst_rtsp_session_pool_create (pool);
+  gst_rtsp_session_set_timeout (session2, 1);
+  timeout = get_watch_timeout (context);
+  fail_unless (timeout > 1000 && timeout <= 6000);
+
+  gst_rtsp_session_set_timeout (session2, 120);
+  timeout = get_watch_timeout (context);
+  fail_unless (timeout > 60000 && timeout <= 65000);
+
+  gst_rtsp_session_set_timeout (session2, 1);
+  fail_unless (gst_rtsp_session_pool_remove (pool, session2));
+  timeout = get_watch_timeout (context);
+  fail_unless (timeout > 60000 && timeout <= 65000);
+  fail_unless_equals_int (gst_rtsp_session_pool_cleanup (pool), 0);
+
+  g_source_destroy (source);
+  g_source_unref (source);
+  g_main_context_unref (context);
+  g_object_unref (session1);
+  g_object_unref (session2);
+  g_object_unref (pool);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_session_expire)
+{
+  GstRTSPSessionPool *pool;
+  GstRTSPSession *session;
+  gint64 before, after;
+  gint timeout;
+  gint64 day = 24 * 60 * 60 * G_USEC_PER_SEC;
+
+  pool = gst_rtsp_session_pool_new ();
+  session = gst_rtsp_session_pool_create (pool);
+
+  /* the session expires 5 seconds after its timeout of 1 second */
+  gst_rtsp_session_set_timeout (session, 1);
+  before = g_get_monotonic_time ();
+  gst_rtsp_session_touch (session);
+  after = g_get_monotonic_time ();
+
+  fail_if (gst_rtsp_session_is_expired_usec (session, after));
+  fail_if (gst_rtsp_session_is_expired_usec (session,
+          before + 6 * G_USEC_PER_SEC - 2000));
+  fail_unless (gst_rtsp_session_is_expired_usec (session,
+          after + 6 * G_USEC_PER_SEC));
+  timeout = gst_rtsp_session_next_timeout_usec (session,
+      before + 5 * G_USEC_PER_SEC);
+  fail_unless (timeout >= 1000 && timeout < 2000);
+
+  /* a timeout of 60 days must not wrap around */
+  gst_rtsp_session_set_timeout (session, 60 * 24 * 60 * 60);
+  gst_rtsp_session_touch (session);
+  after = g_get_monotonic_time ();
+
+  fail_if (gst_rtsp_session_is_expired_usec (session, after + 50 * day));
+  fail_if (gst_rtsp_session_is_expired_usec (session, after + 59 * day));
+  fail_unless (gst_rtsp_session_is_expired_usec (session, after + 61 * day));
+
+  /* a session that can't expire is touched when it is checked */
+  gst_rtsp_session_set_timeout (session, 1);
+  gst_rtsp_session_prevent_expire (session);
+  fail_if (gst_rtsp_session_is_expired_usec (session,
+          g_get_monotonic_time () + 5 * G_USEC_PER_SEC));
+  gst_rtsp_session_allow_expire (session);
+  fail_unless (gst_rtsp_session_is_expired_usec (session,
+          g_get_monotonic_time () + 7 * G_USEC_PER_SEC));
+
+  fail_unless (gst_rtsp_session_pool_remove (pool, session));
+  g_object_unref (session);
+  g_object_unref (pool);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtspsessionpool_suite (void)
 {
@@ -190,6 +370,9 @@ rtspsessionpool_suite (void)
   suite_add_tcase (s, tc);
   tcase_set_timeout (tc, 15);
   tcase_add_test (tc, test_pool);
+  tcase_add_test (tc, test_pool_threads);
+  tcase_add_test (tc, test_pool_watch_timeout);
+  tcase_add_test (tc, test_session_expire);
 
   return s;
 }
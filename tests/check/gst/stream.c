@@ -18,6 +18,8 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/rtp/gstrtcpbuffer.h>
 
 #include <rtsp-stream.h>
 #include <rtsp-address-pool.h>
@@ -426,6 +428,1130 @@ GST_START_TEST (test_tcp_transport)
 
 GST_END_TEST;
 
+static gboolean send_result;
+static guint n_sent;
+
+static gboolean
+test_send_func (GstBuffer * buffer, guint8 channel, gpointer user_data)
+{
+  if (send_result)
+    n_sent++;
+  return send_result;
+}
+
+static void
+test_overflow_func (GstRTSPStreamTransport * trans, gpointer user_data)
+{
+  gboolean *overflowed = user_data;
+
+  *overflowed = TRUE;
+}
+
+static GstRTSPStreamTransport *
+create_tcp_transport (GstRTSPStream ** stream_out)
+{
+  GstPad *srcpad;
+  GstElement *pay;
+  GstRTSPStream *stream;
+  GstRTSPTransport *tr;
+  GstRTSPStreamTransport *trans;
+
+  srcpad = gst_pad_new ("testsrcpad", GST_PAD_SRC);
+  fail_unless (srcpad != NULL);
+  pay = gst_element_factory_make ("rtpgstpay", "testpayloader");
+  fail_unless (pay != NULL);
+  stream = gst_rtsp_stream_new (0, pay, srcpad);
+  fail_unless (stream != NULL);
+  gst_object_unref (pay);
+  gst_object_unref (srcpad);
+
+  fail_unless (gst_rtsp_transport_new (&tr) == GST_RTSP_OK);
+  tr->lower_transport = GST_RTSP_LOWER_TRANS_TCP;
+  tr->interleaved.min = 0;
+  tr->interleaved.max = 1;
+
+  trans = gst_rtsp_stream_transport_new (stream, tr);
+  fail_unless (trans != NULL);
+  gst_rtsp_stream_transport_set_callbacks (trans, test_send_func,
+      test_send_func, NULL, NULL);
+
+  *stream_out = stream;
+  return trans;
+}
+
+static guint64
+get_stat (GstRTSPStreamTransport * trans, const gchar * name)
+{
+  GstStructure *stats;
+  guint64 value = 0;
+
+  stats = gst_rtsp_stream_transport_get_stats (trans);
+  fail_unless (stats != NULL);
+  fail_unless (gst_structure_get_uint64 (stats, name, &value));
+  gst_structure_free (stats);
+
+  return value;
+}
+
+static guint
+get_queue_length (GstRTSPStreamTransport * trans)
+{
+  GstStructure *stats;
+  guint value = 0;
+
+  stats = gst_rtsp_stream_transport_get_stats (trans);
+  fail_unless (stats != NULL);
+  fail_unless (gst_structure_get_uint (stats, "send-queue-length", &value));
+  gst_structure_free (stats);
+
+  return value;
+}
+
+GST_START_TEST (test_send_queue_drop_oldest)
+{
+  GstRTSPStream *stream;
+  GstRTSPStreamTransport *trans;
+  GstBuffer *buffer;
+  gint i;
+
+  trans = create_tcp_transport (&stream);
+  gst_rtsp_stream_transport_set_send_queue (trans, 4,
+      GST_RTSP_SEND_QUEUE_POLICY_DROP_OLDEST);
+
+  buffer = gst_buffer_new_allocate (NULL, 10, NULL);
+
+  /* the receiver is congested, everything is queued */
+  send_result = FALSE;
+  n_sent = 0;
+  for (i = 0; i < 6; i++)
+    fail_unless (gst_rtsp_stream_transport_send_rtp (trans, buffer));
+  fail_unless_equals_int (get_queue_length (trans), 4);
+  fail_unless_equals_int (get_stat (trans, "dropped-oldest"), 2);
+
+  /* new packets go after the queued ones even when the receiver is free */
+  send_result = TRUE;
+  fail_unless (gst_rtsp_stream_transport_send_rtcp (trans, buffer));
+  fail_unless_equals_int (n_sent, 0);
+  fail_unless_equals_int (get_queue_length (trans), 4);
+
+  fail_unless (gst_rtsp_stream_transport_flush_send_queue (trans));
+  fail_unless_equals_int (n_sent, 4);
+  fail_unless_equals_int (get_queue_length (trans), 0);
+
+  gst_buffer_unref (buffer);
+  g_object_unref (trans);
+  g_object_unref (stream);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_send_queue_drop_until_keyframe)
+{
+  GstRTSPStream *stream;
+  GstRTSPStreamTransport *trans;
+  GstBuffer *delta, *key;
+  gint i;
+
+  trans = create_tcp_transport (&stream);
+  gst_rtsp_stream_transport_set_send_queue (trans, 2,
+      GST_RTSP_SEND_QUEUE_POLICY_DROP_UNTIL_KEYFRAME);
+
+  delta = gst_buffer_new_allocate (NULL, 10, NULL);
+  GST_BUFFER_FLAG_SET (delta, GST_BUFFER_FLAG_DELTA_UNIT);
+  key = gst_buffer_new_allocate (NULL, 10, NULL);
+
+  send_result = FALSE;
+  n_sent = 0;
+  for (i = 0; i < 5; i++)
+    fail_unless (gst_rtsp_stream_transport_send_rtp (trans, delta));
+  fail_unless_equals_int (get_queue_length (trans), 0);
+  fail_unless_equals_int (get_stat (trans, "keyframe-resyncs"), 1);
+  fail_unless_equals_int (get_stat (trans, "dropped-until-keyframe"), 5);
+
+  /* delta units are dropped until the next keyframe */
+  send_result = TRUE;
+  fail_unless (gst_rtsp_stream_transport_send_rtp (trans, delta));
+  fail_unless_equals_int (n_sent, 0);
+  fail_unless (gst_rtsp_stream_transport_send_rtp (trans, key));
+  fail_unless (gst_rtsp_stream_transport_send_rtp (trans, delta));
+  fail_unless_equals_int (n_sent, 2);
+
+  gst_buffer_unref (delta);
+  gst_buffer_unref (key);
+  g_object_unref (trans);
+  g_object_unref (stream);
+}
+
+GST_END_TEST;
+
+static GstBuffer *
+create_frame_packet (GstBufferFlags flags, gboolean marker)
+{
+  GstBuffer *buffer;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  buffer = gst_rtp_buffer_new_allocate (10, 0, 0);
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp));
+  gst_rtp_buffer_set_marker (&rtp, marker);
+  gst_rtp_buffer_unmap (&rtp);
+  GST_BUFFER_FLAG_SET (buffer, flags);
+
+  return buffer;
+}
+
+static void
+send_frame_packet (GstRTSPStreamTransport * trans, GstBufferFlags flags,
+    gboolean marker)
+{
+  GstBuffer *buffer = create_frame_packet (flags, marker);
+
+  fail_unless (gst_rtsp_stream_transport_send_rtp (trans, buffer));
+  gst_buffer_unref (buffer);
+}
+
+GST_START_TEST (test_send_queue_drop_frames)
+{
+  GstRTSPStream *stream;
+  GstRTSPStreamTransport *trans;
+  guint size;
+
+  trans = create_tcp_transport (&stream);
+  gst_rtsp_stream_transport_set_send_queue (trans, 4,
+      GST_RTSP_SEND_QUEUE_POLICY_DROP_FRAMES);
+  size = gst_rtp_buffer_calc_packet_len (10, 0, 0);
+
+  send_result = FALSE;
+  n_sent = 0;
+  /* a droppable frame and a reference frame of two packets each */
+  send_frame_packet (trans,
+      GST_BUFFER_FLAG_DELTA_UNIT | GST_BUFFER_FLAG_DROPPABLE, FALSE);
+  send_frame_packet (trans,
+      GST_BUFFER_FLAG_DELTA_UNIT | GST_BUFFER_FLAG_DROPPABLE, TRUE);
+  send_frame_packet (trans, GST_BUFFER_FLAG_DELTA_UNIT, FALSE);
+  send_frame_packet (trans, GST_BUFFER_FLAG_DELTA_UNIT, TRUE);
+  fail_unless_equals_int (get_queue_length (trans), 4);
+
+  /* the droppable frame goes first */
+  send_frame_packet (trans, GST_BUFFER_FLAG_DELTA_UNIT, FALSE);
+  fail_unless_equals_int (get_queue_length (trans), 3);
+  fail_unless_equals_int (get_stat (trans, "dropped-frames"), 1);
+  fail_unless_equals_int (get_stat (trans, "dropped-bytes"), 2 * size);
+  send_frame_packet (trans, GST_BUFFER_FLAG_DELTA_UNIT, TRUE);
+  fail_unless_equals_int (get_queue_length (trans), 4);
+
+  /* then all delta frames, and everything until the next keyframe */
+  send_frame_packet (trans, GST_BUFFER_FLAG_DELTA_UNIT, FALSE);
+  fail_unless_equals_int (get_queue_length (trans), 0);
+  fail_unless_equals_int (get_stat (trans, "dropped-frames"), 3);
+  fail_unless_equals_int (get_stat (trans, "keyframe-resyncs"), 1);
+  send_frame_packet (trans, GST_BUFFER_FLAG_DELTA_UNIT, TRUE);
+  fail_unless_equals_int (get_queue_length (trans), 0);
+  fail_unless_equals_int (get_stat (trans, "dropped-frames"), 4);
+  fail_unless_equals_int (get_stat (trans, "dropped-bytes"), 8 * size);
+
+  send_frame_packet (trans, 0, TRUE);
+  fail_unless_equals_int (get_queue_length (trans), 1);
+
+  send_result = TRUE;
+  fail_unless (gst_rtsp_stream_transport_flush_send_queue (trans));
+  fail_unless_equals_int (n_sent, 1);
+
+  g_object_unref (trans);
+  g_object_unref (stream);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_send_queue_disconnect)
+{
+  GstRTSPStream *stream;
+  GstRTSPStreamTransport *trans;
+  GstBuffer *buffer;
+  gboolean overflowed = FALSE;
+
+  trans = create_tcp_transport (&stream);
+  gst_rtsp_stream_transport_set_send_queue (trans, 1,
+      GST_RTSP_SEND_QUEUE_POLICY_DISCONNECT);
+  gst_rtsp_stream_transport_set_overflow_callback (trans, test_overflow_func,
+      &overflowed, NULL);
+
+  buffer = gst_buffer_new_allocate (NULL, 10, NULL);
+
+  send_result = FALSE;
+  fail_unless (gst_rtsp_stream_transport_send_rtp (trans, buffer));
+  fail_if (overflowed);
+  fail_if (gst_rtsp_stream_transport_send_rtp (trans, buffer));
+  fail_unless (overflowed);
+  fail_unless_equals_int (get_stat (trans, "disconnects"), 1);
+  fail_if (gst_rtsp_stream_transport_flush_send_queue (trans));
+
+  gst_buffer_unref (buffer);
+  g_object_unref (trans);
+  g_object_unref (stream);
+}
+
+GST_END_TEST;
+
+static guint n_lists_sent;
+
+static gboolean
+test_send_list_func (GstBufferList * buffer_list, guint8 channel,
+    gpointer user_data)
+{
+  n_lists_sent++;
+  n_sent += gst_buffer_list_length (buffer_list);
+  return TRUE;
+}
+
+GST_START_TEST (test_send_rtp_list)
+{
+  GstRTSPStream *stream;
+  GstRTSPStreamTransport *trans;
+  GstBufferList *buffer_list;
+  gint i;
+
+  trans = create_tcp_transport (&stream);
+
+  buffer_list = gst_buffer_list_new ();
+  for (i = 0; i < 5; i++)
+    gst_buffer_list_add (buffer_list, gst_buffer_new_allocate (NULL, 10,
+            NULL));
+
+  /* without list callbacks, every buffer goes to the single send callback */
+  send_result = TRUE;
+  n_sent = 0;
+  n_lists_sent = 0;
+  fail_unless (gst_rtsp_stream_transport_send_rtp_list (trans, buffer_list));
+  fail_unless_equals_int (n_sent, 5);
+  fail_unless_equals_int (n_lists_sent, 0);
+
+  /* with list callbacks, the whole list is handed over at once */
+  gst_rtsp_stream_transport_set_list_callbacks (trans, test_send_list_func,
+      test_send_list_func, NULL, NULL);
+  n_sent = 0;
+  fail_unless (gst_rtsp_stream_transport_send_rtp_list (trans, buffer_list));
+  fail_unless (gst_rtsp_stream_transport_send_rtcp_list (trans, buffer_list));
+  fail_unless_equals_int (n_sent, 10);
+  fail_unless_equals_int (n_lists_sent, 2);
+
+  /* with a send queue, buffers that can't be sent are queued one by one */
+  gst_rtsp_stream_transport_set_send_queue (trans, 3,
+      GST_RTSP_SEND_QUEUE_POLICY_DROP_OLDEST);
+  send_result = FALSE;
+  n_sent = 0;
+  fail_unless (gst_rtsp_stream_transport_send_rtp_list (trans, buffer_list));
+  fail_unless_equals_int (get_queue_length (trans), 3);
+  fail_unless_equals_int (get_stat (trans, "dropped-oldest"), 2);
+
+  send_result = TRUE;
+  fail_unless (gst_rtsp_stream_transport_flush_send_queue (trans));
+  fail_unless_equals_int (n_sent, 3);
+
+  gst_buffer_list_unref (buffer_list);
+  g_object_unref (trans);
+  g_object_unref (stream);
+}
+
+GST_END_TEST;
+
+static gboolean
+udpsinks_have_client (GstBin * bin, const gchar * host)
+{
+  GstIterator *it;
+  GValue item = G_VALUE_INIT;
+  gboolean found = FALSE;
+
+  it = gst_bin_iterate_recurse (bin);
+  while (gst_iterator_next (it, &item) == GST_ITERATOR_OK) {
+    GstElement *element = g_value_get_object (&item);
+    GstElementFactory *factory = gst_element_get_factory (element);
+    gchar *clients = NULL;
+
+    if (factory && !g_strcmp0 (GST_OBJECT_NAME (factory), "multiudpsink")) {
+      g_object_get (element, "clients", &clients, NULL);
+      if (clients && strstr (clients, host))
+        found = TRUE;
+      g_free (clients);
+    }
+    g_value_reset (&item);
+  }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  return found;
+}
+
+GST_START_TEST (test_udp_fanout)
+{
+  GstPad *srcpad;
+  GstElement *pay;
+  GstRTSPStream *stream;
+  GstBin *bin;
+  GstElement *rtpbin;
+  GstRTSPAddressPool *pool;
+  GstRTSPTransport *tr;
+  GstRTSPStreamTransport *trans;
+  GSocket *socket;
+
+  srcpad = gst_pad_new ("testsrcpad", GST_PAD_SRC);
+  fail_unless (srcpad != NULL);
+  gst_pad_set_active (srcpad, TRUE);
+  pay = gst_element_factory_make ("rtpgstpay", "testpayloader");
+  fail_unless (pay != NULL);
+  stream = gst_rtsp_stream_new (0, pay, srcpad);
+  fail_unless (stream != NULL);
+  gst_object_unref (pay);
+  gst_object_unref (srcpad);
+  rtpbin = gst_element_factory_make ("rtpbin", "testrtpbin");
+  fail_unless (rtpbin != NULL);
+  bin = GST_BIN (gst_bin_new ("testbin"));
+  fail_unless (bin != NULL);
+  fail_unless (gst_bin_add (bin, rtpbin));
+
+  pool = gst_rtsp_address_pool_new ();
+  fail_unless (gst_rtsp_address_pool_add_range (pool,
+          GST_RTSP_ADDRESS_POOL_ANY_IPV4, GST_RTSP_ADDRESS_POOL_ANY_IPV4, 50000,
+          60000, 0));
+  gst_rtsp_stream_set_address_pool (stream, pool);
+
+  fail_if (gst_rtsp_stream_get_udp_fanout (stream));
+  gst_rtsp_stream_set_udp_fanout (stream, TRUE);
+  fail_unless (gst_rtsp_stream_get_udp_fanout (stream));
+  fail_if (gst_rtsp_stream_get_pacing (stream));
+  gst_rtsp_stream_set_pacing (stream, TRUE);
+  fail_unless (gst_rtsp_stream_get_pacing (stream));
+
+  fail_unless (gst_rtsp_stream_join_bin (stream, bin, rtpbin, GST_STATE_NULL));
+
+  socket = gst_rtsp_stream_get_rtp_socket (stream, G_SOCKET_FAMILY_IPV4);
+  if (socket == NULL) {
+    GST_INFO ("no IPv4 support, skipping");
+    goto done;
+  }
+  g_object_unref (socket);
+
+  fail_unless (gst_rtsp_transport_new (&tr) == GST_RTSP_OK);
+  tr->lower_transport = GST_RTSP_LOWER_TRANS_UDP;
+  tr->destination = g_strdup ("127.0.0.1");
+  tr->client_port.min = 5000;
+  tr->client_port.max = 5001;
+  trans = gst_rtsp_stream_transport_new (stream, tr);
+  fail_unless (trans != NULL);
+
+  /* the destination is served by the fan-out sender, not by the udpsinks */
+  fail_unless (gst_rtsp_stream_add_transport (stream, trans));
+  fail_if (udpsinks_have_client (bin, "127.0.0.1"));
+  fail_unless (gst_rtsp_stream_remove_transport (stream, trans));
+  g_object_unref (trans);
+
+done:
+  g_object_unref (pool);
+  fail_unless (gst_rtsp_stream_leave_bin (stream, bin, rtpbin));
+  gst_object_unref (bin);
+  gst_object_unref (stream);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fanout_threads)
+{
+  GstPad *srcpad;
+  GstElement *pay;
+  GstRTSPStream *stream;
+  GstBin *bin;
+  GstElement *rtpbin;
+  GstRTSPTransport *tr;
+  GstRTSPStreamTransport *trans[8];
+  guint i;
+
+  srcpad = gst_pad_new ("testsrcpad", GST_PAD_SRC);
+  fail_unless (srcpad != NULL);
+  gst_pad_set_active (srcpad, TRUE);
+  pay = gst_element_factory_make ("rtpgstpay", "testpayloader");
+  fail_unless (pay != NULL);
+  stream = gst_rtsp_stream_new (0, pay, srcpad);
+  fail_unless (stream != NULL);
+  gst_object_unref (pay);
+  gst_object_unref (srcpad);
+  rtpbin = gst_element_factory_make ("rtpbin", "testrtpbin");
+  fail_unless (rtpbin != NULL);
+  bin = GST_BIN (gst_bin_new ("testbin"));
+  fail_unless (bin != NULL);
+  fail_unless (gst_bin_add (bin, rtpbin));
+
+  fail_unless_equals_int (gst_rtsp_stream_get_fanout_threads (stream), 0);
+  gst_rtsp_stream_set_fanout_threads (stream, 3);
+  fail_unless_equals_int (gst_rtsp_stream_get_fanout_threads (stream), 3);
+  fail_unless_equals_int (gst_rtsp_stream_get_fanout_queue_size (stream), 256);
+  fail_unless_equals_int (gst_rtsp_stream_get_fanout_partition (stream),
+      GST_RTSP_FANOUT_PARTITION_HASH);
+  gst_rtsp_stream_set_fanout_partition (stream,
+      GST_RTSP_FANOUT_PARTITION_BALANCED);
+  fail_unless_equals_int (gst_rtsp_stream_get_fanout_partition (stream),
+      GST_RTSP_FANOUT_PARTITION_BALANCED);
+
+  fail_unless (gst_rtsp_stream_join_bin (stream, bin, rtpbin, GST_STATE_NULL));
+
+  for (i = 0; i < G_N_ELEMENTS (trans); i++) {
+    fail_unless (gst_rtsp_transport_new (&tr) == GST_RTSP_OK);
+    tr->lower_transport = GST_RTSP_LOWER_TRANS_TCP;
+    tr->interleaved.min = 0;
+    tr->interleaved.max = 1;
+    trans[i] = gst_rtsp_stream_transport_new (stream, tr);
+    fail_unless (trans[i] != NULL);
+    gst_rtsp_stream_transport_set_callbacks (trans[i], test_send_func,
+        test_send_func, NULL, NULL);
+    fail_unless (gst_rtsp_stream_add_transport (stream, trans[i]));
+  }
+
+  /* the fan-out threads skip the removed transports */
+  for (i = 0; i < G_N_ELEMENTS (trans); i++) {
+    fail_unless (gst_rtsp_stream_remove_transport (stream, trans[i]));
+    g_object_unref (trans[i]);
+  }
+
+  fail_unless (gst_rtsp_stream_leave_bin (stream, bin, rtpbin));
+  gst_object_unref (bin);
+  gst_object_unref (stream);
+}
+
+GST_END_TEST;
+
+static GMutex block_lock;
+static GCond block_cond;
+static gboolean block_send;
+static gboolean block_waiting;
+static guint n_block_sent;
+
+static gboolean
+test_blocking_send_func (GstBuffer * buffer, guint8 channel,
+    gpointer user_data)
+{
+  GstRTSPStream *stream = user_data;
+
+  g_mutex_lock (&block_lock);
+  block_waiting = block_send;
+  g_cond_broadcast (&block_cond);
+  while (block_send)
+    g_cond_wait (&block_cond, &block_lock);
+  n_block_sent++;
+  g_cond_broadcast (&block_cond);
+  g_mutex_unlock (&block_lock);
+
+  /* takes the stream lock, which the streaming thread must not hold while
+   * it queues the packets */
+  gst_rtsp_stream_get_fanout_threads (stream);
+
+  return TRUE;
+}
+
+GST_START_TEST (test_fanout_threads_blocked)
+{
+  GstPad *srcpad;
+  GstElement *pay;
+  GstRTSPStream *stream;
+  GstBin *bin;
+  GstElement *rtpbin;
+  GstRTSPTransport *tr;
+  GstRTSPStreamTransport *trans, *removed;
+  GstSegment segment;
+  GstCaps *caps;
+  GstStructure *stats;
+  guint64 dropped;
+  guint i, n_removed_sent;
+
+  srcpad = gst_pad_new ("testsrcpad", GST_PAD_SRC);
+  fail_unless (srcpad != NULL);
+  gst_pad_set_active (srcpad, TRUE);
+  pay = gst_element_factory_make ("rtpgstpay", "testpayloader");
+  fail_unless (pay != NULL);
+  stream = gst_rtsp_stream_new (0, pay, srcpad);
+  fail_unless (stream != NULL);
+  gst_object_unref (pay);
+  rtpbin = gst_element_factory_make ("rtpbin", "testrtpbin");
+  fail_unless (rtpbin != NULL);
+  bin = GST_BIN (gst_bin_new ("testbin"));
+  fail_unless (bin != NULL);
+  fail_unless (gst_bin_add (bin, rtpbin));
+
+  /* with only TCP, the appsink is linked to the session and the samples
+   * arrive from the thread that pushes the buffers */
+  gst_rtsp_stream_set_protocols (stream, GST_RTSP_LOWER_TRANS_TCP);
+  gst_rtsp_stream_set_fanout_threads (stream, 1);
+  gst_rtsp_stream_set_fanout_queue_size (stream, 100);
+  fail_unless (gst_rtsp_stream_join_bin (stream, bin, rtpbin, GST_STATE_NULL));
+
+  fail_unless (gst_rtsp_transport_new (&tr) == GST_RTSP_OK);
+  tr->lower_transport = GST_RTSP_LOWER_TRANS_TCP;
+  tr->interleaved.min = 0;
+  tr->interleaved.max = 1;
+  trans = gst_rtsp_stream_transport_new (stream, tr);
+  fail_unless (trans != NULL);
+  gst_rtsp_stream_transport_set_callbacks (trans, test_blocking_send_func,
+      test_send_func, stream, NULL);
+  send_result = TRUE;
+  fail_unless (gst_rtsp_stream_add_transport (stream, trans));
+
+  /* served by the same fan-out thread */
+  fail_unless (gst_rtsp_transport_new (&tr) == GST_RTSP_OK);
+  tr->lower_transport = GST_RTSP_LOWER_TRANS_TCP;
+  tr->interleaved.min = 2;
+  tr->interleaved.max = 3;
+  removed = gst_rtsp_stream_transport_new (stream, tr);
+  fail_unless (removed != NULL);
+  gst_rtsp_stream_transport_set_callbacks (removed, test_send_func,
+      test_send_func, NULL, NULL);
+  fail_unless (gst_rtsp_stream_add_transport (stream, removed));
+
+  gst_element_set_state (GST_ELEMENT (bin), GST_STATE_PLAYING);
+
+  /* the transport blocks, the streaming thread must not */
+  block_send = TRUE;
+  block_waiting = FALSE;
+  n_block_sent = 0;
+  n_sent = 0;
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_stream_start ("test")));
+  caps = gst_caps_from_string ("application/x-rtp, media=(string)application, "
+      "clock-rate=(int)90000, encoding-name=(string)X-GST, payload=(int)96");
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_caps (caps)));
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  for (i = 0; i < 2000; i++) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    GstBuffer *buffer;
+
+    buffer = gst_rtp_buffer_new_allocate (10, 0, 0);
+    fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp));
+    gst_rtp_buffer_set_payload_type (&rtp, 96);
+    gst_rtp_buffer_set_seq (&rtp, i);
+    gst_rtp_buffer_unmap (&rtp);
+    fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+  }
+
+  /* the packets that didn't fit in the queue were dropped and counted */
+  stats = gst_rtsp_stream_get_fanout_stats (stream);
+  fail_unless (gst_structure_get_uint64 (stats, "dropped", &dropped));
+  fail_unless (dropped > 0);
+  fail_unless (dropped < 2000);
+  gst_structure_free (stats);
+
+  /* removing doesn't wait for the blocked fan-out thread, which must not
+   * send the packets it still has queued to the removed transport */
+  fail_unless (gst_rtsp_stream_remove_transport (stream, removed));
+
+  g_mutex_lock (&block_lock);
+  while (!block_waiting)
+    g_cond_wait (&block_cond, &block_lock);
+  n_removed_sent = n_sent;
+  block_send = FALSE;
+  g_cond_broadcast (&block_cond);
+  while (n_block_sent < 2000 - dropped)
+    g_cond_wait (&block_cond, &block_lock);
+  g_mutex_unlock (&block_lock);
+  fail_unless_equals_int (n_sent, n_removed_sent);
+
+  fail_unless (gst_rtsp_stream_remove_transport (stream, trans));
+  gst_element_set_state (GST_ELEMENT (bin), GST_STATE_NULL);
+  fail_unless (gst_rtsp_stream_leave_bin (stream, bin, rtpbin));
+  fail_unless_equals_int (n_block_sent, 2000 - dropped);
+
+  g_object_unref (removed);
+  g_object_unref (trans);
+  gst_object_unref (srcpad);
+  gst_object_unref (bin);
+  gst_object_unref (stream);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  gboolean congested;
+  GArray *seqnums;
+} TestReceiver;
+
+static gboolean
+test_record_seqnum_func (GstBuffer * buffer, guint8 channel,
+    gpointer user_data)
+{
+  TestReceiver *receiver = user_data;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint16 seqnum;
+
+  if (receiver->congested)
+    return FALSE;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp));
+  seqnum = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+  g_array_append_val (receiver->seqnums, seqnum);
+
+  return TRUE;
+}
+
+static GstRTSPStreamTransport *
+add_receiver (GstRTSPStream * stream, TestReceiver * receiver)
+{
+  GstRTSPTransport *tr;
+  GstRTSPStreamTransport *trans;
+  GstRTSPUrl *url;
+
+  fail_unless (gst_rtsp_transport_new (&tr) == GST_RTSP_OK);
+  tr->lower_transport = GST_RTSP_LOWER_TRANS_TCP;
+  tr->interleaved.min = 0;
+  tr->interleaved.max = 1;
+  trans = gst_rtsp_stream_transport_new (stream, tr);
+  fail_unless (trans != NULL);
+  fail_unless (gst_rtsp_url_parse ("rtsp://localhost/test/stream=0",
+          &url) == GST_RTSP_OK);
+  gst_rtsp_stream_transport_set_url (trans, url);
+  gst_rtsp_url_free (url);
+
+  receiver->seqnums = g_array_new (FALSE, FALSE, sizeof (guint16));
+  gst_rtsp_stream_transport_set_callbacks (trans, test_record_seqnum_func,
+      test_send_func, receiver, NULL);
+  fail_unless (gst_rtsp_stream_add_transport (stream, trans));
+
+  return trans;
+}
+
+static void
+push_rtp_packet (GstPad * srcpad, guint16 seqnum, gboolean delta)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+
+  buffer = gst_rtp_buffer_new_allocate (10, 0, 0);
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp));
+  gst_rtp_buffer_set_payload_type (&rtp, 96);
+  gst_rtp_buffer_set_seq (&rtp, seqnum);
+  gst_rtp_buffer_set_timestamp (&rtp, delta ? 1000 + seqnum : 1000);
+  gst_rtp_buffer_unmap (&rtp);
+  if (delta)
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+  fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+}
+
+static void
+check_seqnums (TestReceiver * receiver, guint first, guint last)
+{
+  guint i;
+
+  fail_unless_equals_int (receiver->seqnums->len, last - first + 1);
+  for (i = 0; i < receiver->seqnums->len; i++)
+    fail_unless_equals_int (g_array_index (receiver->seqnums, guint16, i),
+        first + i);
+}
+
+static void
+check_rtpinfo_seqnum (GstRTSPStreamTransport * trans, guint seqnum)
+{
+  gchar *rtpinfo, *expected;
+
+  rtpinfo = gst_rtsp_stream_transport_get_rtpinfo (trans, GST_CLOCK_TIME_NONE);
+  fail_unless (rtpinfo != NULL);
+  expected = g_strdup_printf (";seq=%u;", seqnum);
+  fail_unless (strstr (rtpinfo, expected) != NULL, "%s", rtpinfo);
+  g_free (expected);
+  g_free (rtpinfo);
+}
+
+GST_START_TEST (test_gop_cache)
+{
+  GstPad *srcpad;
+  GstElement *pay;
+  GstRTSPStream *stream;
+  GstBin *bin;
+  GstElement *rtpbin;
+  GstRTSPStreamTransport *live, *late;
+  TestReceiver live_receiver = { FALSE, NULL };
+  TestReceiver late_receiver = { TRUE, NULL };
+  GstSegment segment;
+  GstCaps *caps;
+  guint i;
+
+  srcpad = gst_pad_new ("testsrcpad", GST_PAD_SRC);
+  fail_unless (srcpad != NULL);
+  gst_pad_set_active (srcpad, TRUE);
+  pay = gst_element_factory_make ("rtpgstpay", "testpayloader");
+  fail_unless (pay != NULL);
+  stream = gst_rtsp_stream_new (0, pay, srcpad);
+  fail_unless (stream != NULL);
+  gst_object_unref (pay);
+  rtpbin = gst_element_factory_make ("rtpbin", "testrtpbin");
+  fail_unless (rtpbin != NULL);
+  bin = GST_BIN (gst_bin_new ("testbin"));
+  fail_unless (bin != NULL);
+  fail_unless (gst_bin_add (bin, rtpbin));
+
+  fail_unless_equals_int (gst_rtsp_stream_get_gop_cache_size (stream), 0);
+  gst_rtsp_stream_set_gop_cache_size (stream, 1024 * 1024);
+  fail_unless_equals_int (gst_rtsp_stream_get_gop_cache_size (stream),
+      1024 * 1024);
+
+  /* with only TCP, the packets arrive in the thread that pushes them */
+  gst_rtsp_stream_set_protocols (stream, GST_RTSP_LOWER_TRANS_TCP);
+  fail_unless (gst_rtsp_stream_join_bin (stream, bin, rtpbin, GST_STATE_NULL));
+
+  /* nothing is cached yet, the transport is added as usual */
+  live = add_receiver (stream, &live_receiver);
+  fail_unless_equals_int (live_receiver.seqnums->len, 0);
+
+  gst_element_set_state (GST_ELEMENT (bin), GST_STATE_PLAYING);
+
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_stream_start ("test")));
+  caps = gst_caps_from_string ("application/x-rtp, media=(string)application, "
+      "clock-rate=(int)90000, encoding-name=(string)X-GST, payload=(int)96");
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_caps (caps)));
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  /* a keyframe and its delta frames */
+  push_rtp_packet (srcpad, 0, FALSE);
+  for (i = 1; i < 10; i++)
+    push_rtp_packet (srcpad, i, TRUE);
+  check_seqnums (&live_receiver, 0, 9);
+
+  /* a congested receiver gets the cached packets queued, adding it doesn't
+   * wait for them to be sent */
+  late = add_receiver (stream, &late_receiver);
+  fail_unless_equals_int (late_receiver.seqnums->len, 0);
+  fail_unless_equals_int (get_queue_length (late), 10);
+
+  /* the live packets are queued after them */
+  push_rtp_packet (srcpad, 10, TRUE);
+  check_seqnums (&live_receiver, 0, 10);
+  fail_unless_equals_int (late_receiver.seqnums->len, 0);
+  fail_unless_equals_int (get_queue_length (late), 11);
+
+  /* only the receiver of the cached packets starts at the first of them */
+  check_rtpinfo_seqnum (live, 10);
+  check_rtpinfo_seqnum (late, 0);
+
+  late_receiver.congested = FALSE;
+  fail_unless (gst_rtsp_stream_transport_flush_send_queue (late));
+  check_seqnums (&late_receiver, 0, 10);
+
+  /* once the burst is sent, the packets are sent directly again */
+  push_rtp_packet (srcpad, 11, TRUE);
+  check_seqnums (&late_receiver, 0, 11);
+  check_seqnums (&live_receiver, 0, 11);
+  fail_unless_equals_int (get_queue_length (late), 0);
+
+  /* removed and added again, it starts with the current cache */
+  fail_unless (gst_rtsp_stream_remove_transport (stream, late));
+  g_array_set_size (late_receiver.seqnums, 0);
+  fail_unless (gst_rtsp_stream_add_transport (stream, late));
+  check_seqnums (&late_receiver, 0, 11);
+
+  gst_element_set_state (GST_ELEMENT (bin), GST_STATE_NULL);
+  fail_unless (gst_rtsp_stream_remove_transport (stream, live));
+  fail_unless (gst_rtsp_stream_remove_transport (stream, late));
+  g_object_unref (live);
+  g_object_unref (late);
+  g_array_free (live_receiver.seqnums, TRUE);
+  g_array_free (late_receiver.seqnums, TRUE);
+  gst_object_unref (srcpad);
+
+  fail_unless (gst_rtsp_stream_leave_bin (stream, bin, rtpbin));
+  gst_object_unref (bin);
+  gst_object_unref (stream);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_recv_batch)
+{
+  GstPad *sinkpad;
+  GstElement *depay;
+  GstRTSPStream *stream;
+  GstBin *bin;
+  GstElement *rtpbin;
+  GstRTSPAddressPool *pool;
+  GSocket *socket, *sender;
+  GSocketAddress *local, *dest;
+  GInetAddress *loopback;
+  GstStructure *stats;
+  guint64 packets = 0, batches = 0;
+  guint max_batch = 0, port, i;
+  gchar data[100] = { 0, };
+
+  sinkpad = gst_pad_new ("testsinkpad", GST_PAD_SINK);
+  fail_unless (sinkpad != NULL);
+  depay = gst_element_factory_make ("rtpgstdepay", "testdepayloader");
+  fail_unless (depay != NULL);
+  stream = gst_rtsp_stream_new (0, depay, sinkpad);
+  fail_unless (stream != NULL);
+  gst_object_unref (depay);
+  gst_object_unref (sinkpad);
+  rtpbin = gst_element_factory_make ("rtpbin", "testrtpbin");
+  fail_unless (rtpbin != NULL);
+  bin = GST_BIN (gst_bin_new ("testbin"));
+  fail_unless (bin != NULL);
+  fail_unless (gst_bin_add (bin, rtpbin));
+
+  pool = gst_rtsp_address_pool_new ();
+  fail_unless (gst_rtsp_address_pool_add_range (pool,
+          GST_RTSP_ADDRESS_POOL_ANY_IPV4, GST_RTSP_ADDRESS_POOL_ANY_IPV4, 50000,
+          60000, 0));
+  gst_rtsp_stream_set_address_pool (stream, pool);
+
+  fail_unless_equals_int (gst_rtsp_stream_get_recv_batch_size (stream), 0);
+  gst_rtsp_stream_set_recv_batch_size (stream, 8);
+  fail_unless_equals_int (gst_rtsp_stream_get_recv_batch_size (stream), 8);
+
+  fail_unless (gst_rtsp_stream_join_bin (stream, bin, rtpbin, GST_STATE_NULL));
+
+  socket = gst_rtsp_stream_get_rtp_socket (stream, G_SOCKET_FAMILY_IPV4);
+  if (socket == NULL) {
+    GST_INFO ("no IPv4 support, skipping");
+    goto done;
+  }
+  local = g_socket_get_local_address (socket, NULL);
+  fail_unless (local != NULL);
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (local));
+  g_object_unref (local);
+  g_object_unref (socket);
+
+  /* queue the packets before the source runs, so that it finds them all at
+   * once */
+  sender = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  fail_unless (sender != NULL);
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  dest = g_inet_socket_address_new (loopback, port);
+  g_object_unref (loopback);
+  for (i = 0; i < 20; i++)
+    fail_unless (g_socket_send_to (sender, dest, data, sizeof (data), NULL,
+            NULL) == sizeof (data));
+  g_object_unref (dest);
+  g_object_unref (sender);
+
+  gst_element_set_state (GST_ELEMENT (bin), GST_STATE_PLAYING);
+
+  for (i = 0; i < 500 && packets < 20; i++) {
+    g_usleep (10 * G_TIME_SPAN_MILLISECOND);
+    stats = gst_rtsp_stream_get_recv_stats (stream);
+    fail_unless (gst_structure_get_uint64 (stats, "packets", &packets));
+    gst_structure_free (stats);
+  }
+
+  stats = gst_rtsp_stream_get_recv_stats (stream);
+  fail_unless (gst_structure_get_uint64 (stats, "packets", &packets));
+  fail_unless (gst_structure_get_uint64 (stats, "batches", &batches));
+  fail_unless (gst_structure_get_uint (stats, "max-batch-size", &max_batch));
+  gst_structure_free (stats);
+  fail_unless_equals_int (packets, 20);
+  fail_unless (batches >= 3);
+  fail_unless_equals_int (max_batch, 8);
+
+  gst_element_set_state (GST_ELEMENT (bin), GST_STATE_NULL);
+
+done:
+  g_object_unref (pool);
+  fail_unless (gst_rtsp_stream_leave_bin (stream, bin, rtpbin));
+  gst_object_unref (bin);
+  gst_object_unref (stream);
+}
+
+GST_END_TEST;
+
+static void
+test_keep_alive_func (gpointer user_data)
+{
+  gint *count = user_data;
+
+  g_atomic_int_inc (count);
+}
+
+static GstRTSPStreamTransport *
+add_udp_receiver (GstRTSPStream * stream, guint rtcp_port, gint * count)
+{
+  GstRTSPTransport *tr;
+  GstRTSPStreamTransport *trans;
+
+  fail_unless (gst_rtsp_transport_new (&tr) == GST_RTSP_OK);
+  tr->lower_transport = GST_RTSP_LOWER_TRANS_UDP;
+  tr->destination = g_strdup ("127.0.0.1");
+  tr->client_port.min = rtcp_port - 1;
+  tr->client_port.max = rtcp_port;
+  trans = gst_rtsp_stream_transport_new (stream, tr);
+  fail_unless (trans != NULL);
+  gst_rtsp_stream_transport_set_keepalive (trans, test_keep_alive_func, count,
+      NULL);
+  fail_unless (gst_rtsp_stream_add_transport (stream, trans));
+
+  return trans;
+}
+
+static GSocket *
+create_rtcp_sender (guint * port)
+{
+  GSocket *socket;
+  GInetAddress *loopback;
+  GSocketAddress *addr;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  fail_unless (socket != NULL);
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  addr = g_inet_socket_address_new (loopback, 0);
+  g_object_unref (loopback);
+  fail_unless (g_socket_bind (socket, addr, FALSE, NULL));
+  g_object_unref (addr);
+
+  addr = g_socket_get_local_address (socket, NULL);
+  fail_unless (addr != NULL);
+  *port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr));
+  g_object_unref (addr);
+
+  return socket;
+}
+
+/* send a receiver report of @ssrc to @port and wait until it was matched
+ * to a transport, which then increments one of the counts */
+static void
+send_receiver_report (GSocket * socket, guint port, guint32 ssrc,
+    gint * counts, guint n_counts)
+{
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  GInetAddress *loopback;
+  GSocketAddress *dest;
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gint total, before = 0;
+  guint i, j;
+
+  for (i = 0; i < n_counts; i++)
+    before += g_atomic_int_get (&counts[i]);
+
+  buffer = gst_rtcp_buffer_new (1000);
+  fail_unless (gst_rtcp_buffer_map (buffer, GST_MAP_READWRITE, &rtcp));
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_RR, &packet));
+  gst_rtcp_packet_rr_set_ssrc (&packet, ssrc);
+  fail_unless (gst_rtcp_packet_add_rb (&packet, 0x12345678, 0, 0, 0, 0, 0,
+          0));
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  dest = g_inet_socket_address_new (loopback, port);
+  g_object_unref (loopback);
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_READ));
+  fail_unless (g_socket_send_to (socket, dest, (const gchar *) map.data,
+          map.size, NULL, NULL) == map.size);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+  g_object_unref (dest);
+
+  for (j = 0; j < 500; j++) {
+    total = 0;
+    for (i = 0; i < n_counts; i++)
+      total += g_atomic_int_get (&counts[i]);
+    if (total > before)
+      break;
+    g_usleep (10 * G_TIME_SPAN_MILLISECOND);
+  }
+  fail_unless (total > before);
+}
+
+GST_START_TEST (test_find_transport)
+{
+  GstPad *srcpad;
+  GstElement *pay;
+  GstRTSPStream *stream;
+  GstBin *bin;
+  GstElement *rtpbin;
+  GstRTSPAddressPool *pool;
+  GstRTSPStreamTransport *first, *second, *other;
+  GSocket *socket, *sender, *other_sender;
+  GSocketAddress *local;
+  guint rtcp_port, port, other_port;
+  gint counts[3] = { 0, };
+
+  srcpad = gst_pad_new ("testsrcpad", GST_PAD_SRC);
+  fail_unless (srcpad != NULL);
+  gst_pad_set_active (srcpad, TRUE);
+  pay = gst_element_factory_make ("rtpgstpay", "testpayloader");
+  fail_unless (pay != NULL);
+  stream = gst_rtsp_stream_new (0, pay, srcpad);
+  fail_unless (stream != NULL);
+  gst_object_unref (pay);
+  gst_object_unref (srcpad);
+  rtpbin = gst_element_factory_make ("rtpbin", "testrtpbin");
+  fail_unless (rtpbin != NULL);
+  bin = GST_BIN (gst_bin_new ("testbin"));
+  fail_unless (bin != NULL);
+  fail_unless (gst_bin_add (bin, rtpbin));
+
+  pool = gst_rtsp_address_pool_new ();
+  fail_unless (gst_rtsp_address_pool_add_range (pool,
+          GST_RTSP_ADDRESS_POOL_ANY_IPV4, GST_RTSP_ADDRESS_POOL_ANY_IPV4, 50000,
+          60000, 0));
+  gst_rtsp_stream_set_address_pool (stream, pool);
+
+  fail_unless (gst_rtsp_stream_join_bin (stream, bin, rtpbin, GST_STATE_NULL));
+
+  socket = gst_rtsp_stream_get_rtcp_socket (stream, G_SOCKET_FAMILY_IPV4);
+  if (socket == NULL) {
+    GST_INFO ("no IPv4 support, skipping");
+    goto done;
+  }
+  local = g_socket_get_local_address (socket, NULL);
+  fail_unless (local != NULL);
+  rtcp_port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (local));
+  g_object_unref (local);
+  g_object_unref (socket);
+
+  sender = create_rtcp_sender (&port);
+  other_sender = create_rtcp_sender (&other_port);
+
+  /* two transports with the same receiver and another one */
+  first = add_udp_receiver (stream, port, &counts[0]);
+  second = add_udp_receiver (stream, port, &counts[1]);
+  other = add_udp_receiver (stream, other_port, &counts[2]);
+
+  gst_element_set_state (GST_ELEMENT (bin), GST_STATE_PLAYING);
+
+  /* RTCP is matched on the address and port it comes from */
+  send_receiver_report (other_sender, rtcp_port, 0x1000, counts, 3);
+  fail_unless_equals_int (counts[0] + counts[1], 0);
+  fail_unless (counts[2] > 0);
+
+  send_receiver_report (sender, rtcp_port, 0x2000, counts, 3);
+  fail_unless (counts[0] + counts[1] > 0);
+
+  /* the remaining transport with the same receiver is still found */
+  fail_unless (gst_rtsp_stream_remove_transport (stream, first));
+  counts[0] = counts[1] = 0;
+  send_receiver_report (sender, rtcp_port, 0x3000, counts, 3);
+  fail_unless_equals_int (counts[0], 0);
+  fail_unless (counts[1] > 0);
+
+  fail_unless (gst_rtsp_stream_remove_transport (stream, second));
+  fail_unless (gst_rtsp_stream_remove_transport (stream, other));
+
+  gst_element_set_state (GST_ELEMENT (bin), GST_STATE_NULL);
+  g_object_unref (first);
+  g_object_unref (second);
+  g_object_unref (other);
+  g_object_unref (sender);
+  g_object_unref (other_sender);
+
+done:
+  g_object_unref (pool);
+  fail_unless (gst_rtsp_stream_leave_bin (stream, bin, rtpbin));
+  gst_object_unref (bin);
+  gst_object_unref (stream);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtspstream_suite (void)
 {
@@ -440,6 +1566,17 @@ rtspstream_suite (void)
   tcase_add_test (tc, test_allocate_udp_ports_multicast);
   tcase_add_test (tc, test_allocate_udp_ports_client_settings);
   tcase_add_test (tc, test_tcp_transport);
+  tcase_add_test (tc, test_send_queue_drop_oldest);
+  tcase_add_test (tc, test_send_queue_drop_until_keyframe);
+  tcase_add_test (tc, test_send_queue_drop_frames);
+  tcase_add_test (tc, test_send_queue_disconnect);
+  tcase_add_test (tc, test_send_rtp_list);
+  tcase_add_test (tc, test_udp_fanout);
+  tcase_add_test (tc, test_fanout_threads);
+  tcase_add_test (tc, test_fanout_threads_blocked);
+  tcase_add_test (tc, test_gop_cache);
+  tcase_add_test (tc, test_recv_batch);
+  tcase_add_test (tc, test_find_transport);
 
   return s;
 }
@@ -19,8 +19,16 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             /* for sched_getaffinity() */
+#endif
+
 #include <gst/check/gstcheck.h>
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 #include <rtsp-thread-pool.h>
 
 GST_START_TEST (test_pool_get_thread)
@@ -215,6 +223,296 @@ GST_START_TEST (test_pool_thread_copy)
 
 GST_END_TEST;
 
+static gboolean
+keep_busy (gpointer user_data)
+{
+  /* spend most of the time dispatching */
+  g_usleep (40 * 1000);
+  return G_SOURCE_CONTINUE;
+}
+
+GST_START_TEST (test_pool_least_loaded)
+{
+  GstRTSPThreadPool *pool;
+  GstRTSPThread *thread1;
+  GstRTSPThread *thread2;
+  GstRTSPThread *thread3;
+  GSource *source;
+  GList *threads;
+  gint i;
+
+  pool = gst_rtsp_thread_pool_new ();
+  gst_rtsp_thread_pool_set_max_threads (pool, 2);
+
+  thread1 = gst_rtsp_thread_pool_get_thread (pool, GST_RTSP_THREAD_TYPE_CLIENT,
+      NULL);
+  thread2 = gst_rtsp_thread_pool_get_thread (pool, GST_RTSP_THREAD_TYPE_CLIENT,
+      NULL);
+  fail_unless (thread1 != thread2);
+
+  threads = gst_rtsp_thread_pool_get_client_threads (pool);
+  fail_unless_equals_int (g_list_length (threads), 2);
+  fail_unless (g_list_find (threads, thread1) != NULL);
+  fail_unless (g_list_find (threads, thread2) != NULL);
+  g_list_free_full (threads, (GDestroyNotify) gst_rtsp_thread_unref);
+
+  /* both threads are idle, the one with the fewest users is taken */
+  fail_unless (gst_rtsp_thread_reuse (thread1));
+  fail_unless_equals_int (gst_rtsp_thread_get_n_users (thread1), 2);
+  thread3 = gst_rtsp_thread_pool_get_thread (pool, GST_RTSP_THREAD_TYPE_CLIENT,
+      NULL);
+  fail_unless (thread3 == thread2);
+  fail_unless_equals_int (gst_rtsp_thread_get_n_users (thread2), 2);
+  gst_rtsp_thread_stop (thread3);
+
+  /* make thread2 busy, it is avoided even though it has fewer users */
+  source = g_timeout_source_new (1);
+  g_source_set_callback (source, keep_busy, NULL, NULL);
+  g_source_attach (source, thread2->context);
+
+  for (i = 0; i < 100 && gst_rtsp_thread_get_load (thread2) < 500; i++)
+    g_usleep (100 * 1000);
+  fail_unless (gst_rtsp_thread_get_load (thread2) >= 500);
+  fail_unless (gst_rtsp_thread_get_load (thread1) < 500);
+
+  thread3 = gst_rtsp_thread_pool_get_thread (pool, GST_RTSP_THREAD_TYPE_CLIENT,
+      NULL);
+  fail_unless (thread3 == thread1);
+  gst_rtsp_thread_stop (thread3);
+
+  g_source_destroy (source);
+  g_source_unref (source);
+
+  /* the load of the idle thread decays without waking it up */
+  for (i = 0; i < 100 && gst_rtsp_thread_get_load (thread2) >= 500; i++)
+    g_usleep (100 * 1000);
+  fail_unless (gst_rtsp_thread_get_load (thread2) < 500);
+
+  gst_rtsp_thread_stop (thread1);
+  gst_rtsp_thread_stop (thread1);
+  gst_rtsp_thread_stop (thread2);
+  g_object_unref (pool);
+  gst_rtsp_thread_pool_cleanup ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pool_max_media_threads)
+{
+  GstRTSPThreadPool *pool;
+  GstRTSPThread *threads[4];
+  GList *media_threads, *walk;
+  gint max_threads;
+  gint i;
+
+  pool = gst_rtsp_thread_pool_new ();
+  fail_unless_equals_int (gst_rtsp_thread_pool_get_max_media_threads (pool),
+      -1);
+
+  g_object_set (pool, "max-media-threads", 2, NULL);
+  g_object_get (pool, "max-media-threads", &max_threads, NULL);
+  fail_unless_equals_int (max_threads, 2);
+
+  for (i = 0; i < G_N_ELEMENTS (threads); i++) {
+    threads[i] = gst_rtsp_thread_pool_get_thread (pool,
+        GST_RTSP_THREAD_TYPE_MEDIA, NULL);
+    fail_unless (GST_IS_RTSP_THREAD (threads[i]));
+  }
+
+  /* the media are spread over 2 threads */
+  fail_unless (threads[0] != threads[1]);
+  fail_unless (threads[2] == threads[0] || threads[2] == threads[1]);
+  fail_unless (threads[3] != threads[2]);
+  fail_unless (threads[3] == threads[0] || threads[3] == threads[1]);
+
+  media_threads = gst_rtsp_thread_pool_get_media_threads (pool);
+  fail_unless_equals_int (g_list_length (media_threads), 2);
+  /* each thread handles 2 media */
+  for (walk = media_threads; walk; walk = walk->next)
+    fail_unless_equals_int (gst_rtsp_thread_get_n_users (walk->data), 2);
+  g_list_free_full (media_threads, (GDestroyNotify) gst_rtsp_thread_unref);
+
+  /* the client threads are not affected */
+  media_threads = gst_rtsp_thread_pool_get_client_threads (pool);
+  fail_unless (media_threads == NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (threads); i++)
+    gst_rtsp_thread_stop (threads[i]);
+
+  g_object_unref (pool);
+  gst_rtsp_thread_pool_cleanup ();
+}
+
+GST_END_TEST;
+
+static gboolean
+wake_up (gpointer user_data)
+{
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+thread_stats (GstRTSPThreadPool * pool, GstRTSPThread * thread,
+    const GstStructure * stats, gpointer user_data)
+{
+  gint *n_stats = user_data;
+
+  fail_unless (GST_IS_RTSP_THREAD (thread));
+  fail_unless (gst_structure_has_name (stats,
+          "application/x-rtsp-thread-stats"));
+  g_atomic_int_inc (n_stats);
+}
+
+GST_START_TEST (test_pool_stats)
+{
+  GstRTSPThreadPool *pool;
+  GstRTSPThread *thread;
+  GSource *source;
+  GstStructure *stats;
+  const GValue *threads;
+  const GstStructure *s;
+  guint64 iterations = 0;
+  gint n_stats = 0;
+  gint i;
+
+  pool = gst_rtsp_thread_pool_new ();
+  g_signal_connect (pool, "thread-stats", G_CALLBACK (thread_stats), &n_stats);
+
+  thread = gst_rtsp_thread_pool_get_thread (pool, GST_RTSP_THREAD_TYPE_CLIENT,
+      NULL);
+  fail_unless (GST_IS_RTSP_THREAD (thread));
+
+  /* the statistics are published when the mainloop wakes up after a second */
+  source = g_timeout_source_new (100);
+  g_source_set_callback (source, wake_up, NULL, NULL);
+  g_source_attach (source, thread->context);
+
+  for (i = 0; i < 50 && iterations == 0; i++) {
+    g_usleep (100 * 1000);
+
+    stats = gst_rtsp_thread_get_stats (thread);
+    fail_unless (gst_structure_has_name (stats,
+            "application/x-rtsp-thread-stats"));
+    fail_unless (gst_structure_get_uint64 (stats, "iterations", &iterations));
+    gst_structure_free (stats);
+  }
+  fail_unless (iterations > 0);
+
+  for (i = 0; i < 50 && g_atomic_int_get (&n_stats) == 0; i++)
+    g_usleep (100 * 1000);
+  fail_unless (g_atomic_int_get (&n_stats) > 0);
+
+  g_source_destroy (source);
+  g_source_unref (source);
+
+  stats = gst_rtsp_thread_pool_get_stats (pool);
+  fail_unless (gst_structure_has_name (stats,
+          "application/x-rtsp-thread-pool-stats"));
+
+  threads = gst_structure_get_value (stats, "client-threads");
+  fail_unless (GST_VALUE_HOLDS_ARRAY (threads));
+  fail_unless_equals_int (gst_value_array_get_size (threads), 1);
+  s = gst_value_get_structure (gst_value_array_get_value (threads, 0));
+  fail_unless_equals_string (gst_structure_get_string (s, "type"), "client");
+  fail_unless (gst_structure_has_field_typed (s, "latency-max",
+          G_TYPE_UINT64));
+  fail_unless (gst_structure_has_field_typed (s, "busy-client",
+          G_TYPE_UINT64));
+
+  threads = gst_structure_get_value (stats, "media-threads");
+  fail_unless (GST_VALUE_HOLDS_ARRAY (threads));
+  fail_unless_equals_int (gst_value_array_get_size (threads), 0);
+  gst_structure_free (stats);
+
+  gst_rtsp_thread_stop (thread);
+  g_object_unref (pool);
+  gst_rtsp_thread_pool_cleanup ();
+}
+
+GST_END_TEST;
+
+#ifdef CPU_SET
+static gboolean
+get_affinity (gpointer user_data)
+{
+  cpu_set_t *set = user_data;
+
+  g_mutex_lock (&check_mutex);
+  fail_unless (sched_getaffinity (0, sizeof (cpu_set_t), set) == 0);
+  g_cond_signal (&check_cond);
+  g_mutex_unlock (&check_mutex);
+
+  return G_SOURCE_REMOVE;
+}
+#endif
+
+GST_START_TEST (test_pool_cpus)
+{
+  GstRTSPThreadPool *pool;
+  GstRTSPThread *thread;
+  gchar *cpus;
+  gboolean colocate;
+
+  pool = gst_rtsp_thread_pool_new ();
+
+  cpus = gst_rtsp_thread_pool_get_cpus (pool, GST_RTSP_THREAD_TYPE_CLIENT);
+  fail_unless (cpus == NULL);
+
+  fail_if (gst_rtsp_thread_pool_set_cpus (pool, GST_RTSP_THREAD_TYPE_CLIENT,
+          "1-"));
+  fail_if (gst_rtsp_thread_pool_set_cpus (pool, GST_RTSP_THREAD_TYPE_CLIENT,
+          "3-1"));
+  fail_if (gst_rtsp_thread_pool_set_cpus (pool, GST_RTSP_THREAD_TYPE_CLIENT,
+          "a"));
+  fail_unless (gst_rtsp_thread_pool_set_cpus (pool,
+          GST_RTSP_THREAD_TYPE_MEDIA, "0-3, 8"));
+  fail_unless (gst_rtsp_thread_pool_set_cpus (pool,
+          GST_RTSP_THREAD_TYPE_CLIENT, "0"));
+
+  g_object_get (pool, "media-cpus", &cpus, NULL);
+  fail_unless_equals_string (cpus, "0-3, 8");
+  g_free (cpus);
+  cpus = gst_rtsp_thread_pool_get_cpus (pool, GST_RTSP_THREAD_TYPE_CLIENT);
+  fail_unless_equals_string (cpus, "0");
+  g_free (cpus);
+
+  g_object_set (pool, "colocate-media", TRUE, NULL);
+  g_object_get (pool, "colocate-media", &colocate, NULL);
+  fail_unless (colocate);
+
+  thread = gst_rtsp_thread_pool_get_thread (pool, GST_RTSP_THREAD_TYPE_CLIENT,
+      NULL);
+  fail_unless (GST_IS_RTSP_THREAD (thread));
+
+#ifdef CPU_SET
+  {
+    cpu_set_t set;
+    GSource *source;
+
+    CPU_ZERO (&set);
+    source = g_idle_source_new ();
+    g_source_set_callback (source, get_affinity, &set, NULL);
+
+    g_mutex_lock (&check_mutex);
+    g_source_attach (source, thread->context);
+    while (CPU_COUNT (&set) == 0)
+      g_cond_wait (&check_cond, &check_mutex);
+    g_mutex_unlock (&check_mutex);
+    g_source_unref (source);
+
+    /* the client thread only runs on CPU 0 */
+    fail_unless_equals_int (CPU_COUNT (&set), 1);
+    fail_unless (CPU_ISSET (0, &set));
+  }
+#endif
+
+  gst_rtsp_thread_stop (thread);
+  g_object_unref (pool);
+  gst_rtsp_thread_pool_cleanup ();
+}
+
+GST_END_TEST;
+
 static Suite *
 rtspthreadpool_suite (void)
 {
@@ -229,6 +527,10 @@ rtspthreadpool_suite (void)
   tcase_add_test (tc, test_pool_max_threads);
   tcase_add_test (tc, test_pool_max_threads_property);
   tcase_add_test (tc, test_pool_thread_copy);
+  tcase_add_test (tc, test_pool_least_loaded);
+  tcase_add_test (tc, test_pool_cpus);
+  tcase_add_test (tc, test_pool_max_media_threads);
+  tcase_add_test (tc, test_pool_stats);
 
   return s;
 }
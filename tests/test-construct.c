@@ -0,0 +1,136 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/* Constructs the same media many times, once with a factory that parses the
+ * launch line for every media and once with the default factory that parses
+ * it once and copies the result, and prints the average construct time. */
+
+#include <gst/gst.h>
+
+#include <gst/rtsp-server/rtsp-server.h>
+
+#define N_CONSTRUCT     1000
+
+#define LAUNCH "( videotestsrc pattern=ball is-live=true ! " \
+    "video/x-raw,width=640,height=480,framerate=30/1 ! videoconvert ! " \
+    "queue max-size-buffers=2 ! rtpvrawpay pt=96 name=pay0 " \
+    "audiotestsrc wave=ticks is-live=true ! audio/x-raw,rate=48000 ! " \
+    "audioconvert ! audioresample ! queue ! rtpL16pay pt=97 name=pay1 )"
+
+#define TEST_TYPE_RTSP_MEDIA_FACTORY      (test_rtsp_media_factory_get_type ())
+
+GType test_rtsp_media_factory_get_type (void);
+
+typedef struct TestRTSPMediaFactoryClass TestRTSPMediaFactoryClass;
+typedef struct TestRTSPMediaFactory TestRTSPMediaFactory;
+
+struct TestRTSPMediaFactoryClass
+{
+  GstRTSPMediaFactoryClass parent;
+};
+
+struct TestRTSPMediaFactory
+{
+  GstRTSPMediaFactory parent;
+};
+
+static GstElement *parse_create_element (GstRTSPMediaFactory * factory,
+    const GstRTSPUrl * url);
+
+G_DEFINE_TYPE (TestRTSPMediaFactory, test_rtsp_media_factory,
+    GST_TYPE_RTSP_MEDIA_FACTORY);
+
+static void
+test_rtsp_media_factory_class_init (TestRTSPMediaFactoryClass * test_klass)
+{
+  GstRTSPMediaFactoryClass *klass = (GstRTSPMediaFactoryClass *) (test_klass);
+  klass->create_element = parse_create_element;
+}
+
+static void
+test_rtsp_media_factory_init (TestRTSPMediaFactory * factory)
+{
+}
+
+/* what the default factory did before it kept the parsed launch line */
+static GstElement *
+parse_create_element (GstRTSPMediaFactory * factory, const GstRTSPUrl * url)
+{
+  GstElement *element;
+  gchar *launch;
+
+  launch = gst_rtsp_media_factory_get_launch (factory);
+  element = gst_parse_launch_full (launch, NULL, GST_PARSE_FLAG_PLACE_IN_BIN,
+      NULL);
+  g_free (launch);
+
+  return element;
+}
+
+static gboolean
+run (GstRTSPMediaFactory * factory, const gchar * name)
+{
+  GstRTSPUrl *url;
+  gint64 start, elapsed;
+  guint i;
+
+  gst_rtsp_media_factory_set_launch (factory, LAUNCH);
+  gst_rtsp_url_parse ("rtsp://localhost:8554/test", &url);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_CONSTRUCT; i++) {
+    GstRTSPMedia *media;
+
+    media = gst_rtsp_media_factory_construct (factory, url);
+    if (media == NULL)
+      goto construct_failed;
+    g_object_unref (media);
+  }
+  elapsed = g_get_monotonic_time () - start;
+
+  g_print ("%-8s: %u constructs in %" G_GINT64_FORMAT " ms, "
+      "%.1f us per construct\n", name, N_CONSTRUCT, elapsed / 1000,
+      (gdouble) elapsed / N_CONSTRUCT);
+
+  gst_rtsp_url_free (url);
+  g_object_unref (factory);
+
+  return TRUE;
+
+  /* ERRORS */
+construct_failed:
+  {
+    g_print ("could not construct media, are the elements installed?\n");
+    gst_rtsp_url_free (url);
+    g_object_unref (factory);
+    return FALSE;
+  }
+}
+
+int
+main (int argc, char *argv[])
+{
+  gst_init (&argc, &argv);
+
+  if (!run (g_object_new (TEST_TYPE_RTSP_MEDIA_FACTORY, NULL), "parse") ||
+      !run (gst_rtsp_media_factory_new (), "template"))
+    return -1;
+
+  return 0;
+}
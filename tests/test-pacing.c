@@ -0,0 +1,199 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Streams large frames to a UDP socket on the loopback interface, once
+ * through the udpsink without pacing and once with pacing, and prints the
+ * size of the bursts of packets that arrive back-to-back. */
+
+#include <gst/gst.h>
+
+#include <gst/rtsp-server/rtsp-server.h>
+
+#define N_FRAMES        90
+#define FRAME_SIZE      (64 * 1024)
+#define FRAME_INTERVAL  (GST_SECOND / 30)
+/* packets that arrive within this many microseconds of each other are part
+ * of the same burst */
+#define BURST_GAP       50
+
+static gpointer
+push_frames (GstElement * appsrc)
+{
+  GstFlowReturn ret;
+  guint i;
+
+  for (i = 0; i < N_FRAMES; i++) {
+    GstBuffer *buffer;
+
+    buffer = gst_buffer_new_allocate (NULL, FRAME_SIZE, NULL);
+    gst_buffer_memset (buffer, 0, i, FRAME_SIZE);
+    GST_BUFFER_PTS (buffer) = i * FRAME_INTERVAL;
+    GST_BUFFER_DURATION (buffer) = FRAME_INTERVAL;
+
+    g_signal_emit_by_name (appsrc, "push-buffer", buffer, &ret);
+    gst_buffer_unref (buffer);
+    if (ret != GST_FLOW_OK)
+      break;
+  }
+  g_signal_emit_by_name (appsrc, "end-of-stream", &ret);
+
+  return NULL;
+}
+
+static gboolean
+run (gboolean pacing)
+{
+  GstElement *pipeline, *appsrc, *pay, *rtpbin;
+  GstPad *srcpad;
+  GstRTSPStream *stream;
+  GstRTSPAddressPool *pool;
+  GstRTSPTransport *tr;
+  GstRTSPStreamTransport *trans;
+  GSocket *socket;
+  GSocketAddress *addr;
+  GInetAddress *loopback;
+  GThread *thread;
+  gchar data[2048];
+  gint64 last = 0;
+  guint port, n_packets = 0, n_bursts = 0, burst = 0, max_burst = 0;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  addr = g_inet_socket_address_new (loopback, 0);
+  g_object_unref (loopback);
+  if (socket == NULL || !g_socket_bind (socket, addr, FALSE, NULL))
+    goto no_socket;
+  g_object_unref (addr);
+  addr = g_socket_get_local_address (socket, NULL);
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr));
+  g_object_unref (addr);
+
+  pipeline = gst_pipeline_new (NULL);
+  appsrc = gst_element_factory_make ("appsrc", NULL);
+  pay = gst_element_factory_make ("rtpgstpay", NULL);
+  rtpbin = gst_element_factory_make ("rtpbin", NULL);
+  if (appsrc == NULL || pay == NULL || rtpbin == NULL)
+    goto no_elements;
+  g_object_set (appsrc, "format", GST_FORMAT_TIME, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), appsrc, pay, rtpbin, NULL);
+  gst_element_link (appsrc, pay);
+
+  srcpad = gst_element_get_static_pad (pay, "src");
+  stream = gst_rtsp_stream_new (0, pay, srcpad);
+  gst_object_unref (srcpad);
+
+  pool = gst_rtsp_address_pool_new ();
+  gst_rtsp_address_pool_add_range (pool, GST_RTSP_ADDRESS_POOL_ANY_IPV4,
+      GST_RTSP_ADDRESS_POOL_ANY_IPV4, 50000, 60000, 0);
+  gst_rtsp_stream_set_address_pool (stream, pool);
+  g_object_unref (pool);
+
+  /* pacing alone switches the unicast destinations to the sender */
+  gst_rtsp_stream_set_pacing (stream, pacing);
+  if (!gst_rtsp_stream_join_bin (stream, GST_BIN (pipeline), rtpbin,
+          GST_STATE_NULL))
+    goto join_failed;
+
+  gst_rtsp_transport_new (&tr);
+  tr->lower_transport = GST_RTSP_LOWER_TRANS_UDP;
+  tr->destination = g_strdup ("127.0.0.1");
+  tr->client_port.min = port;
+  tr->client_port.max = port + 1;
+  trans = gst_rtsp_stream_transport_new (stream, tr);
+  gst_rtsp_stream_add_transport (stream, trans);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  thread = g_thread_new ("push", (GThreadFunc) push_frames, appsrc);
+
+  /* receive until the stream is quiet for a second */
+  while (g_socket_condition_timed_wait (socket, G_IO_IN, G_USEC_PER_SEC,
+          NULL)) {
+    gint64 now;
+
+    if (g_socket_receive (socket, data, sizeof (data), NULL, NULL) <= 0)
+      continue;
+
+    now = g_get_monotonic_time ();
+    if (n_packets == 0 || now - last > BURST_GAP) {
+      n_bursts++;
+      burst = 0;
+    }
+    burst++;
+    max_burst = MAX (max_burst, burst);
+    last = now;
+    n_packets++;
+  }
+
+  g_thread_join (thread);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_rtsp_stream_remove_transport (stream, trans);
+  g_object_unref (trans);
+  gst_rtsp_stream_leave_bin (stream, GST_BIN (pipeline), rtpbin);
+  gst_object_unref (stream);
+  gst_object_unref (pipeline);
+  g_object_unref (socket);
+
+  g_print ("pacing %-3s: %u packets in %u bursts, average burst %.1f, "
+      "largest burst %u\n", pacing ? "on" : "off", n_packets, n_bursts,
+      n_bursts ? (gdouble) n_packets / n_bursts : 0.0, max_burst);
+
+  return TRUE;
+
+  /* ERRORS */
+no_socket:
+  {
+    g_print ("could not bind a socket on the loopback interface\n");
+    if (socket)
+      g_object_unref (socket);
+    g_object_unref (addr);
+    return FALSE;
+  }
+no_elements:
+  {
+    g_print ("appsrc, rtpgstpay and rtpbin are needed\n");
+    if (appsrc)
+      gst_object_unref (appsrc);
+    if (pay)
+      gst_object_unref (pay);
+    if (rtpbin)
+      gst_object_unref (rtpbin);
+    gst_object_unref (pipeline);
+    g_object_unref (socket);
+    return FALSE;
+  }
+join_failed:
+  {
+    g_print ("could not join the stream to the pipeline\n");
+    gst_object_unref (stream);
+    gst_object_unref (pipeline);
+    g_object_unref (socket);
+    return FALSE;
+  }
+}
+
+int
+main (int argc, char *argv[])
+{
+  gst_init (&argc, &argv);
+
+  if (!run (FALSE) || !run (TRUE))
+    return -1;
+
+  return 0;
+}